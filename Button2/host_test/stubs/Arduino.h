@@ -0,0 +1,17 @@
+#pragma once
+// host stub : the replay owns the clock and the pin levels ( see test_button2_replay.cpp )
+#include <stdint.h>
+#include <functional>
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 1
+#define INPUT_PULLUP 2
+
+extern unsigned long replayMs;
+extern int replayLevel[64];
+
+inline unsigned long millis() { return replayMs; }
+inline int digitalRead(uint8_t pin) { return replayLevel[pin & 63]; }
+inline void pinMode(uint8_t, uint8_t) {}
+inline int touchRead(uint8_t) { return 100; }
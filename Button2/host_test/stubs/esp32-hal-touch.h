@@ -0,0 +1,2 @@
+#pragma once
+// host stub : touchRead() is in Arduino.h
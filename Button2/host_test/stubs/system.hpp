@@ -0,0 +1,2 @@
+#pragma once
+// host stub : nothing of system.hpp is used by Button2
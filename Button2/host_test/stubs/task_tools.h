@@ -0,0 +1,13 @@
+#pragma once
+// host stub : the replay calls Button2::loop() itself, the task never starts
+#include <chrono>
+#include <thread>
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+class Task
+{
+public:
+    Task(const char *, int, int, int, bool) {}
+    int StartTask(void * = nullptr) { return 0; }
+};
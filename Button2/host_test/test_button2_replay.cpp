@@ -0,0 +1,169 @@
+/**
+ * @file test_button2_replay.cpp
+ * @brief Button2Engine against Button2::loop() : recorded edges ( random presses with contact bounce ) are
+ * sampled every 10 ms like Button2::run, both must report the same gestures at the same time
+ * ( ./host_test/run.sh button2 )
+ */
+#include "Button2.h"
+#include "Button2Engine.h"
+#include "host_test.hpp"
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+unsigned long replayMs = 0;
+int replayLevel[64] = {};
+
+using Log_t = std::vector<std::string>;
+static const char *const EVENT_NAME[] = {"changed", "pressed", "released", "tap", "click", "double", "triple", "long", "longdet"};
+
+static void Record(Log_t &log, uint16_t button, const char *name)
+{
+    log.push_back(std::to_string(button) + ":" + name + "@" + std::to_string(replayMs));
+}
+
+// the reference : one Button2 per pin, every handler logs
+struct Reference_t
+{
+    Button2 button;
+    uint16_t index;
+    Log_t &log;
+    Reference_t(uint8_t pin, uint16_t _index, bool retrigger, Log_t &_log) : button(pin), index(_index), log(_log)
+    {
+        button.setLongClickDetectedRetriggerable(retrigger);
+        button.setChangedHandler([this](Button2 &) { Record(log, index, "changed"); });
+        button.setPressedHandler([this](Button2 &) { Record(log, index, "pressed"); });
+        button.setReleasedHandler([this](Button2 &) { Record(log, index, "released"); });
+        button.setTapHandler([this](Button2 &) { Record(log, index, "tap"); });
+        button.setClickHandler([this](Button2 &) { Record(log, index, "click"); });
+        button.setDoubleClickHandler([this](Button2 &) { Record(log, index, "double"); });
+        button.setTripleClickHandler([this](Button2 &) { Record(log, index, "triple"); });
+        button.setLongClickHandler([this](Button2 &) { Record(log, index, "long"); });
+        button.setLongClickDetectedHandler([this](Button2 &) { Record(log, index, "longdet"); });
+    }
+};
+
+static void EngineRecord(void *ctx, uint16_t button, Button2Engine::Event_t event)
+{
+    Record(*static_cast<Log_t *>(ctx), button, EVENT_NAME[event]);
+}
+
+using Edges_t = std::vector<std::pair<unsigned long, int>>;
+
+// 40 presses of 5 .. 900 ms, up to 3 bounces of 1 .. 15 ms before each
+static Edges_t RecordEdges(std::mt19937 &rng, unsigned long startMs)
+{
+    Edges_t edges;
+    unsigned long t = startMs;
+    auto between = [&rng](int low, int high) { return std::uniform_int_distribution<int>(low, high)(rng); };
+    for (int press = 0; press < 40; press++)
+    {
+        t += between(5, 700);
+        const int bounces = between(0, 3);
+        for (int b = 0; b < bounces; b++)
+        {
+            edges.push_back({t, LOW});
+            t += between(1, 15);
+            edges.push_back({t, HIGH});
+            t += between(1, 15);
+        }
+        edges.push_back({t, LOW});
+        t += between(5, 900);
+        edges.push_back({t, HIGH});
+    }
+    return edges;
+}
+
+static size_t FirstDifference(const Log_t &a, const Log_t &b)
+{
+    size_t i = 0;
+    while (i < a.size() && i < b.size() && a[i] == b[i])
+    {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * @brief \c buttons pins replayed together : one Button2 each, one engine for all of them
+ * @return events compared, the first mismatch is printed
+ */
+static size_t Replay(uint32_t seed, uint16_t buttons, bool &identical)
+{
+    std::mt19937 rng(seed);
+    const bool retrigger = seed & 1;
+    Log_t expected;
+    Log_t got;
+    replayMs = 1000;
+    std::vector<Edges_t> edges;
+    std::vector<std::unique_ptr<Reference_t>> reference;
+    unsigned long endMs = 0;
+    for (uint16_t i = 0; i < buttons; i++)
+    {
+        replayLevel[i] = HIGH;
+        reference.emplace_back(new Reference_t(i, i, retrigger, expected));
+        edges.push_back(RecordEdges(rng, replayMs));
+        endMs = std::max(endMs, edges.back().back().first);
+    }
+    Button2Engine::Profile_t profile;
+    profile.longClickRetriggerable = retrigger;
+    std::vector<Button2Engine::State_t> states(buttons);
+    Button2Engine engine(states.data(), buttons, profile, EngineRecord, &got);
+
+    std::vector<size_t> next(buttons, 0);
+    bool typesMatch = true;
+    for (replayMs = 1000; replayMs < endMs + 2000; replayMs += 10)
+    {
+        for (uint16_t i = 0; i < buttons; i++)
+        {
+            while (next[i] < edges[i].size() && edges[i][next[i]].first <= replayMs)
+            {
+                replayLevel[i] = edges[i][next[i]++].second;
+            }
+            reference[i]->button.loop();
+            engine.Feed(i, replayLevel[i] == LOW, replayMs);
+            typesMatch &= (engine.GetClickType(i) == reference[i]->button.getClickType());
+            typesMatch &= (engine.IsPressed(i) == reference[i]->button.isPressed());
+        }
+    }
+    identical = (expected == got) && typesMatch;
+    if (!identical)
+    {
+        const size_t i = FirstDifference(expected, got);
+        printf("seed %u : Button2 %s, engine %s ( event %zu, click types %s )\n", seed,
+               i < expected.size() ? expected[i].c_str() : "-", i < got.size() ? got[i].c_str() : "-", i,
+               typesMatch ? "match" : "differ");
+    }
+    return expected.size();
+}
+
+int main()
+{
+    size_t events = 0;
+    int mismatches = 0;
+    for (uint32_t seed = 0; seed < 2000; seed++)
+    {
+        bool identical = false;
+        events += Replay(seed, 1, identical);
+        mismatches += !identical;
+    }
+    printf("1 button : 2000 replays, %zu events\n", events);
+    CHECK_EQ(mismatches, 0);
+    CHECK(events > 100000);
+
+    // buttons sharing one engine must not see each other
+    events = 0;
+    mismatches = 0;
+    for (uint32_t seed = 0; seed < 50; seed++)
+    {
+        bool identical = false;
+        events += Replay(10000 + seed, 16, identical);
+        mismatches += !identical;
+    }
+    printf("16 buttons per engine : 50 replays, %zu events\n", events);
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(sizeof(Button2Engine::State_t), 12u);
+    HOST_TEST_END();
+}
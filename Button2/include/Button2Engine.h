@@ -0,0 +1,109 @@
+/////////////////////////////////////////////////////////////////
+/*
+  Button2Engine.h - Button2 gestures for many buttons, without allocation.
+*/
+/////////////////////////////////////////////////////////////////
+#pragma once
+
+#ifndef Button2Engine_h
+#define Button2Engine_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/////////////////////////////////////////////////////////////////
+#ifndef DEBOUNCE_MS
+#define DEBOUNCE_MS 50
+#define LONGCLICK_MS 200
+#define DOUBLECLICK_MS 300
+#endif
+
+/////////////////////////////////////////////////////////////////
+/*
+  Same gestures as Button2::loop(), one call of Feed() is one call of loop() :
+  a button is 12 bytes of State_t, callbacks are one function pointer + context per engine,
+  and gesture detection is a constexpr table over (phase, edge, elapsed bucket).
+  buttons can be real pins, or virtual ones fed from MQTT / BLE remotes.
+
+    static Button2Engine::State_t remotes[200];
+    Button2Engine engine(remotes, 200, Button2Engine::Profile_t(), onGesture, this);
+    engine.Feed(index, pressed, millis());   // on every sample / remote report
+    engine.Tick(millis());                   // every 10 ms, for the timeouts
+*/
+class Button2Engine {
+  public:
+  enum Event_t : uint8_t {
+    ON_CHANGED,
+    ON_PRESSED,
+    ON_RELEASED,
+    ON_TAP,
+    ON_CLICK,
+    ON_DOUBLE_CLICK,
+    ON_TRIPLE_CLICK,
+    ON_LONG_CLICK,
+    ON_LONG_DETECTED,
+  };
+  typedef void (*Callback_t)(void* ctx, uint16_t button, Event_t event);
+
+  // timings shared by the buttons of an engine
+  struct Profile_t {
+    uint16_t debounceMs = DEBOUNCE_MS;
+    uint16_t longClickMs = LONGCLICK_MS;
+    uint16_t doubleClickMs = DOUBLECLICK_MS;
+    bool longClickRetriggerable = false;
+  };
+
+  struct State_t {
+    uint32_t downMs = 0;   // press start
+    uint32_t clickMs = 0;  // click window start, 0 once reported
+    uint16_t downTime = 0; // last press length, saturated
+    uint8_t phase : 2;
+    uint8_t clicks : 4;
+    uint8_t longFlag : 1;
+    uint8_t longReported : 1;
+    uint8_t longCounter : 5;
+    uint8_t clickType : 3;
+    State_t() : phase(0), clicks(0), longFlag(0), longReported(0), longCounter(0), clickType(0) {}
+  };
+
+  // caller owned storage : nothing is allocated
+  Button2Engine(State_t* states, uint16_t count, const Profile_t& profile, Callback_t callback, void* ctx);
+
+  void Feed(uint16_t button, bool pressed, uint32_t nowMs);
+  // one loop for every button at its current level
+  void Tick(uint32_t nowMs);
+  void Reset(uint16_t button);
+
+  bool IsPressed(uint16_t button) const;
+  uint8_t GetNumberOfClicks(uint16_t button) const;
+  // SINGLE_CLICK .. LONG_CLICK of Button2.h, 0 before the first gesture
+  uint8_t GetClickType(uint16_t button) const;
+  uint16_t WasPressedFor(uint16_t button) const;
+  uint16_t GetCount() const { return count; }
+  const Profile_t& GetProfile() const { return profile; }
+
+  private:
+  State_t* states;
+  const uint16_t count;
+  const Profile_t profile;
+  const Callback_t callback;
+  void* const ctx;
+
+  void Emit(uint16_t button, Event_t event);
+  uint8_t Bucket(const State_t& state, uint8_t input, uint32_t nowMs) const;
+};
+
+/////////////////////////////////////////////////////////////////
+// engine with its storage
+template <uint16_t N>
+class Button2Bank : public Button2Engine {
+  public:
+  Button2Bank(const Profile_t& profile, Callback_t callback, void* ctx) : Button2Engine(storage, N, profile, callback, ctx) {}
+
+  private:
+  State_t storage[N];
+};
+
+/////////////////////////////////////////////////////////////////
+#endif
+/////////////////////////////////////////////////////////////////
@@ -0,0 +1,190 @@
+/////////////////////////////////////////////////////////////////
+/*
+  Button2Engine.cpp - Button2 gestures for many buttons, without allocation.
+*/
+/////////////////////////////////////////////////////////////////
+
+#include "Button2Engine.h"
+
+/////////////////////////////////////////////////////////////////
+// LONG_CLICK click type of Button2.h, 1 .. 3 are the click counts
+#define ENGINE_LONG_CLICK 4
+
+namespace {
+
+// phase : level seen by the previous loop, and whether the press was reported
+enum Phase_t : uint8_t { PHASE_UP, PHASE_DOWN, PHASE_HELD, PHASE_COUNT };
+// edge between the previous loop and this one
+enum Input_t : uint8_t { INPUT_NONE, INPUT_PRESS, INPUT_RELEASE, INPUT_COUNT };
+// elapsed bucket, 2 bits :
+//  down phases, no edge : bit 0 since press >= debounce, bit 1 since press >= long click ( x retrigger count )
+//  release : bit 0 press length >= debounce, bit 1 press length >= long click
+//  up phase, no edge : bit 0 since the click window start > double click
+constexpr uint8_t BUCKET_COUNT = 4;
+
+// actions, in the order Button2::loop() runs them
+enum Action_t : uint8_t {
+  ACT_MARK_DOWN = 1 << 0,    // press edge : start the press and the click window
+  ACT_TRIGGER = 1 << 1,      // debounced press : count the click, ON_CHANGED + ON_PRESSED
+  ACT_DOWN_TIME = 1 << 2,    // release edge : keep the press length
+  ACT_RELEASE = 1 << 3,      // debounced release : ON_CHANGED + ON_RELEASED + ON_TAP
+  ACT_LONG_FLAG = 1 << 4,    // the released press was a long one
+  ACT_REPORT = 1 << 5,       // click window over : ON_CLICK / DOUBLE / TRIPLE / LONG_CLICK
+  ACT_LONG_DETECT = 1 << 6,  // still pressed after the long click time : ON_LONG_DETECTED
+};
+
+struct Transition_t {
+  uint8_t next;
+  uint8_t actions;
+};
+
+constexpr Transition_t T(uint8_t next, uint8_t actions = 0) { return Transition_t{next, actions}; }
+
+constexpr Transition_t TABLE[PHASE_COUNT][INPUT_COUNT][BUCKET_COUNT] = {
+  // PHASE_UP
+  {
+    {T(PHASE_UP), T(PHASE_UP, ACT_REPORT), T(PHASE_UP), T(PHASE_UP, ACT_REPORT)},
+    {T(PHASE_DOWN, ACT_MARK_DOWN), T(PHASE_DOWN, ACT_MARK_DOWN), T(PHASE_DOWN, ACT_MARK_DOWN), T(PHASE_DOWN, ACT_MARK_DOWN)},
+    {T(PHASE_UP), T(PHASE_UP), T(PHASE_UP), T(PHASE_UP)}, // no release while up
+  },
+  // PHASE_DOWN
+  {
+    {T(PHASE_DOWN), T(PHASE_HELD, ACT_TRIGGER), T(PHASE_DOWN, ACT_LONG_DETECT), T(PHASE_HELD, ACT_TRIGGER | ACT_LONG_DETECT)},
+    {T(PHASE_DOWN), T(PHASE_DOWN), T(PHASE_DOWN), T(PHASE_DOWN)}, // no press while down
+    {T(PHASE_UP, ACT_DOWN_TIME), T(PHASE_UP, ACT_DOWN_TIME | ACT_RELEASE), T(PHASE_UP, ACT_DOWN_TIME), T(PHASE_UP, ACT_DOWN_TIME | ACT_RELEASE | ACT_LONG_FLAG)},
+  },
+  // PHASE_HELD
+  {
+    {T(PHASE_HELD), T(PHASE_HELD), T(PHASE_HELD, ACT_LONG_DETECT), T(PHASE_HELD, ACT_LONG_DETECT)},
+    {T(PHASE_HELD), T(PHASE_HELD), T(PHASE_HELD), T(PHASE_HELD)}, // no press while down
+    {T(PHASE_UP, ACT_DOWN_TIME), T(PHASE_UP, ACT_DOWN_TIME | ACT_RELEASE), T(PHASE_UP, ACT_DOWN_TIME), T(PHASE_UP, ACT_DOWN_TIME | ACT_RELEASE | ACT_LONG_FLAG)},
+  },
+};
+
+}  // namespace
+
+/////////////////////////////////////////////////////////////////
+
+Button2Engine::Button2Engine(State_t* _states, uint16_t _count, const Profile_t& _profile, Callback_t _callback, void* _ctx)
+    : states(_states), count(_count), profile(_profile), callback(_callback), ctx(_ctx) {
+}
+
+/////////////////////////////////////////////////////////////////
+
+void Button2Engine::Emit(uint16_t button, Event_t event) {
+  if (callback != nullptr) callback(ctx, button, event);
+}
+
+/////////////////////////////////////////////////////////////////
+
+uint8_t Button2Engine::Bucket(const State_t& state, uint8_t input, uint32_t nowMs) const {
+  if (state.phase == PHASE_UP) {
+    return (nowMs - state.clickMs > profile.doubleClickMs) ? 1 : 0;
+  }
+  const uint32_t elapsed = nowMs - state.downMs;
+  const uint32_t longMs = (input == INPUT_RELEASE) ? profile.longClickMs : static_cast<uint32_t>(profile.longClickMs) * (state.longCounter + 1);
+  return ((elapsed >= profile.debounceMs) ? 1 : 0) | ((elapsed >= longMs) ? 2 : 0);
+}
+
+/////////////////////////////////////////////////////////////////
+
+void Button2Engine::Feed(uint16_t button, bool pressed, uint32_t nowMs) {
+  if (button >= count) return;
+  State_t& state = states[button];
+  const bool wasPressed = state.phase != PHASE_UP;
+  const uint8_t input = (pressed == wasPressed) ? INPUT_NONE : (pressed ? INPUT_PRESS : INPUT_RELEASE);
+  const Transition_t& transition = TABLE[state.phase][input][Bucket(state, input, nowMs)];
+  const uint8_t actions = transition.actions;
+  state.phase = transition.next;
+  if (actions == 0) return;
+
+  if (actions & ACT_MARK_DOWN) {
+    state.downMs = nowMs;
+    state.clickMs = nowMs;
+  }
+  if (actions & ACT_TRIGGER) {
+    if (state.clicks < 15) state.clicks++;
+    Emit(button, ON_CHANGED);
+    Emit(button, ON_PRESSED);
+  }
+  if (actions & ACT_DOWN_TIME) {
+    const uint32_t downTime = nowMs - state.downMs;
+    state.downTime = (downTime > UINT16_MAX) ? UINT16_MAX : downTime;
+  }
+  if (actions & ACT_RELEASE) {
+    Emit(button, ON_CHANGED);
+    Emit(button, ON_RELEASED);
+    Emit(button, ON_TAP);
+  }
+  if (actions & ACT_LONG_FLAG) {
+    state.longFlag = 1;
+  }
+  if (actions & ACT_REPORT) {
+    if (state.longFlag) {
+      // a long press inside a multi click is not reported
+      if (state.clicks == 1) {
+        state.clickType = ENGINE_LONG_CLICK;
+        Emit(button, ON_LONG_CLICK);
+      }
+      state.longFlag = 0;
+      state.longReported = 0;
+      state.longCounter = 0;
+    }
+    else if (state.clicks > 0 && state.clicks <= 3) {
+      static const Event_t CLICK_EVENT[] = {ON_CLICK, ON_DOUBLE_CLICK, ON_TRIPLE_CLICK};
+      state.clickType = state.clicks;
+      Emit(button, CLICK_EVENT[state.clicks - 1]);
+    }
+    state.clicks = 0;
+    state.clickMs = 0;
+  }
+  if ((actions & ACT_LONG_DETECT) && !state.longReported) {
+    state.longReported = 1;
+    state.longFlag = 1;
+    if (profile.longClickRetriggerable && state.longCounter < 31) {
+      state.longCounter++;
+      state.longReported = 0;
+    }
+    Emit(button, ON_LONG_DETECTED);
+  }
+}
+
+/////////////////////////////////////////////////////////////////
+
+void Button2Engine::Tick(uint32_t nowMs) {
+  for (uint16_t button = 0; button < count; button++) {
+    Feed(button, states[button].phase != PHASE_UP, nowMs);
+  }
+}
+
+/////////////////////////////////////////////////////////////////
+
+void Button2Engine::Reset(uint16_t button) {
+  if (button < count) states[button] = State_t();
+}
+
+/////////////////////////////////////////////////////////////////
+
+bool Button2Engine::IsPressed(uint16_t button) const {
+  return (button < count) && states[button].phase != PHASE_UP;
+}
+
+/////////////////////////////////////////////////////////////////
+
+uint8_t Button2Engine::GetNumberOfClicks(uint16_t button) const {
+  return (button < count) ? states[button].clicks : 0;
+}
+
+/////////////////////////////////////////////////////////////////
+
+uint8_t Button2Engine::GetClickType(uint16_t button) const {
+  return (button < count) ? states[button].clickType : 0;
+}
+
+/////////////////////////////////////////////////////////////////
+
+uint16_t Button2Engine::WasPressedFor(uint16_t button) const {
+  return (button < count) ? states[button].downTime : 0;
+}
+
+/////////////////////////////////////////////////////////////////
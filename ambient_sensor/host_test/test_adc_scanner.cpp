@@ -0,0 +1,117 @@
+/**
+ * @file test_adc_scanner.cpp
+ * @brief AdcScanner with a scripted backend : a failed conversion skips only its channel, and removing
+ * the last channel while the timer scans does not deadlock ( ./host_test/run.sh adc_scanner )
+ */
+#include "adc_scanner.hpp"
+#include "host_test.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// every channel reads \c value, the channels in \c failing fail
+struct ScriptBackend_t : public AdcBackend
+{
+    std::atomic<uint32_t> value{1000};
+    std::atomic<uint32_t> failing{0}; // bit n : channel n
+    std::atomic<uint32_t> reads{0};
+
+    esp_err_t ConfigureChannel(uint8_t channel) override { return ESP_OK; }
+    esp_err_t Read(const uint8_t *channels, size_t count, uint32_t *raw) override
+    {
+        reads++;
+        esp_err_t ret = ESP_OK;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (failing & (1 << channels[i]))
+            {
+                raw[i] = INVALID;
+                ret = ESP_FAIL;
+                continue;
+            }
+            raw[i] = value;
+        }
+        return ret;
+    }
+};
+
+struct Changes_t
+{
+    std::atomic<int> events{0};
+    static void Handler(void *ctx, const AdcEvent_t &event)
+    {
+        static_cast<Changes_t *>(ctx)->events++;
+    }
+};
+
+static void TestReadError()
+{
+    ScriptBackend_t backend;
+    AdcScanner scanner(backend, 100000, 100000); // the timer stays out of the way, ScanOnce() below
+    Changes_t changes[2];
+    AdcChannelConfig_t config;
+    config.window = 1;
+    config.median = false;
+    uint8_t ok = 0, bad = 0;
+    CHECK_EQ(scanner.AddChannel(0, Changes_t::Handler, &changes[0], config, &ok), ESP_OK);
+    CHECK_EQ(scanner.AddChannel(1, Changes_t::Handler, &changes[1], config, &bad), ESP_OK);
+    scanner.ScanOnce();
+    CHECK_EQ(scanner.GetValue(bad), 1000u);
+
+    backend.failing = 1 << 1;
+    backend.value = 3000;
+    CHECK(scanner.ScanOnce());
+    CHECK_EQ(scanner.GetValue(ok), 3000u);
+    CHECK_EQ(scanner.GetRaw(ok), 3000u);
+    // the failed channel keeps its last scan : no event, no INVALID in its value
+    CHECK_EQ(scanner.GetValue(bad), 1000u);
+    CHECK_EQ(scanner.GetRaw(bad), 1000u);
+    CHECK_EQ(changes[0].events.load(), 1);
+    CHECK_EQ(changes[1].events.load(), 0);
+    CHECK_EQ(scanner.GetStats().readErrors, 1u);
+
+    backend.failing = 0;
+    scanner.ScanOnce();
+    CHECK_EQ(scanner.GetValue(bad), 3000u);
+    CHECK_EQ(changes[1].events.load(), 1);
+    scanner.Stop();
+}
+
+static void TestRemoveWhileScanning()
+{
+    ScriptBackend_t backend;
+    AdcScanner scanner(backend, 1, 1);
+    std::atomic<int> done{0};
+    std::thread remover([&]()
+                        {
+        for (int i = 0; i < 100; i++)
+        {
+            uint8_t id = 0;
+            scanner.AddChannel(i % AdcBackend::MAX_CHANNELS, nullptr, nullptr, AdcChannelConfig_t(), &id);
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+            // the last channel : Remove() stops the timer, whose callback may be scanning
+            scanner.Remove(id);
+        }
+        done = 1; });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (!done && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK(done);
+    if (!done)
+    {
+        printf("Remove() deadlocked against the scan\n");
+        fflush(stdout);
+        _Exit(1);
+    }
+    remover.join();
+    CHECK(backend.reads > 0);
+}
+
+int main()
+{
+    TestReadError();
+    TestRemoveWhileScanning();
+    HOST_TEST_END();
+}
@@ -0,0 +1,286 @@
+/**
+ * @file test_signal_filters.cpp
+ * @brief the filters against brute-force references, the change detector and the adaptive interval.
+ * the benchmark replays a 24 h light trace ( day ramp, clouds, lamp, noise, spikes ) through the old
+ * LightSensor scheme ( fixed period, window re-summed every sample ) and the filter pipeline with the
+ * adaptive period : reads, events and filter time ( ./host_test/run.sh signal_filters )
+ */
+#include "signal_filters.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+static void TestMovingAverage()
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> sample(0, 4095);
+    for (size_t size : {1, 3, 10, 30})
+    {
+        filters::MovingAverage<uint32_t, 30> average(size);
+        std::vector<uint32_t> seen;
+        int mismatches = 0;
+        for (int i = 0; i < 1000; i++)
+        {
+            seen.push_back(sample(rng));
+            const size_t n = std::min(seen.size(), size);
+            uint64_t sum = 0;
+            for (size_t k = seen.size() - n; k < seen.size(); k++)
+            {
+                sum += seen[k];
+            }
+            mismatches += (average.Update(seen.back()) != sum / n);
+        }
+        CHECK_EQ(mismatches, 0);
+        CHECK(average.Full());
+    }
+    // the window is clamped to 1 .. MAX_SIZE
+    filters::MovingAverage<uint32_t, 8> clamped(100);
+    CHECK_EQ(clamped.GetSize(), 8u);
+    clamped.SetSize(0);
+    CHECK_EQ(clamped.GetSize(), 1u);
+    CHECK_EQ(clamped.Update(7), 7u);
+    CHECK_EQ(clamped.Update(9), 9u);
+    const filters::MovingAverage<uint32_t, 8> empty;
+    CHECK_EQ(empty.Value(), 0u);
+}
+
+static void TestEma()
+{
+    filters::Ema ema(2);
+    CHECK_EQ(ema.Update(1000), 1000); // the first sample primes
+    double reference = 1000;
+    int worst = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        const int32_t sample = (i < 100) ? 3000 : -500;
+        reference += (sample - reference) / 4;
+        worst = std::max(worst, std::abs(ema.Update(sample) - static_cast<int32_t>(std::lround(reference))));
+    }
+    CHECK(worst <= 1);
+    CHECK(std::abs(ema.Value() + 500) <= 1);
+    ema.Reset();
+    CHECK_EQ(ema.Update(42), 42);
+    ema.SetShift(0); // clamped to 1
+    CHECK_EQ(ema.Update(44), 43);
+}
+
+template <size_t N>
+static void TestMedian(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> sample(0, 20); // duplicates on purpose
+    filters::MedianFilter<uint32_t, N> median;
+    std::vector<uint32_t> seen;
+    int mismatches = 0;
+    for (int i = 0; i < 5000; i++)
+    {
+        seen.push_back(sample(rng));
+        std::vector<uint32_t> window(seen.end() - std::min(seen.size(), N), seen.end());
+        std::sort(window.begin(), window.end());
+        mismatches += (median.Update(seen.back()) != window[window.size() / 2]);
+    }
+    CHECK_EQ(mismatches, 0);
+    median.Reset();
+    CHECK_EQ(median.Value(), 0u);
+    CHECK_EQ(median.Update(5), 5u);
+}
+
+static void TestMedianSpike()
+{
+    filters::MedianFilter<uint32_t, 3> median;
+    median.Update(1000);
+    median.Update(1002);
+    CHECK_EQ(median.Update(4095), 1002u); // a single spike never passes
+    CHECK_EQ(median.Update(1001), 1002u);
+    CHECK_EQ(median.Update(1003), 1003u);
+}
+
+static void TestChangeDetector()
+{
+    const uint32_t thresholds[4] = {10, 50, 100, 200};
+    filters::ChangeDetector<uint32_t, 4> changes(thresholds);
+    uint32_t diff = 0;
+    CHECK_EQ(changes.Update(1000, &diff), 0u); // the first value is the reference
+    // noise inside the lowest band never fires
+    int fired = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        fired += changes.Update(1000 + (i % 2 ? 9 : -9)) != 0;
+    }
+    CHECK_EQ(fired, 0);
+    CHECK_EQ(changes.Update(1010, &diff), 1u);
+    CHECK_EQ(diff, 10u);
+    // a slow drift fires each level once per threshold crossed
+    int level[4] = {};
+    for (uint32_t value = 1010; value <= 1410; value++)
+    {
+        const uint32_t bits = changes.Update(value);
+        for (int i = 0; i < 4; i++)
+        {
+            level[i] += (bits >> i) & 1;
+        }
+    }
+    CHECK_EQ(level[0], 40);
+    CHECK_EQ(level[1], 8);
+    CHECK_EQ(level[2], 4);
+    CHECK_EQ(level[3], 2);
+    // a step fires every level at once, diff is the move of the lowest one
+    CHECK_EQ(changes.Update(0, &diff), 0xFu);
+    CHECK_EQ(diff, 1410u);
+    // downwards too, without unsigned wrap
+    CHECK_EQ(changes.Update(5), 0u);
+    changes.Reset();
+    CHECK_EQ(changes.Update(4000), 0u);
+}
+
+static void TestAdaptiveInterval()
+{
+    filters::AdaptiveInterval interval(500, 4000, 4);
+    CHECK_EQ(interval.Period(), 500u);
+    std::vector<uint32_t> periods;
+    for (int i = 0; i < 20; i++)
+    {
+        periods.push_back(interval.Update(false));
+    }
+    CHECK_EQ(periods[2], 500u);
+    CHECK_EQ(periods[3], 1000u); // doubles after 4 flat samples
+    CHECK_EQ(periods[7], 2000u);
+    CHECK_EQ(periods[11], 4000u);
+    CHECK_EQ(periods[19], 4000u); // capped
+    CHECK_EQ(interval.Update(true), 500u);
+    CHECK_EQ(interval.Update(false), 500u); // the flat count restarts too
+    // the cap is reached even when it is not a power of two of the minimum
+    interval.SetRange(300, 1000);
+    for (int i = 0; i < 12; i++)
+    {
+        interval.Update(false);
+    }
+    CHECK_EQ(interval.Period(), 1000u);
+    interval.SetRange(800, 100); // max below min
+    for (int i = 0; i < 8; i++)
+    {
+        interval.Update(false);
+    }
+    CHECK_EQ(interval.Period(), 800u);
+}
+
+// light on the sensor at \c ms of the day, 12 bits
+struct Trace_t
+{
+    std::mt19937 rng{15};
+    std::normal_distribution<double> noise{0, 6};
+    std::uniform_real_distribution<double> unit{0, 1};
+
+    uint32_t At(uint32_t ms)
+    {
+        const double hour = ms / 3600000.0;
+        double light = 150;
+        if (hour > 6 && hour < 20)
+        {
+            light += 2600 * std::sin((hour - 6) / 14 * M_PI);
+            // clouds : slow dips around midday
+            if (hour > 11 && hour < 15)
+            {
+                light -= 500 * std::max(0.0, std::sin(hour * 9));
+            }
+        }
+        if (hour > 19 && hour < 23.5)
+        {
+            light += 900; // lamp
+        }
+        light += noise(rng);
+        if (unit(rng) < 0.002)
+        {
+            light = 4095; // spike
+        }
+        return static_cast<uint32_t>(std::min(4095.0, std::max(0.0, light)));
+    }
+};
+
+static void Bench()
+{
+    constexpr uint32_t DAY_MS = 24u * 3600u * 1000u;
+    constexpr uint32_t PERIOD_MS = 500;
+    constexpr size_t WINDOW = 10;
+
+    // old LightSensor : every period, re-sum the window, an event per level while raw and mean differ
+    uint32_t oldReads = 0, oldEvents = 0;
+    std::vector<uint32_t> oldWindow(WINDOW, 0);
+    size_t oldHead = 0;
+    Trace_t oldTrace;
+    std::vector<uint32_t> oldSamples;
+    for (uint32_t ms = 0; ms < DAY_MS; ms += PERIOD_MS)
+    {
+        oldSamples.push_back(oldTrace.At(ms));
+    }
+    const double oldNs = host_test::NsPer(oldSamples.size(), [&]()
+                                          {
+        for (uint32_t raw : oldSamples)
+        {
+            oldReads++;
+            oldWindow[oldHead] = raw;
+            oldHead = (oldHead + 1 == WINDOW) ? 0 : oldHead + 1;
+            uint32_t sum = 0;
+            for (uint32_t v : oldWindow)
+            {
+                sum += v;
+            }
+            const uint32_t mean = sum / WINDOW;
+            const uint32_t diff = (mean > raw) ? mean - raw : raw - mean;
+            oldEvents += (diff > 4096 / 100) + (diff > 4096 / 20) + (diff > 4096 / 10) + (diff > 4096 / 5);
+        } });
+
+    // the scanner pipeline, with the period of the adaptive interval
+    const uint32_t thresholds[4] = {4096 / 100, 4096 / 20, 4096 / 10, 4096 / 5};
+    filters::MedianFilter<uint32_t, 3> spikes;
+    filters::MovingAverage<uint32_t, 30> average(WINDOW);
+    filters::ChangeDetector<uint32_t, 4> changes(thresholds);
+    filters::AdaptiveInterval interval(PERIOD_MS, 4000, 4);
+    Trace_t newTrace;
+    std::vector<uint32_t> newSamples;
+    for (uint32_t ms = 0; ms < DAY_MS; ms += interval.Period())
+    {
+        // the period only depends on the samples : replay it first, time the filters alone below
+        const uint32_t raw = newTrace.At(ms);
+        newSamples.push_back(raw);
+        const uint32_t value = average.Update(spikes.Update(raw));
+        const uint32_t spread = (raw > value) ? raw - value : value - raw;
+        interval.Update(changes.Update(value) != 0 || spread > thresholds[0]);
+    }
+    spikes.Reset();
+    average.Reset();
+    changes.Reset();
+    uint32_t newEvents = 0;
+    const double newNs = host_test::NsPer(newSamples.size(), [&]()
+                                          {
+        for (uint32_t raw : newSamples)
+        {
+            const uint32_t value = average.Update(spikes.Update(raw));
+            newEvents += __builtin_popcount(changes.Update(value));
+        } });
+
+    const uint32_t newReads = newSamples.size();
+    CHECK_EQ(oldReads, DAY_MS / PERIOD_MS);
+    CHECK(newReads < oldReads / 4);
+    CHECK(newEvents < oldEvents);
+    printf("24 h trace : old %u reads, %u events, %.1f ns per sample ( %.2f ms ) | new %u reads ( %.1f %% ), %u events, "
+           "%.1f ns per sample ( %.2f ms, %.0f %% of the old filter time )\n",
+           oldReads, oldEvents, oldNs, oldNs * oldReads / 1e6, newReads, 100.0 * newReads / oldReads, newEvents,
+           newNs, newNs * newReads / 1e6, 100.0 * (newNs * newReads) / (oldNs * oldReads));
+}
+
+int main()
+{
+    TestMovingAverage();
+    TestEma();
+    TestMedian<3>(1);
+    TestMedian<5>(2);
+    TestMedian<9>(3);
+    TestMedianSpike();
+    TestChangeDetector();
+    TestAdaptiveInterval();
+    Bench();
+    HOST_TEST_END();
+}
@@ -0,0 +1,81 @@
+#ifndef __ADC_BACKEND_H__
+#define __ADC_BACKEND_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief where the AdcScanner converts its channels : one call reads a whole scan
+ */
+class AdcBackend
+{
+public:
+    static constexpr uint8_t MAX_CHANNELS = 8; // ADC1
+    static constexpr uint32_t INVALID = UINT32_MAX; // raw of a failed conversion
+
+    virtual ~AdcBackend() = default;
+    virtual esp_err_t ConfigureChannel(uint8_t channel) = 0;
+    virtual void ReleaseChannel(uint8_t channel) {}
+    /**
+     * @brief one conversion per channel, in the given order
+     *
+     * @param raw \c count results, 12 bits, INVALID for a failed conversion
+     * @return esp_err_t an error when any conversion failed
+     */
+    virtual esp_err_t Read(const uint8_t *channels, size_t count, uint32_t *raw) = 0;
+};
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief ADC1 oneshot reads, 12 bits, 11 dB ( full range )
+ */
+class Adc1Backend : public AdcBackend
+{
+public:
+    esp_err_t ConfigureChannel(uint8_t channel) override;
+    esp_err_t Read(const uint8_t *channels, size_t count, uint32_t *raw) override;
+
+private:
+    bool widthSet = false;
+};
+#endif
+
+/**
+ * @brief replay of recorded scans : one CSV row per Read(), column n is channel n.
+ * a first line that does not start with a digit is a header and skipped.
+ * after the last row the replay wraps around ( or holds the last row, see SetLoop )
+ *
+ *  ldr,pot,battery
+ *  1200,344,4095
+ *  1210,340,4095
+ */
+class CsvAdcBackend : public AdcBackend
+{
+public:
+    // ESP_ERR_INVALID_ARG : a row is not a list of integers
+    esp_err_t Load(const std::string &csv);
+    // ESP_ERR_NOT_FOUND : cannot open \c path ( SPIFFS on target )
+    esp_err_t LoadFile(const char *path);
+    void SetLoop(bool loop);
+    void Rewind();
+    size_t GetRows();
+    size_t GetPosition();
+
+    esp_err_t ConfigureChannel(uint8_t channel) override;
+    esp_err_t Read(const uint8_t *channels, size_t count, uint32_t *raw) override;
+
+private:
+    std::mutex lock;
+    std::vector<uint16_t> values; // rows * columns
+    size_t columns = 0;
+    size_t row = 0;
+    bool loop = true;
+};
+
+#endif // __ADC_BACKEND_H__
@@ -0,0 +1,145 @@
+#ifndef __ADC_SCANNER_H__
+#define __ADC_SCANNER_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "adc_backend.hpp"
+#include "signal_filters.hpp"
+#include "timer_wheel.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#ifndef CONFIG_AMBIENT_SENSOR_DEFAULT_DELAY
+#define CONFIG_AMBIENT_SENSOR_DEFAULT_DELAY 500
+#endif
+#ifndef CONFIG_AMBIENT_SENSOR_DEFAULT_SMOOTHING_FACTOR
+#define CONFIG_AMBIENT_SENSOR_DEFAULT_SMOOTHING_FACTOR 10
+#endif
+#ifndef CONFIG_AMBIENT_SENSOR_MAX_DELAY
+#define CONFIG_AMBIENT_SENSOR_MAX_DELAY 4000
+#endif
+#ifndef CONFIG_AMBIENT_SENSOR_STABLE_SAMPLES
+#define CONFIG_AMBIENT_SENSOR_STABLE_SAMPLES 4
+#endif
+
+// change of a channel, see AdcScanner
+struct AdcEvent_t
+{
+    uint8_t id;
+    uint8_t channel;
+    uint8_t levels; // bit i : thresholds[i] crossed
+    uint32_t raw;
+    uint32_t value; // smoothed
+    uint32_t diff;  // move of the lowest level that fired
+};
+
+struct AdcChannelConfig_t
+{
+    uint8_t window = CONFIG_AMBIENT_SENSOR_DEFAULT_SMOOTHING_FACTOR; // moving average samples
+    bool median = true;                                              // median of 3 before the average ( spikes )
+    uint32_t thresholds[4] = {4096 / 100, 4096 / 20, 4096 / 10, 4096 / 5};
+};
+
+/**
+ * @brief owner of the ADC : one timer, one scan of every registered channel per tick.
+ * a scan converts all channels in one AdcBackend::Read() into a struct of arrays bank, then runs the
+ * per-channel pipeline ( median of 3, moving average, change detector ) over the bank and fans out :
+ * registered variables get the smoothed value, the handler gets the threshold crossings.
+ * the tick backs off like LightSensor did while every channel is flat.
+ * handlers run on the timer task, after the scan, they must stay short and must not call Remove().
+ *
+ *  AdcScanner::Default().AddChannel(ADC1_CHANNEL_6, [](void *ctx, const AdcEvent_t &e) { ... }, this);
+ */
+class AdcScanner
+{
+public:
+    using Handler_t = void (*)(void *ctx, const AdcEvent_t &event);
+    using ChannelConfig_t = AdcChannelConfig_t;
+    static constexpr uint8_t MAX_CHANNELS = AdcBackend::MAX_CHANNELS;
+    static constexpr uint8_t LEVELS = 4;
+    static constexpr uint8_t NO_CHANNEL = 0xFF;
+    struct Stats_t
+    {
+        uint32_t scans;
+        uint32_t conversions;
+        uint32_t events;     // handler calls
+        uint32_t maxScanUs;  // longest scan, handlers excluded
+        uint32_t readErrors; // failed conversions, the channel kept its last scan
+    };
+
+    explicit AdcScanner(AdcBackend &backend, uint32_t periodMs = CONFIG_AMBIENT_SENSOR_DEFAULT_DELAY, uint32_t maxPeriodMs = CONFIG_AMBIENT_SENSOR_MAX_DELAY);
+    ~AdcScanner();
+    AdcScanner(const AdcScanner &) = delete;
+    AdcScanner &operator=(const AdcScanner &) = delete;
+
+    // scanner on ADC1 ( an empty CSV replay on host )
+    static AdcScanner &Default();
+
+    /**
+     * @brief register a channel, the scans start with the first one
+     *
+     * @param handler may be nullptr : the channel only feeds its variables
+     * @param id slot written back, for the calls below and AdcEvent_t::id
+     * @return esp_err_t ESP_ERR_INVALID_STATE channel already scanned, ESP_ERR_NO_MEM every slot used
+     */
+    esp_err_t AddChannel(uint8_t channel, Handler_t handler, void *ctx, const ChannelConfig_t &config = ChannelConfig_t(), uint8_t *id = nullptr);
+    esp_err_t Remove(uint8_t id);
+    // updated with the smoothed value after every scan
+    esp_err_t RegisterVariable(uint8_t id, uint32_t *var);
+    esp_err_t RegisterVariable(uint8_t id, std::atomic<uint32_t> *var);
+    uint32_t GetValue(uint8_t id);
+    uint32_t GetRaw(uint8_t id);
+
+    esp_err_t Start();
+    esp_err_t Stop();
+
+    /**
+     * @brief one scan : convert, filter, fan out. the timer calls it, replays and tests may call it directly
+     *
+     * @return true a channel moved ( a level fired or a sample is off its average by thresholds[0] )
+     */
+    bool ScanOnce();
+
+    Stats_t GetStats();
+    void ResetStats();
+
+private:
+    // struct of arrays, index = slot id
+    struct Bank_t
+    {
+        uint8_t channel[MAX_CHANNELS];
+        uint32_t raw[MAX_CHANNELS];
+        uint32_t value[MAX_CHANNELS];
+        bool median[MAX_CHANNELS];
+        filters::MedianFilter<uint32_t, 3> spikes[MAX_CHANNELS];
+        filters::MovingAverage<uint32_t, 30> average[MAX_CHANNELS];
+        filters::ChangeDetector<uint32_t, LEVELS> changes[MAX_CHANNELS];
+        uint32_t flatBand[MAX_CHANNELS];
+        Handler_t handler[MAX_CHANNELS];
+        void *ctx[MAX_CHANNELS];
+        std::vector<uint32_t *> vars[MAX_CHANNELS];
+        std::vector<std::atomic<uint32_t> *> atomics[MAX_CHANNELS];
+    };
+
+    void Rebuild(); // packed scan order from the used slots
+    void TimerRun();
+
+    AdcBackend &backend;
+    std::mutex passLock; // one scan at a time, handlers included
+    std::mutex lock;     // bank
+    Bank_t bank{};
+    uint8_t used = 0;                  // bit n : slot n registered
+    uint8_t order[MAX_CHANNELS] = {};  // used slots, scan order
+    uint8_t orderChannel[MAX_CHANNELS] = {};
+    uint32_t orderRaw[MAX_CHANNELS] = {};
+    uint8_t count = 0;
+    filters::AdaptiveInterval interval;
+    WheelTimer_p_t timer{nullptr};
+    bool running = false;
+    Stats_t stats{};
+};
+
+#endif // __ADC_SCANNER_H__
@@ -22,22 +22,17 @@
 #include <memory>
 #include <vector>
 #include "homeassistant.h"
+#include "adc_scanner.hpp"
 
 class LightSensor
 {
 private:
     EventLoop_p_t Loop;
     bool isInitialized = false;
-    unsigned int timerDelay = CONFIG_AMBIENT_SENSOR_DEFAULT_DELAY;
-    uint8_t smoothingFactor = CONFIG_AMBIENT_SENSOR_DEFAULT_SMOOTHING_FACTOR; //size of vector used to smooth out the value
-    unsigned int lastSmoothedValue = 0;                                       // actual last smoothed value to be passed to the variables
-    unsigned int lastValue = 0;                                               // actual last raw value rad in ADC
-    std::vector<uint32_t> meanValue;                                          // containning last several measures to smoothe out and put tot the lastSmoothedValue
-    uint8_t meanValCounter;                                                   // used to manage the meanValue vector as a FIFO
-    std::list<unsigned int*> targetVariables; // list of pointers to variable to be updated with last value - use
+    uint8_t smoothingFactor = CONFIG_AMBIENT_SENSOR_DEFAULT_SMOOTHING_FACTOR; //number of samples in the moving average
     static constexpr char TAG[] = "light_sensor";
     adc1_channel_t channel;
-    ESPTimer_p_t timer{ nullptr };
+    uint8_t scanId = AdcScanner::NO_CHANNEL; // slot on the shared AdcScanner : sampling, filters and variables live there
 
     //EVENTS
 
@@ -55,8 +50,7 @@ public:
     esp_err_t RegisterVariable(uint32_t* var);
     //
     EventGroupHandle_t Event();
-    //initialize ADC converter to read Albient light intensity
-    //this will creat a timer that updates the values at a constant interval
+    //register the channel on the shared AdcScanner : one timer and one scan for every analog sensor
     esp_err_t Init();
     //
     esp_err_t RegisterVariable(std::atomic<uint32_t>* var);
@@ -68,10 +62,8 @@ public:
     esp_err_t Diagnose();
 
 private:
-    uint32_t ReadADC(); // low level read
     esp_err_t SetSmoothingFactor(uint8_t val);
-
-    //CONFIG OVERRIDE
-    esp_err_t TimerRun(); // actual measure on timer trigger // stativ and need to get "this" pointer
+    // 1 / 5 / 10 / 20 % crossings from the scanner
+    static void OnChange(void* ctx, const AdcEvent_t& event);
 };
 #endif
\ No newline at end of file
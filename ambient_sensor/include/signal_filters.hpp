@@ -0,0 +1,278 @@
+#ifndef SIGNAL_FILTERS_HPP_
+#define SIGNAL_FILTERS_HPP_
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief streaming filters for sensor samples : fixed storage, no allocation, O(1) per sample
+ * ( MedianFilter is O(N) with a small N )
+ */
+namespace filters
+{
+
+    /**
+     * @brief moving average over the last \c size samples, kept as a running sum
+     *
+     * @tparam T sample type
+     * @tparam MAX_SIZE storage, the window is set at runtime up to it
+     * @tparam Sum accumulator, wide enough for MAX_SIZE samples
+     */
+    template <typename T, size_t MAX_SIZE, typename Sum = uint64_t>
+    class MovingAverage
+    {
+    public:
+        MovingAverage() { SetSize(MAX_SIZE); }
+        explicit MovingAverage(size_t _size) { SetSize(_size); }
+
+        // clears the window
+        void SetSize(size_t _size)
+        {
+            size = (_size == 0) ? 1 : (_size > MAX_SIZE ? MAX_SIZE : _size);
+            Reset();
+        }
+        size_t GetSize() const { return size; }
+        void Reset()
+        {
+            sum = 0;
+            head = 0;
+            count = 0;
+        }
+
+        // add a sample, returns the average of the samples seen so far ( up to the window )
+        T Update(T sample)
+        {
+            if (count == size)
+            {
+                sum -= window[head];
+            }
+            else
+            {
+                count++;
+            }
+            window[head] = sample;
+            sum += sample;
+            head = (head + 1 == size) ? 0 : head + 1;
+            return Value();
+        }
+        T Value() const { return count ? static_cast<T>(sum / static_cast<Sum>(count)) : T(); }
+        bool Full() const { return count == size; }
+
+    private:
+        T window[MAX_SIZE] = {};
+        Sum sum = 0;
+        size_t size = MAX_SIZE;
+        size_t head = 0;
+        size_t count = 0;
+    };
+
+    /**
+     * @brief exponential moving average in fixed point : value += ( sample - value ) / 2^shift
+     * shift 1 .. 16, the first sample initializes the value
+     */
+    class Ema
+    {
+    public:
+        static constexpr uint8_t FRACTION_BITS = 8;
+
+        explicit Ema(uint8_t _shift = 3) { SetShift(_shift); }
+        void SetShift(uint8_t _shift) { shift = (_shift == 0) ? 1 : (_shift > 16 ? 16 : _shift); }
+        void Reset() { primed = false; }
+
+        int32_t Update(int32_t sample)
+        {
+            const int64_t scaled = static_cast<int64_t>(sample) * (1 << FRACTION_BITS); // no shift of a negative sample
+            if (!primed)
+            {
+                value = scaled;
+                primed = true;
+            }
+            else
+            {
+                value += (scaled - value) >> shift;
+            }
+            return Value();
+        }
+        int32_t Value() const { return static_cast<int32_t>((value + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS); }
+
+    private:
+        int64_t value = 0;
+        uint8_t shift = 3;
+        bool primed = false;
+    };
+
+    /**
+     * @brief median of the last N samples ( spike removal ), the window is kept sorted :
+     * one sample out and one in per update
+     *
+     * @tparam N window, odd
+     */
+    template <typename T, size_t N>
+    class MedianFilter
+    {
+        static_assert(N % 2 == 1 && N >= 3, "median window must be odd");
+
+    public:
+        void Reset()
+        {
+            head = 0;
+            count = 0;
+        }
+
+        T Update(T sample)
+        {
+            size_t pos;
+            if (count == N)
+            {
+                // replace the oldest sample in the sorted window
+                const T old = history[head];
+                pos = 0;
+                while (sorted[pos] != old)
+                {
+                    pos++;
+                }
+                while (pos > 0 && sorted[pos - 1] > sample)
+                {
+                    sorted[pos] = sorted[pos - 1];
+                    pos--;
+                }
+                while (pos + 1 < N && sorted[pos + 1] < sample)
+                {
+                    sorted[pos] = sorted[pos + 1];
+                    pos++;
+                }
+            }
+            else
+            {
+                pos = count++;
+                while (pos > 0 && sorted[pos - 1] > sample)
+                {
+                    sorted[pos] = sorted[pos - 1];
+                    pos--;
+                }
+            }
+            sorted[pos] = sample;
+            history[head] = sample;
+            head = (head + 1 == N) ? 0 : head + 1;
+            return Value();
+        }
+        T Value() const { return count ? sorted[count / 2] : T(); }
+
+    private:
+        T history[N] = {};
+        T sorted[N] = {};
+        size_t head = 0;
+        size_t count = 0;
+    };
+
+    /**
+     * @brief change detector with one reference per level : level \c i fires when the value moved
+     * at least \c thresholds[i] away from the value it last fired at ( or the first value ).
+     * a slow drift fires once per threshold crossed, noise inside the band never fires
+     *
+     * @tparam LEVELS number of thresholds, increasing
+     */
+    template <typename T, size_t LEVELS>
+    class ChangeDetector
+    {
+    public:
+        ChangeDetector() = default;
+        explicit ChangeDetector(const T (&_thresholds)[LEVELS]) { SetThresholds(_thresholds); }
+        void SetThresholds(const T (&_thresholds)[LEVELS])
+        {
+            for (size_t i = 0; i < LEVELS; i++)
+            {
+                thresholds[i] = _thresholds[i];
+            }
+            Reset();
+        }
+        void Reset() { primed = false; }
+
+        /**
+         * @return uint32_t bit i : level i fired, \c diff ( optional ) the move of the lowest level that fired
+         */
+        uint32_t Update(T value, T *diff = nullptr)
+        {
+            if (!primed)
+            {
+                for (size_t i = 0; i < LEVELS; i++)
+                {
+                    reference[i] = value;
+                }
+                primed = true;
+                return 0;
+            }
+            uint32_t fired = 0;
+            for (size_t i = 0; i < LEVELS; i++)
+            {
+                const T delta = (value > reference[i]) ? value - reference[i] : reference[i] - value;
+                if (delta >= thresholds[i])
+                {
+                    if (fired == 0 && diff != nullptr)
+                    {
+                        *diff = delta;
+                    }
+                    fired |= (1UL << i);
+                    reference[i] = value;
+                }
+            }
+            return fired;
+        }
+
+    private:
+        T thresholds[LEVELS] = {};
+        T reference[LEVELS] = {};
+        bool primed = false;
+    };
+
+    /**
+     * @brief sampling period that backs off while the signal is flat and snaps back on a change :
+     * after \c stableSamples flat samples the period doubles, up to \c maxMs, a change resets it to \c minMs
+     */
+    class AdaptiveInterval
+    {
+    public:
+        AdaptiveInterval(uint32_t _minMs, uint32_t _maxMs, uint8_t _stableSamples = 4)
+            : minMs(_minMs), maxMs(_maxMs < _minMs ? _minMs : _maxMs), stableSamples(_stableSamples), period(_minMs) {}
+
+        void SetRange(uint32_t _minMs, uint32_t _maxMs)
+        {
+            minMs = _minMs;
+            maxMs = (_maxMs < _minMs) ? _minMs : _maxMs;
+            Reset();
+        }
+        void Reset()
+        {
+            period = minMs;
+            stable = 0;
+        }
+
+        // after a sample : returns the delay to the next one
+        uint32_t Update(bool changed)
+        {
+            if (changed)
+            {
+                period = minMs;
+                stable = 0;
+            }
+            else if (++stable >= stableSamples)
+            {
+                stable = 0;
+                period = (period > maxMs / 2) ? maxMs : period * 2;
+            }
+            return period;
+        }
+        uint32_t Period() const { return period; }
+
+    private:
+        uint32_t minMs;
+        uint32_t maxMs;
+        uint8_t stableSamples;
+        uint32_t period;
+        uint8_t stable = 0;
+    };
+
+} // namespace filters
+
+#endif // SIGNAL_FILTERS_HPP_
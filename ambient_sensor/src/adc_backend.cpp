@@ -0,0 +1,191 @@
+#include "adc_backend.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef ESP_PLATFORM
+#include "driver/adc_common.h"
+
+esp_err_t Adc1Backend::ConfigureChannel(uint8_t channel)
+{
+    if (channel >= ADC1_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!widthSet)
+    {
+        esp_err_t ret = adc1_config_width(ADC_WIDTH_BIT_12);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+        widthSet = true;
+    }
+    return adc1_config_channel_atten(static_cast<adc1_channel_t>(channel), ADC_ATTEN_DB_11);
+}
+
+esp_err_t Adc1Backend::Read(const uint8_t *channels, size_t count, uint32_t *raw)
+{
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < count; i++)
+    {
+        const int value = adc1_get_raw(static_cast<adc1_channel_t>(channels[i]));
+        if (value < 0)
+        {
+            ret = ESP_FAIL;
+            raw[i] = INVALID;
+            continue;
+        }
+        raw[i] = static_cast<uint32_t>(value);
+    }
+    return ret;
+}
+#endif
+
+esp_err_t CsvAdcBackend::Load(const std::string &csv)
+{
+    std::vector<uint16_t> parsed;
+    size_t width = 0;
+    size_t start = 0;
+    bool first = true;
+    while (start < csv.size())
+    {
+        size_t end = csv.find('\n', start);
+        if (end == std::string::npos)
+        {
+            end = csv.size();
+        }
+        std::string line = csv.substr(start, end - start);
+        start = end + 1;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+        const bool header = first && !(line[0] >= '0' && line[0] <= '9');
+        first = false;
+        if (header)
+        {
+            continue;
+        }
+        size_t cells = 0;
+        const char *p = line.c_str();
+        while (true)
+        {
+            char *next = nullptr;
+            const long value = std::strtol(p, &next, 10);
+            if (next == p || value < 0 || value > UINT16_MAX)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            parsed.push_back(static_cast<uint16_t>(value));
+            cells++;
+            while (*next == ' ')
+            {
+                next++;
+            }
+            if (*next == '\0')
+            {
+                break;
+            }
+            if (*next != ',' && *next != ';')
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            p = next + 1;
+        }
+        if (width == 0)
+        {
+            width = cells;
+        }
+        else if (cells != width)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    values.swap(parsed);
+    columns = width;
+    row = 0;
+    return ESP_OK;
+}
+
+esp_err_t CsvAdcBackend::LoadFile(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    std::string csv;
+    char buffer[256];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        csv.append(buffer, len);
+    }
+    fclose(file);
+    return Load(csv);
+}
+
+void CsvAdcBackend::SetLoop(bool _loop)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    loop = _loop;
+}
+
+void CsvAdcBackend::Rewind()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    row = 0;
+}
+
+size_t CsvAdcBackend::GetRows()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return columns ? values.size() / columns : 0;
+}
+
+size_t CsvAdcBackend::GetPosition()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return row;
+}
+
+esp_err_t CsvAdcBackend::ConfigureChannel(uint8_t channel)
+{
+    return (channel < MAX_CHANNELS) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * @brief channels without a column read 0
+ */
+esp_err_t CsvAdcBackend::Read(const uint8_t *channels, size_t count, uint32_t *raw)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const size_t rows = columns ? values.size() / columns : 0;
+    if (rows == 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            raw[i] = INVALID;
+        }
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint16_t *line = &values[row * columns];
+    for (size_t i = 0; i < count; i++)
+    {
+        raw[i] = (channels[i] < columns) ? line[channels[i]] : 0;
+    }
+    if (row + 1 < rows)
+    {
+        row++;
+    }
+    else if (loop)
+    {
+        row = 0;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,302 @@
+#include "adc_scanner.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <chrono>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#endif
+
+static const char TAG[] = "AdcScanner";
+
+static uint64_t NowUs()
+{
+#ifdef ESP_PLATFORM
+    return static_cast<uint64_t>(esp_timer_get_time());
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+AdcScanner::AdcScanner(AdcBackend &_backend, uint32_t periodMs, uint32_t maxPeriodMs)
+    : backend(_backend),
+      interval(periodMs ? periodMs : 1, maxPeriodMs, CONFIG_AMBIENT_SENSOR_STABLE_SAMPLES)
+{
+    for (auto &channel : bank.channel)
+    {
+        channel = NO_CHANNEL;
+    }
+    timer = std::make_unique<WheelTimer>([this]()
+                                         { TimerRun(); },
+                                         "adc scanner");
+}
+
+AdcScanner::~AdcScanner()
+{
+    Stop();
+    timer.reset();
+}
+
+AdcScanner &AdcScanner::Default()
+{
+#ifdef ESP_PLATFORM
+    static Adc1Backend defaultBackend;
+#else
+    static CsvAdcBackend defaultBackend;
+#endif
+    static AdcScanner defaultScanner(defaultBackend);
+    return defaultScanner;
+}
+
+esp_err_t AdcScanner::AddChannel(uint8_t channel, Handler_t handler, void *ctx, const ChannelConfig_t &config, uint8_t *id)
+{
+    if (channel >= MAX_CHANNELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t slot = NO_CHANNEL;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (uint8_t i = 0; i < MAX_CHANNELS; i++)
+        {
+            if ((used & (1 << i)) && bank.channel[i] == channel)
+            {
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (slot == NO_CHANNEL && !(used & (1 << i)))
+            {
+                slot = i;
+            }
+        }
+        if (slot == NO_CHANNEL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    esp_err_t ret = backend.ConfigureChannel(channel);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "channel %d not configured %s", channel, esp_err_to_name(ret));
+        return ret;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        bank.channel[slot] = channel;
+        bank.raw[slot] = 0;
+        bank.value[slot] = 0;
+        bank.median[slot] = config.median;
+        bank.spikes[slot].Reset();
+        bank.average[slot].SetSize(config.window);
+        bank.changes[slot].SetThresholds(config.thresholds);
+        bank.flatBand[slot] = config.thresholds[0];
+        bank.handler[slot] = handler;
+        bank.ctx[slot] = ctx;
+        bank.vars[slot].clear();
+        bank.atomics[slot].clear();
+        used |= (1 << slot);
+        Rebuild();
+    }
+    if (id != nullptr)
+    {
+        *id = slot;
+    }
+    return Start();
+}
+
+esp_err_t AdcScanner::Remove(uint8_t id)
+{
+    bool empty;
+    uint8_t channel;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (id >= MAX_CHANNELS || !(used & (1 << id)))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        channel = bank.channel[id];
+        used &= ~(1 << id);
+        bank.channel[id] = NO_CHANNEL;
+        bank.handler[id] = nullptr;
+        bank.vars[id].clear();
+        bank.atomics[id].clear();
+        Rebuild();
+        empty = (used == 0);
+    }
+    {
+        // a running scan has finished with the slot once passLock is free
+        std::lock_guard<std::mutex> pass(passLock);
+        backend.ReleaseChannel(channel);
+    }
+    // not under passLock : Stop() waits for the timer callback, which takes it
+    return empty ? Stop() : ESP_OK;
+}
+
+esp_err_t AdcScanner::RegisterVariable(uint8_t id, uint32_t *var)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (var == nullptr || id >= MAX_CHANNELS || !(used & (1 << id)))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bank.vars[id].push_back(var);
+    *var = bank.value[id];
+    return ESP_OK;
+}
+
+esp_err_t AdcScanner::RegisterVariable(uint8_t id, std::atomic<uint32_t> *var)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (var == nullptr || id >= MAX_CHANNELS || !(used & (1 << id)))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bank.atomics[id].push_back(var);
+    var->store(bank.value[id]);
+    return ESP_OK;
+}
+
+uint32_t AdcScanner::GetValue(uint8_t id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return (id < MAX_CHANNELS && (used & (1 << id))) ? bank.value[id] : 0;
+}
+
+uint32_t AdcScanner::GetRaw(uint8_t id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return (id < MAX_CHANNELS && (used & (1 << id))) ? bank.raw[id] : 0;
+}
+
+esp_err_t AdcScanner::Start()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (running)
+    {
+        return ESP_OK;
+    }
+    running = true;
+    interval.Reset();
+    return timer->start_once(std::chrono::milliseconds(interval.Period()));
+}
+
+esp_err_t AdcScanner::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    // waits for a running scan
+    return timer->stop();
+}
+
+void AdcScanner::Rebuild()
+{
+    count = 0;
+    for (uint8_t i = 0; i < MAX_CHANNELS; i++)
+    {
+        if (used & (1 << i))
+        {
+            order[count] = i;
+            orderChannel[count] = bank.channel[i];
+            count++;
+        }
+    }
+}
+
+bool AdcScanner::ScanOnce()
+{
+    std::lock_guard<std::mutex> pass(passLock);
+    AdcEvent_t events[MAX_CHANNELS];
+    Handler_t handlers[MAX_CHANNELS];
+    void *ctxs[MAX_CHANNELS];
+    uint8_t eventCount = 0;
+    bool moved = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (count == 0)
+        {
+            return false;
+        }
+        const uint64_t start = NowUs();
+        // every conversion first, then the pipelines over the bank
+        std::fill(orderRaw, orderRaw + count, AdcBackend::INVALID);
+        const bool failed = backend.Read(orderChannel, count, orderRaw) != ESP_OK;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (orderRaw[i] != AdcBackend::INVALID)
+            {
+                bank.raw[order[i]] = orderRaw[i];
+            }
+        }
+        for (uint8_t i = 0; i < count; i++)
+        {
+            // a failed conversion skips the channel : filters, variables and events keep the last scan
+            if (failed && orderRaw[i] == AdcBackend::INVALID)
+            {
+                stats.readErrors++;
+                continue;
+            }
+            const uint8_t slot = order[i];
+            const uint32_t raw = bank.raw[slot];
+            const uint32_t value = bank.average[slot].Update(bank.median[slot] ? bank.spikes[slot].Update(raw) : raw);
+            bank.value[slot] = value;
+            uint32_t diff = 0;
+            const uint32_t levels = bank.changes[slot].Update(value, &diff);
+            const uint32_t spread = (raw > value) ? raw - value : value - raw;
+            if (levels != 0 || spread > bank.flatBand[slot])
+            {
+                moved = true;
+            }
+            for (uint32_t *var : bank.vars[slot])
+            {
+                *var = value;
+            }
+            for (std::atomic<uint32_t> *var : bank.atomics[slot])
+            {
+                var->store(value, std::memory_order_relaxed);
+            }
+            if (levels != 0 && bank.handler[slot] != nullptr)
+            {
+                events[eventCount] = {slot, bank.channel[slot], static_cast<uint8_t>(levels), raw, value, diff};
+                handlers[eventCount] = bank.handler[slot];
+                ctxs[eventCount] = bank.ctx[slot];
+                eventCount++;
+            }
+        }
+        const uint32_t scanUs = static_cast<uint32_t>(NowUs() - start);
+        stats.scans++;
+        stats.conversions += count;
+        stats.events += eventCount;
+        if (scanUs > stats.maxScanUs)
+        {
+            stats.maxScanUs = scanUs;
+        }
+    }
+    for (uint8_t i = 0; i < eventCount; i++)
+    {
+        handlers[i](ctxs[i], events[i]);
+    }
+    return moved;
+}
+
+void AdcScanner::TimerRun()
+{
+    const bool moved = ScanOnce();
+    std::lock_guard<std::mutex> guard(lock);
+    if (running)
+    {
+        timer->start_once(std::chrono::milliseconds(interval.Update(moved)));
+    }
+}
+
+AdcScanner::Stats_t AdcScanner::GetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void AdcScanner::ResetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stats = Stats_t{};
+}
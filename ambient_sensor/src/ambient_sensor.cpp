@@ -19,8 +19,6 @@ LightSensor::LightSensor(EventLoop_p_t& EventLoop, adc1_channel_t _channel, cons
     Loop(EventLoop),
     channel(_channel)
 {
-    timer = std::make_unique<ESPTimer>([&]() {this->TimerRun(); }, std::string(TAG));
-
 }
 
 LightSensor::~LightSensor()
@@ -29,7 +27,7 @@ LightSensor::~LightSensor()
 }
 
 /**
- * @brief start all init and start task
+ * @brief register the channel on the shared scanner
  *
  * @return esp_err_t
  */
@@ -39,104 +37,61 @@ esp_err_t LightSensor::Init()
     {
         return ESP_OK;
     }
-    esp_err_t ret = adc1_config_width(ADC_WIDTH_BIT_12);
-    ret = adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+    AdcScanner::ChannelConfig_t config;
+    config.window = smoothingFactor;
+    esp_err_t ret = AdcScanner::Default().AddChannel(channel, LightSensor::OnChange, this, config, &scanId);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "ADC LightSensor sensor Driver not Started");
         return ret;
     }
-    meanValCounter = 0;
-    meanValue.clear();
-    for (int i = 0; i < smoothingFactor; i++)
-    {
-        meanValue.push_back(0); // put some weros into the fifo
-    }
-    timer->start_periodic(std::chrono::milliseconds(this->timerDelay));
     isInitialized = true;
     return ret;
 }
 
 /**
- * @brief start an ADC read , update variable table, private
+ * @brief threshold crossings of the smoothed value, on the scanner task
  *
- * @return uint32_t
+ * @param ctx LightSensor
  */
-uint32_t LightSensor::ReadADC()
+void LightSensor::OnChange(void* ctx, const AdcEvent_t& event)
 {
-    uint32_t adc_reading = 0;
-    adc_reading = static_cast<uint32_t>(adc1_get_raw(channel));
-    meanValue[meanValCounter] = adc_reading;
-    meanValCounter++;
-    if (meanValCounter >= smoothingFactor)
-        meanValCounter = 0;
-    uint32_t mean = 0;
-    for (int i = 0; i < smoothingFactor; i++)
-    {
-        mean += meanValue[i];
-    }
-    lastSmoothedValue = mean / meanValue.size();
-    for (const auto& target : targetVariables)
-    {
-        *target = lastSmoothedValue;
-    }
-    int diff = 0;
-    if (lastSmoothedValue > adc_reading)
-        diff = (lastSmoothedValue - adc_reading);
-    else
-    {
-        diff = (adc_reading - lastSmoothedValue);
-    }
-    if (diff > (4096 / 100))
+    LightSensor* _this = static_cast<LightSensor*>(ctx);
+    if (event.levels & BIT(0))
     {
-        Loop->post_event_data(EVENT_CHANGED_1_PERC, diff);
+        _this->Loop->post_event_data(_this->EVENT_CHANGED_1_PERC, event.diff);
     }
-    if (diff > (4096 / 20))
+    if (event.levels & BIT(1))
     {
-        Loop->post_event_data(EVENT_CHANGED_5_PERC, diff);
+        _this->Loop->post_event_data(_this->EVENT_CHANGED_5_PERC, event.diff);
     }
-    if (diff > (4096 / 10))
+    if (event.levels & BIT(2))
     {
-        Loop->post_event_data(EVENT_CHANGED_10_PERC, diff);
+        _this->Loop->post_event_data(_this->EVENT_CHANGED_10_PERC, event.diff);
     }
-    if (diff > (4096 / 5))
+    if (event.levels & BIT(3))
     {
-        Loop->post_event_data(EVENT_CHANGED_20_PERC, diff);
+        _this->Loop->post_event_data(_this->EVENT_CHANGED_20_PERC, event.diff);
     }
-    return adc_reading;
 }
 
 /**
- * @brief timer callback to be called each interval, private
- *          this will be called by the timer at each interval
- * @param xTimer
- */
-esp_err_t LightSensor::TimerRun()
-{
-    lastValue = ReadADC();
-    // Loop->post_event_data(EVENT_MEASURE, lastValue);
-    return ESP_OK;
-}
-
-/**
- * @brief shut down all
+ * @brief remove the channel from the scanner
  *
  */
 void LightSensor::DeInit()
 {
-    if (ESP_OK)
+    if (isInitialized)
     {
         isInitialized = false;
-        meanValue.clear();
-        targetVariables.clear();
-        this->timer->stop();
+        if (AdcScanner::Default().Remove(scanId) != ESP_OK)
+            ESP_LOGE(TAG, " something wenwrong while stopping timer");
+        scanId = AdcScanner::NO_CHANNEL;
     }
-    else
-        ESP_LOGE(TAG, " something wenwrong while stopping timer");
 }
 
 /**
- * @brief register a variable pointers to be updated each interal ( up to 5 variables)
+ * @brief register a variable pointers to be updated after each scan
  *
  * @param var
  * @return esp_err_t
@@ -145,14 +100,22 @@ esp_err_t LightSensor::RegisterVariable(uint32_t* var)
 {
     if (var != NULL && isInitialized)
     {
-        targetVariables.push_back(var);
-        return ESP_OK;
+        return AdcScanner::Default().RegisterVariable(scanId, var);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t LightSensor::RegisterVariable(std::atomic<uint32_t>* var)
+{
+    if (var != NULL && isInitialized)
+    {
+        return AdcScanner::Default().RegisterVariable(scanId, var);
     }
     return ESP_ERR_INVALID_ARG;
 }
 
 /**
- * @brief return last read value
+ * @brief return last smoothed value
  *
  * @return uint32_t
  */
@@ -160,11 +123,10 @@ uint32_t LightSensor::GetValue() const
 {
     if (isInitialized)
     {
-        return lastSmoothedValue;
+        return AdcScanner::Default().GetValue(scanId);
     }
     else
     {
         return (0);
     }
 }
-
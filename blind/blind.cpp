@@ -2,9 +2,16 @@
 #include "driver/gpio.h"
 #include <string>
 #include <cstdlib>
-#include "nvs_tools.h"
+#include <cmath>
+#include "nvs_cache.h"
+#include "esp_timer.h"
 xQueueHandle Blind::InterruptQueue = NULL;
 
+static uint32_t NowMs()
+{
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
 Blind::Blind(EventLoop_p_t& _loop,
     gpio_num_t _pin_up,
     gpio_num_t _pin_down
@@ -12,10 +19,10 @@ Blind::Blind(EventLoop_p_t& _loop,
 pin_up(_pin_up),
 pin_down(_pin_down)
 {
-    timer = std::make_unique<ESPTimer>([this]() {TimerExecute(); }, "blind");
+    timer = std::make_unique<WheelTimer>([this]() {TimerExecute(); }, "blind");
     if (this->isInverted)
         std::swap(pin_up, pin_down);
-    timerIntr = std::make_unique<ESPTimer>([this]() { TimerExecuteIntr(); }, "blind2");
+    timerIntr = std::make_unique<WheelTimer>([this]() { TimerExecuteIntr(); }, "blind2");
     InterruptQueue = xQueueCreate(10, sizeof(uint32_t));
     Intertask = new AsyncTask([this](void* arg) {this->InterruptTask(); }, "blind interrupt", (void*)this);
     EnableInterrupt(true);
@@ -30,7 +37,12 @@ Blind::~Blind()
 
 bool Blind::handle_set_per(const std::string& str1)
 {
-    uint8_t val = std::atoi(str1.c_str());
+    uint8_t val = 0;
+    if (BlindMotion::ParsePercentage(str1, val) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "bad percentage \"%s\"", str1.c_str());
+        return false;
+    }
     return handle_set_per_uint(val);
 }
 
@@ -57,21 +69,18 @@ bool Blind::handle_set_per_uint(uint8_t New_percentage)
             movingDirection = Direction_Stop;
             return true;
         }
+        else if (group != nullptr)
+        {
+            perc = New_percentage__;
+            group->SetTarget(groupId, perc, group->NowMs());
+        }
         else
         {
             EnableInterrupt(false);
-            if (perc > New_percentage)
-            {
-                movingDirection = Direction_Down;
-                perc = New_percentage__;
-                timer->start_periodic(std::chrono::milliseconds(DownTime / 100));
-            }
-            else
-            {
-                movingDirection = Direction_UP;
-                perc = New_percentage__;
-                timer->start_periodic(std::chrono::milliseconds(UpTime / 100));
-            }
+            commandMode = false;
+            perc = New_percentage__;
+            motion.SetTravel(UpTime, DownTime);
+            Move(motion.MoveTo(perc, NowMs()));
         }
     }
     return false;
@@ -79,26 +88,29 @@ bool Blind::handle_set_per_uint(uint8_t New_percentage)
 
 bool Blind::handle_set_CMD(MovingDirection_t direction)
 {
-    movingDirection = direction;
-    if (direction != Direction_Stop)
+    if (direction == Direction_Stop)
     {
-        commandMode = true;
-        EnableInterrupt(false);
-        if (direction == Direction_Down)
-        {
-            timer->start_periodic(std::chrono::milliseconds(DownTime / 100));
-        }
-        if (direction == Direction_UP)
-        {
-            timer->start_periodic(std::chrono::milliseconds(UpTime / 100));
-        }
+        if (motion.IsMoving() || group != nullptr)
+            Cancel();
+        return false;
+    }
+    if (group != nullptr)
+    {
+        perc = (direction == Direction_UP) ? 100 : 0;
+        group->SetTarget(groupId, perc, group->NowMs());
+        return false;
     }
+    commandMode = true;
+    EnableInterrupt(false);
+    motion.SetTravel(UpTime, DownTime);
+    Move(motion.Run(direction == Direction_UP ? BlindMotion::DIR_UP : BlindMotion::DIR_DOWN, NowMs()));
     return false;
 }
 
 uint8_t Blind::GetCurrentPerc() const
 {
-    return last_perc;
+    // estimated from the elapsed time while moving
+    return static_cast<uint8_t>(std::lround(motion.Position(NowMs())));
 }
 
 uint8_t Blind::GetTargetPerc()const
@@ -108,81 +120,104 @@ uint8_t Blind::GetTargetPerc()const
 
 void Blind::Cancel()
 {
-    movingDirection = Direction_Stop;
+    if (group != nullptr)
+    {
+        // GroupRelay() switches the relays off and settles
+        group->Stop(groupId, group->NowMs());
+        return;
+    }
+    timer->stop();
     gpio_set_level(pin_up, 0);
     gpio_set_level(pin_down, 0);
+    Settle(motion.Stop(NowMs()));
     EnableInterrupt(true);
-    perc = last_perc;
 }
 
-static  int throttle = 0;
-
-void Blind::TimerExecute()
+/**
+ * @brief relays on for the planned move and one stop timer, instead of one tick per percent
+ *
+ * @param runMs relay on time from BlindMotion, 0 : already there
+ */
+void Blind::Move(uint32_t runMs)
 {
-    switch (movingDirection)
-    {
-    case Direction_Stop:
+    if (runMs == 0)
     {
+        timer->stop();
         gpio_set_level(pin_up, 0);
         gpio_set_level(pin_down, 0);
-        movingDirection = Direction_Stop;
-        loop->post_event(EVENT_BLIND_STOPPED);
-        throttle = 0;
-        isBusy = false;
-        commandMode = false;
-        perc = last_perc;
-        ESP_LOGI(TAG, "STOP");
-        SaveToNVS();
-        timer->stop();
+        Settle(motion.Finish(NowMs()));
         EnableInterrupt(true);
-        break;
-    }
-    case Direction_UP:
-    {
-        ESP_LOGI(TAG, "UP %d %d-command %d", last_perc, perc, commandMode);
-        isBusy = true;
-        gpio_set_level(pin_up, 1);
-        gpio_set_level(pin_down, 0);
-        if (last_perc < 100)
-        {
-            last_perc++;
-            loop->post_event(EVENT_BLIND_CHNAGED, std::chrono::milliseconds(20));
-            if (last_perc == perc && !commandMode)
-            {
-                movingDirection = Direction_Stop;
-            }
-        }
-        else
-        {
-            movingDirection = Direction_Stop;
-        }
-        break;
+        return;
     }
-    case Direction_Down:
+    const bool up = motion.GetDirection() == BlindMotion::DIR_UP;
+    movingDirection = up ? Direction_UP : Direction_Down;
+    isBusy = true;
+    ESP_LOGI(TAG, "%s %d -> %d in %ums command %d", up ? "UP" : "DOWN", GetCurrentPerc(), static_cast<int>(std::lround(motion.GetTarget())), runMs, commandMode);
+    gpio_set_level(up ? pin_down : pin_up, 0);
+    gpio_set_level(up ? pin_up : pin_down, 1);
+    timer->start_once(std::chrono::milliseconds(runMs));
+    loop->post_event(EVENT_BLIND_CHNAGED, std::chrono::milliseconds(20));
+}
+
+/**
+ * @brief the motion is over : keep the position, tell and save it
+ */
+void Blind::Settle(float position, bool notify)
+{
+    movingDirection = Direction_Stop;
+    last_perc = static_cast<uint8_t>(std::lround(position));
+    perc = last_perc;
+    isBusy = false;
+    commandMode = false;
+    ESP_LOGI(TAG, "STOP %d", last_perc);
+    if (notify)
+        loop->post_event(EVENT_BLIND_STOPPED);
+    SaveToNVS();
+}
+
+esp_err_t Blind::JoinGroup(BlindGroup& _group, uint8_t* id)
+{
+    motion.SetTravel(UpTime, DownTime);
+    uint8_t member = 0;
+    esp_err_t ret = _group.Add(motion, Blind::GroupRelay, this, &member);
+    if (ret != ESP_OK)
+        return ret;
+    group = &_group;
+    groupId = member;
+    if (id != nullptr)
+        *id = member;
+    return ESP_OK;
+}
+
+/**
+ * @brief relays of a group member, the group owns the motion and sends the events
+ */
+void Blind::GroupRelay(void* ctx, uint8_t member, BlindMotion::Direction_t direction)
+{
+    Blind* _this = static_cast<Blind*>(ctx);
+    if (direction == BlindMotion::DIR_NONE)
     {
-        ESP_LOGI(TAG, "DOWN %d %d -command %d", last_perc, perc, commandMode);
-        isBusy = true;
-        gpio_set_level(pin_up, 0);
-        gpio_set_level(pin_down, 1);
-        if (last_perc > 0)
-        {
-            last_perc--;
-            loop->post_event(EVENT_BLIND_CHNAGED, std::chrono::milliseconds(20));
-            if (last_perc == perc && !commandMode)
-            {
-                movingDirection = Direction_Stop;
-            }
-        }
-        else
-        {
-            movingDirection = Direction_Stop;
-        }
-        break;
-    }
+        gpio_set_level(_this->pin_up, 0);
+        gpio_set_level(_this->pin_down, 0);
+        _this->Settle(_this->motion.Position(NowMs()), false);
+        _this->EnableInterrupt(true);
+        return;
     }
-    if (commandMode)
-        perc = last_perc;
-    return;
+    _this->EnableInterrupt(false);
+    _this->timer->stop();
+    const bool up = direction == BlindMotion::DIR_UP;
+    _this->movingDirection = up ? Direction_UP : Direction_Down;
+    _this->isBusy = true;
+    gpio_set_level(up ? _this->pin_down : _this->pin_up, 0);
+    gpio_set_level(up ? _this->pin_up : _this->pin_down, 1);
+}
+
+void Blind::TimerExecute()
+{
+    gpio_set_level(pin_up, 0);
+    gpio_set_level(pin_down, 0);
+    Settle(motion.Finish(NowMs()));
+    EnableInterrupt(true);
 }
 
 std::string Blind::GetStatusStr()const
@@ -240,15 +275,11 @@ esp_err_t Blind::mqtt_callback(const std::string& topic, const std::string& data
 
 esp_err_t Blind::SaveToNVS()
 {
-    auto nvs = OPEN_NVS_W("default");
-    esp_err_t ret = ESP_FAIL;
-    if (nvs->isOpen())
-    {
-        ret |= nvs->set("position", last_perc);
-        if (last_perc > 100)
-            last_perc = 100;
-        perc = last_perc;
-    }
+    // write-back cache : repeated stops only update RAM until the next flush
+    esp_err_t ret = NvsCache::Default().set("default", "position", last_perc);
+    if (last_perc > 100)
+        last_perc = 100;
+    perc = last_perc;
     return ret;
 }
 
@@ -257,22 +288,32 @@ esp_err_t Blind::RestoreDefault()
     DownTime = 10000;
     UpTime = 10000;
     last_perc = 0;
+    motion.SetProfile(BlindMotion::Profile_t());
+    motion.SetTravel(UpTime, DownTime);
+    motion.SetPosition(last_perc);
     return ESP_OK;
 }
 esp_err_t Blind::LoadFromNVS()
 {
-    auto nvs = OPEN_NVS("default");
-    esp_err_t ret = ESP_FAIL;
-    if (nvs->isOpen())
-    {
-        ret = nvs->get("TimerUP", UpTime);
-        ret |= nvs->get("TimerDown", DownTime);
-        ret |= nvs->get("position", last_perc);
-        ret |= nvs->get("isInverted", isInverted);
-        if (last_perc > 100)
-            last_perc = 100;
-        perc = last_perc;
-    }
+    auto &nvs = NvsCache::Default();
+    esp_err_t ret = nvs.get("default", "TimerUP", UpTime);
+    ret |= nvs.get("default", "TimerDown", DownTime);
+    ret |= nvs.get("default", "position", last_perc);
+    ret |= nvs.get("default", "isInverted", isInverted);
+    if (last_perc > 100)
+        last_perc = 100;
+    perc = last_perc;
+    BlindMotion::Profile_t profile = motion.GetProfile();
+    profile.upMs = UpTime;
+    profile.downMs = DownTime;
+    nvs.get("default", "StartDelay", profile.startDelayMs);
+    std::string curve;
+    if (nvs.getS("default", "CurveUP", curve) == ESP_OK)
+        BlindMotion::ParseCurve(curve, profile.upCurve);
+    if (nvs.getS("default", "CurveDown", curve) == ESP_OK)
+        BlindMotion::ParseCurve(curve, profile.downCurve);
+    motion.SetProfile(profile);
+    motion.SetPosition(last_perc);
     return ret;
 }
 void Blind::EnableInterrupt(const bool val)
@@ -300,48 +341,13 @@ void Blind::EnableInterrupt(const bool val)
     }
 }
 
+/**
+ * @brief a wall switch move reached the end stop
+ */
 void Blind::TimerExecuteIntr()
 {
-    if (movingDirection == Direction_Stop)
-    {
-        throttle = 0;
-        isBusy = false;
-        SaveToNVS();
-        perc = last_perc;
-        loop->post_event(EVENT_BLIND_STOPPED);
-        timerIntr->stop();
-        ESP_LOGI(TAG, "STOP INTR");
-        return;
-    }
-    else if (movingDirection == Direction_UP)
-    {
-        ESP_LOGI(TAG, "UP INTR");
-        isBusy = true;
-        if (last_perc < 100)
-        {
-            last_perc++;
-
-        }
-        else
-        {
-            movingDirection = Direction_Stop;
-        }
-    }
-    else if (movingDirection == Direction_Down)
-    {
-        ESP_LOGI(TAG, "DOWN INTR");
-        isBusy = true;
-        if (last_perc > 0)
-        {
-            last_perc--;
-        }
-        else
-        {
-            movingDirection = Direction_Stop;
-        }
-    }
-    loop->post_event(EVENT_BLIND_CHNAGED, std::chrono::milliseconds(20));
-
+    ESP_LOGI(TAG, "STOP INTR");
+    Settle(motion.Finish(NowMs()));
 }
 
 void Blind::InterruptTask()
@@ -350,32 +356,55 @@ void Blind::InterruptTask()
     {
         InterruptState_t event;
         auto res = xQueueReceive(InterruptQueue, &event, portMAX_DELAY);
-        if (res == pdTRUE)
+        if (res != pdTRUE)
         {
-            switch ((event))
-            {
-            case InterruptState_t::Up:
-            {
-                movingDirection = MovingDirection_t::Direction_UP;
-                timerIntr->start_periodic(std::chrono::milliseconds(UpTime / 100));
-            }
-            break;
-            case InterruptState_t::Down:
-            {
-                movingDirection = MovingDirection_t::Direction_Down;
-                timerIntr->start_periodic(std::chrono::milliseconds(UpTime / 100));
-            }
-            break;
-            case InterruptState_t::Stop:
+            continue;
+        }
+        // the first edge is the time of the move, the last one after the bounces is its direction
+        const uint32_t edgeMs = NowMs();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        while (xQueueReceive(InterruptQueue, &event, 0) == pdTRUE)
+        {
+        }
+        if (group != nullptr)
+        {
+            // the wall switch is one more command of the member : the group owns its motion and relays
+            if (event == InterruptState_t::Stop)
+                group->Stop(groupId, group->NowMs());
+            else
+                group->SetTarget(groupId, (event == InterruptState_t::Up) ? 100 : 0, group->NowMs());
+            continue;
+        }
+        timerIntr->stop();
+        motion.SetTravel(UpTime, DownTime);
+        switch (event)
+        {
+        case InterruptState_t::Up:
+        case InterruptState_t::Down:
+        {
+            movingDirection = (event == InterruptState_t::Up) ? Direction_UP : Direction_Down;
+            const uint32_t runMs = motion.Run((event == InterruptState_t::Up) ? BlindMotion::DIR_UP : BlindMotion::DIR_DOWN, edgeMs);
+            if (runMs == 0)
             {
-                movingDirection = MovingDirection_t::Direction_Stop;
-            }
+                Settle(motion.Finish(NowMs()));
+                break;
             }
+            isBusy = true;
+            ESP_LOGI(TAG, "%s INTR", (event == InterruptState_t::Up) ? "UP" : "DOWN");
+            // the edge was seen 30 ms ago
+            const uint32_t elapsed = NowMs() - edgeMs;
+            timerIntr->start_once(std::chrono::milliseconds(runMs > elapsed ? runMs - elapsed : 1));
+            loop->post_event(EVENT_BLIND_CHNAGED, std::chrono::milliseconds(20));
+        }
+        break;
+        case InterruptState_t::Stop:
+        {
+            if (motion.IsMoving())
+                Settle(motion.Stop(edgeMs));
+        }
+        break;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(30));
-        //xQueueReset(InterruptQueue);
     }
-
 }
 
 void Blind::up_isr_handler(void* arg)
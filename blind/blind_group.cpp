@@ -0,0 +1,364 @@
+#include "blind_group.hpp"
+#include <algorithm>
+#include <chrono>
+
+BlindGroup::BlindGroup(uint8_t _maxMotors, uint16_t _staggerMs, TimerWheel *_wheel)
+    : maxMotors(_maxMotors > 0 ? _maxMotors : 1),
+      staggerMs(_staggerMs),
+      wheel(_wheel)
+{
+    if (wheel != nullptr)
+    {
+        timer = std::make_unique<WheelTimer>([this]()
+                                             { Poll(NowMs()); },
+                                             "blind group", *wheel);
+    }
+}
+
+BlindGroup::~BlindGroup()
+{
+    // waits for a running pass
+    timer.reset();
+}
+
+esp_err_t BlindGroup::Add(BlindMotion &motion, Relay_t relay, void *ctx, uint8_t *id)
+{
+    if (relay == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    if (members.size() >= UINT8_MAX)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    Member_t member{};
+    member.motion = &motion;
+    member.relay = relay;
+    member.ctx = ctx;
+    member.state = IDLE;
+    member.direction = BlindMotion::DIR_NONE;
+    if (id != nullptr)
+    {
+        *id = static_cast<uint8_t>(members.size());
+    }
+    members.push_back(member);
+    return ESP_OK;
+}
+
+void BlindGroup::SetHandler(Handler_t _handler, void *ctx)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    handler = _handler;
+    handlerCtx = ctx;
+}
+
+esp_err_t BlindGroup::SetTargets(const Target_t *targets, size_t count, uint32_t nowMs)
+{
+    bool report = false;
+    EventKind_t kind = BATCH_STARTED;
+    Summary_t summary{};
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (targets[i].member >= members.size() || targets[i].position < 0 || targets[i].position > 100)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            Queue(targets[i].member, targets[i].position, nowMs);
+        }
+        Arm(PassLocked(nowMs, report, kind, summary));
+    }
+    Report(report, kind, summary);
+    return ESP_OK;
+}
+
+esp_err_t BlindGroup::SetTarget(uint8_t member, float position, uint32_t nowMs)
+{
+    const Target_t target{member, position};
+    return SetTargets(&target, 1, nowMs);
+}
+
+esp_err_t BlindGroup::SetAll(float position, uint32_t nowMs)
+{
+    std::vector<Target_t> targets;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        targets.reserve(members.size());
+        for (uint8_t id = 0; id < members.size(); id++)
+        {
+            targets.push_back({id, position});
+        }
+    }
+    return SetTargets(targets.data(), targets.size(), nowMs);
+}
+
+esp_err_t BlindGroup::Stop(uint8_t id, uint32_t nowMs)
+{
+    bool report = false;
+    EventKind_t kind = BATCH_DONE;
+    Summary_t summary{};
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (id >= members.size())
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        Member_t &member = members[id];
+        if (member.state == RUNNING)
+        {
+            StopMember(id, member, nowMs, false);
+        }
+        member.state = IDLE;
+        queue.erase(std::remove(queue.begin(), queue.end(), id), queue.end());
+        Arm(PassLocked(nowMs, report, kind, summary));
+    }
+    Report(report, kind, summary);
+    return ESP_OK;
+}
+
+void BlindGroup::StopAll(uint32_t nowMs)
+{
+    bool report = false;
+    EventKind_t kind = BATCH_DONE;
+    Summary_t summary{};
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.clear();
+        for (uint8_t id = 0; id < members.size(); id++)
+        {
+            Member_t &member = members[id];
+            if (member.state == RUNNING)
+            {
+                StopMember(id, member, nowMs, false);
+            }
+            member.state = IDLE;
+        }
+        PassLocked(nowMs, report, kind, summary);
+    }
+    Report(report, kind, summary);
+}
+
+uint32_t BlindGroup::Poll(uint32_t nowMs)
+{
+    bool report = false;
+    EventKind_t kind = BATCH_DONE;
+    Summary_t summary{};
+    uint32_t next;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        next = PassLocked(nowMs, report, kind, summary);
+        Arm(next);
+    }
+    Report(report, kind, summary);
+    return next;
+}
+
+/**
+ * @brief new target for a member, under the lock
+ */
+void BlindGroup::Queue(uint8_t id, float position, uint32_t nowMs)
+{
+    Member_t &member = members[id];
+    member.target = position;
+    switch (member.state)
+    {
+    case RUNNING:
+    {
+        const uint32_t runMs = member.motion->MoveTo(position, nowMs);
+        if (runMs == 0)
+        {
+            StopMember(id, member, nowMs, true);
+        }
+        else if (member.motion->GetDirection() == member.direction)
+        {
+            // same direction : the relay stays on, only the stop moves
+            member.stopMs = nowMs + runMs;
+        }
+        else
+        {
+            // reversing is a new motor start : it waits for a slot like the others
+            StopMember(id, member, nowMs, false);
+            member.state = QUEUED;
+            queue.push_back(id);
+        }
+        break;
+    }
+    case QUEUED:
+        break;
+    case IDLE:
+        if (member.motion->Position(nowMs) != position)
+        {
+            member.state = QUEUED;
+            queue.push_back(id);
+        }
+        break;
+    }
+}
+
+void BlindGroup::StopMember(uint8_t id, Member_t &member, uint32_t nowMs, bool arrived)
+{
+    if (arrived)
+    {
+        member.motion->Finish(nowMs);
+    }
+    else
+    {
+        member.motion->Stop(nowMs);
+    }
+    member.relay(member.ctx, id, BlindMotion::DIR_NONE);
+    member.state = IDLE;
+    member.direction = BlindMotion::DIR_NONE;
+    running--;
+    stats.stops++;
+}
+
+uint32_t BlindGroup::PassLocked(uint32_t nowMs, bool &report, EventKind_t &kind, Summary_t &summary)
+{
+    stats.passes++;
+    // arrived members first : they free motor slots
+    for (uint8_t id = 0; id < members.size(); id++)
+    {
+        Member_t &member = members[id];
+        if (member.state == RUNNING && static_cast<int32_t>(nowMs - member.stopMs) >= 0)
+        {
+            StopMember(id, member, nowMs, true);
+        }
+    }
+    // staggered starts
+    while (!queue.empty() && running < maxMotors && (!started || nowMs - lastStartMs >= staggerMs))
+    {
+        const uint8_t id = queue.front();
+        queue.pop_front();
+        Member_t &member = members[id];
+        if (member.state != QUEUED)
+        {
+            continue;
+        }
+        const uint32_t runMs = member.motion->MoveTo(member.target, nowMs);
+        if (runMs == 0)
+        {
+            member.state = IDLE;
+            continue;
+        }
+        member.state = RUNNING;
+        member.direction = member.motion->GetDirection();
+        member.stopMs = nowMs + runMs;
+        member.relay(member.ctx, id, member.direction);
+        running++;
+        started = true;
+        lastStartMs = nowMs;
+        stats.starts++;
+    }
+    if (queue.size() > stats.maxQueued)
+    {
+        stats.maxQueued = queue.size();
+    }
+
+    // one event per batch edge
+    const bool busy = running > 0 || !queue.empty();
+    if (busy && !batchActive)
+    {
+        batchActive = true;
+        batchStartMs = nowMs;
+        report = true;
+        kind = BATCH_STARTED;
+    }
+    else if (!busy && batchActive)
+    {
+        batchActive = false;
+        started = false;
+        report = true;
+        kind = BATCH_DONE;
+    }
+    summary.members = static_cast<uint8_t>(members.size());
+    summary.running = running;
+    summary.queued = static_cast<uint8_t>(queue.size());
+    summary.batchMs = (report && kind == BATCH_DONE) ? nowMs - batchStartMs : 0;
+    if (report && handler != nullptr)
+    {
+        stats.events++;
+    }
+
+    // next start or stop
+    uint32_t next = NO_DEADLINE;
+    for (const Member_t &member : members)
+    {
+        if (member.state == RUNNING)
+        {
+            const int32_t left = static_cast<int32_t>(member.stopMs - nowMs);
+            next = std::min<uint32_t>(next, left > 0 ? left : 0);
+        }
+    }
+    if (!queue.empty() && running < maxMotors)
+    {
+        const uint32_t since = nowMs - lastStartMs;
+        next = std::min<uint32_t>(next, since < staggerMs ? staggerMs - since : 0);
+    }
+    return next;
+}
+
+/**
+ * @brief under the lock : start() does not wait for the callback, stop() would.
+ * an idle group leaves its one-shot timer to expire
+ */
+void BlindGroup::Arm(uint32_t delayMs)
+{
+    if (timer == nullptr || delayMs == NO_DEADLINE)
+    {
+        return;
+    }
+    timer->start_once(std::chrono::milliseconds(delayMs > 0 ? delayMs : 1));
+}
+
+void BlindGroup::Report(bool report, EventKind_t kind, const Summary_t &summary)
+{
+    Handler_t cb;
+    void *ctx;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        cb = handler;
+        ctx = handlerCtx;
+    }
+    if (report && cb != nullptr)
+    {
+        cb(ctx, kind, summary);
+    }
+}
+
+uint32_t BlindGroup::NowMs() const
+{
+    if (wheel != nullptr)
+    {
+        return static_cast<uint32_t>(wheel->NowUs() / 1000);
+    }
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool BlindGroup::IsBusy()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return batchActive;
+}
+
+uint8_t BlindGroup::GetCount()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return static_cast<uint8_t>(members.size());
+}
+
+BlindGroup::Stats_t BlindGroup::GetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void BlindGroup::ResetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stats = Stats_t{};
+}
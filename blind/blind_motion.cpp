@@ -0,0 +1,248 @@
+#include "blind_motion.hpp"
+#include "text_tools.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+esp_err_t BlindMotion::SetProfile(const Profile_t &_profile)
+{
+    if (_profile.upMs == 0 || _profile.downMs == 0 || !CurveValid(_profile.upCurve) || !CurveValid(_profile.downCurve))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    profile = _profile;
+    return ESP_OK;
+}
+
+BlindMotion::Profile_t BlindMotion::GetProfile() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return profile;
+}
+
+void BlindMotion::SetTravel(uint32_t upMs, uint32_t downMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (upMs > 0)
+        profile.upMs = upMs;
+    if (downMs > 0)
+        profile.downMs = downMs;
+}
+
+void BlindMotion::SetPosition(float _position)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    position = std::fmin(std::fmax(_position, 0.0f), 100.0f);
+    target = position;
+    direction = DIR_NONE;
+}
+
+uint32_t BlindMotion::MoveTo(float _target, uint32_t nowMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    _target = std::fmin(std::fmax(_target, 0.0f), 100.0f);
+    const Direction_t previous = direction;
+    uint32_t delayLeft = profile.startDelayMs;
+    if (previous != DIR_NONE)
+    {
+        // the motor keeps running in the same direction : only the rest of the start delay is left
+        const uint32_t elapsed = nowMs - startMs;
+        const uint32_t previousDelay = delayMs;
+        StopLocked(nowMs);
+        delayLeft = (elapsed < previousDelay) ? previousDelay - elapsed : 0;
+    }
+    if (_target == position)
+    {
+        return 0;
+    }
+    const Direction_t next = (_target > position) ? DIR_UP : DIR_DOWN;
+    if (next != previous)
+    {
+        delayLeft = profile.startDelayMs;
+    }
+    const uint16_t(&curve)[CURVE_POINTS] = (next == DIR_UP) ? profile.upCurve : profile.downCurve;
+    const uint32_t travelMs = (next == DIR_UP) ? profile.upMs : profile.downMs;
+    const float share = std::fabs(Share(curve, _target) - Share(curve, position));
+    direction = next;
+    target = _target;
+    startMs = nowMs;
+    delayMs = delayLeft;
+    runMs = delayLeft + static_cast<uint32_t>(std::lround(share * travelMs / CURVE_FULL));
+    if (runMs == 0)
+    {
+        runMs = 1;
+    }
+    return runMs;
+}
+
+uint32_t BlindMotion::Run(Direction_t _direction, uint32_t nowMs)
+{
+    if (_direction == DIR_NONE)
+    {
+        Stop(nowMs);
+        return 0;
+    }
+    return MoveTo((_direction == DIR_UP) ? 100 : 0, nowMs);
+}
+
+float BlindMotion::Stop(uint32_t nowMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return StopLocked(nowMs);
+}
+
+float BlindMotion::StopLocked(uint32_t nowMs)
+{
+    position = PositionLocked(nowMs, true);
+    target = position;
+    direction = DIR_NONE;
+    return position;
+}
+
+float BlindMotion::Finish(uint32_t nowMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return StopLocked(nowMs);
+}
+
+float BlindMotion::Position(uint32_t nowMs) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return PositionLocked(nowMs);
+}
+
+float BlindMotion::PositionLocked(uint32_t nowMs, bool overrun) const
+{
+    if (direction == DIR_NONE)
+    {
+        return position;
+    }
+    uint32_t elapsed = nowMs - startMs;
+    if (elapsed >= runMs && !overrun)
+    {
+        return target;
+    }
+    if (elapsed <= delayMs)
+    {
+        return position;
+    }
+    elapsed -= delayMs;
+    const uint16_t(&curve)[CURVE_POINTS] = (direction == DIR_UP) ? profile.upCurve : profile.downCurve;
+    const uint32_t travelMs = (direction == DIR_UP) ? profile.upMs : profile.downMs;
+    const float moved = static_cast<float>(elapsed) * CURVE_FULL / travelMs;
+    const float share = Share(curve, position);
+    if (direction == DIR_UP)
+    {
+        const float estimate = Inverse(curve, share + moved);
+        return overrun ? estimate : std::fmin(estimate, target);
+    }
+    const float estimate = Inverse(curve, share - moved);
+    return overrun ? estimate : std::fmax(estimate, target);
+}
+
+float BlindMotion::GetTarget() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return target;
+}
+
+BlindMotion::Direction_t BlindMotion::GetDirection() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return direction;
+}
+
+bool BlindMotion::IsMoving() const
+{
+    return GetDirection() != DIR_NONE;
+}
+
+bool BlindMotion::CurveValid(const uint16_t (&curve)[CURVE_POINTS])
+{
+    if (curve[0] != 0 || curve[CURVE_POINTS - 1] != CURVE_FULL)
+    {
+        return false;
+    }
+    for (uint8_t i = 1; i < CURVE_POINTS; i++)
+    {
+        if (curve[i] <= curve[i - 1])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+float BlindMotion::Share(const uint16_t (&curve)[CURVE_POINTS], float _position)
+{
+    const float knot = std::fmin(std::fmax(_position, 0.0f), 100.0f) / 10.0f;
+    const uint8_t i = (knot >= CURVE_POINTS - 1) ? CURVE_POINTS - 2 : static_cast<uint8_t>(knot);
+    return curve[i] + (knot - i) * (curve[i + 1] - curve[i]);
+}
+
+float BlindMotion::Inverse(const uint16_t (&curve)[CURVE_POINTS], float share)
+{
+    if (share <= 0)
+    {
+        return 0;
+    }
+    if (share >= CURVE_FULL)
+    {
+        return 100;
+    }
+    uint8_t i = 0;
+    while (i < CURVE_POINTS - 2 && share > curve[i + 1])
+    {
+        i++;
+    }
+    return 10.0f * (i + (share - curve[i]) / (curve[i + 1] - curve[i]));
+}
+
+esp_err_t BlindMotion::ParseCurve(const std::string &str, uint16_t (&curve)[CURVE_POINTS])
+{
+    uint16_t parsed[CURVE_POINTS];
+    uint8_t i = 0;
+    for (const std::string_view cell : text::Split(str, ','))
+    {
+        if (i == CURVE_POINTS || text::Parse(text::Trim(cell), parsed[i]) != ESP_OK || parsed[i] > CURVE_FULL)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        i++;
+    }
+    if (i != CURVE_POINTS || text::EndsWith(str, ",") || !CurveValid(parsed))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::copy(parsed, parsed + CURVE_POINTS, curve);
+    return ESP_OK;
+}
+
+esp_err_t BlindMotion::ParsePercentage(const std::string &str, uint8_t &percentage)
+{
+    std::string_view payload = text::Trim(str);
+    if (text::EndsWith(payload, "%"))
+    {
+        payload = text::TrimRight(payload.substr(0, payload.size() - 1));
+    }
+    uint8_t parsed = 0;
+    if (text::Parse(payload, parsed) != ESP_OK || parsed > 100)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    percentage = parsed;
+    return ESP_OK;
+}
+
+std::string BlindMotion::CurveToString(const uint16_t (&curve)[CURVE_POINTS])
+{
+    std::string str;
+    for (uint8_t i = 0; i < CURVE_POINTS; i++)
+    {
+        if (i > 0)
+            str += ',';
+        str += std::to_string(curve[i]);
+    }
+    return str;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file test_blind_group.cpp
+ * @brief BlindGroup with mocked relays and a simulated clock ( manual Poll ) : motor slots, stagger,
+ * one event per batch, single member stop and re-plan. the benchmark closes 16 and 64 blinds and
+ * compares the events and completion time with independent blinds ( ./host_test/run.sh blind_group )
+ */
+#include "blind_group.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+
+// the mocked gpio layer : relay state of every member
+struct Relays_t
+{
+    std::vector<int> level; // +1 up, -1 down, 0 off
+    uint32_t nowMs = 0;
+    int on = 0;
+    int maxOn = 0;
+    uint32_t lastStartMs = 0;
+    uint32_t minGapMs = UINT32_MAX;
+    bool started = false;
+    bool bothOn = false;
+
+    static void Hook(void *ctx, uint8_t member, BlindMotion::Direction_t direction)
+    {
+        Relays_t *_this = static_cast<Relays_t *>(ctx);
+        int &level = _this->level[member];
+        if (direction == BlindMotion::DIR_NONE)
+        {
+            _this->on -= (level != 0);
+            level = 0;
+            return;
+        }
+        // a start on an energized member would mean both relays on
+        _this->bothOn |= (level != 0);
+        level = (direction == BlindMotion::DIR_UP) ? 1 : -1;
+        _this->on++;
+        _this->maxOn = std::max(_this->maxOn, _this->on);
+        if (_this->started)
+        {
+            _this->minGapMs = std::min(_this->minGapMs, _this->nowMs - _this->lastStartMs);
+        }
+        _this->started = true;
+        _this->lastStartMs = _this->nowMs;
+    }
+};
+
+struct Events_t
+{
+    int started = 0;
+    int done = 0;
+    uint32_t batchMs = 0;
+
+    static void Handler(void *ctx, BlindGroup::EventKind_t kind, const BlindGroup::Summary_t &summary)
+    {
+        Events_t *_this = static_cast<Events_t *>(ctx);
+        if (kind == BlindGroup::BATCH_STARTED)
+        {
+            _this->started++;
+        }
+        else
+        {
+            _this->done++;
+            _this->batchMs = summary.batchMs;
+        }
+    }
+};
+
+struct Fixture_t
+{
+    std::vector<std::unique_ptr<BlindMotion>> motions;
+    Relays_t relays;
+    Events_t events;
+    BlindGroup group;
+
+    Fixture_t(int count, uint8_t maxMotors, uint16_t staggerMs, uint32_t seed)
+        : group(maxMotors, staggerMs, nullptr)
+    {
+        std::mt19937 rng(seed);
+        group.SetHandler(Events_t::Handler, &events);
+        relays.level.assign(count, 0);
+        for (int i = 0; i < count; i++)
+        {
+            motions.emplace_back(new BlindMotion());
+            BlindMotion::Profile_t profile;
+            profile.upMs = profile.downMs = std::uniform_int_distribution<int>(12000, 20000)(rng);
+            profile.startDelayMs = 150;
+            motions.back()->SetProfile(profile);
+            motions.back()->SetPosition(std::uniform_int_distribution<int>(40, 100)(rng));
+            group.Add(*motions.back(), Relays_t::Hook, &relays);
+        }
+        relays.nowMs = 1000;
+    }
+
+    // the mocked timer : jump to every deadline the group asks for
+    uint32_t Run(uint32_t next, uint32_t untilMs = UINT32_MAX)
+    {
+        while (next != BlindGroup::NO_DEADLINE && relays.nowMs + next < untilMs)
+        {
+            relays.nowMs += next;
+            next = group.Poll(relays.nowMs);
+        }
+        return next;
+    }
+};
+
+static void TestBatch()
+{
+    Fixture_t f(10, 3, 250, 1);
+    f.group.SetAll(0, f.relays.nowMs);
+    f.Run(f.group.Poll(f.relays.nowMs));
+    CHECK_EQ(f.events.started, 1);
+    CHECK_EQ(f.events.done, 1);
+    CHECK(f.relays.maxOn <= 3);
+    CHECK(f.relays.minGapMs >= 250);
+    CHECK(!f.relays.bothOn);
+    CHECK_EQ(f.relays.on, 0);
+    CHECK(!f.group.IsBusy());
+    for (auto &motion : f.motions)
+    {
+        CHECK(motion->Position(f.relays.nowMs) < 0.01f);
+    }
+    const BlindGroup::Stats_t stats = f.group.GetStats();
+    CHECK_EQ(stats.starts, 10u);
+    CHECK_EQ(stats.stops, 10u);
+    CHECK_EQ(stats.events, 2u);
+}
+
+static void TestStopMember()
+{
+    Fixture_t f(4, 1, 100, 2);
+    f.group.SetAll(0, f.relays.nowMs);
+    // member 0 runs, the others wait for the single slot
+    uint32_t next = f.Run(f.group.Poll(f.relays.nowMs), f.relays.nowMs + 1000);
+    CHECK_EQ(f.relays.on, 1);
+    int runningId = -1;
+    for (size_t i = 0; i < f.relays.level.size(); i++)
+    {
+        if (f.relays.level[i] != 0)
+        {
+            runningId = static_cast<int>(i);
+        }
+    }
+    CHECK(runningId >= 0);
+    const float stoppedAt = f.motions[runningId]->Position(f.relays.nowMs);
+    CHECK_EQ(f.group.Stop(static_cast<uint8_t>(runningId), f.relays.nowMs), ESP_OK);
+    CHECK_EQ(f.relays.level[runningId], 0);
+    CHECK(std::fabs(f.motions[runningId]->Position(f.relays.nowMs) - stoppedAt) < 0.01f);
+    // a queued member dropped before its start
+    const uint8_t queuedId = static_cast<uint8_t>((runningId + 1) % 4);
+    const float queuedAt = f.motions[queuedId]->Position(f.relays.nowMs);
+    CHECK_EQ(f.group.Stop(queuedId, f.relays.nowMs), ESP_OK);
+    CHECK_EQ(f.group.Stop(200, f.relays.nowMs), ESP_ERR_INVALID_ARG);
+    next = f.group.Poll(f.relays.nowMs);
+    f.Run(next);
+    CHECK(!f.relays.bothOn);
+    CHECK_EQ(f.relays.on, 0);
+    CHECK_EQ(f.events.done, 1);
+    CHECK(std::fabs(f.motions[queuedId]->Position(f.relays.nowMs) - queuedAt) < 0.01f);
+    CHECK(std::fabs(f.motions[runningId]->Position(f.relays.nowMs) - stoppedAt) < 0.01f);
+    CHECK_EQ(f.group.GetStats().starts, 3u); // the stopped one and the two others
+}
+
+static void TestReverse()
+{
+    Fixture_t f(2, 2, 50, 3);
+    f.group.SetAll(0, f.relays.nowMs);
+    f.Run(f.group.Poll(f.relays.nowMs), f.relays.nowMs + 2000);
+    CHECK_EQ(f.relays.level[0], -1);
+    // reversing switches the down relay off before the up one goes on
+    f.group.SetTarget(0, 100, f.relays.nowMs);
+    f.Run(f.group.Poll(f.relays.nowMs));
+    CHECK(!f.relays.bothOn);
+    CHECK(f.motions[0]->Position(f.relays.nowMs) > 99.99f);
+    CHECK(f.motions[1]->Position(f.relays.nowMs) < 0.01f);
+    CHECK_EQ(f.events.started, 1);
+    CHECK_EQ(f.events.done, 1);
+}
+
+static void Bench()
+{
+    for (int count : {16, 64})
+    {
+        for (uint8_t maxMotors : {4, 8})
+        {
+            Fixture_t f(count, maxMotors, 250, count);
+            // independent blinds : all relays at once, CHANGED on start and STOPPED per blind
+            uint32_t aloneMs = 0;
+            for (auto &motion : f.motions)
+            {
+                BlindMotion alone;
+                alone.SetProfile(motion->GetProfile());
+                alone.SetPosition(motion->Position(0));
+                aloneMs = std::max(aloneMs, alone.MoveTo(0, 0));
+            }
+            const uint32_t startMs = f.relays.nowMs;
+            f.group.SetAll(0, f.relays.nowMs);
+            f.Run(f.group.Poll(f.relays.nowMs));
+            const BlindGroup::Stats_t stats = f.group.GetStats();
+            CHECK(f.relays.maxOn <= maxMotors);
+            CHECK_EQ(f.events.done, 1);
+            printf("%2d blinds, %d motors : %u events ( independent %d ), done in %.1f s ( independent %.1f s, %d motors at once ), "
+                   "%u passes, %u starts, min start gap %u ms\n",
+                   count, maxMotors, stats.events, 2 * count, (f.relays.nowMs - startMs) / 1000.0, aloneMs / 1000.0, count,
+                   stats.passes, stats.starts, f.relays.minGapMs);
+        }
+    }
+}
+
+int main()
+{
+    TestBatch();
+    TestStopMember();
+    TestReverse();
+    Bench();
+    HOST_TEST_END();
+}
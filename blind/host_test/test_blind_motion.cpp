@@ -0,0 +1,185 @@
+/**
+ * @file test_blind_motion.cpp
+ * @brief BlindMotion against an independent model of the blind : random profiles ( travel times, speed
+ * curves, start delay ), random moves, runs, re-plans and cancels. checks the position estimate and counts
+ * the timer wakeups, one per move where the 1 % ticks took one per percent ( ./host_test/run.sh blind_motion )
+ */
+#include "blind_motion.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// the blind : moves along its speed curve once the relay has been on startDelayMs in one direction
+struct Physics_t
+{
+    BlindMotion::Profile_t profile;
+    double position = 0;
+    int relay = 0; // +1 up, -1 down
+    double onMs = 0;
+
+    void Run(int newRelay, double ms)
+    {
+        if (newRelay != relay)
+        {
+            relay = newRelay;
+            onMs = 0;
+        }
+        if (relay == 0)
+        {
+            return;
+        }
+        onMs += ms;
+        double moving = std::min(ms, onMs - profile.startDelayMs);
+        const uint16_t *curve = (relay > 0) ? profile.upCurve : profile.downCurve;
+        const double travelMs = (relay > 0) ? profile.upMs : profile.downMs;
+        while (moving > 1e-9 && !((relay > 0 && position >= 100) || (relay < 0 && position <= 0)))
+        {
+            const int segment = (relay > 0) ? std::min(9, static_cast<int>(std::floor(position / 10)))
+                                            : std::max(0, static_cast<int>(std::ceil(position / 10)) - 1);
+            const double speed = 10.0 / (travelMs * (curve[segment + 1] - curve[segment]) / BlindMotion::CURVE_FULL); // % per ms
+            const double edge = (relay > 0) ? (segment + 1) * 10.0 : segment * 10.0;
+            const double needMs = std::fabs(edge - position) / speed;
+            if (needMs >= moving)
+            {
+                position += relay * speed * moving;
+                moving = 0;
+            }
+            else
+            {
+                position = edge;
+                moving -= needMs;
+            }
+        }
+    }
+};
+
+static void RandomCurve(std::mt19937 &rng, uint16_t (&curve)[BlindMotion::CURVE_POINTS])
+{
+    double weight[10];
+    double total = 0;
+    for (double &w : weight)
+    {
+        w = std::uniform_real_distribution<double>(0.5, 2)(rng);
+        total += w;
+    }
+    double sum = 0;
+    curve[0] = 0;
+    for (int i = 1; i < 10; i++)
+    {
+        sum += weight[i - 1];
+        curve[i] = static_cast<uint16_t>(std::lround(sum / total * BlindMotion::CURVE_FULL));
+    }
+    curve[10] = BlindMotion::CURVE_FULL;
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    auto between = [&rng](int low, int high) { return std::uniform_int_distribution<int>(low, high)(rng); };
+    double maxError = 0;
+    double sumError = 0;
+    long checked = 0;
+    long moves = 0;
+    long wakeups = 0;
+    long tickWakeups = 0;
+    int rejected = 0;
+    for (int sequence = 0; sequence < 200; sequence++)
+    {
+        BlindMotion motion;
+        BlindMotion::Profile_t profile;
+        profile.upMs = between(8000, 30000);
+        profile.downMs = between(8000, 30000);
+        profile.startDelayMs = between(0, 400);
+        RandomCurve(rng, profile.upCurve);
+        RandomCurve(rng, profile.downCurve);
+        rejected += (motion.SetProfile(profile) != ESP_OK);
+        Physics_t blind;
+        blind.profile = profile;
+        double t = 0;
+        uint32_t nowMs = 0;
+        // open loop, like the relays : the error of each move is measured from where the model thinks it started
+        auto check = [&](float estimate) {
+            const double error = std::fabs(estimate - blind.position);
+            maxError = std::max(maxError, error);
+            sumError += error;
+            checked++;
+            blind.position = estimate;
+        };
+        for (int op = 0; op < 50; op++)
+        {
+            const int kind = between(0, 9);
+            const uint32_t runMs = (kind < 7) ? motion.MoveTo(between(0, 100), nowMs)
+                                              : motion.Run((kind == 7) ? BlindMotion::DIR_UP : BlindMotion::DIR_DOWN, nowMs);
+            moves++;
+            if (runMs == 0)
+            {
+                blind.Run(0, 0);
+                continue;
+            }
+            const int relay = (motion.GetDirection() == BlindMotion::DIR_UP) ? 1 : -1;
+            wakeups++; // one one-shot timer for the whole move
+            tickWakeups += std::lround(std::fabs(motion.GetTarget() - motion.Position(nowMs)));
+            // the timer fires up to 1 ms late, unless the move is cancelled ( 1 ) or re-planned ( 2 ) before
+            const int outcome = between(0, 2);
+            double untilMs = nowMs + runMs + std::uniform_real_distribution<double>(0, 1)(rng);
+            if (outcome != 0)
+            {
+                untilMs = nowMs + between(0, runMs);
+            }
+            blind.Run(relay, untilMs - t);
+            t = untilMs;
+            nowMs = static_cast<uint32_t>(std::floor(t));
+            if (outcome == 2)
+            {
+                check(motion.Position(nowMs)); // still moving : the next op re-plans from here
+                continue;
+            }
+            check((outcome == 1) ? motion.Stop(nowMs) : motion.Finish(nowMs));
+            CHECK(!motion.IsMoving());
+            blind.Run(0, 0);
+            nowMs += between(1, 2000); // relays off : the next command starts on a whole ms
+            t = nowMs;
+        }
+    }
+    printf("%ld moves, %ld checks : position error %.4f %% average, %.4f %% max\n", moves, checked, sumError / checked, maxError);
+    printf("timer wakeups %ld, %ld with 1 %% ticks\n", wakeups, tickWakeups);
+    CHECK_EQ(rejected, 0);
+    CHECK(moves >= 10000);
+    CHECK(maxError < 0.05);
+    CHECK(wakeups <= moves);
+    CHECK(wakeups * 10 < tickWakeups);
+
+    // profile checks
+    BlindMotion motion;
+    BlindMotion::Profile_t bad;
+    bad.upCurve[5] = bad.upCurve[4];
+    CHECK(motion.SetProfile(bad) == ESP_ERR_INVALID_ARG);
+    bad = BlindMotion::Profile_t();
+    bad.downMs = 0;
+    CHECK(motion.SetProfile(bad) == ESP_ERR_INVALID_ARG);
+    uint16_t curve[BlindMotion::CURVE_POINTS];
+    CHECK(BlindMotion::ParseCurve("0,50,150,250,350,450,550,650,750,900,1000", curve) == ESP_OK);
+    CHECK_EQ(curve[1], 50);
+    CHECK(BlindMotion::CurveToString(curve) == "0,50,150,250,350,450,550,650,750,900,1000");
+    CHECK(BlindMotion::ParseCurve("0,50,150", curve) == ESP_ERR_INVALID_ARG);
+    CHECK(BlindMotion::ParseCurve("0,50,40,250,350,450,550,650,750,900,1000", curve) == ESP_ERR_INVALID_ARG);
+    uint8_t percentage = 7;
+    CHECK(BlindMotion::ParsePercentage(" 42 \r\n", percentage) == ESP_OK);
+    CHECK_EQ(percentage, 42);
+    CHECK(BlindMotion::ParsePercentage("100 %", percentage) == ESP_OK);
+    CHECK_EQ(percentage, 100);
+    // no wrap : "300" was 44, "-1" was 255
+    for (const char *bad : {"300", "256", "101", "-1", "", "%", "abc", "4 2", "42%%"})
+    {
+        CHECK(BlindMotion::ParsePercentage(bad, percentage) == ESP_ERR_INVALID_ARG);
+    }
+    CHECK_EQ(percentage, 100);
+
+    // a full run at the default 15 s, no start delay
+    motion.SetPosition(0);
+    CHECK_EQ(motion.MoveTo(100, 0), 15000u);
+    CHECK(std::fabs(motion.Position(7500) - 50) < 0.01);
+    CHECK(std::fabs(motion.Finish(15000) - 100) < 0.01);
+    HOST_TEST_END();
+}
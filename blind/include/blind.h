@@ -8,10 +8,11 @@
 #include <string>
 #include "FreeRTOS.hpp"
 #include "homeassistant.h"
+#include "timer_wheel.hpp"
+#include "blind_motion.hpp"
+#include "blind_group.hpp"
 #include <memory>
 
-#define DEFAULT_UP_DOWN_TIME_MS 15000
-
 class Blind
 {
     public:
@@ -33,9 +34,12 @@ class Blind
     uint8_t GetTargetPerc()const;
     void Cancel();
     bool IsBusy()const;
+    BlindMotion& GetMotion() { return motion; }
+    // the moves of this blind are then scheduled by the group, with its aggregated events
+    esp_err_t JoinGroup(BlindGroup& group, uint8_t* id = nullptr);
     esp_err_t mqtt_callback(const std::string& topic, const std::string& data);
-    std::unique_ptr<ESPTimer> timer{ nullptr };
-    std::unique_ptr<ESPTimer> timerIntr{ nullptr };
+    WheelTimer_p_t timer{ nullptr };
+    WheelTimer_p_t timerIntr{ nullptr };
     std::string GetStatusStr()const;
     const Event_t EVENT_BLIND_STOPPED = { TAG, EventID_t(2) };
     const Event_t EVENT_BLIND_CHNAGED = { TAG, EventID_t(3) };
@@ -51,6 +55,10 @@ class Blind
     gpio_num_t pin_up, pin_down;
     uint8_t last_perc = 0;
     uint8_t perc = 0;
+    BlindMotion motion;
+    // set by JoinGroup() : every command then goes through the group
+    BlindGroup* group{ nullptr };
+    uint8_t groupId = 0;
     bool isBusy = false;
     bool commandMode = false;
     bool isInverted = false;
@@ -63,6 +71,9 @@ class Blind
     } InterruptState = InterruptState_t::Stop;
     void TimerExecute();
     void TimerExecuteIntr();
+    void Move(uint32_t runMs);
+    void Settle(float position, bool notify = true);
+    static void GroupRelay(void* ctx, uint8_t member, BlindMotion::Direction_t direction);
     void EnableInterrupt(const bool val);
     static void up_isr_handler(void* arg);
     static void down_isr_handler(void* arg);
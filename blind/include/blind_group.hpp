@@ -0,0 +1,156 @@
+#ifndef __BLIND_GROUP_H__
+#define __BLIND_GROUP_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "blind_motion.hpp"
+#include "timer_wheel.hpp"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#ifndef CONFIG_BLIND_GROUP_MAX_MOTORS
+#define CONFIG_BLIND_GROUP_MAX_MOTORS 4
+#endif
+#ifndef CONFIG_BLIND_GROUP_STAGGER_MS
+#define CONFIG_BLIND_GROUP_STAGGER_MS 250
+#endif
+
+/**
+ * @brief scene control for many blinds : batch targets are queued, relays are switched on one by one
+ * ( \c staggerMs apart ) with at most \c maxMotors motors running, and every member move is timed by
+ * one shared WheelTimer armed for the next start or stop of the group.
+ * a member is a BlindMotion plus a relay hook, see Blind::JoinGroup().
+ * the handler gets one event when a batch starts and one when every member is idle again,
+ * instead of one per blind.
+ *
+ *  BlindGroup group;
+ *  for (auto &blind : blinds) blind->JoinGroup(group);
+ *  group.SetAll(0, group.NowMs());   // close all
+ */
+class BlindGroup
+{
+public:
+    // relay hook : DIR_UP / DIR_DOWN motor on, DIR_NONE motor off ( the motion is already stopped )
+    using Relay_t = void (*)(void *ctx, uint8_t member, BlindMotion::Direction_t direction);
+    enum EventKind_t : uint8_t
+    {
+        BATCH_STARTED,
+        BATCH_DONE,
+    };
+    struct Summary_t
+    {
+        uint8_t members;
+        uint8_t running;
+        uint8_t queued;
+        uint32_t batchMs; // BATCH_DONE : first start to last stop
+    };
+    using Handler_t = void (*)(void *ctx, EventKind_t kind, const Summary_t &summary);
+    struct Target_t
+    {
+        uint8_t member;
+        float position;
+    };
+    struct Stats_t
+    {
+        uint32_t passes;    // scheduler passes ( timer wakeups and commands )
+        uint32_t starts;    // relays switched on
+        uint32_t stops;     // relays switched off
+        uint32_t events;    // handler calls
+        uint32_t maxQueued; // members waiting for a motor slot
+    };
+    static constexpr uint32_t NO_DEADLINE = UINT32_MAX;
+
+    /**
+     * @param wheel shared timing source, nullptr : nothing is armed, the caller drives Poll() ( tests, replays )
+     */
+    explicit BlindGroup(uint8_t maxMotors = CONFIG_BLIND_GROUP_MAX_MOTORS, uint16_t staggerMs = CONFIG_BLIND_GROUP_STAGGER_MS, TimerWheel *wheel = &TimerWheel::Default());
+    ~BlindGroup();
+    BlindGroup(const BlindGroup &) = delete;
+    BlindGroup &operator=(const BlindGroup &) = delete;
+
+    /**
+     * @brief add a member, its moves are then scheduled by the group only
+     *
+     * @return esp_err_t ESP_ERR_INVALID_ARG no relay hook, ESP_ERR_NO_MEM 255 members
+     */
+    esp_err_t Add(BlindMotion &motion, Relay_t relay, void *ctx, uint8_t *id = nullptr);
+    void SetHandler(Handler_t handler, void *ctx);
+
+    /**
+     * @brief queue a batch of targets, a running member is re-planned in place
+     * ( it only waits for a new slot if it has to reverse )
+     *
+     * @return esp_err_t ESP_ERR_INVALID_ARG unknown member or position out of 0 .. 100
+     */
+    esp_err_t SetTargets(const Target_t *targets, size_t count, uint32_t nowMs);
+    esp_err_t SetTarget(uint8_t member, float position, uint32_t nowMs);
+    esp_err_t SetAll(float position, uint32_t nowMs);
+    /**
+     * @brief one member off now, or its queued move dropped
+     *
+     * @return esp_err_t ESP_ERR_INVALID_ARG unknown member
+     */
+    esp_err_t Stop(uint8_t member, uint32_t nowMs);
+    // every relay off now, queued moves dropped
+    void StopAll(uint32_t nowMs);
+
+    /**
+     * @brief stop the members that arrived, start the queued ones that have a slot, report the batch.
+     * the shared timer calls it, manual groups ( no wheel ) call it at the returned deadline
+     *
+     * @return uint32_t ms until the next pass is needed, NO_DEADLINE : idle
+     */
+    uint32_t Poll(uint32_t nowMs);
+
+    uint32_t NowMs() const;
+    bool IsBusy();
+    uint8_t GetCount();
+    Stats_t GetStats();
+    void ResetStats();
+
+private:
+    enum State_t : uint8_t
+    {
+        IDLE,
+        QUEUED,
+        RUNNING,
+    };
+    struct Member_t
+    {
+        BlindMotion *motion;
+        Relay_t relay;
+        void *ctx;
+        float target;
+        uint32_t stopMs; // RUNNING : planned relay off
+        State_t state;
+        BlindMotion::Direction_t direction;
+    };
+
+    void Queue(uint8_t id, float position, uint32_t nowMs);
+    void StopMember(uint8_t id, Member_t &member, uint32_t nowMs, bool arrived);
+    // one pass under the lock, returns the next deadline and the event to send
+    uint32_t PassLocked(uint32_t nowMs, bool &report, EventKind_t &kind, Summary_t &summary);
+    void Arm(uint32_t delayMs);
+    void Report(bool report, EventKind_t kind, const Summary_t &summary);
+
+    const uint8_t maxMotors;
+    const uint16_t staggerMs;
+    TimerWheel *const wheel;
+    WheelTimer_p_t timer{nullptr};
+    std::mutex lock;
+    std::vector<Member_t> members;
+    std::deque<uint8_t> queue;
+    uint8_t running = 0;
+    bool batchActive = false;
+    bool started = false; // a relay was switched on since the batch began
+    uint32_t lastStartMs = 0;
+    uint32_t batchStartMs = 0;
+    Handler_t handler = nullptr;
+    void *handlerCtx = nullptr;
+    Stats_t stats{};
+};
+
+#endif // __BLIND_GROUP_H__
@@ -0,0 +1,104 @@
+#ifndef __BLIND_MOTION_H__
+#define __BLIND_MOTION_H__
+#pragma once
+
+#include "esp_err.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#ifndef DEFAULT_UP_DOWN_TIME_MS
+#define DEFAULT_UP_DOWN_TIME_MS 15000
+#endif
+
+/**
+ * @brief event driven blind motion model : a move is planned once, from the current position,
+ * the travel time of its direction, the speed curve and the motor start delay.
+ * the caller arms one one-shot timer with the returned run time, the live position
+ * is estimated on demand from the elapsed time.
+ * positions are 0 .. 100 %, UP raises the position.
+ *
+ *  uint32_t runMs = motion.MoveTo(40, now);   // relay on, timer->start_once(runMs)
+ *  motion.Position(now);                      // while moving
+ *  motion.Finish(now);                        // timer fired : relay off
+ */
+class BlindMotion
+{
+public:
+    enum Direction_t : uint8_t
+    {
+        DIR_NONE,
+        DIR_UP,
+        DIR_DOWN,
+    };
+    // curve knots at 0, 10 .. 100 %
+    static constexpr uint8_t CURVE_POINTS = 11;
+    static constexpr uint16_t CURVE_FULL = 1000;
+
+    struct Profile_t
+    {
+        uint32_t upMs = DEFAULT_UP_DOWN_TIME_MS;   // full travel 0 -> 100 %
+        uint32_t downMs = DEFAULT_UP_DOWN_TIME_MS; // full travel 100 -> 0 %
+        uint16_t startDelayMs = 0;                 // relay on -> blind moving
+        // share of the full travel time ( permille ) spent between 0 % and each knot,
+        // strictly increasing from 0 to CURVE_FULL. linear by default
+        uint16_t upCurve[CURVE_POINTS] = {0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000};
+        uint16_t downCurve[CURVE_POINTS] = {0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000};
+    };
+
+    /**
+     * @brief replace the profile, a running move keeps its plan
+     *
+     * @return esp_err_t ESP_ERR_INVALID_ARG null travel time or curve not strictly increasing from 0 to CURVE_FULL
+     */
+    esp_err_t SetProfile(const Profile_t &profile);
+    Profile_t GetProfile() const;
+    void SetTravel(uint32_t upMs, uint32_t downMs);
+    // idle position, e.g. restored from NVS
+    void SetPosition(float position);
+
+    /**
+     * @brief plan a move from the current position to \c target, a running move is replaced.
+     * the start delay is only paid again when the direction changes
+     *
+     * @return uint32_t relay on time until the stop, 0 : already there
+     */
+    uint32_t MoveTo(float target, uint32_t nowMs);
+    // move to the end stop of \c direction
+    uint32_t Run(Direction_t direction, uint32_t nowMs);
+    // relays off before the end of the move : the position is frozen at the estimate
+    float Stop(uint32_t nowMs);
+    // the stop timer fired : the position is the target, corrected by the timer lateness
+    float Finish(uint32_t nowMs);
+
+    float Position(uint32_t nowMs) const;
+    float GetTarget() const;
+    Direction_t GetDirection() const;
+    bool IsMoving() const;
+
+    // "0,100,200,..,1000" -> curve, checked like SetProfile()
+    static esp_err_t ParseCurve(const std::string &str, uint16_t (&curve)[CURVE_POINTS]);
+    static std::string CurveToString(const uint16_t (&curve)[CURVE_POINTS]);
+    // "42", " 42 \r\n" or "42%" -> 42, ESP_ERR_INVALID_ARG for anything else or over 100
+    static esp_err_t ParsePercentage(const std::string &str, uint8_t &percentage);
+
+private:
+    static bool CurveValid(const uint16_t (&curve)[CURVE_POINTS]);
+    // position -> time share, and back
+    static float Share(const uint16_t (&curve)[CURVE_POINTS], float position);
+    static float Inverse(const uint16_t (&curve)[CURVE_POINTS], float share);
+    // \c overrun : past the run time the blind keeps moving until the relay is really off
+    float PositionLocked(uint32_t nowMs, bool overrun = false) const;
+    float StopLocked(uint32_t nowMs);
+
+    mutable std::mutex lock;
+    Profile_t profile{};
+    Direction_t direction = DIR_NONE;
+    float position = 0;  // idle position, or where the running segment started
+    float target = 0;
+    uint32_t startMs = 0; // running segment start
+    uint32_t delayMs = 0; // start delay left at startMs
+    uint32_t runMs = 0;   // relay on time of the running segment
+};
+
+#endif // __BLIND_MOTION_H__
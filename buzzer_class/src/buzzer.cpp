@@ -9,12 +9,18 @@
 #if (DEBUG_BUZZER == VERBOS)
 #define LOG_BUZZER LOGI
 #define LOG_BUZZER_V LOGI
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_VERBOSE
 #elif (DEBUG_BUZZER == INFO)
 #define LOG_BUZZER LOGI
 #define LOG_BUZZER_V LOGD
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_INFO
 #else
 #define LOG_BUZZER LOGD
 #define LOG_BUZZER_V LOGV
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_WARN
 #endif
 #include "assertion_tools.h"
 #include "buzzer.h"
@@ -0,0 +1,300 @@
+/**
+ * @file test_deferred_log.cpp
+ * @brief dlog : Format against printf ( widths, precisions, '*', strings of the record not terminated, a
+ * forged 255 byte string, missing arguments, truncation ), records from several threads drained in order
+ * without loss next to the drops, a Dump() decoded back by debug_tools/tools/dlog_decode.cpp. the benchmark
+ * gives the ns of a DLOGI call against formatting at the call site ( ./host_test/run.sh deferred_log )
+ */
+#include "deferred_log.hpp"
+#include "host_test.hpp"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// the decoder tool, its main() renamed
+#define main DlogDecodeMain
+#include "../tools/dlog_decode.cpp"
+#undef main
+
+static const char *TAG = "test";
+
+template <typename... Args>
+static std::vector<uint8_t> Args_(Args... args)
+{
+    std::vector<uint8_t> bytes((size_t{0} + ... + dlog::detail::Size(args)));
+    uint8_t *p = bytes.data();
+    ((p = dlog::detail::Put(p, args)), ...);
+    (void)p;
+    return bytes;
+}
+
+static std::string Format(const char *format, const std::vector<uint8_t> &args, size_t outSize = 256)
+{
+    std::vector<char> out(outSize + 1, '#');
+    const size_t len = dlog::Format(format, args.data(), args.size(), out.data(), outSize);
+    CHECK_EQ(out[outSize], '#'); // nothing past outSize
+    return std::string(out.data(), len);
+}
+
+static void TestFormat()
+{
+    CHECK(Format("%d|%5u|%-4x|%08.3f|%s|%c|%%", Args_(-42, 7u, 255, 3.14159, "abc", 'z')) == "-42|    7|ff  |0003.142|abc|z|%");
+    CHECK(Format("%lld %llu %ld", Args_(int64_t{-5000000000}, UINT64_MAX, 12L)) == "-5000000000 18446744073709551615 12");
+    CHECK(Format("%*d|%-*d|%.*f", Args_(6, 42, 4, 7, 2, 1.005)) == "    42|7   |1.00");
+    CHECK(Format("%g %e", Args_(0.5f, 1e10)) == "0.5 1.000000e+10");
+    CHECK(Format("%p", Args_(reinterpret_cast<void *>(0x1234))) == "0x1234");
+    // strings : widths and precisions on the bytes of the record, no terminator there
+    CHECK(Format("[%s][%8s][%-6s][%.2s][%5.1s][%.0s][%.*s]", Args_("ab", "ab", "ab", "abc", "abc", "abc", 2, "xyz")) ==
+          "[ab][      ab][ab    ][ab][    a][][xy]");
+    CHECK(Format("%s|%s", Args_(static_cast<const char *>(nullptr), "")) == "(null)|");
+    // cut at CONFIG_DLOG_MAX_STRING when logged
+    const std::string longText(100, 'x');
+    CHECK(Format("%s", Args_(longText.c_str())) == longText.substr(0, CONFIG_DLOG_MAX_STRING));
+    // a record holding 255 bytes ( a dump of a build with a larger CONFIG_DLOG_MAX_STRING ) : printed whole
+    std::vector<uint8_t> forged = {dlog::ARG_STR, 255};
+    forged.insert(forged.end(), 255, 'y');
+    CHECK(Format("<%s>", forged, 512) == "<" + std::string(255, 'y') + ">");
+    CHECK(Format("<%.3s>", forged) == "<yyy>");
+    // a length past the end of the arguments is cut at the end
+    forged.resize(12);
+    CHECK(Format("%s", forged) == std::string(10, 'y'));
+    // missing or broken arguments
+    CHECK(Format("%d %s %d", Args_(1)) == "1 <?> <?>");
+    CHECK(Format("%d", {0xEE, 1, 2, 3, 4}) == "<?>");
+    CHECK(Format("%n%d %y", Args_(3, 4)) == "3 %y");
+    CHECK(Format("tail %", Args_()) == "tail ");
+    // truncation : outSize - 1 characters and the terminator
+    CHECK(Format("%s-%d", Args_("abcdef", 12345), 8) == "abcdef-");
+    CHECK(Format("%d", Args_(123456), 4) == "123");
+    char one[1] = {'#'};
+    CHECK_EQ(dlog::Format("%d", nullptr, 0, one, 1), 0u);
+    CHECK_EQ(one[0], '\0');
+}
+
+struct Line_t
+{
+    uint8_t level;
+    std::string tag;
+    std::string text;
+};
+
+static std::vector<Line_t> DrainAll()
+{
+    std::vector<Line_t> lines;
+    dlog::Drain([&](uint8_t level, const char *tag, uint64_t, const char *text) { lines.push_back(Line_t{level, tag, text}); });
+    return lines;
+}
+
+static void TestThreads()
+{
+    constexpr int THREADS = 4;
+    constexpr int RECORDS = 2000;
+    DrainAll();
+    const dlog::Stats_t before = dlog::GetStats();
+    std::atomic<bool> done{false};
+    std::vector<Line_t> lines;
+    std::thread drainer([&]() {
+        while (!done.load())
+        {
+            for (Line_t &line : DrainAll())
+            {
+                lines.push_back(std::move(line));
+            }
+            std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> producers;
+    for (int t = 0; t < THREADS; t++)
+    {
+        producers.emplace_back([t]() {
+            const std::string name = "worker" + std::to_string(t);
+            for (int i = 0; i < RECORDS; i++)
+            {
+                DLOGW(TAG, "%s seq %d", name.c_str(), i);
+                if (i % 64 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    done = true;
+    drainer.join();
+    for (Line_t &line : DrainAll())
+    {
+        lines.push_back(std::move(line));
+    }
+    const dlog::Stats_t after = dlog::GetStats();
+    const uint32_t written = after.written - before.written;
+    const uint32_t dropped = after.dropped - before.dropped;
+    CHECK_EQ(written + dropped, static_cast<uint32_t>(THREADS * RECORDS));
+    CHECK_EQ(lines.size(), written);
+    CHECK_EQ(after.drained - before.drained, written);
+    // per thread in order, each record once
+    int last[THREADS];
+    bool ordered = true;
+    for (int &l : last)
+    {
+        l = -1;
+    }
+    for (const Line_t &line : lines)
+    {
+        int t = 0, seq = 0;
+        ordered &= (line.level == DLOG_WARN && line.tag == TAG);
+        ordered &= (sscanf(line.text.c_str(), "worker%d seq %d", &t, &seq) == 2 && t >= 0 && t < THREADS && seq > last[t]);
+        if (t >= 0 && t < THREADS)
+        {
+            last[t] = seq;
+        }
+    }
+    CHECK(ordered);
+
+    // no drainer : the ring fills, the next records are dropped and counted, never blocking
+    const dlog::Stats_t full = dlog::GetStats();
+    std::thread([]() {
+        for (int i = 0; i < 1000; i++)
+        {
+            DLOGW(TAG, "worker0 seq %d", i);
+        }
+    }).join();
+    const dlog::Stats_t overflow = dlog::GetStats();
+    CHECK(overflow.dropped > full.dropped);
+    CHECK_EQ((overflow.written - full.written) + (overflow.dropped - full.dropped), 1000u);
+    CHECK_EQ(DrainAll().size(), overflow.written - full.written);
+    printf("%d threads x %d records : %u drained, %u dropped | 1000 records undrained : %u kept, %u dropped\n", THREADS, RECORDS,
+           written, dropped, overflow.written - full.written, overflow.dropped - full.dropped);
+}
+
+static void TestDumpDecode()
+{
+    DrainAll();
+    std::vector<std::string> expected;
+    std::vector<std::thread> producers;
+    std::atomic<int> turn{0};
+    for (int t = 0; t < 3; t++)
+    {
+        producers.emplace_back([t, &turn]() {
+            // one after the other : the records are in time order
+            while (turn.load() != t)
+            {
+                std::this_thread::yield();
+            }
+            DLOGE("dump", "thread %d error %s", t, "\"quoted\"");
+            DLOGI("dump", "thread %d value %.2f %x", t, 1.5 * t, 0xAB + t);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            turn++;
+        });
+        char line[128];
+        snprintf(line, sizeof(line), "E dump: thread %d error \"quoted\"", t);
+        expected.push_back(line);
+        snprintf(line, sizeof(line), "I dump: thread %d value %.2f %x", t, 1.5 * t, 0xAB + t);
+        expected.push_back(line);
+    }
+    for (std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    std::vector<uint8_t> dump;
+    const size_t records = dlog::Dump([&](const uint8_t *data, size_t size) { dump.insert(dump.end(), data, data + size); });
+    CHECK_EQ(records, 6u);
+    CHECK_EQ(dlog::Dump([](const uint8_t *, size_t) {}), 0u); // drained by the first one
+
+    char dumpPath[] = "/tmp/dlog_dumpXXXXXX";
+    char textPath[] = "/tmp/dlog_textXXXXXX";
+    const int dumpFd = mkstemp(dumpPath);
+    const int textFd = mkstemp(textPath);
+    CHECK(dumpFd >= 0 && textFd >= 0);
+    CHECK_EQ(write(dumpFd, dump.data(), dump.size()), static_cast<ssize_t>(dump.size()));
+    close(dumpFd);
+    // the tool prints to stdout
+    fflush(stdout);
+    const int savedStdout = dup(1);
+    dup2(textFd, 1);
+    char *argv[] = {const_cast<char *>("dlog_decode"), dumpPath, nullptr};
+    const int ret = DlogDecodeMain(2, argv);
+    fflush(stdout);
+    dup2(savedStdout, 1);
+    close(savedStdout);
+    CHECK_EQ(ret, 0);
+
+    std::vector<std::string> decoded;
+    FILE *text = fdopen(textFd, "r");
+    rewind(text);
+    char line[256];
+    while (fgets(line, sizeof(line), text) != nullptr)
+    {
+        // "E (ms) dump: text" : the time left out
+        std::string s(line);
+        s.erase(s.find_last_not_of('\n') + 1);
+        const size_t open = s.find(" ("), close = s.find(") ");
+        if (open != std::string::npos && close != std::string::npos)
+        {
+            s.erase(open, close + 1 - open);
+        }
+        decoded.push_back(s);
+    }
+    fclose(text);
+    unlink(dumpPath);
+    unlink(textPath);
+    CHECK_EQ(decoded.size(), expected.size());
+    CHECK(decoded == expected);
+}
+
+static void Bench()
+{
+    constexpr int CALLS = 200000;
+    constexpr int BATCH = 50; // drained before the ring is full
+    DrainAll();
+    const std::string topic = "home/kitchen/light/state";
+    double drainNs = 0;
+    size_t drainedCount = 0;
+    const dlog::Stats_t before = dlog::GetStats();
+    const double callNs = host_test::NsPer(CALLS, [&]() {
+        for (int i = 0; i < CALLS; i += BATCH)
+        {
+            for (int j = 0; j < BATCH; j++)
+            {
+                DLOGI(TAG, "publish %s qos %d -> %d", topic.c_str(), 1, i + j);
+            }
+            // the drainer task's share, timed apart
+            const auto start = std::chrono::steady_clock::now();
+            drainedCount += dlog::Drain([](uint8_t, const char *, uint64_t, const char *) {});
+            drainNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+    }) - drainNs / CALLS;
+    CHECK_EQ(dlog::GetStats().dropped, before.dropped);
+    CHECK_EQ(drainedCount, static_cast<size_t>(CALLS));
+
+    // what the call site paid before : the text formatted and written out right away
+    FILE *null = fopen("/dev/null", "w");
+    const double printfNs = host_test::NsPer(CALLS, [&]() {
+        char text[256];
+        for (int i = 0; i < CALLS; i++)
+        {
+            snprintf(text, sizeof(text), "publish %s qos %d -> %d", topic.c_str(), 1, i);
+            fprintf(null, "I (%u) %s: %s\n", static_cast<unsigned>(i), TAG, text);
+        }
+    });
+    fclose(null);
+    printf("DLOGI %.0f ns/call at the call site, %.0f ns/record in the drainer | snprintf + fprintf ( /dev/null ) %.0f ns/call ( %.1fx )\n",
+           callNs, drainNs / CALLS, printfNs, printfNs / callNs);
+#ifndef __SANITIZE_THREAD__
+    CHECK(callNs < printfNs); // TSan makes each atomic of the ring cost more than the whole printf
+#endif
+}
+
+int main()
+{
+    TestFormat();
+    TestThreads();
+    TestDumpDecode();
+    Bench();
+    HOST_TEST_END();
+}
@@ -20,14 +20,16 @@
 template<typename ... Args>
 std::string string_format(const std::string& format, Args ... args)
 {
-    int size_s = std::snprintf(nullptr, 0, format.c_str(), args ...) + 1; // Extra space for '\0'
-    if (size_s <= 0) { throw std::runtime_error("Error during formatting."); }
+    char stackBuffer[128]; // one pass for short texts, a second one only when it does not fit
+    int size_s = std::snprintf(stackBuffer, sizeof(stackBuffer), format.c_str(), args ...);
+    if (size_s < 0) { throw std::runtime_error("Error during formatting."); }
     auto size = static_cast<size_t>(size_s);
-    auto buf = std::make_unique<char[]>(size);
-    std::snprintf(buf.get(), size, format.c_str(), args ...);
-    return std::string(buf.get(), buf.get() + size - 1); // We don't want the '\0' inside
+    if (size < sizeof(stackBuffer)) { return std::string(stackBuffer, size); }
+    std::string buf(size, '\0');
+    std::snprintf(&buf[0], size + 1, format.c_str(), args ...);
+    return buf;
 }
-#define LOGE(tag,s,...) std::string tt=string_format(s, __VA_ARGS__ ); std::cout<<"Error-"<<tag<<":"<<tt;
+#include "debug_tools.h"
 #endif 
 /*
 ASSERTION DEFINES 
@@ -20,7 +20,18 @@
 //#define DEBUG_STORAGE INFO
 #define DEBUG_MQTT INFO
 //#define DEBUG_WEBCLIENT INFO
-#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#if defined(CONFIG_DLOG_ENABLE) || !defined(ESP_PLATFORM)
+// deferred : format id + raw arguments into a ring, formatted by the drainer ( deferred_log.hpp )
+// filtered at compile time by DLOG_LOCAL_LEVEL of the module
+#include "deferred_log.hpp"
+#define LOGC(TAG, ...) DLOGE(TAG, __VA_ARGS__)
+#define LOGE(TAG, ...) DLOGE(TAG, __VA_ARGS__)
+#define LOGW(TAG, ...) DLOGW(TAG, __VA_ARGS__)
+#define LOGI(TAG, ...) DLOGI(TAG, __VA_ARGS__)
+#define LOGD(TAG, ...) DLOGD(TAG, __VA_ARGS__)
+#define LOGV(TAG, ...) DLOGV(TAG, __VA_ARGS__)
+#else
 //logging redirection //
 #define LOGC(TAG, ...)          \
     ESP_LOGE(TAG, __VA_ARGS__); \
@@ -47,26 +58,6 @@
     ;                              \
     /* ESP_LOGV(TAG, __VA_ARGS__); \
      ramiLogger.CreatLog(Verbos, TAG, __VA_ARGS__);*/
-#else
-#include <iostream>
-#include <stdio.h>
-#include <string>
-template<typename ... Args>
-std::string string_format(const std::string& format, Args ... args)
-{
-    int size_s = std::snprintf(nullptr, 0, format.c_str(), args ...) + 1; // Extra space for '\0'
-    if (size_s <= 0) { throw std::runtime_error("Error during formatting."); }
-    auto size = static_cast<size_t>(size_s);
-    auto buf = std::make_unique<char[]>(size);
-    std::snprintf(buf.get(), size, format.c_str(), args ...);
-    return std::string(buf.get(), buf.get() + size - 1); // We don't want the '\0' inside
-}
-#define LOGE(tag,s,...) std::string tt=string_format(s, __VA_ARGS__ ); std::cout<<"Error-"<<tag<<":"<<tt;
-#define LOGC(tag,s,...) std::string tt=string_format(s, __VA_ARGS__ ); std::cout<< "Critical-" <<tag<<":"<<tt;
-#define LOGW(tag,s,...) std::string tt=string_format(s, __VA_ARGS__ ); std::cout<< "Warning-" <<tag<<":"<<tt;
-#define LOGI(tag,s,...) std::string tt=string_format(s, __VA_ARGS__ ); std::cout<< "Info-" <<tag<<":"<<tt;
-#define LOGD(tag,s,...) std::string tt=string_format(s, __VA_ARGS__ ); std::cout<< "Debug-" <<tag<<":"<<tt;
-
 #endif 
 
 #endif
@@ -0,0 +1,251 @@
+#ifndef __ALADIN_DEFERRED_LOG_H__
+#define __ALADIN_DEFERRED_LOG_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#ifndef CONFIG_DLOG_RING_SIZE
+#define CONFIG_DLOG_RING_SIZE 4096
+#endif
+#ifndef CONFIG_DLOG_MAX_SITES
+#define CONFIG_DLOG_MAX_SITES 512
+#endif
+#ifndef CONFIG_DLOG_MAX_STRING
+#define CONFIG_DLOG_MAX_STRING 32
+#endif
+#ifndef CONFIG_DLOG_DRAIN_MS
+#define CONFIG_DLOG_DRAIN_MS 100
+#endif
+
+#define DLOG_NONE 0
+#define DLOG_ERROR 1
+#define DLOG_WARN 2
+#define DLOG_INFO 3
+#define DLOG_DEBUG 4
+#define DLOG_VERBOSE 5
+
+/*
+ * compile time filter of the translation unit, modules set it from their DEBUG_xxx switch
+ * ( debug_tools.h ) after the includes :
+ *  #undef DLOG_LOCAL_LEVEL
+ *  #define DLOG_LOCAL_LEVEL DLOG_VERBOSE
+ */
+#ifndef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_INFO
+#endif
+
+/**
+ * @brief deferred logging : the call site stores the id of its format string, a timestamp and the raw arguments
+ * in a lock-free ring of the current core, the formatting happens later in the drainer task ( Drain() )
+ * or offline from a Dump() ( debug_tools/tools/dlog_decode.cpp ).
+ * a call site registers { level, tag, format } once, the first time it runs : the tag and the format must be
+ * string literals / static arrays. %s arguments are copied, cut at CONFIG_DLOG_MAX_STRING.
+ * a full ring drops the new records ( counted ), logging never blocks. not for ISRs.
+ *
+ *  DLOGI(TAG, "publish %s qos %d -> %d", topic.c_str(), qos, msgId);
+ */
+namespace dlog
+{
+    struct Site_t
+    {
+        const char *tag;
+        const char *format;
+        uint8_t level;
+    };
+
+    // argument tags of a record
+    enum Arg_t : uint8_t
+    {
+        ARG_I32,
+        ARG_U32,
+        ARG_I64,
+        ARG_U64,
+        ARG_F64,
+        ARG_STR, // u8 length then the bytes
+        ARG_PTR, // u64
+    };
+
+    struct Stats_t
+    {
+        uint32_t written;
+        uint32_t dropped; // ring full
+        uint32_t drained;
+        uint16_t sites;
+    };
+
+    // [u32 size | flags][u16 site][u16 argument bytes][u64 time us][arguments], padded to 4 bytes
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr uint32_t SKIP = 0x80000000; // size word of the padding at the end of a ring
+
+    uint16_t Register(const Site_t *site);
+    const Site_t *GetSite(uint16_t id);
+    uint16_t GetSiteCount();
+
+    /**
+     * @brief reserve a record of \c argBytes arguments in the ring of this core
+     *
+     * @return uint8_t* where the arguments go, nullptr ring full ( dropped )
+     */
+    uint8_t *Begin(uint16_t site, size_t argBytes, void *&record);
+    void Commit(void *record, size_t size);
+
+    // printer of Drain(), \c text is not terminated by a new line
+    using Printer_t = std::function<void(uint8_t level, const char *tag, uint64_t timeUs, const char *text)>;
+    // consumer of Dump()
+    using Sink_t = std::function<void(const uint8_t *data, size_t size)>;
+
+    /**
+     * @brief format and print the committed records, oldest first across the rings
+     *
+     * @param printer nullptr : esp_log_write() on target, stdout on host
+     * @return size_t records printed
+     */
+    size_t Drain(const Printer_t &printer = nullptr);
+
+    /**
+     * @brief drain the committed records in binary form, after a header holding every site :
+     * "DLOG" u8 version u8 0 u16 sites, then per site u8 level u8 tagLen u16 formatLen tag format,
+     * then the records as they sit in the rings
+     *
+     * @return size_t records written
+     */
+    size_t Dump(const Sink_t &sink);
+
+    /**
+     * @brief printf \c format with the arguments of a record
+     *
+     * @return size_t length of the text, cut at outSize - 1
+     */
+    size_t Format(const char *format, const uint8_t *args, size_t argBytes, char *out, size_t outSize);
+
+    // drainer task ( every CONFIG_DLOG_DRAIN_MS ), started by the first Register()
+    void StartDrainer();
+    Stats_t GetStats();
+
+    namespace detail
+    {
+        template <typename T>
+        struct Kind
+        {
+            using U = std::decay_t<T>;
+            static constexpr bool isString = std::is_same<U, const char *>::value || std::is_same<U, char *>::value;
+            static constexpr bool isFloat = std::is_floating_point<U>::value;
+            static constexpr bool isPointer = std::is_pointer<U>::value && !isString;
+            static constexpr bool isWide = (std::is_integral<U>::value || std::is_enum<U>::value) && sizeof(U) > 4;
+        };
+
+        inline const char *Text(const char *text)
+        {
+            return (text == nullptr) ? "(null)" : text;
+        }
+
+        // strnlen, without its -Wstringop-overread on the literals shorter than \c max ( "(null)" )
+        inline size_t Length(const char *text, size_t max)
+        {
+            size_t n = 0;
+            while (n < max && text[n] != '\0')
+            {
+                n++;
+            }
+            return n;
+        }
+
+        template <typename T>
+        inline size_t Size(const T &value)
+        {
+            if constexpr (Kind<T>::isString)
+            {
+                return 2 + Length(Text(value), CONFIG_DLOG_MAX_STRING);
+            }
+            else
+            {
+                return 1 + ((Kind<T>::isFloat || Kind<T>::isPointer || Kind<T>::isWide) ? 8 : 4);
+            }
+        }
+
+        template <typename T>
+        inline uint8_t *Put(uint8_t *p, const T &value)
+        {
+            if constexpr (Kind<T>::isString)
+            {
+                const char *text = Text(value);
+                const uint8_t len = static_cast<uint8_t>(Length(text, CONFIG_DLOG_MAX_STRING));
+                p[0] = ARG_STR;
+                p[1] = len;
+                memcpy(p + 2, text, len);
+                return p + 2 + len;
+            }
+            else if constexpr (Kind<T>::isFloat)
+            {
+                const double v = value;
+                p[0] = ARG_F64;
+                memcpy(p + 1, &v, 8);
+                return p + 9;
+            }
+            else if constexpr (Kind<T>::isPointer)
+            {
+                const uint64_t v = reinterpret_cast<uintptr_t>(value);
+                p[0] = ARG_PTR;
+                memcpy(p + 1, &v, 8);
+                return p + 9;
+            }
+            else
+            {
+                using I = std::conditional_t<std::is_enum<T>::value, std::underlying_type<T>, std::common_type<T>>;
+                using V = typename I::type;
+                if constexpr (sizeof(V) > 4)
+                {
+                    const uint64_t v = static_cast<uint64_t>(value);
+                    p[0] = std::is_signed<V>::value ? ARG_I64 : ARG_U64;
+                    memcpy(p + 1, &v, 8);
+                    return p + 9;
+                }
+                else
+                {
+                    const uint32_t v = static_cast<uint32_t>(value);
+                    p[0] = std::is_signed<V>::value ? ARG_I32 : ARG_U32;
+                    memcpy(p + 1, &v, 4);
+                    return p + 5;
+                }
+            }
+        }
+
+        template <typename... Args>
+        inline void Write(uint16_t site, Args... args)
+        {
+            const size_t argBytes = (size_t{0} + ... + Size(args));
+            void *record = nullptr;
+            uint8_t *p = Begin(site, argBytes, record);
+            if (p == nullptr)
+            {
+                return;
+            }
+            ((p = Put(p, args)), ...);
+            Commit(record, argBytes);
+        }
+    } // namespace detail
+} // namespace dlog
+
+#define DLOG_AT(LEVEL, TAG, FORMAT, ...)                                                   \
+    do                                                                                    \
+    {                                                                                     \
+        if (DLOG_LOCAL_LEVEL >= LEVEL)                                                    \
+        {                                                                                 \
+            static const dlog::Site_t dlogSite{TAG, FORMAT, LEVEL};                       \
+            static const uint16_t dlogId = dlog::Register(&dlogSite);                     \
+            dlog::detail::Write(dlogId, ##__VA_ARGS__);                                   \
+        }                                                                                 \
+    } while (0)
+
+#define DLOGE(TAG, FORMAT, ...) DLOG_AT(DLOG_ERROR, TAG, FORMAT, ##__VA_ARGS__)
+#define DLOGW(TAG, FORMAT, ...) DLOG_AT(DLOG_WARN, TAG, FORMAT, ##__VA_ARGS__)
+#define DLOGI(TAG, FORMAT, ...) DLOG_AT(DLOG_INFO, TAG, FORMAT, ##__VA_ARGS__)
+#define DLOGD(TAG, FORMAT, ...) DLOG_AT(DLOG_DEBUG, TAG, FORMAT, ##__VA_ARGS__)
+#define DLOGV(TAG, FORMAT, ...) DLOG_AT(DLOG_VERBOSE, TAG, FORMAT, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,586 @@
+#include "deferred_log.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+#ifndef CONFIG_DLOG_DRAIN_STACK
+#define CONFIG_DLOG_DRAIN_STACK 3072
+#endif
+// host builds drain in a thread unless built with CONFIG_DLOG_AUTO_DRAIN=0, target : Kconfig
+#if !defined(ESP_PLATFORM) && !defined(CONFIG_DLOG_AUTO_DRAIN)
+#define CONFIG_DLOG_AUTO_DRAIN 1
+#endif
+
+namespace dlog
+{
+    static constexpr uint32_t RING_SIZE = CONFIG_DLOG_RING_SIZE;
+    static constexpr uint32_t MASK = RING_SIZE - 1;
+    static constexpr uint16_t NO_SITE = 0xFFFF;
+    static constexpr size_t TEXT_SIZE = 256;
+    static_assert(RING_SIZE >= 256 && (RING_SIZE & MASK) == 0, "CONFIG_DLOG_RING_SIZE must be a power of two >= 256");
+    static_assert(CONFIG_DLOG_MAX_SITES < NO_SITE, "CONFIG_DLOG_MAX_SITES too big");
+    static_assert(CONFIG_DLOG_MAX_STRING <= 255, "CONFIG_DLOG_MAX_STRING must fit a byte");
+#ifdef ESP_PLATFORM
+    static constexpr size_t RINGS = portNUM_PROCESSORS;
+#else
+    static constexpr size_t RINGS = 4;
+#endif
+
+    /**
+     * @brief many producers ( the tasks of a core ) reserve with a CAS on \c head, the drainer frees with \c tail.
+     * a record is visible once its size word is stored, the drainer zeroes what it consumed so a reserved
+     * record always reads 0 until committed
+     */
+    struct Ring_t
+    {
+        alignas(64) std::atomic<uint32_t> head{0};
+        std::atomic<uint32_t> written{0};
+        std::atomic<uint32_t> dropped{0};
+        alignas(64) std::atomic<uint32_t> tail{0};
+        alignas(8) uint8_t buffer[RING_SIZE]{};
+    };
+
+    static Ring_t rings[RINGS];
+    static std::atomic<const Site_t *> sites[CONFIG_DLOG_MAX_SITES];
+    static std::atomic<uint16_t> siteCount{0};
+    static std::atomic<uint32_t> drained{0};
+    static std::mutex drainLock; // Drain() / Dump()
+    static std::once_flag drainerOnce;
+
+    static inline uint32_t LoadWord(const uint8_t *p)
+    {
+        return __atomic_load_n(reinterpret_cast<const uint32_t *>(p), __ATOMIC_ACQUIRE);
+    }
+
+    static inline void StoreWord(uint8_t *p, uint32_t word)
+    {
+        __atomic_store_n(reinterpret_cast<uint32_t *>(p), word, __ATOMIC_RELEASE);
+    }
+
+    static inline uint32_t RecordSize(size_t argBytes)
+    {
+        return static_cast<uint32_t>((HEADER_SIZE + argBytes + 3) & ~static_cast<size_t>(3));
+    }
+
+    static inline uint64_t NowUs()
+    {
+#ifdef ESP_PLATFORM
+        return esp_timer_get_time();
+#else
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static inline Ring_t &LocalRing()
+    {
+#ifdef ESP_PLATFORM
+        return rings[xPortGetCoreID()];
+#else
+        static std::atomic<size_t> next{0};
+        static thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % RINGS;
+        return rings[index];
+#endif
+    }
+
+    uint16_t Register(const Site_t *site)
+    {
+        uint16_t id = siteCount.load(std::memory_order_relaxed);
+        do
+        {
+            if (id >= CONFIG_DLOG_MAX_SITES)
+            {
+                return NO_SITE;
+            }
+        } while (!siteCount.compare_exchange_weak(id, id + 1, std::memory_order_relaxed));
+        sites[id].store(site, std::memory_order_release);
+#if CONFIG_DLOG_AUTO_DRAIN
+        StartDrainer();
+#endif
+        return id;
+    }
+
+    const Site_t *GetSite(uint16_t id)
+    {
+        return (id < CONFIG_DLOG_MAX_SITES) ? sites[id].load(std::memory_order_acquire) : nullptr;
+    }
+
+    uint16_t GetSiteCount()
+    {
+        return siteCount.load(std::memory_order_acquire);
+    }
+
+    uint8_t *Begin(uint16_t site, size_t argBytes, void *&record)
+    {
+        Ring_t &ring = LocalRing();
+        const uint32_t size = RecordSize(argBytes);
+        if (site == NO_SITE || size > RING_SIZE / 4)
+        {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        uint32_t head = ring.head.load(std::memory_order_relaxed);
+        uint32_t pad = 0;
+        do
+        {
+            // records are never split : pad up to the end of the buffer
+            const uint32_t offset = head & MASK;
+            pad = (offset + size > RING_SIZE) ? RING_SIZE - offset : 0;
+            if (head + pad + size - ring.tail.load(std::memory_order_acquire) > RING_SIZE)
+            {
+                ring.dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        } while (!ring.head.compare_exchange_weak(head, head + pad + size, std::memory_order_relaxed));
+        if (pad != 0)
+        {
+            StoreWord(&ring.buffer[head & MASK], SKIP | pad);
+        }
+        uint8_t *p = &ring.buffer[(head + pad) & MASK];
+        const uint16_t bytes = static_cast<uint16_t>(argBytes);
+        const uint64_t now = NowUs();
+        memcpy(p + 4, &site, 2);
+        memcpy(p + 6, &bytes, 2);
+        memcpy(p + 8, &now, 8);
+        record = p;
+        return p + HEADER_SIZE;
+    }
+
+    void Commit(void *record, size_t argBytes)
+    {
+        StoreWord(static_cast<uint8_t *>(record), RecordSize(argBytes));
+        LocalRing().written.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief next committed record of the ring, padding skipped, nullptr none yet
+     */
+    static const uint8_t *Peek(Ring_t &ring, uint32_t &size)
+    {
+        for (;;)
+        {
+            const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+            if (tail == ring.head.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+            uint8_t *p = &ring.buffer[tail & MASK];
+            const uint32_t word = LoadWord(p);
+            if (word == 0)
+            {
+                return nullptr; // reserved, not committed yet
+            }
+            if ((word & SKIP) == 0)
+            {
+                size = word;
+                return p;
+            }
+            memset(p, 0, word & ~SKIP);
+            ring.tail.store(tail + (word & ~SKIP), std::memory_order_release);
+        }
+    }
+
+    static void Release(Ring_t &ring, uint32_t size)
+    {
+        const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+        memset(&ring.buffer[tail & MASK], 0, size);
+        ring.tail.store(tail + size, std::memory_order_release);
+    }
+
+    /**
+     * @brief under drainLock : oldest committed record of all the rings
+     */
+    static const uint8_t *Oldest(Ring_t *&from, uint32_t &size)
+    {
+        const uint8_t *oldest = nullptr;
+        uint64_t oldestUs = 0;
+        for (Ring_t &ring : rings)
+        {
+            uint32_t recordSize = 0;
+            const uint8_t *p = Peek(ring, recordSize);
+            if (p == nullptr)
+            {
+                continue;
+            }
+            uint64_t timeUs = 0;
+            memcpy(&timeUs, p + 8, 8);
+            if (oldest == nullptr || timeUs < oldestUs)
+            {
+                oldest = p;
+                oldestUs = timeUs;
+                from = &ring;
+                size = recordSize;
+            }
+        }
+        return oldest;
+    }
+
+    static void DefaultPrinter(uint8_t level, const char *tag, uint64_t timeUs, const char *text)
+    {
+        static constexpr char letters[] = "?EWIDV";
+        const char letter = letters[level <= DLOG_VERBOSE ? level : 0];
+#ifdef ESP_PLATFORM
+        esp_log_write(static_cast<esp_log_level_t>(level), tag, "%c (%u) %s: %s\n", letter, static_cast<unsigned>(timeUs / 1000), tag, text);
+#else
+        printf("%c (%llu) %s: %s\n", letter, static_cast<unsigned long long>(timeUs / 1000), tag, text);
+#endif
+    }
+
+    size_t Drain(const Printer_t &printer)
+    {
+        std::lock_guard<std::mutex> guard(drainLock);
+        char text[TEXT_SIZE];
+        size_t count = 0;
+        Ring_t *ring = nullptr;
+        uint32_t size = 0;
+        while (const uint8_t *p = Oldest(ring, size))
+        {
+            uint16_t id = 0, argBytes = 0;
+            uint64_t timeUs = 0;
+            memcpy(&id, p + 4, 2);
+            memcpy(&argBytes, p + 6, 2);
+            memcpy(&timeUs, p + 8, 8);
+            const Site_t *site = GetSite(id);
+            if (site != nullptr)
+            {
+                Format(site->format, p + HEADER_SIZE, argBytes, text, sizeof(text));
+                if (printer != nullptr)
+                {
+                    printer(site->level, site->tag, timeUs, text);
+                }
+                else
+                {
+                    DefaultPrinter(site->level, site->tag, timeUs, text);
+                }
+            }
+            Release(*ring, size);
+            count++;
+        }
+        drained.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    size_t Dump(const Sink_t &sink)
+    {
+        if (sink == nullptr)
+        {
+            return 0;
+        }
+        std::lock_guard<std::mutex> guard(drainLock);
+        const uint16_t count = GetSiteCount();
+        const uint8_t header[8] = {'D', 'L', 'O', 'G', 1, 0, static_cast<uint8_t>(count & 0xFF), static_cast<uint8_t>(count >> 8)};
+        sink(header, sizeof(header));
+        for (uint16_t id = 0; id < count; id++)
+        {
+            const Site_t *site = GetSite(id);
+            const char *tag = (site != nullptr) ? site->tag : "";
+            const char *format = (site != nullptr) ? site->format : "";
+            const uint8_t tagLen = static_cast<uint8_t>(detail::Length(tag, 255));
+            const uint16_t formatLen = static_cast<uint16_t>(detail::Length(format, 0xFFFF));
+            const uint8_t entry[4] = {static_cast<uint8_t>(site != nullptr ? site->level : DLOG_NONE), tagLen,
+                                      static_cast<uint8_t>(formatLen & 0xFF), static_cast<uint8_t>(formatLen >> 8)};
+            sink(entry, sizeof(entry));
+            sink(reinterpret_cast<const uint8_t *>(tag), tagLen);
+            sink(reinterpret_cast<const uint8_t *>(format), formatLen);
+        }
+        size_t records = 0;
+        Ring_t *ring = nullptr;
+        uint32_t size = 0;
+        while (const uint8_t *p = Oldest(ring, size))
+        {
+            sink(p, size);
+            Release(*ring, size);
+            records++;
+        }
+        drained.fetch_add(records, std::memory_order_relaxed);
+        return records;
+    }
+
+    /**
+     * @brief arguments of a record, read in order, converted to what the conversion asks for
+     */
+    class Reader
+    {
+    public:
+        Reader(const uint8_t *_p, const uint8_t *_end) : p(_p), end(_end) {}
+
+        bool Next(uint8_t &tag, uint64_t &bits, const char *&text, uint8_t &len)
+        {
+            if (p >= end)
+            {
+                return false;
+            }
+            tag = *p++;
+            if (tag == ARG_STR)
+            {
+                if (p >= end)
+                {
+                    return false;
+                }
+                len = *p++;
+                len = static_cast<uint8_t>(std::min<size_t>(len, end - p));
+                text = reinterpret_cast<const char *>(p);
+                p += len;
+                return true;
+            }
+            const size_t width = (tag == ARG_I32 || tag == ARG_U32) ? 4 : 8;
+            if (static_cast<size_t>(end - p) < width || tag > ARG_PTR)
+            {
+                p = end;
+                return false;
+            }
+            bits = 0;
+            memcpy(&bits, p, width);
+            p += width;
+            return true;
+        }
+
+        static int64_t Signed(uint8_t tag, uint64_t bits)
+        {
+            switch (tag)
+            {
+            case ARG_I32:
+                return static_cast<int32_t>(static_cast<uint32_t>(bits));
+            case ARG_F64:
+            {
+                double v;
+                memcpy(&v, &bits, 8);
+                return static_cast<int64_t>(v);
+            }
+            default:
+                return static_cast<int64_t>(bits);
+            }
+        }
+
+        static uint64_t Unsigned(uint8_t tag, uint64_t bits)
+        {
+            return (tag == ARG_F64) ? static_cast<uint64_t>(Signed(tag, bits)) : bits;
+        }
+
+        static double Double(uint8_t tag, uint64_t bits)
+        {
+            if (tag == ARG_F64)
+            {
+                double v;
+                memcpy(&v, &bits, 8);
+                return v;
+            }
+            return (tag == ARG_U32 || tag == ARG_U64 || tag == ARG_PTR) ? static_cast<double>(bits) : static_cast<double>(Signed(tag, bits));
+        }
+
+    private:
+        const uint8_t *p;
+        const uint8_t *end;
+    };
+
+    size_t Format(const char *format, const uint8_t *args, size_t argBytes, char *out, size_t outSize)
+    {
+        if (outSize == 0)
+        {
+            return 0;
+        }
+        Reader reader(args, args + argBytes);
+        size_t len = 0;
+        const auto append = [&](int written) {
+            if (written > 0)
+            {
+                len = std::min(len + static_cast<size_t>(written), outSize - 1);
+            }
+        };
+        const auto copy = [&](const char *text, size_t n) {
+            n = std::min(n, outSize - 1 - len);
+            memcpy(out + len, text, n);
+            len += n;
+        };
+        const char *f = format;
+        while (*f != '\0' && len < outSize - 1)
+        {
+            if (*f != '%')
+            {
+                const char *stop = strchr(f, '%');
+                const size_t n = (stop != nullptr) ? static_cast<size_t>(stop - f) : strlen(f);
+                copy(f, n);
+                f += n;
+                continue;
+            }
+            if (f[1] == '%')
+            {
+                copy(f, 1);
+                f += 2;
+                continue;
+            }
+            // %[flags][width][.precision][length]conversion, '*' taken from the arguments
+            char spec[48];
+            size_t s = 0;
+            spec[s++] = *f++;
+            uint8_t tag = 0, strLen = 0;
+            uint64_t bits = 0;
+            const char *text = nullptr;
+            size_t dot = 0; // of the precision in spec, 0 none
+            bool missing = false;
+            while (*f != '\0' && strchr("-+ #0", *f) != nullptr && s < 8)
+            {
+                spec[s++] = *f++;
+            }
+            for (int part = 0; part < 2; part++)
+            {
+                if (part == 1)
+                {
+                    if (*f != '.')
+                    {
+                        break;
+                    }
+                    dot = s;
+                    spec[s++] = *f++;
+                }
+                if (*f == '*')
+                {
+                    f++;
+                    missing |= !reader.Next(tag, bits, text, strLen);
+                    s += snprintf(spec + s, 12, "%d", static_cast<int>(Reader::Signed(tag, bits)));
+                }
+                while (*f >= '0' && *f <= '9' && s < 30)
+                {
+                    spec[s++] = *f++;
+                }
+            }
+            while (*f != '\0' && strchr("hlLqjzt", *f) != nullptr)
+            {
+                f++;
+            }
+            const char conversion = *f;
+            if (conversion == '\0')
+            {
+                break;
+            }
+            f++;
+            if (conversion == 'n')
+            {
+                continue;
+            }
+            missing |= !reader.Next(tag, bits, text, strLen);
+            if (missing)
+            {
+                append(snprintf(out + len, outSize - len, "<?>"));
+                continue;
+            }
+            switch (conversion)
+            {
+            case 'd':
+            case 'i':
+                spec[s++] = 'l';
+                spec[s++] = 'l';
+                spec[s++] = conversion;
+                spec[s] = '\0';
+                append(snprintf(out + len, outSize - len, spec, static_cast<long long>(Reader::Signed(tag, bits))));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec[s++] = 'l';
+                spec[s++] = 'l';
+                spec[s++] = conversion;
+                spec[s] = '\0';
+                append(snprintf(out + len, outSize - len, spec, static_cast<unsigned long long>(Reader::Unsigned(tag, bits))));
+                break;
+            case 'c':
+                spec[s++] = 'c';
+                spec[s] = '\0';
+                append(snprintf(out + len, outSize - len, spec, static_cast<int>(Reader::Signed(tag, bits))));
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                spec[s++] = conversion;
+                spec[s] = '\0';
+                append(snprintf(out + len, outSize - len, spec, Reader::Double(tag, bits)));
+                break;
+            case 's':
+            {
+                // not terminated in the record : printed with %.*s, a precision of the format cuts it further
+                int n = (tag == ARG_STR && text != nullptr) ? strLen : 0;
+                if (dot != 0)
+                {
+                    spec[s] = '\0';
+                    const int precision = atoi(spec + dot + 1);
+                    n = (precision >= 0 && precision < n) ? precision : n;
+                    s = dot;
+                }
+                spec[s++] = '.';
+                spec[s++] = '*';
+                spec[s++] = 's';
+                spec[s] = '\0';
+                append(snprintf(out + len, outSize - len, spec, n, n != 0 ? text : ""));
+                break;
+            }
+            case 'p':
+                append(snprintf(out + len, outSize - len, "0x%llx", static_cast<unsigned long long>(bits)));
+                break;
+            default:
+                append(snprintf(out + len, outSize - len, "%%%c", conversion));
+                break;
+            }
+        }
+        out[len] = '\0';
+        return len;
+    }
+
+#ifdef ESP_PLATFORM
+    static void DrainTask(void *)
+    {
+        for (;;)
+        {
+            Drain();
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_DLOG_DRAIN_MS));
+        }
+    }
+#endif
+
+    void StartDrainer()
+    {
+        std::call_once(drainerOnce, []() {
+#ifdef ESP_PLATFORM
+            xTaskCreate(DrainTask, "dlog", CONFIG_DLOG_DRAIN_STACK, nullptr, 1, nullptr);
+#else
+            std::thread([]() {
+                for (;;)
+                {
+                    Drain();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(CONFIG_DLOG_DRAIN_MS));
+                }
+            }).detach();
+            std::atexit([]() { Drain(); });
+#endif
+        });
+    }
+
+    Stats_t GetStats()
+    {
+        Stats_t stats{};
+        for (Ring_t &ring : rings)
+        {
+            stats.written += ring.written.load(std::memory_order_relaxed);
+            stats.dropped += ring.dropped.load(std::memory_order_relaxed);
+        }
+        stats.drained = drained.load(std::memory_order_relaxed);
+        stats.sites = GetSiteCount();
+        return stats;
+    }
+} // namespace dlog
@@ -0,0 +1,110 @@
+/**
+ * @file dlog_decode.cpp
+ * @brief host tool : text of a dlog::Dump() ( deferred_log.hpp ), one line per record
+ *
+ *  g++ -std=gnu++17 -Idebug_tools/include -I<dir with an empty sdkconfig.h> -DCONFIG_DLOG_AUTO_DRAIN=0 \
+ *      debug_tools/tools/dlog_decode.cpp debug_tools/src/deferred_log.cpp -o dlog_decode -lpthread
+ *  ./dlog_decode dump.bin        ( or from stdin )
+ */
+#include "deferred_log.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct DumpSite_t
+{
+    uint8_t level;
+    std::string tag;
+    std::string format;
+};
+
+static bool ReadAll(FILE *file, std::vector<uint8_t> &data)
+{
+    uint8_t chunk[4096];
+    size_t n = 0;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    return ferror(file) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *file = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+    if (file == nullptr)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    const bool read = ReadAll(file, data);
+    if (file != stdin)
+    {
+        fclose(file);
+    }
+    if (!read || data.size() < 8 || memcmp(data.data(), "DLOG", 4) != 0 || data[4] != 1)
+    {
+        fprintf(stderr, "not a dlog dump ( version 1 )\n");
+        return 1;
+    }
+    const uint16_t count = data[6] | (data[7] << 8);
+    size_t pos = 8;
+    std::vector<DumpSite_t> sites;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (pos + 4 > data.size())
+        {
+            fprintf(stderr, "truncated site table\n");
+            return 1;
+        }
+        DumpSite_t site;
+        site.level = data[pos];
+        const size_t tagLen = data[pos + 1];
+        const size_t formatLen = data[pos + 2] | (data[pos + 3] << 8);
+        pos += 4;
+        if (pos + tagLen + formatLen > data.size())
+        {
+            fprintf(stderr, "truncated site table\n");
+            return 1;
+        }
+        site.tag.assign(reinterpret_cast<const char *>(&data[pos]), tagLen);
+        pos += tagLen;
+        site.format.assign(reinterpret_cast<const char *>(&data[pos]), formatLen);
+        pos += formatLen;
+        sites.push_back(std::move(site));
+    }
+    static constexpr char letters[] = "?EWIDV";
+    char text[1024];
+    size_t records = 0, unknown = 0;
+    while (pos + dlog::HEADER_SIZE <= data.size())
+    {
+        uint32_t size = 0;
+        uint16_t id = 0, argBytes = 0;
+        uint64_t timeUs = 0;
+        memcpy(&size, &data[pos], 4);
+        memcpy(&id, &data[pos + 4], 2);
+        memcpy(&argBytes, &data[pos + 6], 2);
+        memcpy(&timeUs, &data[pos + 8], 8);
+        if (size < dlog::HEADER_SIZE + argBytes || pos + size > data.size())
+        {
+            fprintf(stderr, "bad record at %zu\n", pos);
+            return 1;
+        }
+        if (id < sites.size())
+        {
+            const DumpSite_t &site = sites[id];
+            dlog::Format(site.format.c_str(), &data[pos + dlog::HEADER_SIZE], argBytes, text, sizeof(text));
+            printf("%c (%llu) %s: %s\n", letters[site.level <= DLOG_VERBOSE ? site.level : 0],
+                   static_cast<unsigned long long>(timeUs / 1000), site.tag.c_str(), text);
+        }
+        else
+        {
+            unknown++;
+        }
+        records++;
+        pos += size;
+    }
+    fprintf(stderr, "%zu records, %zu sites, %zu unknown\n", records, sites.size(), unknown);
+    return 0;
+}
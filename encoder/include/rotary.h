@@ -7,6 +7,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "system.hpp"
+#include "timer_wheel.hpp"
 
 using namespace idf::event;
 #define RE_A_GPIO 16
@@ -16,7 +17,7 @@ using namespace idf::event;
 class Rotary : public Task
 {
     private:
-    ESPTimer_p_t sleepTimer{ nullptr };
+    WheelTimer_p_t sleepTimer{ nullptr };
     const char* TAG;
     QueueHandle_t event_queue;
     rotary_encoder_t re;
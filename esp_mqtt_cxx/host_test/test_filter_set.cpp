@@ -0,0 +1,255 @@
+/**
+ * @file test_filter_set.cpp
+ * @brief FilterSet : + and # levels, # matching its parent level, $ topics out of first level wildcards,
+ * overlapping filters each called once. Client::subscribe(filter, handler) on a stubbed client : routed by
+ * dispatch(), replaced on resubscribe, rolled back when the client refuses. the benchmark matches topics
+ * against 1000 filters, one walk of the set against a Filter::match per filter ( ./host_test/run.sh filter_set )
+ */
+#include "esp_mqtt.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using idf::mqtt::Filter;
+using idf::mqtt::FilterSet;
+
+// the stubbed client : subscribe answers with subscribeResult
+static int subscribeResult = 1;
+static int subscribeCalls = 0;
+static char clientHandle;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *)
+{
+    return reinterpret_cast<esp_mqtt_client_handle_t>(&clientHandle);
+}
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t, esp_mqtt_event_id_t, esp_event_handler_t, void *) { return ESP_OK; }
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t) { return ESP_OK; }
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t, const char *, int)
+{
+    subscribeCalls++;
+    return subscribeResult;
+}
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t, const char *, const char *, int, int, int) { return 1; }
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t) { return ESP_OK; }
+
+static std::vector<int> Match(const FilterSet<int> &set, std::string_view topic)
+{
+    std::vector<int> ids;
+    const size_t count = set.match(topic, [&](int id) { ids.push_back(id); });
+    CHECK_EQ(count, ids.size());
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+static void TestFilterSet()
+{
+    FilterSet<int> set;
+    CHECK(set.empty());
+    CHECK(Match(set, "a/b").empty());
+    set.add("home/+/state", 1);
+    set.add("home/#", 2);
+    set.add("home/kitchen/state", 3);
+    set.add("+/kitchen/+", 4);
+    set.add("#", 5);
+    set.add("home/+/+/set", 6);
+    set.add("$SYS/#", 7);
+    set.add("home/kitchen/state", 8); // same filter twice : both handlers
+    CHECK(!set.empty());
+
+    CHECK(Match(set, "home/kitchen/state") == std::vector<int>({1, 2, 3, 4, 5, 8}));
+    CHECK(Match(set, "home/hall/state") == std::vector<int>({1, 2, 5}));
+    // + is exactly one level, empty levels count
+    CHECK(Match(set, "home/state") == std::vector<int>({2, 5}));
+    CHECK(Match(set, "home//state") == std::vector<int>({1, 2, 5}));
+    CHECK(Match(set, "home/a/b/set") == std::vector<int>({2, 5, 6}));
+    CHECK(Match(set, "home/a/b/set/x") == std::vector<int>({2, 5}));
+    // # matches its parent level
+    CHECK(Match(set, "home") == std::vector<int>({2, 5}));
+    CHECK(Match(set, "homes") == std::vector<int>({5}));
+    // first level wildcards skip $ topics, an explicit $ level does not
+    CHECK(Match(set, "$SYS/broker/load") == std::vector<int>({7}));
+    CHECK(Match(set, "$SYS") == std::vector<int>({7}));
+    CHECK(Match(set, "$other/kitchen/x").empty());
+    CHECK(Match(set, "x/$SYS/y") == std::vector<int>({5}));
+    CHECK(Match(set, "").empty());
+
+    bool thrown = false;
+    try
+    {
+        set.add("home/#/x", 9);
+    }
+    catch (const std::domain_error &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    thrown = false;
+    try
+    {
+        set.add("home/a+", 9);
+    }
+    catch (const std::domain_error &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    set.clear();
+    CHECK(Match(set, "home").empty());
+}
+
+class TestClient : public idf::mqtt::Client
+{
+public:
+    TestClient() : Client(esp_mqtt_client_config_t{}) {}
+    size_t Deliver(const char *topic)
+    {
+        esp_mqtt_event_t event{};
+        event.event_id = MQTT_EVENT_DATA;
+        event.topic = const_cast<char *>(topic);
+        event.topic_len = static_cast<int>(strlen(topic));
+        return dispatch(&event);
+    }
+
+private:
+    void on_connected(const esp_mqtt_event_handle_t) override {}
+};
+
+static void TestSubscribe()
+{
+    TestClient client;
+    std::vector<std::string> calls;
+    auto handler = [&](const char *name) {
+        return [&calls, name](const esp_mqtt_event_handle_t event) {
+            calls.push_back(std::string(name) + ":" + std::string(event->topic, event->topic_len));
+        };
+    };
+    CHECK(client.subscribe("home/+/set", handler("set")).has_value());
+    CHECK(client.subscribe("home/#", handler("all")).has_value());
+    CHECK_EQ(client.Deliver("home/hall/set"), 2u);
+    CHECK_EQ(client.Deliver("other"), 0u);
+    CHECK_EQ(calls.size(), 2u);
+    // invalid filter or no handler : no subscribe sent
+    const int sent = subscribeCalls;
+    CHECK(!client.subscribe("home/#/x", handler("bad")).has_value());
+    CHECK(!client.subscribe("home/x", nullptr).has_value());
+    CHECK_EQ(subscribeCalls, sent);
+
+    // refused : a new filter is not routed
+    subscribeResult = -1;
+    CHECK(!client.subscribe("cmd/+", handler("cmd")).has_value());
+    CHECK_EQ(client.Deliver("cmd/x"), 0u);
+    // refused resubscribe : the previous handler is back
+    calls.clear();
+    CHECK(!client.subscribe("home/+/set", handler("new")).has_value());
+    CHECK_EQ(client.Deliver("home/hall/set"), 2u);
+    CHECK(std::count(calls.begin(), calls.end(), "set:home/hall/set") == 1);
+    CHECK(std::count(calls.begin(), calls.end(), "new:home/hall/set") == 0);
+
+    // accepted resubscribe : replaced, not added
+    subscribeResult = 7;
+    const auto id = client.subscribe("home/+/set", handler("new"));
+    CHECK(id.has_value() && *id == idf::mqtt::MessageID{7});
+    calls.clear();
+    CHECK_EQ(client.Deliver("home/hall/set"), 2u);
+    CHECK(std::count(calls.begin(), calls.end(), "new:home/hall/set") == 1);
+    CHECK(std::count(calls.begin(), calls.end(), "set:home/hall/set") == 0);
+
+    // a handler subscribing while called : the walk in progress keeps its snapshot
+    calls.clear();
+    CHECK(client.subscribe("late/x", [&](const esp_mqtt_event_handle_t) {
+        calls.push_back("late");
+        client.subscribe("late/#", handler("later"));
+    }).has_value());
+    CHECK_EQ(client.Deliver("late/x"), 1u);
+    CHECK_EQ(client.Deliver("late/x"), 2u);
+}
+
+static void Bench()
+{
+    constexpr int FILTERS = 1000;
+    std::vector<std::string> filters;
+    for (int i = 0; i < FILTERS; i++)
+    {
+        const std::string room = "room" + std::to_string(i % 50);
+        const std::string device = "dev" + std::to_string(i);
+        switch (i % 10)
+        {
+        case 0:
+            filters.push_back("home/" + room + "/+/set");
+            break;
+        case 1:
+            filters.push_back("home/" + room + "/" + device + "/#");
+            break;
+        default:
+            filters.push_back("home/" + room + "/" + device + "/set");
+            break;
+        }
+    }
+    filters.push_back("homeassistant/status");
+
+    FilterSet<int> set;
+    std::vector<Filter> linear;
+    for (int i = 0; i <= FILTERS; i++)
+    {
+        set.add(filters[i], i);
+        linear.emplace_back(filters[i]);
+    }
+    std::vector<std::string> topics;
+    for (int i = 0; i < 256; i++)
+    {
+        const int d = (i * 37) % (FILTERS + 200); // some devices without a filter
+        topics.push_back("home/room" + std::to_string(d % 50) + "/dev" + std::to_string(d) + "/set");
+    }
+    topics.push_back("homeassistant/status");
+
+    // the same matches, counted both ways
+    size_t setMatches = 0, linearMatches = 0;
+    for (const std::string &topic : topics)
+    {
+        setMatches += set.match(topic, [](int) {});
+        for (const Filter &filter : linear)
+        {
+            linearMatches += filter.match(topic);
+        }
+    }
+    CHECK_EQ(setMatches, linearMatches);
+    CHECK(setMatches > topics.size());
+
+    constexpr int ROUNDS = 20;
+    size_t sink = 0;
+    const double setNs = host_test::NsPer(ROUNDS * topics.size(), [&]() {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (const std::string &topic : topics)
+            {
+                sink += set.match(topic, [&](int id) { sink += id; });
+            }
+        }
+    });
+    const double linearNs = host_test::NsPer(ROUNDS * topics.size(), [&]() {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (const std::string &topic : topics)
+            {
+                for (const Filter &filter : linear)
+                {
+                    sink += filter.match(topic);
+                }
+            }
+        }
+    });
+    CHECK(sink != 0);
+    CHECK(setNs < linearNs);
+    printf("%d filters, %zu topics : FilterSet %.0f ns/topic, Filter::match per filter %.0f ns/topic ( %.0fx )\n",
+           FILTERS + 1, topics.size(), setNs, linearNs, linearNs / setNs);
+}
+
+int main()
+{
+    TestFilterSet();
+    TestSubscribe();
+    Bench();
+    HOST_TEST_END();
+}
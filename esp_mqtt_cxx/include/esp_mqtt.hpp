@@ -18,11 +18,18 @@
 #error MQTT class can only be used when __cpp_exceptions is enabled. Enable CONFIG_COMPILER_CXX_EXCEPTIONS in Kconfig
 #endif
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
 #include <variant>
 #include <utility>
 #include <memory>
 #include <string>
+#include <vector>
 #include "esp_exception.hpp"
 #include "esp_mqtt_client_config.hpp"
 #include "mqtt_client.h"
@@ -136,6 +143,154 @@ private:
     std::string filter;
 };
 
+/**
+ * @brief Set of topic filters compiled into a level trie.
+ *
+ * Every filter (including + and # wildcards) is added once, then a topic is matched
+ * against all of them in a single walk. Matching does not allocate.
+ * Wildcards in the first level do not match topics starting with $.
+ *
+ * @tparam Handler Value returned for each matching filter (callback, id, pointer..).
+ */
+template <class Handler>
+class FilterSet {
+public:
+    /**
+     * @brief Add a filter with its handler.
+     * @throws std::domain_error if the filter is invalid.
+     */
+    void add(const std::string &filter, Handler handler)
+    {
+        if (!filter_is_valid(filter.begin(), filter.end())) {
+            throw std::domain_error("Forbidden Filter string");
+        }
+        if (nodes.empty()) {
+            nodes.emplace_back();
+        }
+        uint32_t node = ROOT;
+        std::string_view rest{filter};
+        while (true) {
+            const auto slash = rest.find('/');
+            const std::string_view level = rest.substr(0, slash);
+            if (level == "#") {
+                nodes[node].hash_handlers.push_back(std::move(handler));
+                return;
+            }
+            node = (level == "+") ? plus_child(node) : child(node, level);
+            if (slash == std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(slash + 1);
+        }
+        nodes[node].handlers.push_back(std::move(handler));
+    }
+
+    /**
+     * @brief Call on_match(handler) for every filter matching the topic name.
+     *
+     * @return number of matching filters
+     */
+    template <class Callback>
+    size_t match(std::string_view topic, Callback &&on_match) const
+    {
+        if (nodes.empty() || topic.empty()) {
+            return 0;
+        }
+        return walk(ROOT, topic, false, topic.front() == '$', on_match);
+    }
+
+    template <class Callback>
+    size_t match(const char *const begin, int size, Callback &&on_match) const
+    {
+        return match(std::string_view(begin, size), std::forward<Callback>(on_match));
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return nodes.empty();
+    }
+
+    void clear() noexcept
+    {
+        nodes.clear();
+    }
+
+private:
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        std::vector<std::pair<std::string, uint32_t>> children; // sorted by level name
+        uint32_t plus = NONE;
+        std::vector<Handler> handlers;      // filters ending at this level
+        std::vector<Handler> hash_handlers; // filters ending with /# below this level
+    };
+
+    uint32_t child(uint32_t node, std::string_view level)
+    {
+        auto &children = nodes[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), level,
+        [](const auto & entry, std::string_view key) {
+            return std::string_view(entry.first) < key;
+        });
+        if (it != children.end() && it->first == level) {
+            return it->second;
+        }
+        const auto index = static_cast<uint32_t>(nodes.size());
+        children.emplace(it, std::string(level), index);
+        nodes.emplace_back(); // children is not used after this point, nodes may reallocate
+        return index;
+    }
+
+    uint32_t plus_child(uint32_t node)
+    {
+        if (nodes[node].plus == NONE) {
+            const auto index = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+            nodes[node].plus = index;
+        }
+        return nodes[node].plus;
+    }
+
+    template <class Callback>
+    size_t walk(uint32_t index, std::string_view rest, bool at_end, bool system_topic, Callback &on_match) const
+    {
+        const Node &node = nodes[index];
+        const bool first_level = (index == ROOT);
+        size_t count = 0;
+        if (!(first_level && system_topic)) {
+            for (const auto &handler : node.hash_handlers) {
+                on_match(handler);
+                count++;
+            }
+        }
+        if (at_end) {
+            for (const auto &handler : node.handlers) {
+                on_match(handler);
+                count++;
+            }
+            return count;
+        }
+        const auto slash = rest.find('/');
+        const std::string_view level = rest.substr(0, slash);
+        const bool next_at_end = (slash == std::string_view::npos);
+        const std::string_view next = next_at_end ? std::string_view{} : rest.substr(slash + 1);
+        auto it = std::lower_bound(node.children.begin(), node.children.end(), level,
+        [](const auto & entry, std::string_view key) {
+            return std::string_view(entry.first) < key;
+        });
+        if (it != node.children.end() && it->first == level) {
+            count += walk(it->second, next, next_at_end, system_topic, on_match);
+        }
+        if (node.plus != NONE && !(first_level && system_topic)) {
+            count += walk(node.plus, next, next_at_end, system_topic, on_match);
+        }
+        return count;
+    }
+
+    std::vector<Node> nodes;
+};
+
 /**
  * @brief Message identifier to track delivery.
  *
@@ -164,6 +319,24 @@ public:
      */
     std::optional<MessageID> subscribe(const std::string &filter, QoS qos = QoS::AtLeastOnce);
 
+    using DataHandler = std::function<void(const esp_mqtt_event_handle_t event)>;
+
+    /**
+     * @brief Subscribe to topic and route its messages to a handler
+     *
+     * The default on_data() calls every handler whose filter matches the topic, in a single walk of
+     * a FilterSet holding all of them. Subscribing the same filter again ( ex : on every on_connected )
+     * replaces its handler.
+     *
+     * @param filter
+     * @param on_message called from the mqtt task for each message matching \c filter
+     * @param qos QoS subscription, defaulted as QoS::AtLeastOnce
+     *
+     * @return Optional MessageID. In case of failure ( or an invalid filter ) std::nullopt is returned,
+     * the handler is not kept ( the one it replaced is restored ).
+     */
+    std::optional<MessageID> subscribe(const std::string &filter, DataHandler on_message, QoS qos = QoS::AtLeastOnce);
+
     /**
      * @brief publish message to topic
      *
@@ -213,6 +386,15 @@ protected:
     using ClientHandler = std::unique_ptr<esp_mqtt_client, MqttClientDeleter>;
     ClientHandler handler;
 
+    /**
+     * @brief Call the handler of every subscribed filter matching the topic of the event.
+     *
+     * Does not allocate, handlers may subscribe again while being called.
+     *
+     * @return number of handlers called
+     */
+    size_t dispatch(const esp_mqtt_event_handle_t event) const;
+
 private:
     static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id,
                                    void *event_data) noexcept;
@@ -224,6 +406,16 @@ private:
     virtual void on_published(const esp_mqtt_event_handle_t event);
     virtual void on_before_connect(const esp_mqtt_event_handle_t event);
     virtual void on_connected(const esp_mqtt_event_handle_t event) = 0;
-    virtual void on_data(const esp_mqtt_event_handle_t event) = 0;
+    // dispatch() by default
+    virtual void on_data(const esp_mqtt_event_handle_t event);
+
+    // swaps in a data_filters built from data_handlers, data_lock held
+    void rebuild_filters();
+
+    using DataFilters = FilterSet<DataHandler>;
+    std::mutex data_lock;                                                  // writers of data_filters
+    std::map<std::string, std::pair<uint32_t, DataHandler>> data_handlers; // filter -> subscription id, handler
+    uint32_t data_subscriptions = 0;                                       // last subscription id
+    std::shared_ptr<const DataFilters> data_filters;                       // rebuilt on subscribe, read without lock
 };
 } // namespace idf::mqtt
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <algorithm>
+#include <cstring>
 
 #include "mqtt_client.h"
 #include "esp_log.h"
@@ -211,6 +212,19 @@ void Client::on_connected(esp_mqtt_event_handle_t const event)
 }
 void Client::on_data(esp_mqtt_event_handle_t const event)
 {
+    dispatch(event);
+}
+
+size_t Client::dispatch(esp_mqtt_event_handle_t const event) const
+{
+    // a snapshot : a handler subscribing meanwhile swaps in a new set, this one lives until the walk ends
+    const std::shared_ptr<const DataFilters> filters = std::atomic_load(&data_filters);
+    if (filters == nullptr || event->topic == nullptr || event->topic_len <= 0) {
+        return 0; // continued chunk of a long message : the topic came with the first one
+    }
+    return filters->match(event->topic, event->topic_len, [event](const DataHandler & on_message) {
+        on_message(event);
+    });
 }
 
 std::optional<MessageID> Client::subscribe(std::string const &topic, QoS qos)
@@ -223,6 +237,47 @@ std::optional<MessageID> Client::subscribe(std::string const &topic, QoS qos)
     return MessageID{res};
 }
 
+std::optional<MessageID> Client::subscribe(std::string const &filter, DataHandler on_message, QoS qos)
+{
+    if (on_message == nullptr || !filter_is_valid(filter.begin(), filter.end())) {
+        return std::nullopt;
+    }
+    DataHandler previous;
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> guard(data_lock);
+        id = ++data_subscriptions;
+        auto &entry = data_handlers[filter];
+        previous = std::move(entry.second);
+        entry = {id, std::move(on_message)};
+        rebuild_filters();
+    }
+    // not under data_lock : a handler subscribing from the mqtt task would wait on it
+    auto res = subscribe(filter, qos);
+    if (!res) {
+        std::lock_guard<std::mutex> guard(data_lock);
+        auto entry = data_handlers.find(filter);
+        if (entry != data_handlers.end() && entry->second.first == id) { // not replaced meanwhile
+            if (previous == nullptr) {
+                data_handlers.erase(entry);
+            } else {
+                entry->second.second = std::move(previous);
+            }
+            rebuild_filters();
+        }
+    }
+    return res;
+}
+
+void Client::rebuild_filters()
+{
+    auto filters = std::make_shared<DataFilters>();
+    for (const auto &[subscribed, entry] : data_handlers) {
+        filters->add(subscribed, entry.second);
+    }
+    std::atomic_store(&data_filters, std::shared_ptr<const DataFilters>(std::move(filters)));
+}
+
 bool is_valid(std::string::const_iterator first, std::string::const_iterator last)
 {
     if (first == last) {
@@ -250,6 +305,11 @@ bool is_valid(std::string::const_iterator first, std::string::const_iterator las
     return true;
 }
 
+bool filter_is_valid(std::string::const_iterator first, std::string::const_iterator last)
+{
+    return is_valid(first, last);
+}
+
 Filter::Filter(std::string user_filter) : filter(std::move(user_filter))
 {
     if (!is_valid(filter.begin(), filter.end())) {
@@ -285,6 +345,11 @@ const std::string &Filter::get()
     return filter;
 }
 
+[[nodiscard]] bool Filter::match(std::string const &topic) const noexcept
+{
+    return match(topic.begin(), topic.end());
+}
+
 [[nodiscard]] bool Filter::match(char const *const first, int size) const noexcept
 {
     auto it = static_cast<std::string::const_iterator>(first);
@@ -27,17 +27,14 @@ private:
     void on_connected(esp_mqtt_event_handle_t const event) override
     {
         using mqtt::QoS;
-        subscribe(messages.get());
-        subscribe(sent_load.get(), QoS::AtMostOnce);
-    }
-    void on_data(esp_mqtt_event_handle_t const event) override
-    {
-        if (messages.match(event->topic, event->topic_len)) {
+        // on_data() calls the handlers of the matching filters
+        subscribe("$SYS/broker/messages/received", [](esp_mqtt_event_handle_t const event) {
             ESP_LOGI(TAG, "Received in the messages topic");
-        }
+        });
+        subscribe("$SYS/broker/load/+/sent", [](esp_mqtt_event_handle_t const event) {
+            ESP_LOGI(TAG, "Received in %.*s", event->topic_len, event->topic);
+        }, QoS::AtMostOnce);
     }
-    mqtt::Filter messages{"$SYS/broker/messages/received"};
-    mqtt::Filter sent_load{"$SYS/broker/load/+/sent"};
 };
 }
 
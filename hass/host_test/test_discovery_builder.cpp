@@ -0,0 +1,282 @@
+/**
+ * @file test_discovery_builder.cpp
+ * @brief DiscoveryBuilder against the nlohmann::json documents the entities used to build : every payload
+ * of 100 entities ( relays, blinds, sensors, binary sensors ) byte for byte equal to the old json dump(),
+ * device fields with quotes, control characters and UTF-8, stable over a second update. the benchmark renders
+ * the 100 entities both ways, time and allocations per full update ( ./host_test/run.sh discovery_builder )
+ */
+#include "homeassistant.h"
+#include "host_test.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using homeassistant::Device_Description_t;
+using homeassistant::DiscoveryBuilder;
+
+// allocations of operator new, per update in the benchmark
+static std::atomic<long> allocations{0};
+
+void *operator new(size_t size)
+{
+    void *block = malloc(size ? size : 1);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    allocations++;
+    return block;
+}
+// not inlined : gcc would pair the free with the library operator new inside the json map ( -Wmismatched-new-delete )
+__attribute__((noinline)) void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+__attribute__((noinline)) void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+enum Kind_t
+{
+    RELAY,
+    BLIND,
+    SENSOR,
+    BINARY_SENSOR
+};
+
+struct Entity_t
+{
+    Kind_t kind;
+    std::string entity; // switch name or class
+    std::string unit;
+    homeassistant::Discovery *discovery;
+};
+
+// the payload as the entities built it before DiscoveryBuilder, and its wire form ( dump(5) / dump(0) )
+static nlohmann::json OldJson(const Device_Description_t &d, const Entity_t &e, std::string *wire)
+{
+    nlohmann::json json;
+    json["dev"]["name"] = d.name.c_str();
+    json["dev"]["mdl"] = d.model.c_str();
+    json["dev"]["sw"] = d.version.c_str();
+    json["dev"]["mf"] = d.manufacturer.c_str();
+    json["room"] = d.room.c_str();
+    json["dev"]["sa"] = d.room.c_str();
+    json["dev"]["identifiers"] = {d.MAC.c_str()};
+    json["payload_available"] = "online";
+    json["payload_not_available"] = "offline";
+    const std::string uniqueId = d.room + "_" + d.name + "_" + d.MAC + "_" + e.entity;
+    const std::string device = d.room + "/" + d.name + "_" + d.MAC;
+    const std::string prefix = device + "/" + e.entity;
+    const std::string availability = device + "/connection";
+    int indent = 5;
+    switch (e.kind)
+    {
+    case RELAY:
+        json["state_topic"] = "~/state";
+        json["unique_id"] = uniqueId.c_str();
+        json["availability_topic"] = availability.c_str();
+        json["~"] = prefix.c_str();
+        json["pl_on"] = "ON";
+        json["pl_off"] = "OFF";
+        json["command_topic"] = "~/cmd";
+        json["name"] = (d.name + "_" + e.entity).c_str();
+        json["device_class"] = homeassistant::Switch_Class_t::outlet;
+        break;
+    case BLIND:
+        json["~"] = prefix.c_str();
+        json["payload_close"] = "CLOSE";
+        json["payload_stop"] = "STOP";
+        json["payload_open"] = "OPEN";
+        json["availability_topic"] = availability.c_str();
+        json["set_position_topic"] = "~/set_pos";
+        json["state_topic"] = "~/state";
+        json["command_topic"] = "~/cmd";
+        json["position_topic"] = "~/position";
+        json["name"] = uniqueId.c_str();
+        json["state_open"] = "open";
+        json["state_opening"] = "opening";
+        json["state_closed"] = "closed";
+        json["state_closing"] = "closing";
+        json["position_template"] = "{{ value_json.position }}";
+        json["value_template"] = "{{ value_json.state }}";
+        json["device_class"] = e.entity;
+        json["unique_id"] = uniqueId.c_str();
+        json["position_open"] = 100;
+        json["position_closed"] = 0;
+        indent = 0;
+        break;
+    case SENSOR:
+    case BINARY_SENSOR:
+        json["unique_id"] = uniqueId.c_str();
+        json["~"] = prefix.c_str();
+        json["availability_topic"] = availability.c_str();
+        json["state_topic"] = "~/state";
+        json["value_template"] = ("{{ value_json." + e.entity + "}}").c_str();
+        if (e.kind == SENSOR && e.unit != "N/A")
+        {
+            json["unit_of_meas"] = e.unit.c_str();
+        }
+        if (e.kind == BINARY_SENSOR)
+        {
+            json["payload_on"] = true;
+            json["payload_off"] = false;
+        }
+        json["device_class"] = e.entity.c_str();
+        json["name"] = uniqueId.c_str();
+        break;
+    }
+    if (wire != nullptr)
+    {
+        *wire = json.dump(indent);
+    }
+    return json;
+}
+
+static std::vector<Entity_t> Entities(size_t count)
+{
+    static const char *blinds[] = {homeassistant::BlindDiscovery::shutter, homeassistant::BlindDiscovery::awning,
+                                   homeassistant::BlindDiscovery::curtain, homeassistant::BlindDiscovery::window};
+    static const char *sensors[] = {homeassistant::SensorDiscovery::temperature, homeassistant::SensorDiscovery::humidity,
+                                    homeassistant::SensorDiscovery::pressure, homeassistant::SensorDiscovery::power};
+    static const char *units[] = {"°C", "%", "N/A", "W"};
+    static const char *binarySensors[] = {homeassistant::BinarySensorDiscovery::motion, homeassistant::BinarySensorDiscovery::door,
+                                          homeassistant::BinarySensorDiscovery::smoke, homeassistant::BinarySensorDiscovery::opening};
+    std::vector<Entity_t> entities;
+    for (size_t i = 0; i < count; i++)
+    {
+        Entity_t e{static_cast<Kind_t>(i % 4), "", "", nullptr};
+        const size_t n = i / 4;
+        switch (e.kind)
+        {
+        case RELAY:
+            e.entity = "relay \"" + std::to_string(n) + "\"";
+            e.discovery = new homeassistant::RelayDiscovery(e.entity, homeassistant::Switch_Class_t::outlet);
+            break;
+        case BLIND:
+            e.entity = blinds[n % 4];
+            e.discovery = new homeassistant::BlindDiscovery(blinds[n % 4]);
+            break;
+        case SENSOR:
+            e.entity = sensors[n % 4];
+            e.unit = units[n % 4];
+            e.discovery = new homeassistant::SensorDiscovery(sensors[n % 4], e.unit);
+            break;
+        case BINARY_SENSOR:
+            e.entity = binarySensors[n % 4];
+            e.discovery = new homeassistant::BinarySensorDiscovery(binarySensors[n % 4]);
+            break;
+        }
+        entities.push_back(e);
+    }
+    return entities;
+}
+
+static void TestEscaping()
+{
+    std::string out;
+    DiscoveryBuilder::AppendEscaped(out, std::string_view("a\"b\\c\b\f\n\r\t\x01\x1f\x7f é€", 20));
+    const nlohmann::json json = std::string("a\"b\\c\b\f\n\r\t\x01\x1f\x7f é€", 20);
+    CHECK(("\"" + out + "\"") == json.dump());
+    // optional field left unset : no key
+    DiscoveryBuilder builder;
+    DiscoveryBuilder::Fields_t fields{};
+    fields[DiscoveryBuilder::CLASS] = "power";
+    static constexpr DiscoveryBuilder::Key_t keys[] = {
+        DiscoveryBuilder::Field("unit_of_meas", DiscoveryBuilder::UNIT, "", "", true),
+        DiscoveryBuilder::Field("value_template", DiscoveryBuilder::CLASS, "{{ value_json.", "}}"),
+    };
+    CHECK(builder.Render(keys, fields) == "{\"value_template\":\"{{ value_json.power}}\"}");
+    fields[DiscoveryBuilder::UNIT] = "";
+    CHECK(builder.Render(keys, fields) == "{\"unit_of_meas\":\"\",\"value_template\":\"{{ value_json.power}}\"}");
+}
+
+static void TestGolden(const std::vector<Entity_t> &entities)
+{
+    const Device_Description_t &d = homeassistant::hassDevCtxDescription;
+    for (int update = 0; update < 2; update++)
+    {
+        CHECK_EQ(homeassistant::UpdateDiscoveryList(), ESP_OK);
+        size_t identical = 0;
+        for (const Entity_t &e : entities)
+        {
+            std::string wire;
+            const nlohmann::json old = OldJson(d, e, &wire);
+            const std::string &rendered = e.discovery->DiscoveryMessage();
+            identical += (rendered == old.dump());
+            // what the broker got before, compacted
+            identical += (rendered == nlohmann::json::parse(wire).dump());
+            identical += (nlohmann::json::parse(rendered) == old);
+        }
+        CHECK_EQ(identical, 3 * entities.size());
+        // topics rebuilt, not appended to, on the second update
+        const std::string uniqueId = d.room + "_" + d.name + "_" + d.MAC + "_" + entities[1].entity;
+        CHECK(entities[1].discovery->DiscoveryTopic() == "homeassistant/cover/" + uniqueId + "/config");
+        CHECK(entities[0].discovery->StatusTopic() == d.room + "/" + d.name + "_" + d.MAC + "/" + entities[0].entity + "/state");
+    }
+}
+
+static void Bench(const std::vector<Entity_t> &entities)
+{
+    constexpr int ROUNDS = 50;
+    const Device_Description_t &d = homeassistant::hassDevCtxDescription;
+    size_t oldBytes = 0, newBytes = 0;
+    const long oldStart = allocations.load();
+    const double oldNs = host_test::NsPer(ROUNDS, [&]() {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            oldBytes = 0;
+            for (const Entity_t &e : entities)
+            {
+                std::string wire;
+                OldJson(d, e, &wire);
+                oldBytes += wire.size();
+            }
+        }
+    });
+    const long oldAllocs = (allocations.load() - oldStart) / ROUNDS;
+
+    homeassistant::UpdateDiscoveryList(); // the buffers at their size
+    const long newStart = allocations.load();
+    const double newNs = host_test::NsPer(ROUNDS, [&]() {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            homeassistant::UpdateDiscoveryList();
+        }
+    });
+    const long newAllocs = (allocations.load() - newStart) / ROUNDS;
+    for (const Entity_t &e : entities)
+    {
+        newBytes += e.discovery->DiscoveryMessage().size();
+    }
+    CHECK(newNs < oldNs);
+    CHECK(newAllocs < oldAllocs);
+    CHECK(newBytes < oldBytes);
+    printf("%zu entities per update : nlohmann %.0f us, %ld allocations, %zu bytes | DiscoveryBuilder %.0f us, %ld allocations, %zu bytes ( %.1fx )\n",
+           entities.size(), oldNs / 1000, oldAllocs, oldBytes, newNs / 1000, newAllocs, newBytes, oldNs / newNs);
+}
+
+int main()
+{
+    Device_Description_t &d = homeassistant::hassDevCtxDescription;
+    d.name = "blind \"A\"\tunit";
+    d.room = "séjour";
+    d.MAC = "AA:BB:CC:DD:EE:FF";
+    d.model = "esp32 \\ rev3";
+    d.version = "1.2.3\n";
+    d.manufacturer = "Ünïcode ™";
+    const std::vector<Entity_t> entities = Entities(100);
+
+    TestEscaping();
+    TestGolden(entities);
+    Bench(entities);
+    for (const Entity_t &e : entities)
+    {
+        delete e.discovery;
+    }
+    HOST_TEST_END();
+}
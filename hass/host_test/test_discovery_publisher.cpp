@@ -0,0 +1,199 @@
+/**
+ * @file test_discovery_publisher.cpp
+ * @brief the discovery stream of homeassistant against a fake broker : PUBACKs come late from a broker task
+ * that holds the client lock while it runs the hooks, like the esp-mqtt task. checks the window, the pacing,
+ * a disconnect in the middle of a chunk ( no deadlock, the rest resumes ) and the skip of unchanged
+ * discoveries and the resend of the states on the next connection ( ./host_test/run.sh discovery_publisher )
+ */
+#include "homeassistant.h"
+#include "host_test.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+struct Broker_t
+{
+    std::mutex clientLock; // the esp-mqtt API lock
+    std::deque<std::pair<int, Clock::time_point>> unacked;
+    std::multiset<std::string> received;
+    int nextId = 1;
+    bool connected = false;
+    size_t maxInFlight = 0;
+    int published = 0;
+    int disconnectAt = -1; // publish count that drops the connection
+    std::atomic<bool> dropping{false};
+    std::atomic<bool> quit{false};
+    std::chrono::milliseconds latency{20};
+
+    esp_err_t Publish(const std::pair<std::string, std::string>& message, int* msgId)
+    {
+        {
+            std::lock_guard<std::mutex> guard(clientLock);
+            if (!connected)
+            {
+                return ESP_FAIL;
+            }
+            received.insert(message.first);
+            *msgId = nextId++;
+            unacked.push_back({ *msgId, Clock::now() + latency });
+            maxInFlight = std::max(maxInFlight, unacked.size());
+            if (++published == disconnectAt)
+            {
+                dropping = true;
+            }
+        }
+        if (dropping)
+        {
+            // the broker task takes the lock first : the next publish of this chunk waits for it
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return ESP_OK;
+    }
+
+    // the MQTT task
+    void Run()
+    {
+        while (!quit)
+        {
+            {
+                std::lock_guard<std::mutex> guard(clientLock);
+                while (!unacked.empty() && unacked.front().second <= Clock::now())
+                {
+                    const int id = unacked.front().first;
+                    unacked.pop_front();
+                    homeassistant::OnMqttPublished(id);
+                }
+                if (dropping)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    connected = false;
+                    unacked.clear();
+                    homeassistant::OnMqttDisconnected();
+                    dropping = false;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    void Connect()
+    {
+        {
+            std::lock_guard<std::mutex> guard(clientLock);
+            connected = true;
+        }
+        // from the event loop, not the broker task
+        homeassistant::OnMqttConnected();
+    }
+};
+
+static Broker_t broker;
+
+static bool WaitDone(std::chrono::milliseconds timeout)
+{
+    const auto deadline = Clock::now() + timeout;
+    while (!homeassistant::DefaultDiscoveryPublisher().IsDone())
+    {
+        if (Clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+int main()
+{
+    constexpr int ENTITIES = 24;
+    std::vector<std::unique_ptr<homeassistant::RelayDiscovery>> relays;
+    for (int i = 0; i < ENTITIES; i++)
+    {
+        relays.emplace_back(new homeassistant::RelayDiscovery("relay" + std::to_string(i), homeassistant::Switch_Class_t::Switch));
+    }
+    CHECK_EQ(homeassistant::UpdateDiscoveryList(), ESP_OK);
+    homeassistant::discoveryPublishFunction = [](const std::pair<std::string, std::string> message, int* msgId) {
+        return broker.Publish(message, msgId);
+    };
+    std::thread mqttTask([]() { broker.Run(); });
+    // a deadlock ends the test instead of hanging it
+    std::thread watchdog([]() {
+        const auto deadline = Clock::now() + std::chrono::seconds(30);
+        while (!broker.quit && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (!broker.quit)
+        {
+            printf("deadlock : the discovery stream did not finish\n");
+            fflush(stdout);
+            _Exit(1);
+        }
+    });
+
+    // first connection, dropped in the middle of the third chunk
+    broker.disconnectAt = 10;
+    const auto start = Clock::now();
+    broker.Connect();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(!homeassistant::DefaultDiscoveryPublisher().IsDone());
+    broker.Connect();
+    CHECK(WaitDone(std::chrono::seconds(10)));
+    const double firstMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> guard(broker.clientLock);
+        for (const auto& relay : relays)
+        {
+            CHECK(broker.received.count(relay->DiscoveryTopic()) >= 1);
+        }
+        CHECK(broker.received.count(relays[0]->AvailabilityTopic()) >= 1);
+        CHECK(broker.maxInFlight <= CONFIG_HASS_DISCOVERY_WINDOW);
+    }
+    const auto stats = homeassistant::DefaultDiscoveryPublisher().GetStats();
+    CHECK(stats.acked >= static_cast<uint32_t>(ENTITIES + 1)); // the availability once per connection
+    CHECK(stats.published <= static_cast<uint32_t>(ENTITIES + 1 + CONFIG_HASS_DISCOVERY_WINDOW + CONFIG_HASS_DISCOVERY_CHUNK));
+
+    // reconnect : only the availability, the discoveries did not change
+    homeassistant::DefaultDiscoveryPublisher().ResetStats();
+    int before;
+    {
+        std::lock_guard<std::mutex> guard(broker.clientLock);
+        before = broker.published;
+    }
+    broker.Connect();
+    CHECK(WaitDone(std::chrono::seconds(5)));
+    {
+        std::lock_guard<std::mutex> guard(broker.clientLock);
+        CHECK_EQ(broker.published - before, 1);
+    }
+    CHECK_EQ(homeassistant::DefaultDiscoveryPublisher().GetStats().skipped, static_cast<uint32_t>(ENTITIES));
+
+    // states : unchanged ones are suppressed until a connection invalidates them
+    static std::atomic<int> states{0};
+    homeassistant::statsGenerateFunctions.push_back([]() { return std::make_pair(std::string("dev/temperature/state"), std::string("{\"temperature\":21.5}")); });
+    homeassistant::MqttPublishFunction = [](const std::pair<std::string, std::string>) {
+        states++;
+        return ESP_OK;
+    };
+    homeassistant::PublishAllStats();
+    homeassistant::PublishAllStats();
+    CHECK_EQ(states.load(), 1);
+    broker.Connect();
+    homeassistant::PublishAllStats();
+    CHECK_EQ(states.load(), 2);
+    CHECK(WaitDone(std::chrono::seconds(5)));
+
+    printf("%d entities : %d messages at most %u in flight, done in %.0f ms with one disconnect ( flood : %d at once ), "
+           "reconnect sent 1 message\n",
+        ENTITIES, before, static_cast<unsigned>(broker.maxInFlight), firstMs, 2 * ENTITIES);
+    broker.quit = true;
+    mqttTask.join();
+    watchdog.join();
+    HOST_TEST_END();
+}
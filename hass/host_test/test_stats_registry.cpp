@@ -0,0 +1,308 @@
+/**
+ * @file test_stats_registry.cpp
+ * @brief StatsRegistry : unchanged payloads suppressed, numbers inside the deadband suppressed, the forced
+ * refresh, a refused publish retried, Scan on JSON numbers only ( hex, inf, nan and out of range floats are
+ * text ) and Sync racing a sweep. the benchmark sweeps synthetic sensor streams, messages sent against the
+ * full dump of every state on every sweep ( ./host_test/run.sh stats_registry )
+ */
+#include "stats_registry.hpp"
+#include "host_test.hpp"
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+using homeassistant::StatsRegistry;
+
+static uint32_t Hash(const std::string &payload, size_t *count = nullptr)
+{
+    uint32_t hash = 2166136261u;
+    float numbers[StatsRegistry::MAX_NUMBERS];
+    const size_t found = StatsRegistry::Scan(payload, hash, numbers, StatsRegistry::MAX_NUMBERS);
+    if (count != nullptr)
+    {
+        *count = found;
+    }
+    return hash;
+}
+
+static void TestScan()
+{
+    uint32_t hash = 2166136261u;
+    float numbers[4];
+    CHECK_EQ(StatsRegistry::Scan("{\"t\":21.5,\"h\":-40,\"p\":1.2e3}", hash, numbers, 4), 3u);
+    CHECK(numbers[0] == 21.5f && numbers[1] == -40.0f && numbers[2] == 1200.0f);
+    // the numbers are left out of the hash, the text is not
+    CHECK_EQ(Hash("{\"t\":21.5}"), Hash("{\"t\":3}"));
+    CHECK(Hash("{\"t\":21.5}") != Hash("{\"u\":21.5}"));
+    // in a string : text, escaped quotes included
+    size_t count = 0;
+    CHECK(Hash("{\"s\":\"v1 \\\"2\\\"\"}", &count) != Hash("{\"s\":\"v1 \\\"3\\\"\"}"));
+    CHECK_EQ(count, 0u);
+    // not JSON numbers : text, so a change is always seen
+    CHECK(Hash("{\"t\":-inf}", &count) != Hash("{\"t\":-nan}"));
+    CHECK_EQ(count, 0u);
+    // hex : 0, x and 10, not 16
+    CHECK_EQ(StatsRegistry::Scan("{\"t\":0x10}", hash, numbers, 4), 2u);
+    CHECK(numbers[0] == 0.0f && numbers[1] == 10.0f);
+    CHECK(Hash("{\"t\":1e999}", &count) != Hash("{\"t\":2e999}"));
+    CHECK_EQ(count, 0u);
+    CHECK(Hash("{\"t\":-1e999}") != Hash("{\"t\":1e999}"));
+    // "1." and "1e" : the number stops before the dot / exponent
+    CHECK(Hash("{\"t\":1.}", &count) == Hash("{\"t\":2.}"));
+    CHECK_EQ(count, 1u);
+    CHECK(Hash("{\"t\":1e}") != Hash("{\"t\":1}"));
+    CHECK(Hash("-") != Hash("0"));
+    // past MAX_NUMBERS the numbers go to the hash
+    CHECK_EQ(Hash("[1,2,3,4,5,6,7,8,9]"), Hash("[0,0,0,0,0,0,0,0,9]"));
+    CHECK(Hash("[1,2,3,4,5,6,7,8,9]") != Hash("[1,2,3,4,5,6,7,8,10]"));
+}
+
+static void TestDelta()
+{
+    StatsRegistry registry(0);
+    std::string payload = "{\"temperature\":21.40}";
+    std::vector<std::string> sent;
+    esp_err_t result = ESP_OK;
+    const auto Publish = [&](const StatsRegistry::StringPair_t message) {
+        if (result == ESP_OK)
+        {
+            sent.push_back(message.second);
+        }
+        return result;
+    };
+    const size_t id = registry.Add([&]() { return std::make_pair(std::string("room/temperature/state"), payload); }, 0.1f);
+    CHECK_EQ(registry.GetCount(), 1u);
+    CHECK_EQ(registry.SetDeadband(id + 1, 1), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(registry.Sweep(nullptr, 0), ESP_ERR_INVALID_STATE);
+
+    CHECK_EQ(registry.Sweep(Publish, 0), ESP_OK);
+    CHECK_EQ(registry.Sweep(Publish, 1), ESP_OK);
+    payload = "{\"temperature\":21.43}"; // inside the deadband
+    CHECK_EQ(registry.Sweep(Publish, 2), ESP_OK);
+    payload = "{\"temperature\":21.49}"; // still 0.09 from the published value
+    CHECK_EQ(registry.Sweep(Publish, 3), ESP_OK);
+    CHECK_EQ(sent.size(), 1u);
+    payload = "{\"temperature\":21.51}";
+    CHECK_EQ(registry.Sweep(Publish, 4), ESP_OK);
+    CHECK_EQ(sent.size(), 2u);
+    payload = "{\"temperature\":21.51,\"unit\":\"C\"}"; // same number, other text
+    CHECK_EQ(registry.Sweep(Publish, 5), ESP_OK);
+    CHECK_EQ(sent.size(), 3u);
+
+    StatsRegistry::Stats_t stats = registry.GetStats();
+    CHECK_EQ(stats.sweeps, 6u);
+    CHECK_EQ(stats.sent, 3u);
+    CHECK_EQ(stats.suppressed, 3u);
+    CHECK_EQ(stats.deadband, 2u);
+
+    // refused : counted, sent again on the next sweep
+    payload = "{\"temperature\":25}";
+    result = ESP_FAIL;
+    CHECK_EQ(registry.Sweep(Publish, 6), ESP_FAIL);
+    result = ESP_OK;
+    CHECK_EQ(registry.Sweep(Publish, 7), ESP_OK);
+    CHECK_EQ(sent.size(), 4u);
+    CHECK(sent.back() == payload);
+    CHECK_EQ(registry.GetStats().errors, 1u);
+
+    // deadband 0 : any move
+    registry.SetDeadband(id, 0);
+    payload = "{\"temperature\":25.001}";
+    registry.Sweep(Publish, 8);
+    CHECK_EQ(sent.size(), 5u);
+
+    // after a reconnect every entry goes out once
+    registry.Invalidate();
+    registry.Sweep(Publish, 9);
+    registry.Sweep(Publish, 10);
+    CHECK_EQ(sent.size(), 6u);
+    registry.ResetStats();
+    CHECK_EQ(registry.GetStats().sent, 0u);
+}
+
+static void TestRefresh()
+{
+    StatsRegistry registry(1000);
+    int sent = 0;
+    const auto Publish = [&](const StatsRegistry::StringPair_t) {
+        sent++;
+        return ESP_OK;
+    };
+    registry.Add([]() { return std::make_pair(std::string("a/state"), std::string("{\"on\":true}")); });
+    registry.Sweep(Publish, 5000);
+    registry.Sweep(Publish, 5999);
+    CHECK_EQ(sent, 1);
+    registry.Sweep(Publish, 6000);
+    CHECK_EQ(sent, 2);
+    CHECK_EQ(registry.GetStats().refreshed, 1u);
+    // the ms counter wrapping around
+    registry.Sweep(Publish, UINT32_MAX - 100);
+    CHECK_EQ(sent, 3);
+    registry.Sweep(Publish, 500);
+    CHECK_EQ(sent, 3);
+    registry.Sweep(Publish, 900);
+    CHECK_EQ(sent, 4);
+    registry.SetRefreshInterval(0);
+    registry.Sweep(Publish, 900000);
+    CHECK_EQ(sent, 4);
+}
+
+static void TestSyncDuringSweep()
+{
+    StatsRegistry registry(0);
+    std::vector<StatsRegistry::Generator_t> generators;
+    std::atomic<bool> done{false};
+    std::atomic<int> published{0};
+    std::thread sweeper([&]() {
+        uint32_t now = 0;
+        while (!done.load())
+        {
+            registry.Sweep([&](const StatsRegistry::StringPair_t) {
+                published++;
+                return ESP_OK;
+            }, now++);
+        }
+    });
+    for (int i = 0; i < 200; i++)
+    {
+        const std::string topic = "sensor" + std::to_string(i) + "/state";
+        generators.push_back([topic]() { return std::make_pair(topic, std::string("{\"v\":1}")); });
+        registry.Sync(generators);
+        if (i % 50 == 0)
+        {
+            registry.Sync(generators); // nothing new
+        }
+    }
+    done = true;
+    sweeper.join();
+    CHECK_EQ(registry.GetCount(), 200u);
+    published = 0;
+    registry.Invalidate();
+    registry.Sweep([&](const StatsRegistry::StringPair_t) {
+        published++;
+        return ESP_OK;
+    }, 0);
+    CHECK_EQ(published.load(), 200); // each entry once
+
+    // two callers of PublishAllStats() : each generator added once
+    StatsRegistry shared(0);
+    std::thread other([&]() { shared.Sync(generators); });
+    shared.Sync(generators);
+    other.join();
+    CHECK_EQ(shared.GetCount(), 200u);
+}
+
+// a deterministic noise source, [-1, 1)
+static float Noise(uint32_t &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return static_cast<float>(state >> 8) / static_cast<float>(1u << 23) - 1.0f;
+}
+
+static void Bench()
+{
+    // 20 temperatures ( noise 0.03, slow drift, deadband 0.1 ), 20 humidities ( noise 0.5, deadband 1 ),
+    // 10 switches flipping now and then : one sweep a second for an hour
+    constexpr int SENSORS = 50;
+    constexpr uint32_t SWEEPS = 3600;
+    struct Stream_t
+    {
+        std::string topic;
+        float value;
+        float noise;
+        float drift;
+        bool flag;
+    };
+    std::vector<Stream_t> streams(SENSORS);
+    std::vector<StatsRegistry::Generator_t> generators;
+    StatsRegistry registry(CONFIG_HASS_STATS_REFRESH_S * 1000);
+    uint32_t seed = 12345;
+    uint32_t sweep = 0;
+    for (int i = 0; i < SENSORS; i++)
+    {
+        Stream_t &s = streams[i];
+        if (i < 20)
+        {
+            s = {"room" + std::to_string(i) + "/temperature/state", 20.0f + i * 0.1f, 0.03f, 0.0005f, false};
+        }
+        else if (i < 40)
+        {
+            s = {"room" + std::to_string(i) + "/humidity/state", 45.0f, 0.5f, 0.0f, false};
+        }
+        else
+        {
+            s = {"room" + std::to_string(i) + "/switch/state", 0, 0, 0, false};
+        }
+        generators.push_back([&s, &seed, &sweep, i]() {
+            char payload[64];
+            if (i < 40)
+            {
+                const float value = s.value + s.drift * sweep + s.noise * Noise(seed);
+                snprintf(payload, sizeof(payload), i < 20 ? "{\"temperature\":%.2f}" : "{\"humidity\":%.1f}", value);
+            }
+            else
+            {
+                if ((Noise(seed) + 1) < 0.01f) // about every 200 s
+                {
+                    s.flag = !s.flag;
+                }
+                snprintf(payload, sizeof(payload), "{\"state\":\"%s\"}", s.flag ? "ON" : "OFF");
+            }
+            return std::make_pair(s.topic, std::string(payload));
+        });
+    }
+    // as PublishAllStats() registers statsGenerateFunctions
+    registry.Sync(generators);
+    for (int i = 0; i < 40; i++)
+    {
+        registry.SetDeadband(i, i < 20 ? 0.1f : 1.0f);
+    }
+
+    size_t bytes = 0;
+    const auto Publish = [&](const StatsRegistry::StringPair_t message) {
+        bytes += message.first.size() + message.second.size();
+        return ESP_OK;
+    };
+    const double deltaNs = host_test::NsPer(SWEEPS, [&]() {
+        for (sweep = 0; sweep < SWEEPS; sweep++)
+        {
+            registry.Sweep(Publish, sweep * 1000);
+        }
+    });
+    const size_t deltaBytes = bytes;
+    const StatsRegistry::Stats_t stats = registry.GetStats();
+
+    // the old PublishAllStats : every generator published on every sweep
+    bytes = 0;
+    seed = 12345;
+    size_t fullSent = 0;
+    const double fullNs = host_test::NsPer(SWEEPS, [&]() {
+        for (sweep = 0; sweep < SWEEPS; sweep++)
+        {
+            for (const StatsRegistry::Generator_t &generator : generators)
+            {
+                Publish(generator());
+                fullSent++;
+            }
+        }
+    });
+    CHECK_EQ(stats.sent + stats.suppressed, fullSent);
+    CHECK(stats.sent * 5 < fullSent);
+    CHECK(stats.refreshed > 0);
+    printf("%d sensors, %u sweeps : full dump %zu messages %zu bytes, %.1f us/sweep | delta %u sent ( %u refreshes ), "
+           "%u suppressed ( %u inside the deadband ), %zu bytes, %.1f us/sweep ( %.1f%% of the messages )\n",
+           SENSORS, static_cast<unsigned>(SWEEPS), fullSent, bytes, fullNs / 1000, stats.sent, stats.refreshed, stats.suppressed,
+           stats.deadband, deltaBytes, deltaNs / 1000, 100.0 * stats.sent / fullSent);
+}
+
+int main()
+{
+    TestScan();
+    TestDelta();
+    TestRefresh();
+    TestSyncDuringSweep();
+    Bench();
+    HOST_TEST_END();
+}
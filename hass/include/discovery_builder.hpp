@@ -0,0 +1,179 @@
+#pragma once
+#ifndef _DISCOVERY_BUILDER_
+#define _DISCOVERY_BUILDER_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace homeassistant {
+
+    /**
+     * @brief renders discovery payloads as compact JSON from constexpr key templates.
+     * the templates hold every constant key and value, only the fields ( room, name, MAC, topics ... )
+     * are escaped and appended at render time, into one buffer reused from one entity to the next.
+     * the keys of a template are listed in the order nlohmann::json sorts them ( std::map, byte order ),
+     * so the output is byte identical to discoveryJson.dump()
+     */
+    class DiscoveryBuilder {
+    public:
+        enum Field_t : uint8_t {
+            NONE = 0,
+            ROOM,
+            NAME,
+            MAC,
+            MODEL,
+            VERSION,
+            MANUFACTURER,
+            PREFIX,        // "~", room/name_MAC/entity
+            UNIQUE_ID,
+            AVAILABILITY,
+            ENTITY_NAME,
+            CLASS,
+            UNIT,
+            FIELD_COUNT
+        };
+        enum Kind_t : uint8_t {
+            TEXT,   // "before" field "after"
+            RAW,    // before, as is ( numbers, booleans )
+            LIST,   // [ "field" ]
+            OBJECT  // children
+        };
+        struct Key_t {
+            const char* key;
+            Kind_t kind;
+            Field_t field;
+            const char* before;
+            const char* after;
+            const Key_t* children;
+            uint8_t childCount;
+            bool optional; // skipped when the field is not set ( default std::string_view )
+        };
+        using Fields_t = std::array<std::string_view, FIELD_COUNT>;
+
+        // constant string value
+        static constexpr Key_t Text(const char* key, const char* value) { return { key, TEXT, NONE, value, "", nullptr, 0, false }; }
+        // field, with constant text around it
+        static constexpr Key_t Field(const char* key, Field_t field, const char* before = "", const char* after = "", bool optional = false)
+        {
+            return { key, TEXT, field, before, after, nullptr, 0, optional };
+        }
+        static constexpr Key_t Raw(const char* key, const char* value) { return { key, RAW, NONE, value, "", nullptr, 0, false }; }
+        static constexpr Key_t List(const char* key, Field_t field) { return { key, LIST, field, "", "", nullptr, 0, false }; }
+        template <size_t N>
+        static constexpr Key_t Object(const char* key, const Key_t (&children)[N]) { return { key, OBJECT, NONE, "", "", children, N, false }; }
+
+        /**
+         * @brief render a template
+         *
+         * @return const std::string& the buffer, valid until the next Render()
+         */
+        template <size_t N>
+        const std::string& Render(const Key_t (&keys)[N], const Fields_t& fields)
+        {
+            buffer.clear();
+            AppendObject(keys, N, fields);
+            return buffer;
+        }
+        size_t Capacity() const { return buffer.capacity(); }
+
+        // JSON string escaping as nlohmann::json dump() does it ( UTF-8 kept as is )
+        static void AppendEscaped(std::string& out, std::string_view text);
+
+    private:
+        void AppendObject(const Key_t* keys, size_t count, const Fields_t& fields);
+        std::string buffer;
+    };
+
+    // discovery templates, keys in nlohmann::json order
+    namespace discovery_template {
+        using Builder = DiscoveryBuilder;
+
+        inline constexpr Builder::Key_t DEVICE[] = {
+            Builder::List("identifiers", Builder::MAC),
+            Builder::Field("mdl", Builder::MODEL),
+            Builder::Field("mf", Builder::MANUFACTURER),
+            Builder::Field("name", Builder::NAME),
+            Builder::Field("sa", Builder::ROOM),
+            Builder::Field("sw", Builder::VERSION),
+        };
+
+        inline constexpr Builder::Key_t RELAY[] = {
+            Builder::Field("availability_topic", Builder::AVAILABILITY),
+            Builder::Text("command_topic", "~/cmd"),
+            Builder::Object("dev", DEVICE),
+            Builder::Field("device_class", Builder::CLASS),
+            Builder::Field("name", Builder::ENTITY_NAME),
+            Builder::Text("payload_available", "online"),
+            Builder::Text("payload_not_available", "offline"),
+            Builder::Text("pl_off", "OFF"),
+            Builder::Text("pl_on", "ON"),
+            Builder::Field("room", Builder::ROOM),
+            Builder::Text("state_topic", "~/state"),
+            Builder::Field("unique_id", Builder::UNIQUE_ID),
+            Builder::Field("~", Builder::PREFIX),
+        };
+
+        inline constexpr Builder::Key_t BLIND[] = {
+            Builder::Field("availability_topic", Builder::AVAILABILITY),
+            Builder::Text("command_topic", "~/cmd"),
+            Builder::Object("dev", DEVICE),
+            Builder::Field("device_class", Builder::CLASS),
+            Builder::Field("name", Builder::UNIQUE_ID),
+            Builder::Text("payload_available", "online"),
+            Builder::Text("payload_close", "CLOSE"),
+            Builder::Text("payload_not_available", "offline"),
+            Builder::Text("payload_open", "OPEN"),
+            Builder::Text("payload_stop", "STOP"),
+            Builder::Raw("position_closed", "0"),
+            Builder::Raw("position_open", "100"),
+            Builder::Text("position_template", "{{ value_json.position }}"),
+            Builder::Text("position_topic", "~/position"),
+            Builder::Field("room", Builder::ROOM),
+            Builder::Text("set_position_topic", "~/set_pos"),
+            Builder::Text("state_closed", "closed"),
+            Builder::Text("state_closing", "closing"),
+            Builder::Text("state_open", "open"),
+            Builder::Text("state_opening", "opening"),
+            Builder::Text("state_topic", "~/state"),
+            Builder::Field("unique_id", Builder::UNIQUE_ID),
+            Builder::Text("value_template", "{{ value_json.state }}"),
+            Builder::Field("~", Builder::PREFIX),
+        };
+
+        inline constexpr Builder::Key_t SENSOR[] = {
+            Builder::Field("availability_topic", Builder::AVAILABILITY),
+            Builder::Object("dev", DEVICE),
+            Builder::Field("device_class", Builder::CLASS),
+            Builder::Field("name", Builder::UNIQUE_ID),
+            Builder::Text("payload_available", "online"),
+            Builder::Text("payload_not_available", "offline"),
+            Builder::Field("room", Builder::ROOM),
+            Builder::Text("state_topic", "~/state"),
+            Builder::Field("unique_id", Builder::UNIQUE_ID),
+            Builder::Field("unit_of_meas", Builder::UNIT, "", "", true),
+            Builder::Field("value_template", Builder::CLASS, "{{ value_json.", "}}"),
+            Builder::Field("~", Builder::PREFIX),
+        };
+
+        inline constexpr Builder::Key_t BINARY_SENSOR[] = {
+            Builder::Field("availability_topic", Builder::AVAILABILITY),
+            Builder::Object("dev", DEVICE),
+            Builder::Field("device_class", Builder::CLASS),
+            Builder::Field("name", Builder::UNIQUE_ID),
+            Builder::Text("payload_available", "online"),
+            Builder::Text("payload_not_available", "offline"),
+            Builder::Raw("payload_off", "false"),
+            Builder::Raw("payload_on", "true"),
+            Builder::Field("room", Builder::ROOM),
+            Builder::Text("state_topic", "~/state"),
+            Builder::Field("unique_id", Builder::UNIQUE_ID),
+            Builder::Field("value_template", Builder::CLASS, "{{ value_json.", "}}"),
+            Builder::Field("~", Builder::PREFIX),
+        };
+    };
+};
+
+#endif
@@ -0,0 +1,159 @@
+#pragma once
+#ifndef _DISCOVERY_PUBLISHER_
+#define _DISCOVERY_PUBLISHER_
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "timer_wheel.hpp"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef CONFIG_HASS_DISCOVERY_WINDOW
+#define CONFIG_HASS_DISCOVERY_WINDOW 4
+#endif
+#ifndef CONFIG_HASS_DISCOVERY_CHUNK
+#define CONFIG_HASS_DISCOVERY_CHUNK 4
+#endif
+#ifndef CONFIG_HASS_DISCOVERY_INTERVAL_MS
+#define CONFIG_HASS_DISCOVERY_INTERVAL_MS 100
+#endif
+#ifndef CONFIG_HASS_DISCOVERY_ACK_TIMEOUT_MS
+#define CONFIG_HASS_DISCOVERY_ACK_TIMEOUT_MS 5000
+#endif
+
+namespace homeassistant {
+    class Discovery;
+
+    struct DiscoveryPublisherConfig_t {
+        uint8_t window = CONFIG_HASS_DISCOVERY_WINDOW;
+        uint8_t chunk = CONFIG_HASS_DISCOVERY_CHUNK;
+        uint32_t intervalMs = CONFIG_HASS_DISCOVERY_INTERVAL_MS;
+        uint32_t ackTimeoutMs = CONFIG_HASS_DISCOVERY_ACK_TIMEOUT_MS; // then sent again
+    };
+
+    /**
+     * @brief streams the discovery list to the broker after a connection, instead of all at once :
+     * at most \c chunk messages every \c intervalMs, and at most \c window messages waiting for their PUBACK.
+     * an entity whose discovery ( topic and payload ) hashes to the value stored at its last PUBACK
+     * is skipped, the availability topics are sent once per connection.
+     * a disconnect keeps what was acknowledged : the next Start() resumes with the rest.
+     *
+     *  publisher.SetPublishFunction([](const std::string& topic, const std::string& payload, int* msgId) {
+     *      return mqtt.Publish(MqttMsg_t{ true, 1, payload, topic, payload.length() }, msgId); });
+     *  // MQTT connected      -> publisher.Start();
+     *  // MQTT_EVENT_PUBLISHED -> publisher.OnPublished(msg_id);
+     *  // MQTT disconnected   -> publisher.OnDisconnected();
+     *
+     * homeassistant::AttachMqttEvents() wires DefaultDiscoveryPublisher() this way.
+     */
+    class DiscoveryPublisher {
+    public:
+        // publish one message, \c msgId : id of the PUBACK to wait for, 0 : nothing to wait for ( QoS 0 )
+        using Publish_t = std::function<esp_err_t(const std::string& topic, const std::string& payload, int* msgId)>;
+        // hash persistence, the default is NvsCache::Default() on target and nothing on host
+        using LoadHash_t = std::function<bool(const char* key, uint32_t& hash)>;
+        using SaveHash_t = std::function<void(const char* key, uint32_t hash)>;
+        using Config_t = DiscoveryPublisherConfig_t;
+        struct Stats_t {
+            uint32_t published;  // messages handed to the publish function
+            uint32_t acked;
+            uint32_t skipped;    // discoveries unchanged since their last PUBACK
+            uint32_t timeouts;
+            uint32_t errors;     // publish function failures
+            uint32_t passes;
+            uint32_t lastRunMs;  // Start() to every message acknowledged
+        };
+        static constexpr uint32_t NO_DEADLINE = UINT32_MAX;
+        static constexpr char NVS_NAMESPACE[] = "hass";
+
+        /**
+         * @param wheel pacing timer, nullptr : nothing is armed, the caller drives Poll() ( tests )
+         */
+        explicit DiscoveryPublisher(const Config_t& config = Config_t(), TimerWheel* wheel = &TimerWheel::Default());
+        ~DiscoveryPublisher();
+        DiscoveryPublisher(const DiscoveryPublisher&) = delete;
+        DiscoveryPublisher& operator=(const DiscoveryPublisher&) = delete;
+
+        void SetPublishFunction(Publish_t publish);
+        void SetHashStore(LoadHash_t load, SaveHash_t save);
+
+        /**
+         * @brief connection up : hash the discovery list ( UpdateDiscoveryList() first ) and start streaming
+         *
+         * @return esp_err_t ESP_ERR_INVALID_STATE no publish function, ESP_ERR_INVALID_SIZE empty list
+         */
+        esp_err_t Start(uint32_t nowMs);
+        esp_err_t Start() { return Start(NowMs()); }
+        // PUBACK of \c msgId
+        void OnPublished(int msgId);
+        void OnPublished(int msgId, uint32_t nowMs);
+        // connection lost : messages waiting for a PUBACK are sent again on the next Start(). never blocks
+        void OnDisconnected();
+        // forget the stored hashes : everything is sent on the next Start()
+        void Invalidate();
+
+        /**
+         * @brief timeouts, then the next messages the window and the chunk allow
+         *
+         * @return uint32_t ms until the next pass is needed, NO_DEADLINE : done or disconnected
+         */
+        uint32_t Poll(uint32_t nowMs);
+
+        uint32_t NowMs() const;
+        bool IsDone();
+        size_t GetPendingCount();
+        Stats_t GetStats();
+        void ResetStats();
+
+    private:
+        enum State_t : uint8_t {
+            PENDING,
+            SENDING,   // handed to the publish function, lock released
+            IN_FLIGHT, // waiting for the PUBACK
+            DONE,
+        };
+        struct Item_t {
+            Discovery* entity;  // nullptr : availability message
+            std::string topic;
+            std::string payload;
+            uint32_t hash;
+            uint32_t sentMs;
+            int msgId;
+            State_t state;
+            char key[10];       // NVS key, "d" + hash of the topic
+        };
+
+        static uint32_t Hash(const std::string& topic, const std::string& payload);
+        void Collect();
+        void Acked(Item_t& item);
+        size_t GetPendingLocked();
+        uint32_t NextDeadlineLocked(uint32_t nowMs);
+        void Arm(uint32_t delayMs);
+
+        Config_t config;
+        TimerWheel* const wheel;
+        WheelTimer_p_t timer{nullptr};
+        std::mutex passLock; // Start() and passes, the publish function runs without \c lock
+        std::mutex lock;
+        Publish_t publish = nullptr;
+        LoadHash_t loadHash = nullptr;
+        SaveHash_t saveHash = nullptr;
+        std::vector<Item_t> items;
+        std::vector<int> earlyAcks; // PUBACKs received before the publish function returned
+        std::vector<size_t> batch;  // items sent by the current pass
+        size_t cursor = 0;          // items before it are not PENDING
+        uint8_t inFlight = 0;
+        uint8_t budget = 0;         // messages left in the current chunk
+        uint32_t chunkStartMs = 0;
+        uint32_t startMs = 0;
+        bool connected = false;
+        bool complete = false;
+        bool forceAll = false;      // Invalidate()
+        Stats_t stats{};
+    };
+};
+
+#endif
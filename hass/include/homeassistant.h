@@ -7,8 +7,10 @@
 #include <forward_list>
 #include <memory>
 #include "nlohmann/json.hpp"
+#include "discovery_builder.hpp"
+#include "discovery_publisher.hpp"
+#include "esp_event_cxx.hpp"
 #include <string>
-#include <sstream>
 #include <vector>
 #include <esp_log.h>
 #include <functional>
@@ -55,6 +57,7 @@ namespace homeassistant {
         const std::string& name()const;
         const std::string& room()const;
         const std::string& MAC()const;
+        const Device_Description_t& Description()const;
         nlohmann::json JsonObject()const;
     };
 
@@ -62,15 +65,23 @@ namespace homeassistant {
     protected:
         BaseDevCtx& _BaseDevCtx;
         std::string hass_mqtt_device;
-        std::stringstream discovery_topic;
+        std::string discovery_topic;
         std::string availability_topic = "";
         std::string state_topic = "";
         std::string command_topic = "";
         std::string discovery_message;
-        std::stringstream topics_prefix;
-        std::stringstream unique_id;
-        nlohmann::json discoveryJson;
+        std::string topics_prefix;
+        std::string unique_id;
         virtual void ProcessFinalJson() = 0;
+        // device and topic fields, the entity adds its own before rendering
+        DiscoveryBuilder::Fields_t Fields() const;
+        // compact payload into discovery_message, see DiscoveryBuilder
+        template <size_t N>
+        void Render(const DiscoveryBuilder::Key_t (&keys)[N], const DiscoveryBuilder::Fields_t& fields)
+        {
+            discovery_message.assign(builder.Render(keys, fields));
+        }
+        static DiscoveryBuilder builder; // shared, UpdateDiscoveryList() renders one entity at a time
         bool procced = false;
     protected:
         static constexpr char relay_t[] = "switch";
@@ -101,11 +112,34 @@ namespace homeassistant {
     };
 
     esp_err_t UpdateDiscoveryList();
+    // every entity constructed so far, in construction order
+    const std::vector<Discovery*>& DiscoveryList();
+    // discovery and availability of every entity, paced by DefaultDiscoveryPublisher()
     esp_err_t PublishDiscovery_and_Available();
+    // streams the discovery list through discoveryPublishFunction ( statsPublishDiscoveryFunction without it )
+    DiscoveryPublisher& DefaultDiscoveryPublisher();
+    /**
+     * @brief MQTT connection hooks, from the event loop handlers of the client events ( see AttachMqttEvents ).
+     * not from the MQTT event task itself : a discovery publish may wait for the client lock held there
+     */
+    esp_err_t OnMqttConnected();
+    void OnMqttPublished(int msgId);
+    void OnMqttDisconnected();
+    /**
+     * @brief OnMqttConnected / OnMqttPublished / OnMqttDisconnected on \c loop, e.g. for mqtt_class :
+     *  AttachMqttEvents(*loop, mqtt.EVENT_CONNECTED, mqtt.EVENT_PUBLISH, mqtt.EVENT_DISCONNECT);
+     * the published event carries the int msg_id of the PUBACK
+     */
+    esp_err_t AttachMqttEvents(idf::event::ESPEventLoop& loop, const idf::event::ESPEvent& connected,
+        const idf::event::ESPEvent& published, const idf::event::ESPEvent& disconnected);
+    // publishes the states that changed since the last call ( see StatsRegistry ) in one flush,
+    // states the client refused are flushed again after CONFIG_HASS_STATS_RETRY_MS
     esp_err_t PublishAllStats();
     extern std::vector<std::function<const std::pair<std::string,std::string>()>> statsGenerateFunctions;
     extern std::function<esp_err_t(const std::pair<std::string,std::string>)> MqttPublishFunction;
     extern std::function<esp_err_t(const std::pair<std::string,std::string>)> statsPublishDiscoveryFunction;
+    // discovery publish with the PUBACK id ( msgId, 0 for QoS 0 ), e.g. Mqtt::Publish(msg, msgId)
+    extern std::function<esp_err_t(const std::pair<std::string,std::string>, int* msgId)> discoveryPublishFunction;
     extern homeassistant::Device_Description_t hassDevCtxDescription;
     extern homeassistant::BaseDevCtx thisDevideCtx;
     class RelayDiscovery : public Discovery {
@@ -132,8 +166,8 @@ namespace homeassistant {
         BlindDiscovery(const char* class_type) : Discovery(Discovery::cover_t), _class_type(class_type)
         {
         }
-        const std::string GetSetPosTopic() const { return  std::string(topics_prefix.str() + "/set_pos"); }
-        const std::string GetPosTopic() const { return  std::string(topics_prefix.str() + "/position"); }
+        const std::string GetSetPosTopic() const { return  std::string(topics_prefix + "/set_pos"); }
+        const std::string GetPosTopic() const { return  std::string(topics_prefix + "/position"); }
         static constexpr char	None[] = "None";
         static constexpr char	awning[] = "awning";
         static constexpr char	blind[] = "blind";
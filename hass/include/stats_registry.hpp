@@ -0,0 +1,113 @@
+#pragma once
+#ifndef _STATS_REGISTRY_
+#define _STATS_REGISTRY_
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef CONFIG_HASS_STATS_REFRESH_S
+#define CONFIG_HASS_STATS_REFRESH_S 300
+#endif
+#ifndef CONFIG_HASS_STATS_RETRY_MS
+#define CONFIG_HASS_STATS_RETRY_MS 2000
+#endif
+
+namespace homeassistant {
+
+    /**
+     * @brief delta publishing of the state messages : each sweep calls every generator, and a payload is
+     * published only when it differs from the last one published on its topic.
+     * numbers are compared apart from the rest of the payload : a payload whose text ( numbers left out ) is
+     * unchanged and whose numbers all moved less than the deadband of the entry is suppressed,
+     * so {"temperature":21.43} after {"temperature":21.40} is not sent with a 0.1 deadband.
+     * every entry is sent again after \c refreshMs, even unchanged.
+     *
+     *  auto id = StatsRegistry::Default().Add([] { return std::make_pair(topic, payload); }, 0.1f);
+     *  StatsRegistry::Default().Sweep(MqttPublishFunction, StatsRegistry::Default().NowMs());
+     */
+    class StatsRegistry {
+    public:
+        using StringPair_t = std::pair<std::string, std::string>;
+        using Generator_t = std::function<const StringPair_t()>;
+        using Publish_t = std::function<esp_err_t(const StringPair_t)>;
+        static constexpr size_t MAX_NUMBERS = 8; // compared with the deadband, the next ones must match exactly
+        struct Stats_t {
+            uint32_t sweeps;
+            uint32_t sent;
+            uint32_t suppressed; // unchanged or inside the deadband
+            uint32_t deadband;   // of suppressed : numbers moved, inside the deadband
+            uint32_t refreshed;  // of sent : unchanged, sent for the refresh interval
+            uint32_t errors;     // publish failures, retried on the next sweep
+        };
+
+        explicit StatsRegistry(uint32_t refreshMs = CONFIG_HASS_STATS_REFRESH_S * 1000);
+        StatsRegistry(const StatsRegistry&) = delete;
+        StatsRegistry& operator=(const StatsRegistry&) = delete;
+
+        // registry behind PublishAllStats()
+        static StatsRegistry& Default();
+
+        /**
+         * @brief add a state generator
+         *
+         * @param deadband smallest move of a number that is published, 0 : any change
+         * @return size_t id of the entry, for SetDeadband()
+         */
+        size_t Add(Generator_t generator, float deadband = 0);
+        // ESP_ERR_INVALID_ARG unknown id
+        esp_err_t SetDeadband(size_t id, float deadband);
+        // 0 : no forced refresh
+        void SetRefreshInterval(uint32_t refreshMs);
+        // adds the generators appended to \c generators since the last call ( statsGenerateFunctions )
+        void Sync(const std::vector<Generator_t>& generators);
+        // the next sweep sends every entry ( after a reconnect )
+        void Invalidate();
+
+        /**
+         * @brief one pass over the entries, publishing the changed ones
+         *
+         * @return esp_err_t ESP_OK, or the OR of the publish errors
+         */
+        esp_err_t Sweep(const Publish_t& publish, uint32_t nowMs);
+
+        uint32_t NowMs() const;
+        size_t GetCount();
+        Stats_t GetStats();
+        void ResetStats();
+
+        /**
+         * @brief hash of the payload with every number outside the strings left out, and its numbers.
+         * JSON numbers only : hex, inf and nan, or a number out of the float range, are hashed as text
+         *
+         * @return size_t numbers found, only the first \c max are written, the next ones go to the hash
+         */
+        static size_t Scan(const std::string& payload, uint32_t& hash, float* numbers, size_t max);
+
+    private:
+        struct Entry_t {
+            Generator_t generator;
+            float deadband;
+            bool published;      // hash and numbers valid
+            uint32_t hash;       // topic and payload text of the last publish
+            uint32_t sentMs;
+            uint8_t count;       // numbers of the last publish
+            float numbers[MAX_NUMBERS];
+        };
+
+        std::mutex passLock; // entries, sweeps
+        std::mutex lock;     // stats
+        std::vector<Entry_t> entries;
+        size_t synced = 0;
+        uint32_t refreshMs;
+        Stats_t stats{};
+    };
+};
+
+#endif
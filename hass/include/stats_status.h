@@ -0,0 +1,28 @@
+#pragma once
+#ifndef _STATS_STATUS_
+#define _STATS_STATUS_
+
+#include "config.hpp"
+#include "stats_registry.hpp"
+
+namespace homeassistant {
+
+    /**
+     * @brief StatsRegistry counters in the status dump :
+     * "hass_stats":{"sent":..,"suppressed":..,"deadband":..,"refreshed":..,"errors":..,"sweeps":..,"entries":..}
+     */
+    class StatsRegistryStatus : public Config {
+    public:
+        static constexpr char TAG[] = "hass_stats";
+
+        explicit StatsRegistryStatus(StatsRegistry& registry);
+
+    protected:
+        esp_err_t GetConfigurationStatus(json& config_out) const override;
+
+    private:
+        StatsRegistry& registry;
+    };
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "discovery_builder.hpp"
+
+namespace homeassistant {
+
+    void DiscoveryBuilder::AppendEscaped(std::string& out, std::string_view text)
+    {
+        static constexpr char hex[] = "0123456789abcdef";
+        for (const char c : text)
+        {
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\b':
+                out += "\\b";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<uint8_t>(c) < 0x20)
+                {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0x0F];
+                    out += hex[c & 0x0F];
+                }
+                else
+                {
+                    out += c;
+                }
+                break;
+            }
+        }
+    }
+
+    void DiscoveryBuilder::AppendObject(const Key_t* keys, size_t count, const Fields_t& fields)
+    {
+        buffer += '{';
+        bool first = true;
+        for (size_t i = 0; i < count; i++)
+        {
+            const Key_t& key = keys[i];
+            const std::string_view field = fields[key.field];
+            if (key.optional && field.data() == nullptr)
+            {
+                continue;
+            }
+            if (!first)
+            {
+                buffer += ',';
+            }
+            first = false;
+            buffer += '"';
+            buffer += key.key;
+            buffer += "\":";
+            switch (key.kind)
+            {
+            case TEXT:
+                buffer += '"';
+                buffer += key.before;
+                AppendEscaped(buffer, field);
+                buffer += key.after;
+                buffer += '"';
+                break;
+            case RAW:
+                buffer += key.before;
+                break;
+            case LIST:
+                buffer += "[\"";
+                AppendEscaped(buffer, field);
+                buffer += "\"]";
+                break;
+            case OBJECT:
+                AppendObject(key.children, key.childCount, fields);
+                break;
+            }
+        }
+        buffer += '}';
+    }
+};
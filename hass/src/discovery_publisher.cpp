@@ -0,0 +1,406 @@
+#include "discovery_publisher.hpp"
+#include "homeassistant.h"
+#include "esp_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#ifdef ESP_PLATFORM
+#include "nvs_cache.h"
+#endif
+
+namespace homeassistant {
+    static const char TAG[] = "HASS_PUB";
+    constexpr char DiscoveryPublisher::NVS_NAMESPACE[];
+
+    DiscoveryPublisher::DiscoveryPublisher(const Config_t& _config, TimerWheel* _wheel) :
+        config(_config),
+        wheel(_wheel)
+    {
+        config.window = std::max<uint8_t>(config.window, 1);
+        config.chunk = std::max<uint8_t>(config.chunk, 1);
+#ifdef ESP_PLATFORM
+        loadHash = [](const char* key, uint32_t& hash) {
+            return NvsCache::Default().get(NVS_NAMESPACE, key, hash) == ESP_OK;
+        };
+        saveHash = [](const char* key, uint32_t hash) {
+            NvsCache::Default().set(NVS_NAMESPACE, key, hash);
+        };
+#endif
+        if (wheel != nullptr)
+        {
+            timer = std::make_unique<WheelTimer>([this]()
+                { Poll(NowMs()); },
+                "hass discovery", *wheel);
+        }
+    }
+
+    DiscoveryPublisher::~DiscoveryPublisher()
+    {
+        // waits for a running pass
+        timer.reset();
+    }
+
+    void DiscoveryPublisher::SetPublishFunction(Publish_t _publish)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        publish = _publish;
+    }
+
+    void DiscoveryPublisher::SetHashStore(LoadHash_t load, SaveHash_t save)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        loadHash = load;
+        saveHash = save;
+    }
+
+    /**
+     * @brief FNV-1a over topic and payload, never 0 ( no hash stored )
+     */
+    uint32_t DiscoveryPublisher::Hash(const std::string& topic, const std::string& payload)
+    {
+        uint32_t hash = 2166136261u;
+        for (const char c : topic)
+        {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        hash = (hash ^ 0u) * 16777619u;
+        for (const char c : payload)
+        {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return hash ? hash : 1;
+    }
+
+    /**
+     * @brief under both locks : one item per discovery, one per distinct availability topic after the
+     * first entity that uses it. unchanged discoveries are DONE from the start
+     */
+    void DiscoveryPublisher::Collect()
+    {
+        std::vector<Item_t> previous;
+        previous.swap(items);
+        std::vector<std::string> availability;
+        for (Discovery* entity : DiscoveryList())
+        {
+            Item_t item{};
+            item.entity = entity;
+            item.topic = entity->DiscoveryTopic();
+            item.payload = entity->DiscoveryMessage();
+            item.hash = Hash(item.topic, item.payload);
+            snprintf(item.key, sizeof(item.key), "d%08x", static_cast<unsigned>(Hash(item.topic, std::string())));
+            item.state = PENDING;
+            if (!forceAll)
+            {
+                uint32_t stored = 0;
+                const auto old = std::find_if(previous.begin(), previous.end(), [&item](const Item_t& p) {
+                    return p.entity == item.entity && p.state == DONE;
+                });
+                if (old != previous.end())
+                {
+                    stored = old->hash;
+                }
+                else if (loadHash != nullptr)
+                {
+                    loadHash(item.key, stored);
+                }
+                if (stored == item.hash)
+                {
+                    item.state = DONE;
+                    stats.skipped++;
+                }
+            }
+            items.push_back(std::move(item));
+            const std::string& topic = entity->AvailabilityTopic();
+            if (std::find(availability.begin(), availability.end(), topic) == availability.end())
+            {
+                availability.push_back(topic);
+                Item_t online{};
+                const auto message = entity->AvailabilityMessage();
+                online.topic = message.first;
+                online.payload = message.second;
+                online.state = PENDING;
+                items.push_back(std::move(online));
+            }
+        }
+        forceAll = false;
+    }
+
+    esp_err_t DiscoveryPublisher::Start(uint32_t nowMs)
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        std::lock_guard<std::mutex> guard(lock);
+        if (publish == nullptr)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        const uint32_t skipped = stats.skipped;
+        Collect();
+        if (items.empty())
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        connected = true;
+        complete = false;
+        startMs = nowMs;
+        inFlight = 0;
+        earlyAcks.clear();
+        cursor = 0;
+        budget = config.chunk;
+        chunkStartMs = nowMs;
+        ESP_LOGI(TAG, "%u messages, %u discoveries unchanged", static_cast<unsigned>(GetPendingLocked()), static_cast<unsigned>(stats.skipped - skipped));
+        Arm(0);
+        return ESP_OK;
+    }
+
+    void DiscoveryPublisher::OnPublished(int msgId)
+    {
+        OnPublished(msgId, NowMs());
+    }
+
+    void DiscoveryPublisher::OnPublished(int msgId, uint32_t nowMs)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        bool sending = false;
+        for (Item_t& item : items)
+        {
+            if (item.state == IN_FLIGHT && item.msgId == msgId)
+            {
+                Acked(item);
+                inFlight--;
+                // the window has room again
+                Arm(NextDeadlineLocked(nowMs));
+                return;
+            }
+            sending |= (item.state == SENDING);
+        }
+        if (sending)
+        {
+            if (earlyAcks.size() >= config.window)
+            {
+                earlyAcks.erase(earlyAcks.begin());
+            }
+            earlyAcks.push_back(msgId);
+        }
+    }
+
+    void DiscoveryPublisher::OnDisconnected()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            connected = false;
+            for (Item_t& item : items)
+            {
+                if (item.state == IN_FLIGHT || item.state == SENDING)
+                {
+                    item.state = PENDING;
+                }
+            }
+            inFlight = 0;
+            cursor = 0;
+            earlyAcks.clear();
+        }
+        // no timer->stop() : it waits for a running pass, whose publish may wait for the MQTT task calling us.
+        // an armed pass sees the disconnection and does not arm again
+    }
+
+    void DiscoveryPublisher::Invalidate()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        forceAll = true;
+    }
+
+    uint32_t DiscoveryPublisher::Poll(uint32_t nowMs)
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        std::unique_lock<std::mutex> guard(lock);
+        stats.passes++;
+        if (!connected)
+        {
+            return NO_DEADLINE;
+        }
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            Item_t& item = items[i];
+            if (item.state == IN_FLIGHT && nowMs - item.sentMs >= config.ackTimeoutMs)
+            {
+                item.state = PENDING;
+                inFlight--;
+                stats.timeouts++;
+                cursor = std::min(cursor, i);
+            }
+        }
+        if (nowMs - chunkStartMs >= config.intervalMs)
+        {
+            chunkStartMs = nowMs;
+            budget = config.chunk;
+        }
+        batch.clear();
+        for (size_t i = cursor; i < items.size() && budget > 0 && inFlight < config.window; i++)
+        {
+            if (items[i].state == PENDING)
+            {
+                items[i].state = SENDING;
+                batch.push_back(i);
+                budget--;
+                inFlight++;
+            }
+        }
+        const Publish_t send = publish;
+        bool failed = false;
+        for (const size_t index : batch)
+        {
+            if (failed)
+            {
+                if (items[index].state == SENDING)
+                {
+                    items[index].state = PENDING;
+                    inFlight--;
+                }
+                continue;
+            }
+            int msgId = 0;
+            guard.unlock();
+            // items only change size under passLock, held here
+            esp_err_t ret = send(items[index].topic, items[index].payload, &msgId);
+            guard.lock();
+            Item_t& item = items[index];
+            if (item.state != SENDING)
+            {
+                continue; // disconnected meanwhile
+            }
+            if (ret != ESP_OK)
+            {
+                // the outbox is full or the client went down : retry on the next chunk
+                failed = true;
+                item.state = PENDING;
+                inFlight--;
+                budget = 0;
+                stats.errors++;
+                cursor = std::min(cursor, index);
+                continue;
+            }
+            stats.published++;
+            const auto early = std::find(earlyAcks.begin(), earlyAcks.end(), msgId);
+            if (msgId <= 0 || early != earlyAcks.end())
+            {
+                if (early != earlyAcks.end())
+                {
+                    earlyAcks.erase(early);
+                }
+                Acked(item);
+                inFlight--;
+            }
+            else
+            {
+                item.state = IN_FLIGHT;
+                item.msgId = msgId;
+                item.sentMs = nowMs;
+            }
+        }
+        const uint32_t next = NextDeadlineLocked(nowMs);
+        Arm(next);
+        return next;
+    }
+
+    void DiscoveryPublisher::Acked(Item_t& item)
+    {
+        item.state = DONE;
+        stats.acked++;
+        if (item.entity != nullptr && saveHash != nullptr)
+        {
+            saveHash(item.key, item.hash);
+        }
+    }
+
+    size_t DiscoveryPublisher::GetPendingLocked()
+    {
+        return std::count_if(items.begin(), items.end(), [](const Item_t& item) { return item.state != DONE; });
+    }
+
+    /**
+     * @brief under the lock : next chunk, or the first PUBACK timeout while the window is full
+     */
+    uint32_t DiscoveryPublisher::NextDeadlineLocked(uint32_t nowMs)
+    {
+        if (!connected)
+        {
+            return NO_DEADLINE;
+        }
+        while (cursor < items.size() && items[cursor].state != PENDING)
+        {
+            cursor++;
+        }
+        const bool pending = cursor < items.size();
+        if (!pending && inFlight == 0)
+        {
+            if (!complete)
+            {
+                complete = true;
+                stats.lastRunMs = nowMs - startMs;
+                ESP_LOGI(TAG, "discovery done in %u ms", static_cast<unsigned>(stats.lastRunMs));
+            }
+            return NO_DEADLINE;
+        }
+        uint32_t next = NO_DEADLINE;
+        if (pending && inFlight < config.window)
+        {
+            const uint32_t elapsed = nowMs - chunkStartMs;
+            next = (budget > 0) ? 0 : (elapsed >= config.intervalMs ? 0 : config.intervalMs - elapsed);
+        }
+        for (const Item_t& item : items)
+        {
+            if (item.state == IN_FLIGHT)
+            {
+                const uint32_t waited = nowMs - item.sentMs;
+                next = std::min(next, waited >= config.ackTimeoutMs ? 0 : config.ackTimeoutMs - waited);
+            }
+        }
+        return next;
+    }
+
+    /**
+     * @brief under the lock : start() does not wait for the callback, stop() would
+     */
+    void DiscoveryPublisher::Arm(uint32_t delayMs)
+    {
+        if (timer == nullptr || delayMs == NO_DEADLINE)
+        {
+            return;
+        }
+        timer->start_once(std::chrono::milliseconds(delayMs > 0 ? delayMs : 1));
+    }
+
+    uint32_t DiscoveryPublisher::NowMs() const
+    {
+        if (wheel != nullptr)
+        {
+            return static_cast<uint32_t>(wheel->NowUs() / 1000);
+        }
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    bool DiscoveryPublisher::IsDone()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return complete;
+    }
+
+    size_t DiscoveryPublisher::GetPendingCount()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return GetPendingLocked();
+    }
+
+    DiscoveryPublisher::Stats_t DiscoveryPublisher::GetStats()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return stats;
+    }
+
+    void DiscoveryPublisher::ResetStats()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stats = Stats_t{};
+    }
+};
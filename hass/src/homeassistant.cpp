@@ -10,7 +10,17 @@ Copyright (C) 2019-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com
 
 */
 #include "homeassistant.h"
+#include "stats_registry.hpp"
+#include "publish_coalescer.hpp"
+#include "task_pool.hpp"
+#include "fast_format.hpp"
 #include "esp_log.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#ifdef ESP_PLATFORM
+#include "stats_status.h"
+#endif
 namespace homeassistant {
     homeassistant::Device_Description_t hassDevCtxDescription;
     homeassistant::BaseDevCtx thisDevideCtx(hassDevCtxDescription);
@@ -19,41 +29,113 @@ namespace homeassistant {
     {
         if (discoveryList.size() == 0)
             return ESP_ERR_INVALID_SIZE;
+        // every entity shares thisDevideCtx
+        thisDevideCtx.UpdateDescription();
         for (auto& d : discoveryList)
         {
-            d->UpdateDevCtx();
             d->ProcessJson();
         }
         return ESP_OK;
     }
+    const std::vector<Discovery*>& DiscoveryList()
+    {
+        return discoveryList;
+    }
+    DiscoveryPublisher& DefaultDiscoveryPublisher()
+    {
+        static DiscoveryPublisher publisher;
+        static std::once_flag wired;
+        std::call_once(wired, []() {
+            publisher.SetPublishFunction([](const std::string& topic, const std::string& payload, int* msgId) {
+                if (discoveryPublishFunction != nullptr)
+                    return discoveryPublishFunction(std::make_pair(topic, payload), msgId);
+                // no PUBACK id : only the chunks pace the stream
+                *msgId = 0;
+                return (statsPublishDiscoveryFunction != nullptr) ? statsPublishDiscoveryFunction(std::make_pair(topic, payload)) : ESP_ERR_INVALID_STATE;
+            });
+        });
+        return publisher;
+    }
     esp_err_t PublishDiscovery_and_Available()
     {
-        if (statsPublishDiscoveryFunction == nullptr)
+        if (statsPublishDiscoveryFunction == nullptr && discoveryPublishFunction == nullptr)
             return ESP_ERR_INVALID_STATE;
-        esp_err_t ret = ESP_OK;
-        for (auto& d : discoveryList)
+        return DefaultDiscoveryPublisher().Start();
+    }
+    esp_err_t OnMqttConnected()
+    {
+        // retained states may be gone with the broker session : the next sweep sends them all
+        StatsRegistry::Default().Invalidate();
+        return PublishDiscovery_and_Available();
+    }
+    void OnMqttPublished(int msgId)
+    {
+        DefaultDiscoveryPublisher().OnPublished(msgId);
+    }
+    void OnMqttDisconnected()
+    {
+        DefaultDiscoveryPublisher().OnDisconnected();
+    }
+    esp_err_t AttachMqttEvents(idf::event::ESPEventLoop& loop, const idf::event::ESPEvent& connected,
+        const idf::event::ESPEvent& published, const idf::event::ESPEvent& disconnected)
+    {
+        static std::vector<std::unique_ptr<idf::event::ESPEventReg>> registrations;
+        static std::mutex registrationsLock;
+        std::lock_guard<std::mutex> guard(registrationsLock);
+        registrations.clear();
+        registrations.push_back(loop.register_event(connected, []() { OnMqttConnected(); }));
+        registrations.push_back(loop.register_event(published, [](const idf::event::ESPEvent&, void* data) {
+            if (data != nullptr)
+                OnMqttPublished(*static_cast<int*>(data));
+        }));
+        registrations.push_back(loop.register_event(disconnected, []() { OnMqttDisconnected(); }));
+        return ESP_OK;
+    }
+    // states of a sweep, latest value per topic, handed to MqttPublishFunction in one pass
+    static PublishCoalescer statsOutbox([](const std::string& topic, const std::string& payload, uint8_t, bool) {
+        return (MqttPublishFunction != nullptr) ? MqttPublishFunction(std::make_pair(topic, payload)) : ESP_ERR_INVALID_STATE;
+    });
+    static std::atomic_bool statsRetryArmed{ false };
+
+    static esp_err_t FlushStats()
+    {
+        const esp_err_t ret = statsOutbox.Flush();
+        if (ret != ESP_OK && statsOutbox.Pending() > 0 && !statsRetryArmed.exchange(true))
         {
-            ret |= statsPublishDiscoveryFunction(d->GenerateDiscoveryData());
-            ret |= statsPublishDiscoveryFunction(d->AvailabilityMessage());
+            // refused states stay staged : flushed again on a pool worker until the client takes them
+            const esp_err_t err = TaskPool::Default().SubmitAfter(std::chrono::milliseconds(CONFIG_HASS_STATS_RETRY_MS), []() {
+                statsRetryArmed = false;
+                FlushStats();
+            });
+            if (err != ESP_OK)
+            {
+                statsRetryArmed = false;
+            }
         }
-        return ret ;
+        return ret;
     }
     esp_err_t PublishAllStats()
     {
         if (MqttPublishFunction == nullptr)
             return ESP_ERR_INVALID_STATE;
-        esp_err_t ret = ESP_OK;
-        for (auto& statsGen : statsGenerateFunctions)
-        {
-            ret |= MqttPublishFunction(statsGen());
-        }
-        return ret ;
+#ifdef ESP_PLATFORM
+        // sent / suppressed counters in the status dump, built after the Config statics ( the Config ctor locks the list )
+        static StatsRegistryStatus statsStatus(StatsRegistry::Default());
+#endif
+        // only the changed states, see StatsRegistry
+        StatsRegistry& registry = StatsRegistry::Default();
+        registry.Sync(statsGenerateFunctions);
+        const esp_err_t ret = registry.Sweep([](const std::pair<std::string, std::string> message) {
+            return statsOutbox.Stage(message.first, message.second);
+        }, registry.NowMs());
+        return ret | FlushStats();
     }
     typedef std::pair<std::string,std::string> StringPair_t;
     typedef std::function<esp_err_t(const StringPair_t)> PublishPairFunc_t ;
     std::vector<std::function<const StringPair_t()>> statsGenerateFunctions = {};
     PublishPairFunc_t statsPublishDiscoveryFunction = nullptr;
     PublishPairFunc_t MqttPublishFunction = nullptr;
+    std::function<esp_err_t(const StringPair_t, int*)> discoveryPublishFunction = nullptr;
 
 
     static constexpr char mqtt_payload_online[] = "online";
@@ -110,11 +192,16 @@ namespace homeassistant {
     const std::string& BaseDevCtx::MAC() const {
         return deviceDescription.MAC;
     }
+    const Device_Description_t& BaseDevCtx::Description() const {
+        return deviceDescription;
+    }
     nlohmann::json BaseDevCtx::JsonObject() const
     {
         return _json;
     }
 
+    DiscoveryBuilder Discovery::builder;
+
     Discovery::Discovery(const std::string& _hass_mqtt_device) :
         _BaseDevCtx(homeassistant::thisDevideCtx),
         hass_mqtt_device(_hass_mqtt_device)
@@ -128,42 +215,43 @@ namespace homeassistant {
 
     void Discovery::ProcessJson()
     {
-        _BaseDevCtx.UpdateDescription();
-        discoveryJson.clear();
-        discoveryJson = _BaseDevCtx.JsonObject();
+        const std::string& room = _BaseDevCtx.room();
+        const std::string& name = _BaseDevCtx.name();
+        const std::string& MAC = _BaseDevCtx.MAC();
         state_topic = "~/";
         command_topic = "~/";
-        this->unique_id.clear();
-        this->unique_id << _BaseDevCtx.room().c_str();
-        unique_id << '_';
-        unique_id << _BaseDevCtx.name().c_str();
-        unique_id << "_";
-        unique_id << _BaseDevCtx.MAC().c_str();
-        unique_id << '_';
+        // rebuilt in place : the strings keep their capacity from one update to the next
+        unique_id.clear();
+        unique_id.append(room).append(1, '_').append(name).append(1, '_').append(MAC).append(1, '_');
         topics_prefix.clear();
-        this->topics_prefix << _BaseDevCtx.room().c_str();
-        this->topics_prefix << "/";
-        this->topics_prefix << _BaseDevCtx.name().c_str();
-        this->topics_prefix << "_";
-        this->topics_prefix << _BaseDevCtx.MAC().c_str();
+        topics_prefix.append(room).append(1, '/').append(name).append(1, '_').append(MAC);
+        //
+        availability_topic.clear();
+        availability_topic.append(topics_prefix).append("/connection");
         //
-        this->availability_topic = topics_prefix.str().c_str();
-        this->availability_topic += "/connection";
-        //     
         discovery_topic.clear();
-        this->discovery_topic << HOMEASSISTANT_PREFIX;
-        this->discovery_topic << ("/");
-        this->discovery_topic << hass_mqtt_device;
-        this->discovery_topic << "/";
-
-        this->discoveryJson["payload_available"] = mqtt_payload_online;
-        this->discoveryJson["payload_not_available"] = mqtt_payload_offline;
+        discovery_topic.append(HOMEASSISTANT_PREFIX).append(1, '/').append(hass_mqtt_device).append(1, '/');
         this->ProcessFinalJson();
         this->procced = true;
     }
+    DiscoveryBuilder::Fields_t Discovery::Fields() const
+    {
+        const Device_Description_t& description = _BaseDevCtx.Description();
+        DiscoveryBuilder::Fields_t fields{};
+        fields[DiscoveryBuilder::ROOM] = description.room;
+        fields[DiscoveryBuilder::NAME] = description.name;
+        fields[DiscoveryBuilder::MAC] = description.MAC;
+        fields[DiscoveryBuilder::MODEL] = description.model;
+        fields[DiscoveryBuilder::VERSION] = description.version;
+        fields[DiscoveryBuilder::MANUFACTURER] = description.manufacturer;
+        fields[DiscoveryBuilder::PREFIX] = topics_prefix;
+        fields[DiscoveryBuilder::UNIQUE_ID] = unique_id;
+        fields[DiscoveryBuilder::AVAILABILITY] = availability_topic;
+        return fields;
+    }
     void Discovery::DumpDebugAll()
     {
-        ESP_LOGW("HASS", " discovery_topic \n\r %s \n\r", discovery_topic.str().c_str());
+        ESP_LOGW("HASS", " discovery_topic \n\r %s \n\r", discovery_topic.c_str());
         ESP_LOGW("HASS", " availability_topic \n\r %s \n\r", availability_topic.c_str());
         ESP_LOGW("HASS", "StatusTopic \n\r %s \n\r", StatusTopic().c_str());
         ESP_LOGW("HASS", " CommandTopic \n\r %s \n\r", CommandTopic().c_str());
@@ -173,134 +261,80 @@ namespace homeassistant {
     {
         return this->availability_topic;
     }
-    const std::string Discovery::DiscoveryTopic() const { return  this->discovery_topic.str(); }
+    const std::string Discovery::DiscoveryTopic() const { return  this->discovery_topic; }
     const std::string& Discovery::AvailabilityTopic() const { return  this->availability_topic; }
     const std::pair<std::string,std::string> Discovery::AvailabilityMessage() const { return std::make_pair(this->availability_topic, mqtt_payload_online); }
 
-    const std::string Discovery::StatusTopic() const { return std::string(topics_prefix.str() + "/state"); };
-    const std::string Discovery::CommandTopic() const { return  std::string(topics_prefix.str() + "/cmd"); }
+    const std::string Discovery::StatusTopic() const { return ffmt::format(FMT_COMPILE("{}/state"), topics_prefix); };
+    const std::string Discovery::CommandTopic() const { return ffmt::format(FMT_COMPILE("{}/cmd"), topics_prefix); }
     const std::string& Discovery::DiscoveryMessage() const  { return  this->discovery_message; }
 
     void RelayDiscovery::ProcessFinalJson()
     {
-        this->unique_id << _switch_name;
+        this->unique_id += _switch_name;
         //
-        this->topics_prefix << "/" << _switch_name;
+        this->topics_prefix.append(1, '/').append(_switch_name);
 
-        std::string name = _BaseDevCtx.name() + "_" + _switch_name;
+        std::string name = ffmt::format(FMT_COMPILE("{}_{}"), _BaseDevCtx.name(), _switch_name);
         this->state_topic += "state";
         //
-        //
-        this->discovery_topic << unique_id.str().c_str();
-        this->discovery_topic << ("/config");
+        this->discovery_topic.append(unique_id).append("/config");
         //
         this->command_topic += "cmd";
         //
-        this->discoveryJson["state_topic"] = state_topic.c_str();
-        this->discoveryJson["unique_id"] = unique_id.str().c_str();
-        this->discoveryJson["availability_topic"] = availability_topic.c_str();
-        this->discoveryJson["~"] = topics_prefix.str().c_str();
-        this->discoveryJson["pl_on"] = "ON";
-        this->discoveryJson["pl_off"] = "OFF";
-        this->discoveryJson["command_topic"] = command_topic;
-        this->discoveryJson["name"] = name.c_str();
-        this->discoveryJson["device_class"] = _class_type.c_str();
-        this->discovery_message = discoveryJson.dump(5);
+        DiscoveryBuilder::Fields_t fields = Fields();
+        fields[DiscoveryBuilder::ENTITY_NAME] = name;
+        fields[DiscoveryBuilder::CLASS] = _class_type;
+        Render(discovery_template::RELAY, fields);
     }
 
     void BlindDiscovery::ProcessFinalJson()
     {
         //
-        this->unique_id << _class_type;
+        this->unique_id += _class_type;
         //
-
         this->state_topic += "state";
         //
-        this->discovery_topic << unique_id.str().c_str();
-        this->discovery_topic << ("/config");
+        this->discovery_topic.append(unique_id).append("/config");
         //
-        this->topics_prefix << "/" << _class_type;
+        this->topics_prefix.append(1, '/').append(_class_type);
         //
-        this->discoveryJson["~"] = topics_prefix.str().c_str();
-        this->discoveryJson["payload_close"] = "CLOSE";
-        this->discoveryJson["payload_stop"] = "STOP";
-        this->discoveryJson["payload_open"] = "OPEN";
-        this->discoveryJson["availability_topic"] = availability_topic.c_str();
-        this->discoveryJson["set_position_topic"] = "~/set_pos";
-        this->discoveryJson["state_topic"] =  "~/state";
-        this->discoveryJson["command_topic"] = "~/cmd";
-        this->discoveryJson["position_topic"] = "~/position";
-        this->discoveryJson["name"] = unique_id.str().c_str();
-        this->discoveryJson["state_open"] = "open";
-        this->discoveryJson["state_opening"] = "opening";
-        this->discoveryJson["state_closed"] = "closed";
-        this->discoveryJson["state_closing"] = "closing";
-        this->discoveryJson["position_template"] = "{{ value_json.position }}";
-        this->discoveryJson["value_template"] = "{{ value_json.state }}";
-        this->discoveryJson["device_class"] = _class_type;
-        this->discoveryJson["unique_id"] = unique_id.str().c_str();
-        this->discoveryJson["position_open"] = 100;
-        this->discoveryJson["position_closed"] = 0;
-        this->discovery_message = discoveryJson.dump(0);
+        DiscoveryBuilder::Fields_t fields = Fields();
+        fields[DiscoveryBuilder::CLASS] = _class_type;
+        Render(discovery_template::BLIND, fields);
     }
 
     void SensorDiscovery::ProcessFinalJson()
     {
-        this->unique_id << _sensorClass;
+        this->unique_id += _sensorClass;
         //
         this->state_topic += "state";
         //
-        this->discovery_topic << unique_id.str().c_str() << ("/config");
+        this->discovery_topic.append(unique_id).append("/config");
         //
-        this->topics_prefix << "/" << name.c_str();
+        this->topics_prefix.append(1, '/').append(name);
         //
-        this->discoveryJson["unique_id"] = unique_id.str().c_str();
-        //
-        this->discoveryJson["~"] = topics_prefix.str().c_str();
-        this->discoveryJson["availability_topic"] = availability_topic.c_str();
-        this->discoveryJson["state_topic"] = state_topic.c_str();
-        std::string val = "{{ value_json.";
-        val += _sensorClass;
-        val += "}}";
-        this->discoveryJson["value_template"] = val.c_str();
+        DiscoveryBuilder::Fields_t fields = Fields();
+        fields[DiscoveryBuilder::CLASS] = _sensorClass;
         if ((__unit) != "N/A")
         {
-            this->discoveryJson["unit_of_meas"] = __unit.c_str();
+            fields[DiscoveryBuilder::UNIT] = __unit;
         }
-        this->discoveryJson["device_class"] = _sensorClass.c_str();
-        this->discoveryJson["name"] = unique_id.str().c_str();
-        this->discovery_message = discoveryJson.dump(5);
-
+        Render(discovery_template::SENSOR, fields);
     }
 
     void BinarySensorDiscovery::ProcessFinalJson()
     {
-        this->unique_id << _sensorClass;
+        this->unique_id += _sensorClass;
         //
         this->state_topic += "state";
         //
-        this->discovery_topic << unique_id.str().c_str() << ("/config");
+        this->discovery_topic.append(unique_id).append("/config");
         //
-        this->topics_prefix << "/" << name.c_str();
+        this->topics_prefix.append(1, '/').append(name);
         //
-        this->discoveryJson["unique_id"] = unique_id.str().c_str();
-        //
-        this->discoveryJson["~"] = topics_prefix.str().c_str();
-        this->discoveryJson["availability_topic"] = availability_topic.c_str();
-        this->discoveryJson["state_topic"] = state_topic.c_str();
-        std::string val = "{{ value_json.";
-        val += _sensorClass;
-        val += "}}";
-        this->discoveryJson["value_template"] = val.c_str();
-        /* if ((__unit.length()) > 0)
-         {
-             this->discoveryJson["unit_of_meas"] = __unit.c_str();
-         }*/
-        this->discoveryJson["payload_on"] = true;
-        this->discoveryJson["payload_off"] = false;
-        this->discoveryJson["device_class"] = _sensorClass.c_str();
-        this->discoveryJson["name"] = unique_id.str().c_str();
-        this->discovery_message = discoveryJson.dump(5);
-
+        DiscoveryBuilder::Fields_t fields = Fields();
+        fields[DiscoveryBuilder::CLASS] = _sensorClass;
+        Render(discovery_template::BINARY_SENSOR, fields);
     }
 };
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "stats_registry.hpp"
+#include "text_tools.hpp"
+#include <chrono>
+#include <cmath>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#endif
+
+namespace homeassistant {
+
+    static inline uint32_t Fnv(uint32_t hash, char c)
+    {
+        return (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+
+    static inline bool Digit(const char* p, const char* end)
+    {
+        return p < end && *p >= '0' && *p <= '9';
+    }
+
+    // length of the JSON number at \c p, 0 when there is none : no hex, inf or nan, unlike strtof
+    static size_t NumberLength(const char* p, const char* end)
+    {
+        const char* q = (p < end && *p == '-') ? p + 1 : p;
+        if (!Digit(q, end))
+        {
+            return 0;
+        }
+        while (Digit(q, end))
+        {
+            q++;
+        }
+        if (q < end && *q == '.' && Digit(q + 1, end))
+        {
+            q++;
+            while (Digit(q, end))
+            {
+                q++;
+            }
+        }
+        if (q < end && (*q == 'e' || *q == 'E'))
+        {
+            const char* e = q + 1;
+            if (e < end && (*e == '+' || *e == '-'))
+            {
+                e++;
+            }
+            if (Digit(e, end))
+            {
+                while (Digit(e, end))
+                {
+                    e++;
+                }
+                q = e;
+            }
+        }
+        return static_cast<size_t>(q - p);
+    }
+
+    StatsRegistry::StatsRegistry(uint32_t _refreshMs) : refreshMs(_refreshMs)
+    {
+    }
+
+    StatsRegistry& StatsRegistry::Default()
+    {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    size_t StatsRegistry::Add(Generator_t generator, float deadband)
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        Entry_t entry{};
+        entry.generator = generator;
+        entry.deadband = deadband < 0 ? 0 : deadband;
+        entries.push_back(std::move(entry));
+        return entries.size() - 1;
+    }
+
+    esp_err_t StatsRegistry::SetDeadband(size_t id, float deadband)
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        if (id >= entries.size())
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        entries[id].deadband = deadband < 0 ? 0 : deadband;
+        return ESP_OK;
+    }
+
+    void StatsRegistry::SetRefreshInterval(uint32_t _refreshMs)
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        refreshMs = _refreshMs;
+    }
+
+    void StatsRegistry::Sync(const std::vector<Generator_t>& generators)
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        for (size_t i = synced; i < generators.size(); i++)
+        {
+            Entry_t entry{};
+            entry.generator = generators[i];
+            entries.push_back(std::move(entry));
+        }
+        synced = generators.size();
+    }
+
+    void StatsRegistry::Invalidate()
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        for (Entry_t& entry : entries)
+        {
+            entry.published = false;
+        }
+    }
+
+    size_t StatsRegistry::Scan(const std::string& payload, uint32_t& hash, float* numbers, size_t max)
+    {
+        size_t count = 0;
+        bool quoted = false;
+        const char* p = payload.c_str();
+        const char* end = p + payload.size();
+        while (p < end)
+        {
+            const char c = *p;
+            if (quoted)
+            {
+                hash = Fnv(hash, c);
+                if (c == '\\' && p + 1 < end)
+                {
+                    hash = Fnv(hash, *++p);
+                }
+                else if (c == '"')
+                {
+                    quoted = false;
+                }
+                p++;
+                continue;
+            }
+            const size_t length = NumberLength(p, end);
+            if (length != 0)
+            {
+                const char* next = p + length;
+                float value = 0;
+                // out of the float range ( 1e999 ) : text, like the numbers past max
+                const bool number = text::Parse(std::string_view(p, length), value) == ESP_OK && std::isfinite(value);
+                if (number && count < max)
+                {
+                    numbers[count] = value;
+                    hash = Fnv(hash, '#');
+                }
+                else
+                {
+                    for (const char* q = p; q < next; q++)
+                    {
+                        hash = Fnv(hash, *q);
+                    }
+                }
+                count += number ? 1 : 0;
+                p = next;
+                continue;
+            }
+            quoted = (c == '"');
+            hash = Fnv(hash, c);
+            p++;
+        }
+        return count;
+    }
+
+    esp_err_t StatsRegistry::Sweep(const Publish_t& publish, uint32_t nowMs)
+    {
+        if (publish == nullptr)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        std::lock_guard<std::mutex> pass(passLock);
+        esp_err_t ret = ESP_OK;
+        uint32_t sent = 0, suppressed = 0, deadband = 0, refreshed = 0, errors = 0;
+        float numbers[MAX_NUMBERS];
+        for (Entry_t& entry : entries)
+        {
+            const StringPair_t message = entry.generator();
+            uint32_t hash = 2166136261u;
+            for (const char c : message.first)
+            {
+                hash = Fnv(hash, c);
+            }
+            hash = Fnv(hash, '\0');
+            const size_t found = Scan(message.second, hash, numbers, MAX_NUMBERS);
+            const uint8_t count = static_cast<uint8_t>(found < MAX_NUMBERS ? found : MAX_NUMBERS);
+            bool changed = !entry.published || hash != entry.hash || count != entry.count;
+            bool moved = false;
+            for (uint8_t i = 0; !changed && i < count; i++)
+            {
+                const float delta = std::fabs(numbers[i] - entry.numbers[i]);
+                if (delta != 0)
+                {
+                    moved = true;
+                    changed = (entry.deadband == 0) || (delta >= entry.deadband);
+                }
+            }
+            const bool refresh = !changed && refreshMs != 0 && (nowMs - entry.sentMs >= refreshMs);
+            if (!changed && !refresh)
+            {
+                suppressed++;
+                deadband += moved ? 1 : 0;
+                continue;
+            }
+            const esp_err_t err = publish(message);
+            if (err != ESP_OK)
+            {
+                ret |= err;
+                errors++;
+                continue;
+            }
+            sent++;
+            refreshed += refresh ? 1 : 0;
+            entry.published = true;
+            entry.hash = hash;
+            entry.sentMs = nowMs;
+            entry.count = count;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                entry.numbers[i] = numbers[i];
+            }
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        stats.sweeps++;
+        stats.sent += sent;
+        stats.suppressed += suppressed;
+        stats.deadband += deadband;
+        stats.refreshed += refreshed;
+        stats.errors += errors;
+        return ret;
+    }
+
+    uint32_t StatsRegistry::NowMs() const
+    {
+#ifdef ESP_PLATFORM
+        return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    size_t StatsRegistry::GetCount()
+    {
+        std::lock_guard<std::mutex> pass(passLock);
+        return entries.size();
+    }
+
+    StatsRegistry::Stats_t StatsRegistry::GetStats()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return stats;
+    }
+
+    void StatsRegistry::ResetStats()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stats = Stats_t{};
+    }
+};
@@ -0,0 +1,31 @@
+#include "stats_status.h"
+
+namespace homeassistant {
+    constexpr char StatsRegistryStatus::TAG[];
+
+    StatsRegistryStatus::StatsRegistryStatus(StatsRegistry& _registry) : Config(TAG), registry(_registry)
+    {
+    }
+
+    esp_err_t StatsRegistryStatus::GetConfigurationStatus(json& config_out) const
+    {
+        try
+        {
+            const StatsRegistry::Stats_t stats = registry.GetStats();
+            config_out[TAG] = {
+                {"sent", stats.sent},
+                {"suppressed", stats.suppressed},
+                {"deadband", stats.deadband},
+                {"refreshed", stats.refreshed},
+                {"errors", stats.errors},
+                {"sweeps", stats.sweeps},
+                {"entries", registry.GetCount()},
+            };
+            return ESP_OK;
+        }
+        catch (const std::exception& e)
+        {
+            return ESP_FAIL;
+        }
+    }
+};
@@ -0,0 +1,33 @@
+/**
+ * @file host_stubs.cpp
+ * @brief the few ESP-IDF functions the host tests link against, weak : a test can define its own
+ */
+#include "esp_system.h"
+#include "nvs_flash.h"
+#include "nvs_handle.hpp"
+#include "queue.h"
+#include "task.h"
+
+#define HOST_WEAK __attribute__((weak))
+
+HOST_WEAK esp_err_t esp_register_shutdown_handler(shutdown_handler_t) { return ESP_OK; }
+HOST_WEAK void esp_restart(void) {}
+HOST_WEAK esp_err_t nvs_flash_init(void) { return ESP_OK; }
+HOST_WEAK QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t) { return nullptr; }
+HOST_WEAK BaseType_t xQueueSend(QueueHandle_t, const void *, TickType_t) { return pdFALSE; }
+HOST_WEAK BaseType_t xQueueReceive(QueueHandle_t, void *, TickType_t) { return pdFALSE; }
+HOST_WEAK void vQueueDelete(QueueHandle_t) {}
+HOST_WEAK TaskHandle_t xTaskGetCurrentTaskHandle(void) { return nullptr; }
+HOST_WEAK UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+namespace nvs
+{
+    HOST_WEAK std::unique_ptr<NVSHandle> open_nvs_handle(const char *, nvs_open_mode_t, esp_err_t *err)
+    {
+        if (err != nullptr)
+        {
+            *err = ESP_ERR_NVS_NOT_INITIALIZED;
+        }
+        return nullptr;
+    }
+} // namespace nvs
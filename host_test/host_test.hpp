@@ -0,0 +1,72 @@
+#ifndef HOST_TEST_HPP_
+#define HOST_TEST_HPP_
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+/**
+ * @brief minimal checks for the host tests : a failed CHECK prints its line and the test goes on,
+ * HOST_TEST_END prints the summary ( last line, shown by run.sh ) and gives the exit code
+ *
+ *  int main()
+ *  {
+ *      CHECK(cache.commit() == ESP_OK);
+ *      CHECK_EQ(commits, 2);
+ *      HOST_TEST_END();
+ *  }
+ */
+namespace host_test
+{
+    inline int &Failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+    inline int &Checks()
+    {
+        static int checks = 0;
+        return checks;
+    }
+    inline bool Check(bool ok, const char *expr, const char *file, int line)
+    {
+        Checks()++;
+        if (!ok)
+        {
+            Failures()++;
+            printf("%s:%d: CHECK failed : %s\n", file, line, expr);
+        }
+        return ok;
+    }
+    template <typename A, typename B>
+    inline bool CheckEq(const A &a, const B &b, const char *expr, const char *file, int line)
+    {
+        const bool ok = (a == b);
+        if (!Check(ok, expr, file, line))
+        {
+            printf("    got %lld, expected %lld\n", static_cast<long long>(a), static_cast<long long>(b));
+        }
+        return ok;
+    }
+
+    // wall time of \c fn, in ns per \c iterations
+    template <typename F>
+    inline double NsPer(size_t iterations, F &&fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iterations ? iterations : 1);
+    }
+} // namespace host_test
+
+#define CHECK(expr) host_test::Check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) host_test::CheckEq((a), (b), #a " == " #b, __FILE__, __LINE__)
+#define HOST_TEST_END()                                                                        \
+    do                                                                                         \
+    {                                                                                          \
+        printf("%d checks, %d failures\n", host_test::Checks(), host_test::Failures());         \
+        return host_test::Failures() ? 1 : 0;                                                  \
+    } while (0)
+
+#endif // HOST_TEST_HPP_
@@ -0,0 +1,95 @@
+#!/bin/sh
+# host tests of the components, built against the ESP-IDF stubs of host_test/stubs
+#
+#  ./host_test/run.sh            build and run every test
+#  ./host_test/run.sh nvs        only the tests whose name contains "nvs"
+#  CXX=clang++ SANITIZE=thread ./host_test/run.sh
+#
+# nlohmann/json.hpp is taken from the system, or from JSON_INCLUDE when set
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${OUT:-${TMPDIR:-/tmp}/host_test}
+CXX=${CXX:-g++}
+SANITIZE=${SANITIZE:-address,undefined}
+CXXFLAGS="-std=gnu++17 -O1 -g -Wall -Wno-unused-function -fsanitize=$SANITIZE ${JSON_INCLUDE:+-idirafter $JSON_INCLUDE}"
+FILTER=$1
+mkdir -p "$OUT"
+passed=0
+failed=0
+
+# host_case <name> "<include dirs>" "<sources>" ["<extra flags>"] : paths relative to the repository root
+host_case()
+{
+    case "$1" in *"$FILTER"*) ;; *) return ;; esac
+    includes="-I$ROOT/host_test -I$ROOT/host_test/stubs"
+    for dir in $2; do includes="$includes -I$ROOT/$dir"; done
+    sources="$ROOT/host_test/host_stubs.cpp"
+    for src in $3; do sources="$sources $ROOT/$src"; done
+    printf '%-28s' "$1"
+    if ! $CXX $CXXFLAGS $4 $includes $sources -o "$OUT/$1" -lpthread 2> "$OUT/$1.log"; then
+        echo "BUILD FAILED ( $OUT/$1.log )"
+        failed=$((failed + 1))
+        return
+    fi
+    if ASAN_OPTIONS=detect_leaks=0 "$OUT/$1" > "$OUT/$1.log" 2>&1; then
+        echo "ok   $(grep -E "checks, [0-9]+ failures" "$OUT/$1.log" | tail -n 1)"
+        passed=$((passed + 1))
+    else
+        echo "FAILED ( $OUT/$1.log )"
+        failed=$((failed + 1))
+    fi
+}
+
+host_case config "system_tools/include idf_event_cxx/include debug_tools/include fmt/include" \
+    "system_tools/host_test/test_config.cpp system_tools/src/config.cpp system_tools/src/task_pool.cpp system_tools/src/_pthread.cpp idf_event_cxx/src/timer_wheel.cpp fmt/src/format.cc"
+host_case deferred_log "debug_tools/include" \
+    "debug_tools/host_test/test_deferred_log.cpp debug_tools/src/deferred_log.cpp" "-DCONFIG_DLOG_AUTO_DRAIN=0"
+host_case nvs_cache "nvs_tools/include debug_tools/include" \
+    "nvs_tools/host_test/test_nvs_cache.cpp nvs_tools/src/nvs_cache.cpp debug_tools/src/deferred_log.cpp"
+host_case spsc_ring "system_tools/include" \
+    "system_tools/host_test/test_spsc_ring.cpp"
+host_case event_lockfree "idf_event_cxx/include" \
+    "idf_event_cxx/host_test/test_event_lockfree.cpp idf_event_cxx/src/esp_event_lockfree.cpp" \
+    "-DCONFIG_ESP_EVENT_POST_FROM_ISR=1"
+host_case payload_pool "idf_event_cxx/include" \
+    "idf_event_cxx/host_test/test_payload_pool.cpp idf_event_cxx/src/esp_event_payload_pool.cpp idf_event_cxx/src/esp_event_cxx.cpp idf_event_cxx/src/esp_event_lockfree.cpp idf_event_cxx/src/esp_exception.cpp"
+host_case timer_wheel "idf_event_cxx/include" \
+    "idf_event_cxx/host_test/test_timer_wheel.cpp idf_event_cxx/src/timer_wheel.cpp"
+host_case bounded_queue "system_tools/include idf_event_cxx/include" \
+    "system_tools/host_test/test_bounded_queue.cpp system_tools/src/_pthread.cpp"
+host_case task_pool "system_tools/include idf_event_cxx/include" \
+    "system_tools/host_test/test_task_pool.cpp system_tools/src/task_pool.cpp system_tools/src/_pthread.cpp idf_event_cxx/src/timer_wheel.cpp"
+host_case publish_coalescer "system_tools/include" \
+    "system_tools/host_test/test_publish_coalescer.cpp system_tools/src/publish_coalescer.cpp"
+host_case filter_set "esp_mqtt_cxx/host_test/stubs esp_mqtt_cxx/include esp_mqtt_cxx/priv_include" \
+    "esp_mqtt_cxx/host_test/test_filter_set.cpp esp_mqtt_cxx/src/esp_mqtt_cxx.cpp esp_mqtt_cxx/src/esp_exception.cpp"
+host_case base64 "system_tools/include" \
+    "system_tools/host_test/test_base64.cpp system_tools/src/base64.cpp"
+host_case text_tools "system_tools/include" \
+    "system_tools/host_test/test_text_tools.cpp"
+host_case text_tools_strtod "system_tools/include" \
+    "system_tools/host_test/test_text_tools.cpp" "-DTEXT_TOOLS_STRTOD"
+host_case fast_format "system_tools/include fmt/include" \
+    "system_tools/host_test/test_fast_format.cpp system_tools/src/utilities.cpp system_tools/src/base64.cpp fmt/src/format.cc"
+host_case task_profiler "system_tools/include idf_event_cxx/include" \
+    "system_tools/host_test/test_task_profiler.cpp system_tools/src/task_profiler.cpp idf_event_cxx/src/timer_wheel.cpp"
+host_case input_scanner "input_scanner/include idf_event_cxx/include system_tools/include" \
+    "input_scanner/host_test/test_input_scanner.cpp input_scanner/src/input_scanner.cpp input_scanner/src/input_backend.cpp system_tools/src/_pthread.cpp"
+host_case button2_replay "Button2/host_test/stubs Button2/include" \
+    "Button2/host_test/test_button2_replay.cpp Button2/src/Button2.cpp Button2/src/Button2Engine.cpp"
+host_case blind_motion "blind/include system_tools/include" \
+    "blind/host_test/test_blind_motion.cpp blind/blind_motion.cpp"
+host_case blind_group "blind/include idf_event_cxx/include system_tools/include" \
+    "blind/host_test/test_blind_group.cpp blind/blind_group.cpp blind/blind_motion.cpp idf_event_cxx/src/timer_wheel.cpp"
+host_case signal_filters "ambient_sensor/include" \
+    "ambient_sensor/host_test/test_signal_filters.cpp"
+host_case adc_scanner "ambient_sensor/include idf_event_cxx/include" \
+    "ambient_sensor/host_test/test_adc_scanner.cpp ambient_sensor/src/adc_scanner.cpp ambient_sensor/src/adc_backend.cpp idf_event_cxx/src/timer_wheel.cpp"
+host_case stats_registry "hass/include system_tools/include" \
+    "hass/host_test/test_stats_registry.cpp hass/src/stats_registry.cpp"
+host_case discovery_builder "hass/include idf_event_cxx/include system_tools/include nvs_tools/include fmt/include" \
+    "hass/host_test/test_discovery_builder.cpp hass/src/homeassistant.cpp hass/src/discovery_builder.cpp hass/src/discovery_publisher.cpp hass/src/stats_registry.cpp system_tools/src/publish_coalescer.cpp system_tools/src/task_pool.cpp system_tools/src/_pthread.cpp idf_event_cxx/src/timer_wheel.cpp idf_event_cxx/src/esp_event_cxx.cpp idf_event_cxx/src/esp_event_api.cpp idf_event_cxx/src/esp_exception.cpp idf_event_cxx/src/esp_event_payload_pool.cpp idf_event_cxx/src/esp_event_lockfree.cpp fmt/src/format.cc"
+host_case discovery_publisher "hass/include idf_event_cxx/include system_tools/include nvs_tools/include fmt/include" \
+    "hass/host_test/test_discovery_publisher.cpp hass/src/homeassistant.cpp hass/src/discovery_builder.cpp hass/src/discovery_publisher.cpp hass/src/stats_registry.cpp system_tools/src/publish_coalescer.cpp system_tools/src/task_pool.cpp system_tools/src/_pthread.cpp idf_event_cxx/src/timer_wheel.cpp idf_event_cxx/src/esp_event_cxx.cpp idf_event_cxx/src/esp_event_api.cpp idf_event_cxx/src/esp_exception.cpp idf_event_cxx/src/esp_event_payload_pool.cpp idf_event_cxx/src/esp_event_lockfree.cpp fmt/src/format.cc"
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,19 @@
+#pragma once
+// host stub : the FreeRTOS types and tick macros the components use outside ESP_PLATFORM
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void *TaskHandle_t;
+
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (ms)
+#define pdTRUE 1
+#define pdFALSE 0
+typedef void *QueueHandle_t;
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include "esp_err.h"
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+typedef void (*shutdown_handler_t)(void);
+#ifdef __cplusplus
+extern "C" {
+#endif
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
+void esp_restart(void);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#include "nvs.h"
+#include <cstdint>
+#include <memory>
+
+// the interface of nvs_handle.hpp, implemented by the tests ( in-memory flash )
+namespace nvs
+{
+    enum class ItemType : uint8_t
+    {
+        U8 = 0x01,
+        I8 = 0x11,
+        U16 = 0x02,
+        I16 = 0x12,
+        U32 = 0x04,
+        I32 = 0x14,
+        U64 = 0x08,
+        I64 = 0x18,
+        SZ = 0x21,
+        BLOB = 0x41,
+        ANY = 0xff
+    };
+
+    class NVSHandle
+    {
+    public:
+        virtual ~NVSHandle() {}
+        virtual esp_err_t set_string(const char *key, const char *value) = 0;
+        virtual esp_err_t get_string(const char *key, char *out_str, size_t len) = 0;
+        virtual esp_err_t get_item_size(ItemType datatype, const char *key, size_t &size) = 0;
+        virtual esp_err_t set_typed_item(ItemType datatype, const char *key, const void *data, size_t dataSize) = 0;
+        virtual esp_err_t get_typed_item(ItemType datatype, const char *key, void *data, size_t dataSize) = 0;
+        virtual esp_err_t erase_item(const char *key) = 0;
+        virtual esp_err_t erase_all() = 0;
+        virtual esp_err_t commit() = 0;
+    };
+
+    std::unique_ptr<NVSHandle> open_nvs_handle(const char *ns_name, nvs_open_mode_t open_mode, esp_err_t *err = nullptr);
+} // namespace nvs
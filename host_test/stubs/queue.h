@@ -0,0 +1,9 @@
+#pragma once
+// host stub : declarations only, host_stubs.cpp gives queues that never hold anything
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+void vQueueDelete(QueueHandle_t queue);
+#define xQueueSendToBack xQueueSend
@@ -0,0 +1 @@
+// host builds : every CONFIG_ value falls back to the default of its header
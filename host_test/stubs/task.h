@@ -0,0 +1,6 @@
+#pragma once
+// host stub : declarations only, host_stubs.cpp answers as a single task with an unknown stack
+#include "FreeRTOS.h"
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
@@ -0,0 +1,367 @@
+// host test of ESPEventAPILockFree : dispatch, blocking posts waiting on the dispatcher, isr posts.
+// the benchmark reports post to handler latency percentiles and events/s for 1, 2 and 4 producers,
+// against a mutex / condition variable queue with a strcmp keyed handler map ( the FreeRTOS queue path )
+#include "esp_event_lockfree.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace idf::event;
+using namespace std::chrono;
+
+static const char INPUT_BASE[] = "INPUT";
+static const char BULK_BASE[] = "BULK";
+
+static std::atomic<int> calls{0};
+static std::atomic<long> sum{0};
+static std::atomic<bool> gateOpen{true};
+static std::atomic<bool> gateHeld{false};
+
+static void Count(void *, esp_event_base_t, int32_t, void *data)
+{
+    calls++;
+    if (data != nullptr)
+    {
+        sum += *static_cast<int *>(data);
+    }
+}
+
+// holds the dispatcher until gateOpen, so the lanes fill up
+static void Gate(void *, esp_event_base_t, int32_t, void *)
+{
+    gateHeld = true;
+    while (!gateOpen.load())
+    {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+}
+
+static bool WaitDispatched(ESPEventAPILockFree &api, uint32_t count)
+{
+    const auto deadline = steady_clock::now() + seconds(10);
+    while (api.get_stats().dispatched < count)
+    {
+        if (steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    return true;
+}
+
+static double ThreadCpuMs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// park the dispatcher in Gate() and fill the low lane
+static void Jam(ESPEventAPILockFree &api, size_t cells)
+{
+    gateOpen = false;
+    gateHeld = false;
+    CHECK(api.post(BULK_BASE, 0, nullptr, 0, 0) == ESP_OK);
+    while (!gateHeld.load())
+    {
+        std::this_thread::yield();
+    }
+    for (size_t i = 0; i < cells; i++)
+    {
+        CHECK(api.post(BULK_BASE, 1, nullptr, 0, 0) == ESP_OK);
+    }
+    CHECK(api.post(BULK_BASE, 1, nullptr, 0, 0) == ESP_ERR_TIMEOUT);
+}
+
+static void TestDispatch()
+{
+    ESPEventAPILockFree api(8);
+    calls = 0;
+    sum = 0;
+    esp_event_handler_instance_t instance = nullptr;
+    CHECK(api.handler_register(INPUT_BASE, 1, Count, nullptr, &instance) == ESP_OK);
+    int value = 5;
+    CHECK(api.post(INPUT_BASE, 1, &value, sizeof(value), 0) == ESP_OK);
+    CHECK(api.post(INPUT_BASE, 2, &value, sizeof(value), 0) == ESP_OK);
+    CHECK(WaitDispatched(api, 2));
+    CHECK_EQ(calls.load(), 1);
+    CHECK_EQ(sum.load(), 5);
+    CHECK_EQ(api.get_stats().unhandled, 1u);
+    CHECK(api.handler_unregister(INPUT_BASE, 1, instance) == ESP_OK);
+    CHECK(api.handler_unregister(INPUT_BASE, 1, instance) == ESP_ERR_NOT_FOUND);
+}
+
+static void TestBlockingPost()
+{
+    ESPEventAPILockFree api(4);
+    CHECK(api.handler_register(BULK_BASE, 0, Gate, nullptr, nullptr) == ESP_OK);
+    Jam(api, 4);
+
+    // a timed post gives up after its ticks, and is counted as dropped
+    const auto start = steady_clock::now();
+    CHECK(api.post(BULK_BASE, 1, nullptr, 0, pdMS_TO_TICKS(30)) == ESP_ERR_TIMEOUT);
+    CHECK(steady_clock::now() - start >= milliseconds(30));
+    CHECK_EQ(api.get_stats().dropped, 2u);
+
+    // a portMAX_DELAY post sleeps until the dispatcher frees a cell
+    std::atomic<bool> done{false};
+    esp_err_t ret = ESP_FAIL;
+    double cpuMs = 0;
+    std::thread poster([&] {
+        const double before = ThreadCpuMs();
+        ret = api.post(BULK_BASE, 1, nullptr, 0, portMAX_DELAY);
+        cpuMs = ThreadCpuMs() - before;
+        done = true;
+    });
+    std::this_thread::sleep_for(milliseconds(200));
+    CHECK(!done.load());
+    gateOpen = true;
+    poster.join();
+    CHECK(ret == ESP_OK);
+    printf("blocked post : %.2f ms cpu over 200 ms\n", cpuMs);
+    CHECK(cpuMs < 20.0);
+    CHECK(WaitDispatched(api, 6));
+}
+
+static void TestProducers()
+{
+    ESPEventAPILockFree api(16);
+    calls = 0;
+    sum = 0;
+    CHECK(api.handler_register(INPUT_BASE, 1, Count, nullptr, nullptr) == ESP_OK);
+    constexpr int PRODUCERS = 4;
+    constexpr int EVENTS = 20000;
+    std::atomic<int> refused{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([&api, &refused] {
+            for (int i = 0; i < EVENTS; i++)
+            {
+                int one = 1;
+                if (api.post(INPUT_BASE, 1, &one, sizeof(one), portMAX_DELAY) != ESP_OK)
+                {
+                    refused++;
+                }
+            }
+        });
+    }
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+    CHECK_EQ(refused.load(), 0);
+    CHECK(WaitDispatched(api, PRODUCERS * EVENTS));
+    CHECK_EQ(calls.load(), PRODUCERS * EVENTS);
+    CHECK_EQ(sum.load(), PRODUCERS * EVENTS);
+    CHECK_EQ(api.get_stats().dropped, 0u);
+}
+
+static void TestPostFromIsr()
+{
+    ESPEventAPILockFree api(4);
+    calls = 0;
+    sum = 0;
+    CHECK(api.handler_register(INPUT_BASE, 1, Count, nullptr, nullptr) == ESP_OK);
+    CHECK(api.handler_register(BULK_BASE, 0, Gate, nullptr, nullptr) == ESP_OK);
+    int value = 7;
+    CHECK(api.post_from_isr(INPUT_BASE, 1, &value, sizeof(value)) == ESP_OK);
+    CHECK(WaitDispatched(api, 1));
+    CHECK_EQ(sum.load(), 7);
+    uint8_t big[CONFIG_EVENT_LOCKFREE_INLINE_DATA_SIZE + 1] = {};
+    CHECK(api.post_from_isr(INPUT_BASE, 1, big, sizeof(big)) == ESP_ERR_INVALID_ARG);
+    CHECK(api.post_from_isr(nullptr, 1, nullptr, 0) == ESP_ERR_INVALID_ARG);
+
+    // a full lane drops at once
+    Jam(api, 4);
+    const auto start = steady_clock::now();
+    CHECK(api.post_from_isr(BULK_BASE, 1, nullptr, 0) == ESP_ERR_TIMEOUT);
+    CHECK(steady_clock::now() - start < milliseconds(5));
+    gateOpen = true;
+    CHECK(WaitDispatched(api, 6));
+}
+
+static uint64_t NowNs()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// the old path : every post copied through one locked bounded queue, handlers found by strcmp on the base
+class OldLoop
+{
+public:
+    explicit OldLoop(size_t _capacity) : capacity(_capacity), dispatcher([this] { Run(); }) {}
+    ~OldLoop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running = false;
+        }
+        notEmpty.notify_all();
+        dispatcher.join();
+    }
+    void Register(esp_event_base_t base, int32_t id, esp_event_handler_t handler)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        handlers[base][id] = handler;
+    }
+    void Post(esp_event_base_t base, int32_t id, const void *data, size_t size)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        notFull.wait(guard, [this] { return queue.size() < capacity; });
+        queue.push_back(Event_t{base, id, std::vector<uint8_t>(static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size)});
+        notEmpty.notify_one();
+    }
+
+private:
+    struct Event_t
+    {
+        esp_event_base_t base;
+        int32_t id;
+        std::vector<uint8_t> data;
+    };
+    struct Less_t
+    {
+        bool operator()(const char *a, const char *b) const { return strcmp(a, b) < 0; }
+    };
+    void Run()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true)
+        {
+            notEmpty.wait(guard, [this] { return !queue.empty() || !running; });
+            if (queue.empty())
+            {
+                return;
+            }
+            Event_t event = std::move(queue.front());
+            queue.pop_front();
+            notFull.notify_one();
+            auto base = handlers.find(event.base);
+            esp_event_handler_t handler = nullptr;
+            if (base != handlers.end())
+            {
+                auto found = base->second.find(event.id);
+                handler = (found != base->second.end()) ? found->second : nullptr;
+            }
+            guard.unlock();
+            if (handler != nullptr)
+            {
+                handler(nullptr, event.base, event.id, event.data.data());
+            }
+            guard.lock();
+        }
+    }
+    const size_t capacity;
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<Event_t> queue;
+    std::map<const char *, std::map<int32_t, esp_event_handler_t>, Less_t> handlers;
+    bool running = true;
+    std::thread dispatcher;
+};
+
+// the dispatcher is one thread : the latencies are written without a lock
+static std::vector<uint64_t> latencies;
+static std::atomic<uint32_t> received{0};
+
+static void Stamp(void *, esp_event_base_t, int32_t, void *data)
+{
+    uint64_t posted;
+    memcpy(&posted, data, sizeof(posted));
+    latencies.push_back(NowNs() - posted);
+    received.fetch_add(1, std::memory_order_release);
+}
+
+static uint64_t Percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+// events/s, latencies sorted
+static double Run(int producers, uint32_t total, const std::function<void(uint64_t)> &post)
+{
+    latencies.clear();
+    latencies.reserve(total);
+    received = 0;
+    const uint32_t perProducer = total / producers;
+    std::vector<std::thread> threads;
+    const auto start = steady_clock::now();
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&] {
+            for (uint32_t i = 0; i < perProducer; i++)
+            {
+                const uint64_t now = NowNs();
+                post(now);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    while (received.load(std::memory_order_acquire) < perProducer * producers)
+    {
+        std::this_thread::yield();
+    }
+    const double seconds = duration<double>(steady_clock::now() - start).count();
+    std::sort(latencies.begin(), latencies.end());
+    return perProducer * producers / seconds;
+}
+
+static void Bench()
+{
+    constexpr uint32_t TOTAL = 100000;
+    for (int producers : {1, 2, 4})
+    {
+        double lockfreeRate = 0;
+        uint64_t l50 = 0, l99 = 0, l999 = 0;
+        {
+            ESPEventAPILockFree api(64);
+            CHECK(api.handler_register(INPUT_BASE, 1, Stamp, nullptr, nullptr) == ESP_OK);
+            lockfreeRate = Run(producers, TOTAL, [&](uint64_t stamp) {
+                api.post(INPUT_BASE, 1, &stamp, sizeof(stamp), portMAX_DELAY);
+            });
+            CHECK_EQ(latencies.size(), static_cast<size_t>(TOTAL / producers * producers));
+            CHECK_EQ(api.get_stats().dropped, 0u);
+            l50 = Percentile(latencies, 0.5);
+            l99 = Percentile(latencies, 0.99);
+            l999 = Percentile(latencies, 0.999);
+        }
+        double oldRate = 0;
+        {
+            OldLoop old(64);
+            old.Register(INPUT_BASE, 1, Stamp);
+            oldRate = Run(producers, TOTAL, [&](uint64_t stamp) { old.Post(INPUT_BASE, 1, &stamp, sizeof(stamp)); });
+            CHECK_EQ(latencies.size(), static_cast<size_t>(TOTAL / producers * producers));
+        }
+        printf("%d producer(s) : lock-free %.2f M events/s ( p50 %llu ns, p99 %llu ns, p99.9 %llu ns ), "
+               "mutex queue %.2f M events/s ( p50 %llu ns, p99 %llu ns, p99.9 %llu ns )\n",
+               producers, lockfreeRate / 1e6, (unsigned long long)l50, (unsigned long long)l99, (unsigned long long)l999,
+               oldRate / 1e6, (unsigned long long)Percentile(latencies, 0.5), (unsigned long long)Percentile(latencies, 0.99),
+               (unsigned long long)Percentile(latencies, 0.999));
+    }
+}
+
+int main()
+{
+    TestDispatch();
+    TestBlockingPost();
+    TestProducers();
+    TestPostFromIsr();
+    Bench();
+    HOST_TEST_END();
+}
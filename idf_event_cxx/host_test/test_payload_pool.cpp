@@ -0,0 +1,174 @@
+// host test of EventPayloadPool and of ESPEventLoop pooling : 1M events without an allocation on the lock-free
+// loop, ids and registrations left alone on a backend without done hook ( esp_event )
+#include "esp_event_cxx.hpp"
+#include "esp_event_lockfree.hpp"
+#include "host_test.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace idf::event;
+
+static std::atomic<long> allocations{0};
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+static const char MQTT_BASE[] = "MQTT";
+
+struct Reading_t
+{
+    int32_t channel;
+    int32_t value;
+    uint32_t stamp[4];
+};
+
+static void TestPool()
+{
+    EventPayloadPool pool(2);
+    const uint8_t bytes[200] = {1, 2, 3};
+    PayloadRef small = pool.acquire(bytes, 10);
+    CHECK(small);
+    CHECK_EQ(small.size(), 10u);
+    CHECK(pool.owns(small.data()));
+    CHECK(!pool.owns(bytes));
+    CHECK(!pool.acquire(bytes, 200)); // bigger than the largest class
+    PayloadRef second = pool.acquire(bytes, 16);
+    CHECK(second);
+    CHECK(!pool.acquire(bytes, 1)); // 16 bytes class exhausted
+    PayloadRef kept = pool.retain(small.data());
+    CHECK(kept.data() == small.data());
+    small.reset();
+    CHECK(!pool.acquire(bytes, 1)); // still held by kept
+    kept.reset();
+    CHECK(pool.acquire(bytes, 1));
+    const EventPayloadPool::Stats_t stats = pool.get_stats();
+    CHECK_EQ(stats.oversize, 1u);
+    CHECK_EQ(stats.exhausted, 2u);
+    CHECK_EQ(stats.highWater[0], 2);
+    second.reset();
+    CHECK_EQ(pool.get_stats().inUse[0], 0);
+}
+
+static void TestLockFreeLoop()
+{
+    auto api = std::make_shared<ESPEventAPILockFree>(64);
+    ESPEventLoop loop(api);
+    std::atomic<long> handled{0};
+    std::atomic<long> sum{0};
+    std::atomic<int> wrongId{0};
+    auto reg = loop.register_event(ESPEvent(MQTT_BASE, ESPEventID(3)), [&](const ESPEvent &event, void *data) {
+        if (event.id.get_id() != 3)
+        {
+            wrongId++;
+        }
+        sum += static_cast<Reading_t *>(data)->value;
+        handled++;
+    });
+    const Reading_t reading{1, 2, {}};
+    for (int i = 0; i < 1000; i++) // warm up : lazy allocations of the runtime
+    {
+        CHECK(loop.post_event_data(ESPEvent(MQTT_BASE, ESPEventID(3)), reading) == ESP_OK);
+    }
+    while (handled.load() < 1000)
+    {
+        std::this_thread::yield();
+    }
+
+    constexpr long EVENTS = 1000000;
+    long refused = 0;
+    const long before = allocations.load();
+    const double ns = host_test::NsPer(EVENTS, [&] {
+        for (long i = 0; i < EVENTS; i++)
+        {
+            if (loop.post_event_data(ESPEvent(MQTT_BASE, ESPEventID(3)), reading) != ESP_OK)
+            {
+                refused++;
+            }
+        }
+        while (handled.load() < 1000 + EVENTS)
+        {
+            std::this_thread::yield();
+        }
+    });
+    const long allocated = allocations.load() - before;
+    printf("1M pooled events : %.0f ns per event, %ld allocations\n", ns, allocated);
+    CHECK_EQ(allocated, 0);
+    CHECK_EQ(refused, 0);
+    CHECK_EQ(wrongId.load(), 0);
+    CHECK_EQ(sum.load(), 2 * (1000 + EVENTS));
+    const EventPayloadPool::Stats_t stats = loop.get_payload_stats();
+    // a burst bigger than the class falls back to a plain ( inline ) copy, still without allocation
+    printf("pooled %u, fallback %u\n", stats.acquired, stats.exhausted);
+    CHECK_EQ(stats.acquired + stats.exhausted, static_cast<uint32_t>(1000 + EVENTS));
+    CHECK(stats.acquired > 0);
+    CHECK_EQ(stats.released, stats.acquired);
+    CHECK_EQ(stats.inUse[1], 0);
+    CHECK_EQ(api->get_stats().heapPayload, 0u);
+}
+
+// esp_event stand-in : no done hook, records what the loop registers and posts
+class PlainAPI : public ESPEventAPI
+{
+public:
+    esp_err_t handler_register(esp_event_base_t, int32_t id, esp_event_handler_t, void *, esp_event_handler_instance_t *instance) override
+    {
+        ids.push_back(id);
+        if (instance != nullptr)
+        {
+            *instance = reinterpret_cast<esp_event_handler_instance_t>(ids.size());
+        }
+        return ESP_OK;
+    }
+    esp_err_t handler_unregister(esp_event_base_t, int32_t, esp_event_handler_instance_t) override { return ESP_OK; }
+    esp_err_t post(esp_event_base_t, int32_t id, void *, size_t size, TickType_t) override
+    {
+        posted.push_back(id);
+        sizes.push_back(size);
+        return ESP_OK;
+    }
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+    esp_err_t post_from_isr(esp_event_base_t, int32_t, void *, size_t) override { return ESP_OK; }
+#endif
+    std::vector<int32_t> ids;
+    std::vector<int32_t> posted;
+    std::vector<size_t> sizes;
+};
+
+static void TestPlainLoop()
+{
+    auto api = std::make_shared<PlainAPI>();
+    ESPEventLoop loop(api);
+    auto reg = loop.register_event(ESPEvent(MQTT_BASE, ESPEventID(3)), [](const ESPEvent &, void *) {});
+    CHECK_EQ(api->ids.size(), 1u); // no pooled id, no ANY_BASE release handler
+    CHECK_EQ(api->ids[0], 3);
+    const Reading_t reading{1, 2, {}};
+    CHECK(loop.post_event_data(ESPEvent(MQTT_BASE, ESPEventID(3)), reading) == ESP_OK);
+    CHECK_EQ(api->posted.size(), 1u);
+    CHECK_EQ(api->posted[0], 3);
+    CHECK_EQ(api->sizes[0], sizeof(Reading_t));
+    CHECK_EQ(loop.get_payload_stats().acquired, 0u);
+}
+
+int main()
+{
+    TestPool();
+    TestLockFreeLoop();
+    TestPlainLoop();
+    HOST_TEST_END();
+}
@@ -0,0 +1,337 @@
+/**
+ * @file test_timer_wheel.cpp
+ * @brief TimerWheel on a manual clock, Advance() driven here : expiry on each side of the level boundaries,
+ * a timer past the last level parked and re-placed, periodic catch up after a long step, Stop / Start from
+ * inside a callback. the benchmark starts, moves and cancels 10k timers against a std::multimap queue, then
+ * lets 10k timers expire on the threaded driver and reports the lateness ( ./host_test/run.sh timer_wheel )
+ */
+#include "timer_wheel.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+static constexpr uint64_t TICK_US = 1000;
+static constexpr uint64_t LEVEL0 = TimerWheel::SLOTS;
+static constexpr uint64_t LEVEL1 = LEVEL0 * TimerWheel::SLOTS;
+static constexpr uint64_t LEVEL2 = LEVEL1 * TimerWheel::SLOTS;
+static constexpr uint64_t RANGE = LEVEL2 * TimerWheel::SLOTS; // 64^4 ticks
+
+class ManualClock
+{
+public:
+    uint64_t us = 0;
+    TimerWheel::Clock_t Clock()
+    {
+        return [this]() { return us; };
+    }
+};
+
+struct Probe_t
+{
+    TimerWheel::Node node{};
+    int fired = 0;
+    uint64_t firedAt = 0;
+};
+
+static void Arm(TimerWheel &wheel, ManualClock &clock, Probe_t &probe, uint64_t delayTicks, uint64_t periodTicks = 0)
+{
+    probe.node.callback = [&probe, &clock]() {
+        probe.fired++;
+        probe.firedAt = clock.us;
+    };
+    CHECK_EQ(wheel.Start(probe.node, delayTicks * TICK_US, periodTicks * TICK_US), ESP_OK);
+}
+
+// fires at its due tick, not one tick before, from an aligned and an unaligned start
+static void TestBoundaries()
+{
+    for (uint64_t offset : {uint64_t{0}, uint64_t{37}, LEVEL0 - 1, LEVEL1 - 5})
+    {
+        const uint64_t delays[] = {1, LEVEL0 - 1, LEVEL0, LEVEL0 + 1, LEVEL1 - 1, LEVEL1, LEVEL1 + 1,
+                                   LEVEL2 - 1, LEVEL2, LEVEL2 + 1, RANGE - 1};
+        for (uint64_t delay : delays)
+        {
+            ManualClock clock;
+            clock.us = offset * TICK_US;
+            TimerWheel wheel(1, clock.Clock());
+            Probe_t probe;
+            Arm(wheel, clock, probe, delay);
+            const uint64_t due = (offset + delay) * TICK_US;
+            if (due > TICK_US + clock.us)
+            {
+                clock.us = due - TICK_US;
+                wheel.Advance(clock.us);
+            }
+            const bool early = probe.fired != 0;
+            clock.us = due;
+            wheel.Advance(clock.us);
+            const bool onTime = !early && probe.fired == 1 && !wheel.IsActive(probe.node);
+            CHECK(onTime);
+            if (!onTime)
+            {
+                printf("    offset %llu delay %llu : fired %d%s\n", (unsigned long long)offset, (unsigned long long)delay,
+                       probe.fired, early ? " early" : "");
+            }
+        }
+    }
+
+    // many timers on the same and on neighbour slots, one long step
+    ManualClock clock;
+    TimerWheel wheel(1, clock.Clock());
+    std::vector<Probe_t> probes(300);
+    for (size_t i = 0; i < probes.size(); i++)
+    {
+        Arm(wheel, clock, probes[i], 1 + (i * 997) % (LEVEL1 + 10));
+    }
+    clock.us = (LEVEL1 + 10) * TICK_US;
+    wheel.Advance(clock.us);
+    int fired = 0;
+    for (const Probe_t &probe : probes)
+    {
+        fired += probe.fired;
+    }
+    CHECK_EQ(fired, 300);
+    CHECK_EQ(wheel.GetStats().active, 0u);
+    CHECK_EQ(wheel.GetStats().batches, 1u);
+}
+
+// past the last level : parked at the end of the range, re-placed until due
+static void TestFarFuture()
+{
+    ManualClock clock;
+    TimerWheel wheel(1, clock.Clock());
+    Probe_t far, near;
+    const uint64_t delay = RANGE * 2 + 12345;
+    Arm(wheel, clock, far, delay);
+    Arm(wheel, clock, near, RANGE - 1);
+    // one hour steps, landing on the due tick of each
+    const uint64_t step = 3600ull * 1000 * 1000;
+    const auto AdvanceTo = [&](uint64_t us) {
+        while (clock.us < us)
+        {
+            clock.us = std::min(clock.us + step, us);
+            wheel.Advance(clock.us);
+        }
+    };
+    AdvanceTo((RANGE - 2) * TICK_US);
+    CHECK_EQ(near.fired, 0);
+    AdvanceTo((RANGE - 1) * TICK_US);
+    CHECK_EQ(near.fired, 1);
+    AdvanceTo((delay - 2) * TICK_US);
+    CHECK_EQ(near.fired, 1);
+    CHECK_EQ(far.fired, 0);
+    clock.us = (delay - 1) * TICK_US;
+    wheel.Advance(clock.us);
+    CHECK_EQ(far.fired, 0);
+    clock.us += TICK_US;
+    wheel.Advance(clock.us);
+    CHECK_EQ(far.fired, 1);
+    CHECK(wheel.GetStats().cascaded > 4u);
+}
+
+static void TestPeriodic()
+{
+    ManualClock clock;
+    TimerWheel wheel(1, clock.Clock());
+    Probe_t probe;
+    Arm(wheel, clock, probe, 10, 10);
+    for (int i = 0; i < 100; i++)
+    {
+        clock.us += TICK_US;
+        wheel.Advance(clock.us);
+    }
+    CHECK_EQ(probe.fired, 10);
+    CHECK_EQ(probe.firedAt, 100 * TICK_US);
+
+    // a 35 tick step : one call, the missed periods are skipped, not replayed
+    clock.us += 35 * TICK_US;
+    wheel.Advance(clock.us);
+    CHECK_EQ(probe.fired, 11);
+    clock.us += TICK_US;
+    wheel.Advance(clock.us);
+    CHECK_EQ(probe.fired, 12); // due again the next tick
+    clock.us += 9 * TICK_US;
+    wheel.Advance(clock.us);
+    CHECK_EQ(probe.fired, 12);
+    clock.us += TICK_US;
+    wheel.Advance(clock.us);
+    CHECK_EQ(probe.fired, 13); // back on a 10 tick period
+    CHECK_EQ(wheel.GetStats().maxLateUs, 25 * TICK_US); // due at 110, run at 135
+    CHECK_EQ(wheel.Stop(probe.node), ESP_OK);
+    CHECK_EQ(wheel.GetStats().active, 0u);
+}
+
+static void TestCallbackControl()
+{
+    ManualClock clock;
+    TimerWheel wheel(1, clock.Clock());
+
+    // a periodic timer stopping itself
+    Probe_t self;
+    int selfCalls = 0;
+    self.node.callback = [&]() {
+        if (++selfCalls == 3)
+        {
+            wheel.Stop(self.node);
+        }
+    };
+    wheel.Start(self.node, 5 * TICK_US, 5 * TICK_US);
+
+    // a one shot restarting itself twice
+    Probe_t again;
+    int againCalls = 0;
+    again.node.callback = [&]() {
+        if (++againCalls < 3)
+        {
+            wheel.Start(again.node, 7 * TICK_US, 0);
+        }
+    };
+    wheel.Start(again.node, 7 * TICK_US, 0);
+
+    // due in the same batch, each stops the other : the one called first wins, the other never runs
+    Probe_t first, second;
+    first.node.callback = [&]() {
+        first.fired++;
+        wheel.Stop(second.node);
+    };
+    second.node.callback = [&]() {
+        second.fired++;
+        wheel.Stop(first.node);
+    };
+    wheel.Start(first.node, 50 * TICK_US, 0);
+    wheel.Start(second.node, 50 * TICK_US, 0);
+
+    for (int i = 0; i < 100; i++)
+    {
+        clock.us += TICK_US;
+        wheel.Advance(clock.us);
+    }
+    CHECK_EQ(selfCalls, 3);
+    CHECK(!wheel.IsActive(self.node));
+    CHECK_EQ(againCalls, 3);
+    CHECK(!wheel.IsActive(again.node));
+    CHECK_EQ(first.fired + second.fired, 1);
+    CHECK_EQ(wheel.GetStats().active, 0u);
+
+    // a node without callback is refused
+    TimerWheel::Node empty;
+    CHECK_EQ(wheel.Start(empty, TICK_US, 0), ESP_ERR_INVALID_STATE);
+}
+
+static uint64_t Percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+static void Bench()
+{
+    constexpr int TIMERS = 10000;
+    std::mt19937 rng(9);
+    std::vector<uint64_t> delays(TIMERS);
+    for (uint64_t &delay : delays)
+    {
+        delay = (1 + rng() % 200) * TICK_US; // 1 to 200 ms
+    }
+
+    // start, move, cancel : the wheel against a sorted queue
+    ManualClock clock;
+    TimerWheel wheel(1, clock.Clock());
+    std::vector<TimerWheel::Node> nodes(TIMERS);
+    for (TimerWheel::Node &node : nodes)
+    {
+        node.callback = []() {};
+    }
+    const double startNs = host_test::NsPer(TIMERS, [&]() {
+        for (int i = 0; i < TIMERS; i++)
+        {
+            wheel.Start(nodes[i], delays[i], 0);
+        }
+    });
+    const double moveNs = host_test::NsPer(TIMERS, [&]() {
+        for (int i = 0; i < TIMERS; i++)
+        {
+            wheel.Start(nodes[i], delays[TIMERS - 1 - i], 0);
+        }
+    });
+    const double stopNs = host_test::NsPer(TIMERS, [&]() {
+        for (int i = 0; i < TIMERS; i++)
+        {
+            wheel.Stop(nodes[i]);
+        }
+    });
+    CHECK_EQ(wheel.GetStats().active, 0u);
+
+    std::mutex queueLock;
+    std::multimap<uint64_t, TimerWheel::Node *> queue;
+    std::vector<std::multimap<uint64_t, TimerWheel::Node *>::iterator> handles(TIMERS);
+    const double queueStartNs = host_test::NsPer(TIMERS, [&]() {
+        for (int i = 0; i < TIMERS; i++)
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            handles[i] = queue.emplace(clock.us + delays[i], &nodes[i]);
+        }
+    });
+    const double queueStopNs = host_test::NsPer(TIMERS, [&]() {
+        for (int i = 0; i < TIMERS; i++)
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            queue.erase(handles[i]);
+        }
+    });
+
+    // expiry on the real driver : lateness of each callback against its due time
+    TimerWheel real(1);
+    std::vector<uint64_t> late;
+    late.reserve(TIMERS);
+    std::atomic<int> pending{TIMERS};
+    std::atomic<int> early{0};
+    std::vector<TimerWheel::Node> realNodes(TIMERS);
+    std::vector<uint64_t> dueUs(TIMERS);
+    for (int i = 0; i < TIMERS; i++)
+    {
+        realNodes[i].callback = [&, i]() {
+            const uint64_t now = real.NowUs();
+            if (now < dueUs[i])
+            {
+                early++;
+            }
+            late.push_back(now > dueUs[i] ? now - dueUs[i] : 0); // callbacks run on the driver, one at a time
+            pending--;
+        };
+    }
+    for (int i = 0; i < TIMERS; i++)
+    {
+        dueUs[i] = real.NowUs() + delays[i];
+        real.Start(realNodes[i], delays[i], 0);
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (pending.load() > 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK_EQ(pending.load(), 0);
+    CHECK_EQ(early.load(), 0);
+    std::sort(late.begin(), late.end());
+    const TimerWheel::Stats_t stats = real.GetStats();
+    printf("%d timers : start %.0f ns, move %.0f ns, stop %.0f ns | multimap insert %.0f ns, erase %.0f ns | "
+           "driver : %u batches, late p50 %llu us, p99 %llu us, max %llu us\n",
+           TIMERS, startNs, moveNs, stopNs, queueStartNs, queueStopNs, stats.batches,
+           (unsigned long long)Percentile(late, 0.5), (unsigned long long)Percentile(late, 0.99),
+           (unsigned long long)(late.empty() ? 0 : late.back()));
+}
+
+int main()
+{
+    TestBoundaries();
+    TestFarFuture();
+    TestPeriodic();
+    TestCallbackControl();
+    Bench();
+    HOST_TEST_END();
+}
@@ -8,9 +8,16 @@
 #else
 #include "FreeRTOS.h" // for tickType_t
 #include "esp_err.h"
-typedef void (*esp_event_handler_t)(esp_event_base_t event_base, int32_t event_id, void *event_data, size_t event_data_len);
-typedef void *esp_event_handler_instance_t; /**< context identifying an instance of a registered event handler */
 typedef const char *esp_event_base_t;
+// same signature as esp_event.h so ESPEventReg::event_handler_hook registers on host too
+typedef void (*esp_event_handler_t)(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+typedef void *esp_event_handler_instance_t; /**< context identifying an instance of a registered event handler */
+#ifndef ESP_EVENT_ANY_BASE
+#define ESP_EVENT_ANY_BASE NULL /**< register handler for any event base */
+#endif
+#ifndef ESP_EVENT_ANY_ID
+#define ESP_EVENT_ANY_ID -1 /**< register handler for any event id */
+#endif
 #endif
 #include "string.h"
 #include <cstring>
@@ -49,6 +56,29 @@ namespace idf
                                                void *,
                                                size_t,
                                                TickType_t) = 0;
+
+                        /**
+                         * @brief optional : \c hook is called for every event once all of its handlers ran
+                         *
+                         * @return esp_err_t ESP_ERR_NOT_SUPPORTED if the backend can't tell ( esp_event )
+                         */
+                        virtual esp_err_t done_hook_register(esp_event_handler_t hook,
+                                                             void *arg,
+                                                             esp_event_handler_instance_t *instance)
+                        {
+                                return ESP_ERR_NOT_SUPPORTED;
+                        }
+                        virtual esp_err_t done_hook_unregister(esp_event_handler_instance_t instance)
+                        {
+                                return ESP_ERR_NOT_SUPPORTED;
+                        }
+                        /**
+                         * @brief true if done_hook_register() works : ESPEventLoop only pools payloads on such a backend
+                         */
+                        virtual bool has_done_hook() const
+                        {
+                                return false;
+                        }
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
                         virtual esp_err_t post_from_isr(esp_event_base_t event_base,
                                                         int32_t event_id,
@@ -40,6 +40,7 @@ typedef const char *esp_event_base_t; /**< unique pointer to a subsystem that ex
 #include <vector>
 
 #include "esp_event_api.hpp"
+#include "esp_event_payload_pool.hpp"
 #include "esp_exception.hpp"
 
 namespace idf
@@ -51,6 +52,13 @@ namespace idf
 
               const std::chrono::milliseconds MIN_TIMEOUT(500);
 
+              /**
+               * @brief set in the id of events whose data is a payload pool slot ( see ESPEventLoop::post_event_data() ),
+               * ESPEventReg registers both ids and hands the slot payload to the callback. only on an api with a done
+               * hook ( ESPEventAPILockFree ) : on esp_event ids and handlers are left as they are.
+               */
+              constexpr int32_t POOLED_EVENT_ID = 0x40000000;
+
               class EventException : public ESPException
               {
               public:
@@ -198,6 +206,11 @@ namespace idf
                       */
                      virtual void dispatch_event_handling(ESPEvent event, void *event_data);
                      virtual void dispatch_event_handling_no_arg();
+                     /**
+                      * register / unregister event_handler_hook for the plain and the pooled event id
+                      */
+                     void register_hook();
+                     void unregister_hook();
                      /**
                       * Save the event here to be able to un-register from the event loop on destruction.
                       */
@@ -213,6 +226,7 @@ namespace idf
                       * Event handler instance from the esp event C API.
                       */
                      esp_event_handler_instance_t instance;
+                     esp_event_handler_instance_t instance_pooled{nullptr};
               };
 
               /**
@@ -340,7 +354,8 @@ namespace idf
                       *
                       * @param event the event to post
                       * @param event_data The event data. A copy will be made internally and a pointer to the copy will be passed to the
-                      *        event handler.
+                      *        event handler. On the lock-free loop the copy goes to the payload pool when a slot of its size class is free,
+                      *        to the heap otherwise.
                       * @param wait_time the maximum wait time the function tries to post the event
                       */
                      template <typename T>
@@ -366,13 +381,41 @@ namespace idf
                                           const std::chrono::milliseconds &wait_time = MIN_TIMEOUT);
                      esp_err_t IRAM_ATTR post_event_from_isr(const ESPEvent &event) noexcept;
 
+                     /**
+                      * @brief keep the payload of a pooled event after the handler returned
+                      *
+                      * @param event_data the data pointer given to the handler
+                      * @return PayloadRef empty if the data doesn't come from this loop's pool
+                      */
+                     PayloadRef retain_payload(void *event_data);
+                     EventPayloadPool::Stats_t get_payload_stats() const;
+
               private:
+                     /**
+                      * @brief posts the pool slot pointer, the reference travels with the event
+                      */
+                     esp_err_t post_payload(const ESPEvent &event, PayloadRef &&payload, const std::chrono::milliseconds &wait_time);
+                     /**
+                      * @brief drops the reference of pooled events once their handlers ran
+                      */
+                     static void payload_done_hook(void *handler_arg,
+                                                   esp_event_base_t event_base,
+                                                   int32_t event_id,
+                                                   void *event_data);
+
+                     /**
+                      * payloads posted with post_event_data() are copied here instead of the heap,
+                      * nullptr if CONFIG_EVENT_PAYLOAD_POOL_SLOTS is 0 or if the api has no done hook ( esp_event )
+                      */
+                     std::unique_ptr<EventPayloadPool> payload_pool;
+                     esp_event_handler_instance_t payload_hook_instance{nullptr};
+
                      /**
                       * This API handle allows different sets of APIs to be applied, e.g. default event loop API and
                       * custom event loop API.
                       */
                      std::shared_ptr<ESPEventAPI> api;
-                     std::mutex lock;
+                     std::mutex lock; // registration only
               };
 
               /**
@@ -512,7 +555,15 @@ namespace idf
                                                       const T &event_data,
                                                       const std::chrono::milliseconds &wait_time)
               {
-                     std::lock_guard autolock(lock);
+                     if (payload_pool)
+                     {
+                            PayloadRef payload = payload_pool->acquire(&event_data, sizeof(event_data));
+                            if (payload)
+                            {
+                                   return post_payload(event, std::move(payload), wait_time);
+                            }
+                     }
+                     // no loop lock here : every ESPEventAPI post() is thread safe and producers must not serialize
                      esp_err_t result = api->post(event.base,
                                                   event.id.get_id(),
                                                   (void *)&event_data,
@@ -0,0 +1,204 @@
+#ifndef ESP_EVENT_LOCKFREE_HPP_
+#define ESP_EVENT_LOCKFREE_HPP_
+
+#include "esp_event_api.hpp"
+#include "mpmc_queue.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef CONFIG_EVENT_LOCKFREE_QUEUE_SIZE
+#define CONFIG_EVENT_LOCKFREE_QUEUE_SIZE 32
+#endif
+#ifndef CONFIG_EVENT_LOCKFREE_INLINE_DATA_SIZE
+#define CONFIG_EVENT_LOCKFREE_INLINE_DATA_SIZE 32
+#endif
+#ifndef CONFIG_EVENT_LOCKFREE_HIGH_PRIORITY_BASES
+#define CONFIG_EVENT_LOCKFREE_HIGH_PRIORITY_BASES 8
+#endif
+#ifndef CONFIG_EVENT_LOCKFREE_TASK_STACK
+#define CONFIG_EVENT_LOCKFREE_TASK_STACK 4096
+#endif
+#ifndef CONFIG_EVENT_LOCKFREE_TASK_PRIORITY
+#define CONFIG_EVENT_LOCKFREE_TASK_PRIORITY 10
+#endif
+
+namespace idf
+{
+
+        namespace event
+        {
+
+                /**
+                 * @brief event loop backend that builds on ESP32 and on Linux.
+                 *
+                 * posting copies the event into one of two lock-free MPMC lanes ( high / low ), a single dispatcher
+                 * thread drains the high lane first so input events ( blind, pir, buttons .. ) are not stuck behind
+                 * bulk traffic ( mqtt data ). handlers are looked up in a hash table keyed by (base pointer, id) :
+                 * bases are compared by address like esp_event does, not by strcmp.
+                 *
+                 * the handler table is copy-on-write : (un)registering is slow, dispatching never takes a lock.
+                 * after handler_unregister() returns ( from another thread ) the handler is not called anymore.
+                 */
+                class ESPEventAPILockFree : public ESPEventAPI
+                {
+                public:
+                        enum class Priority_t : uint8_t
+                        {
+                                PRIO_LOW = 0,
+                                PRIO_HIGH = 1
+                        };
+                        struct Stats_t
+                        {
+                                uint32_t posted[2];   // per lane, index = Priority_t
+                                uint32_t dropped;     // post() timed out on a full lane
+                                uint32_t dispatched;  // events popped by the dispatcher
+                                uint32_t unhandled;   // events without any handler
+                                uint32_t heapPayload; // payloads too big for the inline slot
+                        };
+
+                        /**
+                         * @param queueSize cells per lane ( rounded up to a power of two )
+                         */
+                        explicit ESPEventAPILockFree(size_t queueSize = CONFIG_EVENT_LOCKFREE_QUEUE_SIZE);
+                        virtual ~ESPEventAPILockFree();
+                        ESPEventAPILockFree(const ESPEventAPILockFree &o) = delete;
+                        ESPEventAPILockFree &operator=(const ESPEventAPILockFree &) = delete;
+
+                        esp_err_t handler_register(esp_event_base_t event_base,
+                                                   int32_t event_id,
+                                                   esp_event_handler_t event_handler,
+                                                   void *event_handler_arg,
+                                                   esp_event_handler_instance_t *instance) override;
+
+                        esp_err_t handler_unregister(esp_event_base_t event_base,
+                                                     int32_t event_id,
+                                                     esp_event_handler_instance_t instance) override;
+
+                        /**
+                         * @brief post to the lane of the event base ( see set_base_priority() )
+                         */
+                        esp_err_t post(esp_event_base_t event_base,
+                                       int32_t event_id,
+                                       void *event_data,
+                                       size_t event_data_size,
+                                       TickType_t ticks_to_wait) override;
+                        esp_err_t post(esp_event_base_t event_base,
+                                       int32_t event_id,
+                                       void *event_data,
+                                       size_t event_data_size,
+                                       TickType_t ticks_to_wait,
+                                       Priority_t priority);
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+                        /**
+                         * @brief never waits, the event is dropped if the lane is full
+                         */
+                        esp_err_t post_from_isr(esp_event_base_t event_base,
+                                                int32_t event_id,
+                                                void *event_data,
+                                                size_t event_data_size) override;
+#endif // CONFIG_ESP_EVENT_POST_FROM_ISR
+
+                        /**
+                         * @brief \c hook runs on the dispatcher after the last handler of every event
+                         */
+                        esp_err_t done_hook_register(esp_event_handler_t hook,
+                                                     void *arg,
+                                                     esp_event_handler_instance_t *instance) override;
+                        esp_err_t done_hook_unregister(esp_event_handler_instance_t instance) override;
+                        bool has_done_hook() const override { return true; }
+
+                        /**
+                         * @brief route every event of \c event_base to a lane
+                         *
+                         * @return esp_err_t ESP_ERR_NO_MEM if CONFIG_EVENT_LOCKFREE_HIGH_PRIORITY_BASES bases are already high
+                         */
+                        esp_err_t set_base_priority(esp_event_base_t event_base, Priority_t priority);
+                        Priority_t get_base_priority(esp_event_base_t event_base) const;
+
+                        Stats_t get_stats() const;
+                        void reset_stats();
+
+                private:
+                        struct Key_t
+                        {
+                                esp_event_base_t base;
+                                int32_t id;
+                                bool operator==(const Key_t &other) const { return base == other.base && id == other.id; }
+                        };
+                        struct KeyHash_t
+                        {
+                                size_t operator()(const Key_t &key) const
+                                {
+                                        const uintptr_t h = reinterpret_cast<uintptr_t>(key.base);
+                                        return static_cast<size_t>((h >> 2) * 31u) ^ static_cast<size_t>(static_cast<uint32_t>(key.id) * 2654435761u);
+                                }
+                        };
+                        struct Handler_t
+                        {
+                                esp_event_handler_t handler;
+                                void *arg;
+                                esp_event_handler_instance_t instance;
+                        };
+                        using Table_t = std::unordered_map<Key_t, std::vector<Handler_t>, KeyHash_t>;
+
+                        struct Event_t
+                        {
+                                esp_event_base_t base = nullptr;
+                                int32_t id = 0;
+                                uint32_t size = 0;
+                                uint8_t *heapData = nullptr; // owned, payloads bigger than inlineData
+                                alignas(8) uint8_t inlineData[CONFIG_EVENT_LOCKFREE_INLINE_DATA_SIZE];
+                                void *data() { return (size == 0) ? nullptr : (heapData ? heapData : inlineData); }
+                        };
+
+                        void DispatcherLoop();
+                        void Dispatch(Event_t &event);
+                        void CallHandlers(const Table_t &table, const Key_t &key, Event_t &event, bool &handled);
+                        bool TryPostOnce(Event_t &event, Priority_t priority, bool fromIsr = false);
+                        esp_err_t WaitAndPost(Event_t &event, Priority_t priority, TickType_t ticks_to_wait);
+                        void WakeDispatcher(bool fromIsr);
+                        void SleepDispatcher();
+                        void WakePosters();
+                        std::shared_ptr<const Table_t> LoadTable() const;
+                        void WaitDispatchDone();
+
+                        MPMCQueue<Event_t> lanes[2];
+                        std::array<std::atomic<esp_event_base_t>, CONFIG_EVENT_LOCKFREE_HIGH_PRIORITY_BASES> highBases{};
+
+                        std::shared_ptr<const Table_t> table;
+                        std::mutex tableLock; // writers only
+                        uintptr_t nextInstance = 0;
+
+                        std::thread dispatcher;
+                        std::atomic<bool> running{true};
+                        std::atomic<bool> sleeping{false};
+                        std::atomic<uint32_t> dispatchEpoch{0}; // odd while an event is being dispatched
+#ifdef ESP_PLATFORM
+                        std::atomic<TaskHandle_t> dispatcherTask{nullptr}; // sleeps on its task notification, isr safe
+#else
+                        std::mutex wakeLock;
+                        std::condition_variable wakeCond;
+#endif
+                        std::atomic<uint32_t> waitingPosters{0}; // blocking post() calls waiting for a free cell
+                        std::mutex spaceLock;
+                        std::condition_variable spaceCond;
+
+                        std::atomic<uint32_t> posted[2]{};
+                        std::atomic<uint32_t> dropped{0};
+                        std::atomic<uint32_t> dispatched{0};
+                        std::atomic<uint32_t> unhandled{0};
+                        std::atomic<uint32_t> heapPayload{0};
+                };
+
+        } // event
+
+} // idf
+
+#endif // ESP_EVENT_LOCKFREE_HPP_
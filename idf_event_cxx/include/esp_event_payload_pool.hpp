@@ -0,0 +1,147 @@
+#ifndef ESP_EVENT_PAYLOAD_POOL_HPP_
+#define ESP_EVENT_PAYLOAD_POOL_HPP_
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "mpmc_queue.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#ifndef CONFIG_EVENT_PAYLOAD_POOL_SLOTS
+#define CONFIG_EVENT_PAYLOAD_POOL_SLOTS 8 // only used by a loop on ESPEventAPILockFree
+#endif
+
+namespace idf
+{
+
+        namespace event
+        {
+
+                class EventPayloadPool;
+
+                /**
+                 * @brief refcounted handle on a pool slot, the slot goes back to the pool with the last handle
+                 */
+                class PayloadRef
+                {
+                public:
+                        PayloadRef() = default;
+                        PayloadRef(const PayloadRef &other);
+                        PayloadRef(PayloadRef &&other) noexcept : slot(other.slot) { other.slot = nullptr; }
+                        PayloadRef &operator=(PayloadRef other) noexcept
+                        {
+                                std::swap(slot, other.slot);
+                                return *this;
+                        }
+                        ~PayloadRef() { reset(); }
+
+                        void *data() const;
+                        size_t size() const;
+                        void reset();
+                        explicit operator bool() const { return slot != nullptr; }
+
+                private:
+                        friend class EventPayloadPool;
+                        struct Slot_t;
+                        explicit PayloadRef(Slot_t *_slot) : slot(_slot) {}
+                        Slot_t *slot = nullptr;
+                };
+
+                /**
+                 * @brief slab of size-classed event payload buffers, allocated once.
+                 * acquire / release never allocate nor lock : every size class keeps its free slots in a lock-free queue.
+                 * a payload too big for the largest class, or a class with no free slot, is reported to the caller
+                 * ( and counted ) so it can fall back to a plain copy.
+                 */
+                class EventPayloadPool
+                {
+                public:
+                        static constexpr size_t CLASS_COUNT = 4;
+                        static constexpr std::array<size_t, CLASS_COUNT> CLASS_SIZE = {16, 32, 64, 128};
+                        static constexpr size_t HEADER_SIZE = 16; // slot header, keeps the payload 8 bytes aligned
+
+                        struct Stats_t
+                        {
+                                uint32_t acquired;               // slots handed out
+                                uint32_t released;               // slots back in the pool
+                                uint32_t exhausted;              // acquire with no free slot in the class
+                                uint32_t oversize;               // payloads bigger than the largest class
+                                uint16_t inUse[CLASS_COUNT];     // slots currently out, per class
+                                uint16_t highWater[CLASS_COUNT]; // max slots out at once, per class
+                        };
+
+                        explicit EventPayloadPool(size_t slotsPerClass = CONFIG_EVENT_PAYLOAD_POOL_SLOTS);
+                        EventPayloadPool(const EventPayloadPool &) = delete;
+                        EventPayloadPool &operator=(const EventPayloadPool &) = delete;
+
+                        /**
+                         * @brief copy a payload into a free slot
+                         *
+                         * @return PayloadRef empty if the payload is too big or its class is exhausted
+                         */
+                        PayloadRef acquire(const void *data, size_t size);
+
+                        /**
+                         * @brief true if \c data is the payload of one of this pool's slots
+                         */
+                        bool owns(const void *data) const;
+
+                        /**
+                         * @brief new reference on the slot holding \c data ( empty if not owned )
+                         */
+                        PayloadRef retain(void *data);
+
+                        /**
+                         * @brief the slot pointer travels through the event loop as event data, this is its size
+                         */
+                        static constexpr size_t WIRE_SIZE = sizeof(void *);
+                        // write / read the slot carried by a posted event ( the wire takes its own reference )
+                        static void to_wire(PayloadRef &&ref, void *wire);
+                        static PayloadRef from_wire(void *wire);
+                        static void *wire_data(void *wire);
+
+                        Stats_t get_stats() const;
+                        void reset_stats();
+
+                private:
+                        friend class PayloadRef;
+                        using Slot_t = PayloadRef::Slot_t;
+
+                        void release(Slot_t *slot);
+
+                        struct Class_t
+                        {
+                                explicit Class_t(size_t slots) : freeSlots(slots) {}
+                                std::unique_ptr<uint8_t[]> slab{};
+                                size_t stride = 0;
+                                size_t slots = 0;
+                                MPMCQueue<Slot_t *> freeSlots;
+                                std::atomic<uint16_t> inUse{0};
+                                std::atomic<uint16_t> highWater{0};
+                        };
+                        std::array<std::unique_ptr<Class_t>, CLASS_COUNT> classes{};
+
+                        std::atomic<uint32_t> acquired{0};
+                        std::atomic<uint32_t> released{0};
+                        std::atomic<uint32_t> exhausted{0};
+                        std::atomic<uint32_t> oversize{0};
+                };
+
+                struct PayloadRef::Slot_t
+                {
+                        EventPayloadPool *pool;
+                        std::atomic<uint16_t> refs;
+                        uint16_t size;
+                        uint8_t sizeClass;
+                        uint8_t *data() { return reinterpret_cast<uint8_t *>(this) + EventPayloadPool::HEADER_SIZE; }
+                };
+
+        } // event
+
+} // idf
+
+#endif // ESP_EVENT_PAYLOAD_POOL_HPP_
@@ -0,0 +1,243 @@
+#ifndef MPMC_QUEUE_HPP_
+#define MPMC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace idf
+{
+
+        /**
+         * @brief bounded multi producer / multi consumer lock-free queue (Vyukov).
+         * every cell carries a sequence number : a producer claims a cell with one CAS on the enqueue
+         * position and publishes it by bumping the sequence, consumers do the same on the dequeue position.
+         * storage is allocated once in the constructor, push / pop never allocate and never block.
+         *
+         * @tparam T element type, must be default constructible and movable
+         * @tparam PADDED one cache line per cell : producers / consumers of neighbour cells stop sharing lines,
+         * worth it on multi core hosts, only wastes RAM on the ESP32 ( no data cache on internal SRAM )
+         */
+        template <typename T, bool PADDED = false>
+        class MPMCQueue
+        {
+        public:
+                static constexpr size_t CACHE_LINE = 64;
+
+                /**
+                 * @param capacity number of cells, rounded up to a power of two (min 2)
+                 */
+                explicit MPMCQueue(size_t capacity)
+                {
+                        size_t size = 2;
+                        while (size < capacity)
+                        {
+                                size <<= 1;
+                        }
+                        mask = size - 1;
+                        cells = std::unique_ptr<Cell[]>(new Cell[size]);
+                        for (size_t i = 0; i < size; i++)
+                        {
+                                cells[i].sequence.store(i, std::memory_order_relaxed);
+                        }
+                        enqueuePos.store(0, std::memory_order_relaxed);
+                        dequeuePos.store(0, std::memory_order_relaxed);
+                }
+                MPMCQueue(const MPMCQueue &) = delete;
+                MPMCQueue &operator=(const MPMCQueue &) = delete;
+
+                /**
+                 * @brief store an element, never blocks
+                 *
+                 * @return true stored , false queue full
+                 */
+                template <typename U>
+                bool try_push(U &&item)
+                {
+                        Cell *cell = nullptr;
+                        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+                        for (;;)
+                        {
+                                cell = &cells[pos & mask];
+                                const size_t seq = cell->sequence.load(std::memory_order_acquire);
+                                const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                                if (diff == 0)
+                                {
+                                        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                                        {
+                                                break;
+                                        }
+                                }
+                                else if (diff < 0)
+                                {
+                                        return false; // full
+                                }
+                                else
+                                {
+                                        pos = enqueuePos.load(std::memory_order_relaxed);
+                                }
+                        }
+                        cell->data = std::forward<U>(item);
+                        cell->sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                }
+
+                /**
+                 * @brief take the oldest element, never blocks
+                 *
+                 * @return true item filled , false queue empty
+                 */
+                bool try_pop(T &item)
+                {
+                        Cell *cell = nullptr;
+                        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+                        for (;;)
+                        {
+                                cell = &cells[pos & mask];
+                                const size_t seq = cell->sequence.load(std::memory_order_acquire);
+                                const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                                if (diff == 0)
+                                {
+                                        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                                        {
+                                                break;
+                                        }
+                                }
+                                else if (diff < 0)
+                                {
+                                        return false; // empty
+                                }
+                                else
+                                {
+                                        pos = dequeuePos.load(std::memory_order_relaxed);
+                                }
+                        }
+                        item = std::move(cell->data);
+                        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+                        return true;
+                }
+
+                /**
+                 * @brief store up to \c count elements moved from \c first, in order, with a single claim
+                 * on the enqueue position, never blocks
+                 *
+                 * @return size_t elements stored, less than \c count when the queue filled up
+                 */
+                template <typename It>
+                size_t try_push_n(It first, size_t count)
+                {
+                        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+                        size_t n = 0;
+                        while (count > 0)
+                        {
+                                // free cells following pos
+                                for (n = 0; n < count && n <= mask; n++)
+                                {
+                                        const size_t seq = cells[(pos + n) & mask].sequence.load(std::memory_order_acquire);
+                                        if (seq != pos + n)
+                                        {
+                                                break;
+                                        }
+                                }
+                                if (n == 0)
+                                {
+                                        const size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+                                        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0)
+                                        {
+                                                return 0; // full
+                                        }
+                                        pos = enqueuePos.load(std::memory_order_relaxed);
+                                        continue;
+                                }
+                                if (enqueuePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+                                {
+                                        break;
+                                }
+                        }
+                        for (size_t i = 0; i < n; i++, ++first)
+                        {
+                                Cell &cell = cells[(pos + i) & mask];
+                                cell.data = std::move(*first);
+                                cell.sequence.store(pos + i + 1, std::memory_order_release);
+                        }
+                        return n;
+                }
+
+                /**
+                 * @brief take up to \c max of the oldest elements into \c out, in order, with a single claim
+                 * on the dequeue position, never blocks
+                 *
+                 * @return size_t elements taken, 0 queue empty
+                 */
+                template <typename It>
+                size_t try_pop_n(It out, size_t max)
+                {
+                        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+                        size_t n = 0;
+                        while (max > 0)
+                        {
+                                // published cells following pos
+                                for (n = 0; n < max && n <= mask; n++)
+                                {
+                                        const size_t seq = cells[(pos + n) & mask].sequence.load(std::memory_order_acquire);
+                                        if (seq != pos + n + 1)
+                                        {
+                                                break;
+                                        }
+                                }
+                                if (n == 0)
+                                {
+                                        const size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+                                        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0)
+                                        {
+                                                return 0; // empty
+                                        }
+                                        pos = dequeuePos.load(std::memory_order_relaxed);
+                                        continue;
+                                }
+                                if (dequeuePos.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+                                {
+                                        break;
+                                }
+                        }
+                        for (size_t i = 0; i < n; i++, ++out)
+                        {
+                                Cell &cell = cells[(pos + i) & mask];
+                                *out = std::move(cell.data);
+                                cell.sequence.store(pos + i + mask + 1, std::memory_order_release);
+                        }
+                        return n;
+                }
+
+                /**
+                 * @brief approximate number of stored elements (exact when producers and consumers are idle)
+                 */
+                size_t size_approx() const
+                {
+                        const size_t enq = enqueuePos.load(std::memory_order_acquire);
+                        const size_t deq = dequeuePos.load(std::memory_order_acquire);
+                        return (enq > deq) ? (enq - deq) : 0;
+                }
+                bool empty() const { return size_approx() == 0; }
+                size_t capacity() const { return mask + 1; }
+
+        private:
+                struct alignas(PADDED ? CACHE_LINE : alignof(std::atomic<size_t>)) alignas(T) Cell
+                {
+                        std::atomic<size_t> sequence{0};
+                        T data{};
+                };
+
+                // producers and consumers hammer different positions : keep them on separate cache lines
+                alignas(CACHE_LINE) std::atomic<size_t> enqueuePos{0};
+                alignas(CACHE_LINE) std::atomic<size_t> dequeuePos{0};
+                alignas(CACHE_LINE) std::unique_ptr<Cell[]> cells{};
+                size_t mask = 0;
+        };
+
+} // idf
+
+#endif // MPMC_QUEUE_HPP_
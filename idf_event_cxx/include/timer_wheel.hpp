@@ -0,0 +1,198 @@
+#ifndef TIMER_WHEEL_HPP_
+#define TIMER_WHEEL_HPP_
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#else
+#include <condition_variable>
+#endif
+
+#ifndef CONFIG_TIMER_WHEEL_TICK_MS
+#define CONFIG_TIMER_WHEEL_TICK_MS 1
+#endif
+
+/**
+ * @brief hierarchical timing wheel : any number of logical timers driven by one esp_timer ( one thread on host ).
+ * 4 levels of 64 slots, the level 0 slot is one tick : timers up to 64^4 ticks are placed in O(1),
+ * later ones are parked in the last level and re-placed when it cascades.
+ * start / stop / restart are O(1) list operations, expired timers are collected under the lock
+ * and their callbacks run as one batch without it.
+ * the driver is one-shot : it sleeps until the next occupied level 0 slot ( or the next cascade ),
+ * not every tick. a callback runs at most one tick late, never early.
+ */
+class TimerWheel
+{
+public:
+    static constexpr uint32_t LEVEL_BITS = 6;
+    static constexpr uint32_t SLOTS = 1 << LEVEL_BITS;
+    static constexpr uint32_t LEVELS = 4;
+
+    struct Stats_t
+    {
+        uint32_t active;    // timers armed
+        uint32_t fired;     // callbacks run
+        uint32_t cascaded;  // timers moved down a level
+        uint32_t batches;   // Advance() passes that fired something
+        uint32_t maxLateUs; // worst delay between the due time and the callback
+    };
+
+    /**
+     * @brief logical timer, owned by the caller ( see WheelTimer )
+     */
+    struct Node
+    {
+        Node *prev = nullptr;
+        Node *next = nullptr;
+        Node **head = nullptr; // slot list holding the node, nullptr if not armed
+        uint64_t expires = 0;  // tick
+        uint32_t periodTicks = 0;
+        bool armed = false;
+        std::function<void()> callback{nullptr};
+    };
+
+    // time source in us. with a clock the wheel has no driver : the owner calls Advance() ( tests, simulations )
+    using Clock_t = std::function<uint64_t()>;
+
+    explicit TimerWheel(uint32_t tickMs = CONFIG_TIMER_WHEEL_TICK_MS, Clock_t clock = nullptr);
+    ~TimerWheel();
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    // shared wheel used by WheelTimer
+    static TimerWheel &Default();
+
+    /**
+     * @brief (re)arm a node, a running node is moved
+     *
+     * @param delayUs first expiry, relative to now
+     * @param periodUs 0 for one-shot
+     */
+    esp_err_t Start(Node &node, uint64_t delayUs, uint64_t periodUs);
+    /**
+     * @brief disarm a node, waits for its callback if it is running on another task
+     */
+    esp_err_t Stop(Node &node);
+    bool IsActive(const Node &node);
+
+    /**
+     * @brief expire everything due at \c nowUs ( called by the driver, public for tests )
+     */
+    void Advance(uint64_t nowUs);
+    uint64_t NowUs() const;
+
+    Stats_t GetStats();
+    void ResetStats();
+
+private:
+    void Link(Node &node);
+    void Unlink(Node &node);
+    void Cascade(uint32_t level, uint32_t slot);
+    void ExpireSlot(uint32_t index);
+    uint64_t NextWakeTick() const;
+    uint64_t ToTicks(uint64_t us) const { return (us + tickUs - 1) / tickUs; }
+    // (re)schedule the driver for \c wakeTick, 0 : nothing armed
+    void DriverArm(uint64_t wakeTick);
+
+    const uint64_t tickUs;
+    const Clock_t clock;
+    uint64_t now = 0; // ticks
+    Node *slots[LEVELS][SLOTS] = {};
+    uint64_t occupied[LEVELS] = {}; // bit set : slot list not empty
+    Node *expired = nullptr;
+    uint32_t active = 0;
+    Stats_t stats{};
+    std::mutex lock;
+    Node *firing = nullptr; // callback running on the driver
+    std::atomic<std::thread::id> driverThread{};
+    uint64_t driverWake = 0; // tick the driver is scheduled for, 0 : idle
+#ifdef ESP_PLATFORM
+    static void DriverCallback(void *arg);
+    esp_timer_handle_t driverTimer = nullptr;
+#else
+    void DriverLoop();
+    std::thread driver;
+    std::condition_variable wake;
+    bool exiting = false;
+#endif
+};
+
+/**
+ * @brief timer on the shared TimerWheel, same API as ESPTimer
+ */
+class WheelTimer
+{
+public:
+    enum TimerType
+    {
+        NONE = -1,
+        PERIODIC = 0,
+        ONCE = 1,
+    };
+    WheelTimer(std::function<void()> timeout_cb, const std::string &timer_name = "WheelTimer", TimerWheel &wheel = TimerWheel::Default());
+    WheelTimer(const std::string &timer_name = "WheelTimer", TimerWheel &wheel = TimerWheel::Default());
+    ~WheelTimer();
+    WheelTimer(const WheelTimer &) = delete;
+    WheelTimer &operator=(const WheelTimer &) = delete;
+
+    template <typename r, typename p>
+    esp_err_t start_once(const std::chrono::duration<r, p> &timeout) noexcept
+    {
+        setPeriod(timeout);
+        return start(ONCE);
+    }
+    template <typename r, typename p>
+    esp_err_t start_periodic(const std::chrono::duration<r, p> &_period) noexcept
+    {
+        setPeriod(_period);
+        return start(PERIODIC);
+    }
+    template <typename r, typename p>
+    void setPeriod(const std::chrono::duration<r, p> &timeout) noexcept
+    {
+        period = std::chrono::duration_cast<std::chrono::microseconds>(timeout);
+    }
+    void setCallback(std::function<void()> _timeout_cb) noexcept;
+    esp_err_t stop() noexcept;
+    // stop if needed and start again with the last period
+    esp_err_t reset_periodic();
+    esp_err_t reset_once();
+    bool is_active();
+
+    template <typename r, typename p>
+    static auto FastTimerOnce(std::function<void(void *)> timeout_cb, const std::chrono::duration<r, p> &time, const std::string &timer_name = "WheelTimer", void *arg = nullptr)
+    {
+        auto timer = std::make_shared<WheelTimer>([timeout_cb, arg]()
+                                                  { timeout_cb(arg); },
+                                                  timer_name);
+        timer->start_once(std::chrono::duration_cast<std::chrono::microseconds>(time));
+        return timer;
+    }
+    const auto &GetPeriod()
+    {
+        return period;
+    }
+
+private:
+    esp_err_t start(TimerType type);
+
+    TimerWheel &wheel;
+    TimerWheel::Node node{};
+    std::function<void()> timeout_cb{nullptr};
+    const std::string name;
+    std::chrono::microseconds period{0};
+    std::atomic<TimerType> currentType{NONE}; // written by the wheel driver for one-shot timers
+};
+typedef std::unique_ptr<WheelTimer> WheelTimer_p_t;
+
+#endif // TIMER_WHEEL_HPP_
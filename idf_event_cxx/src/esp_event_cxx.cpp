@@ -37,11 +37,7 @@ namespace idf
             if (!api)
                 throw EventException(ESP_ERR_INVALID_ARG);
 
-            esp_err_t reg_result = api->handler_register(ev.base, ev.id.get_id(), event_handler_hook, this, &instance);
-            if (reg_result != ESP_OK)
-            {
-                throw ESPEventRegisterException(reg_result, event);
-            }
+            register_hook();
         }
         ESPEventReg::ESPEventReg(std::function<void()> cb,
                                  const ESPEvent &ev,
@@ -53,16 +49,41 @@ namespace idf
             if (!api)
                 throw EventException(ESP_ERR_INVALID_ARG);
 
-            esp_err_t reg_result = api->handler_register(ev.base, ev.id.get_id(), event_handler_hook, this, &instance);
+            register_hook();
+        }
+
+        ESPEventReg::~ESPEventReg()
+        {
+            unregister_hook();
+        }
+
+        void ESPEventReg::register_hook()
+        {
+            esp_err_t reg_result = api->handler_register(event.base, event.id.get_id(), event_handler_hook, this, &instance);
             if (reg_result != ESP_OK)
             {
                 throw ESPEventRegisterException(reg_result, event);
             }
+            if (event.id.get_id() == ESP_EVENT_ANY_ID || !api->has_done_hook())
+            {
+                return; // pooled ids already match, or the loop never pools
+            }
+            reg_result = api->handler_register(event.base, event.id.get_id() | POOLED_EVENT_ID, event_handler_hook, this, &instance_pooled);
+            if (reg_result != ESP_OK)
+            {
+                api->handler_unregister(event.base, event.id.get_id(), instance);
+                throw ESPEventRegisterException(reg_result, event);
+            }
         }
 
-        ESPEventReg::~ESPEventReg()
+        void ESPEventReg::unregister_hook()
         {
             api->handler_unregister(event.base, event.id.get_id(), instance);
+            if (instance_pooled != nullptr)
+            {
+                api->handler_unregister(event.base, event.id.get_id() | POOLED_EVENT_ID, instance_pooled);
+                instance_pooled = nullptr;
+            }
         }
 
         void ESPEventReg::dispatch_event_handling(ESPEvent event, void *event_data)
@@ -80,6 +101,11 @@ namespace idf
                                              void *event_data)
         {
             ESPEventReg *object = static_cast<ESPEventReg *>(handler_arg);
+            if (event_id != ESP_EVENT_ANY_ID && (event_id & POOLED_EVENT_ID) != 0)
+            {
+                event_id &= ~POOLED_EVENT_ID;
+                event_data = EventPayloadPool::wire_data(event_data);
+            }
             if (object->cb != nullptr)
                 object->dispatch_event_handling(ESPEvent(event_base, ESPEventID(event_id)), event_data);
             else if (object->cb_no_arg != nullptr)
@@ -144,7 +170,7 @@ namespace idf
             if (object->timeout_mutex.try_lock())
             {
                 object->timeout_cb(object->event);
-                object->api->handler_unregister(object->event.base, object->event.id.get_id(), object->instance);
+                object->unregister_hook();
                 object->timeout_mutex.unlock();
             }
         }
@@ -161,9 +187,68 @@ namespace idf
         {
             if (!api)
                 throw EventException(ESP_ERR_INVALID_ARG);
+#if CONFIG_EVENT_PAYLOAD_POOL_SLOTS > 0
+            if (!api->has_done_hook())
+            {
+                return; // esp_event : plain copies, event ids untouched
+            }
+            payload_pool = std::unique_ptr<EventPayloadPool>(new EventPayloadPool(CONFIG_EVENT_PAYLOAD_POOL_SLOTS));
+            esp_err_t res = api->done_hook_register(payload_done_hook, this, &payload_hook_instance);
+            if (res != ESP_OK)
+            {
+                ESP_LOGW("ESPEventLoop", "payload pool disabled, hook registration failed %s", esp_err_to_name(res));
+                payload_pool.reset();
+            }
+#endif
+        }
+
+        ESPEventLoop::~ESPEventLoop()
+        {
+            if (payload_pool)
+            {
+                api->done_hook_unregister(payload_hook_instance);
+            }
         }
 
-        ESPEventLoop::~ESPEventLoop() {}
+        void ESPEventLoop::payload_done_hook(void *handler_arg,
+                                             esp_event_base_t event_base,
+                                             int32_t event_id,
+                                             void *event_data)
+        {
+            ESPEventLoop *loop = static_cast<ESPEventLoop *>(handler_arg);
+            if (event_id != ESP_EVENT_ANY_ID && (event_id & POOLED_EVENT_ID) != 0 && event_data != nullptr &&
+                loop->payload_pool->owns(EventPayloadPool::wire_data(event_data)))
+            {
+                EventPayloadPool::from_wire(event_data); // every handler ran : the slot goes back to the pool here
+            }
+        }
+
+        esp_err_t ESPEventLoop::post_payload(const ESPEvent &event, PayloadRef &&payload, const std::chrono::milliseconds &wait_time)
+        {
+            uint8_t wire[EventPayloadPool::WIRE_SIZE];
+            EventPayloadPool::to_wire(std::move(payload), wire);
+            esp_err_t result = api->post(event.base,
+                                         event.id.get_id() | POOLED_EVENT_ID,
+                                         wire,
+                                         sizeof(wire),
+                                         convert_duration_to_ticks(wait_time));
+            if (result != ESP_OK)
+            {
+                EventPayloadPool::from_wire(wire); // not posted : give the slot back
+                ESP_LOGE("EVENT DATA FAILED", "%s : %d ", (const char *)event.base, event.id.get_id());
+            }
+            return result;
+        }
+
+        PayloadRef ESPEventLoop::retain_payload(void *event_data)
+        {
+            return payload_pool ? payload_pool->retain(event_data) : PayloadRef();
+        }
+
+        EventPayloadPool::Stats_t ESPEventLoop::get_payload_stats() const
+        {
+            return payload_pool ? payload_pool->get_stats() : EventPayloadPool::Stats_t{};
+        }
 
         unique_ptr<ESPEventReg> ESPEventLoop::register_event(const ESPEvent &event,
                                                              function<void(const ESPEvent &, void *)> cb)
@@ -182,7 +267,14 @@ namespace idf
                                                   void *event_data,
                                                   const std::chrono::milliseconds &wait_time)
         {
-            std::unique_lock autolock(lock);
+            if (payload_pool)
+            {
+                PayloadRef payload = payload_pool->acquire(&event_data, sizeof(event_data));
+                if (payload)
+                {
+                    return post_payload(event, std::move(payload), wait_time);
+                }
+            }
             esp_err_t result = api->post(event.base,
                                          event.id.get_id(),
                                          &event_data,
@@ -199,7 +291,6 @@ namespace idf
         esp_err_t ESPEventLoop::post_event(const ESPEvent &event,
                                            const chrono::milliseconds &wait_time)
         {
-            std::unique_lock autolock(lock);
             esp_err_t result = api->post(event.base,
                                          event.id.get_id(),
                                          nullptr,
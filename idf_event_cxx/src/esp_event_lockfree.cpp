@@ -0,0 +1,494 @@
+#include "sdkconfig.h"
+#include "esp_event_lockfree.hpp"
+#include "esp_log.h"
+#ifdef ESP_PLATFORM
+#include "esp_pthread.h"
+#endif
+#include <chrono>
+#include <cstring>
+
+namespace idf
+{
+
+    namespace event
+    {
+        static const char TAG[] = "EventLockFree";
+        // done hooks are kept in the handler table under this private base
+        static const char DONE_HOOK_BASE[] = "EVENT_DONE_HOOK";
+
+        ESPEventAPILockFree::ESPEventAPILockFree(size_t queueSize)
+            : lanes{MPMCQueue<Event_t>(queueSize), MPMCQueue<Event_t>(queueSize)},
+              table(std::make_shared<const Table_t>())
+        {
+            for (auto &base : highBases)
+            {
+                base.store(nullptr, std::memory_order_relaxed);
+            }
+#ifdef ESP_PLATFORM
+            esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+            cfg.stack_size = CONFIG_EVENT_LOCKFREE_TASK_STACK;
+            cfg.prio = CONFIG_EVENT_LOCKFREE_TASK_PRIORITY;
+            cfg.thread_name = "EventLockFree";
+            esp_pthread_set_cfg(&cfg);
+#endif
+            dispatcher = std::thread(&ESPEventAPILockFree::DispatcherLoop, this);
+#ifdef ESP_PLATFORM
+            cfg = esp_pthread_get_default_config();
+            esp_pthread_set_cfg(&cfg);
+#endif
+        }
+
+        ESPEventAPILockFree::~ESPEventAPILockFree()
+        {
+            running.store(false);
+            WakeDispatcher(false);
+            WakePosters();
+            if (dispatcher.joinable())
+            {
+                dispatcher.join();
+            }
+            // free the payloads of events that were never dispatched
+            Event_t event;
+            for (auto &lane : lanes)
+            {
+                while (lane.try_pop(event))
+                {
+                    delete[] event.heapData;
+                }
+            }
+        }
+
+        std::shared_ptr<const ESPEventAPILockFree::Table_t> ESPEventAPILockFree::LoadTable() const
+        {
+            return std::atomic_load(&table);
+        }
+
+        esp_err_t ESPEventAPILockFree::handler_register(esp_event_base_t event_base,
+                                                        int32_t event_id,
+                                                        esp_event_handler_t event_handler,
+                                                        void *event_handler_arg,
+                                                        esp_event_handler_instance_t *instance)
+        {
+            if (event_handler == nullptr || (event_base == ESP_EVENT_ANY_BASE && event_id != ESP_EVENT_ANY_ID))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            std::lock_guard<std::mutex> guard(tableLock);
+            auto next = std::make_shared<Table_t>(*LoadTable());
+            const esp_event_handler_instance_t newInstance = reinterpret_cast<esp_event_handler_instance_t>(++nextInstance);
+            (*next)[Key_t{event_base, event_id}].push_back(Handler_t{event_handler, event_handler_arg, newInstance});
+            std::atomic_store(&table, std::shared_ptr<const Table_t>(std::move(next)));
+            if (instance != nullptr)
+            {
+                *instance = newInstance;
+            }
+            return ESP_OK;
+        }
+
+        /**
+         * @brief remove one handler instance ( all handlers of the key if instance is nullptr )
+         * waits for the event being dispatched, if any, unless called from a handler
+         */
+        esp_err_t ESPEventAPILockFree::handler_unregister(esp_event_base_t event_base,
+                                                          int32_t event_id,
+                                                          esp_event_handler_instance_t instance)
+        {
+            {
+                std::lock_guard<std::mutex> guard(tableLock);
+                std::shared_ptr<const Table_t> current = LoadTable();
+                const Key_t key{event_base, event_id};
+                auto found = current->find(key);
+                if (found == current->end())
+                {
+                    return ESP_ERR_NOT_FOUND;
+                }
+                std::vector<Handler_t> remaining;
+                for (const auto &handler : found->second)
+                {
+                    if (instance != nullptr && handler.instance != instance)
+                    {
+                        remaining.push_back(handler);
+                    }
+                }
+                if (remaining.size() == found->second.size())
+                {
+                    return ESP_ERR_NOT_FOUND;
+                }
+                auto next = std::make_shared<Table_t>(*current);
+                if (remaining.empty())
+                {
+                    next->erase(key);
+                }
+                else
+                {
+                    (*next)[key] = std::move(remaining);
+                }
+                std::atomic_store(&table, std::shared_ptr<const Table_t>(std::move(next)));
+            }
+            WaitDispatchDone();
+            return ESP_OK;
+        }
+
+        /**
+         * @brief the dispatcher may still hold the previous table : wait for the current event to finish
+         * the table store then epoch load here, and the epoch increment then table load in Dispatch() are
+         * all seq_cst : either the dispatcher sees the new table, or this sees the odd epoch and waits
+         */
+        void ESPEventAPILockFree::WaitDispatchDone()
+        {
+            if (std::this_thread::get_id() == dispatcher.get_id())
+            {
+                return; // unregistering from a handler
+            }
+            const uint32_t epoch = dispatchEpoch.load(std::memory_order_seq_cst);
+            if ((epoch & 1) == 0)
+            {
+                return;
+            }
+            while (dispatchEpoch.load(std::memory_order_seq_cst) == epoch)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        esp_err_t ESPEventAPILockFree::done_hook_register(esp_event_handler_t hook,
+                                                          void *arg,
+                                                          esp_event_handler_instance_t *instance)
+        {
+            return handler_register(DONE_HOOK_BASE, 0, hook, arg, instance);
+        }
+
+        esp_err_t ESPEventAPILockFree::done_hook_unregister(esp_event_handler_instance_t instance)
+        {
+            if (instance == nullptr)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            return handler_unregister(DONE_HOOK_BASE, 0, instance);
+        }
+
+        esp_err_t ESPEventAPILockFree::set_base_priority(esp_event_base_t event_base, Priority_t priority)
+        {
+            if (event_base == nullptr)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            std::lock_guard<std::mutex> guard(tableLock);
+            for (auto &base : highBases)
+            {
+                if (base.load(std::memory_order_relaxed) == event_base)
+                {
+                    if (priority == Priority_t::PRIO_LOW)
+                    {
+                        base.store(nullptr, std::memory_order_release);
+                    }
+                    return ESP_OK;
+                }
+            }
+            if (priority == Priority_t::PRIO_LOW)
+            {
+                return ESP_OK;
+            }
+            for (auto &base : highBases)
+            {
+                if (base.load(std::memory_order_relaxed) == nullptr)
+                {
+                    base.store(event_base, std::memory_order_release);
+                    return ESP_OK;
+                }
+            }
+            ESP_LOGE(TAG, "no room left for high priority base %s", event_base);
+            return ESP_ERR_NO_MEM;
+        }
+
+        ESPEventAPILockFree::Priority_t ESPEventAPILockFree::get_base_priority(esp_event_base_t event_base) const
+        {
+            for (const auto &base : highBases)
+            {
+                if (base.load(std::memory_order_acquire) == event_base)
+                {
+                    return Priority_t::PRIO_HIGH;
+                }
+            }
+            return Priority_t::PRIO_LOW;
+        }
+
+        esp_err_t ESPEventAPILockFree::post(esp_event_base_t event_base,
+                                            int32_t event_id,
+                                            void *event_data,
+                                            size_t event_data_size,
+                                            TickType_t ticks_to_wait)
+        {
+            return post(event_base, event_id, event_data, event_data_size, ticks_to_wait, get_base_priority(event_base));
+        }
+
+        /**
+         * @brief copy the event into a lane, waits up to ticks_to_wait for the dispatcher to free a cell if the lane is full
+         *
+         * @return esp_err_t ESP_ERR_TIMEOUT lane still full after ticks_to_wait
+         */
+        esp_err_t ESPEventAPILockFree::post(esp_event_base_t event_base,
+                                            int32_t event_id,
+                                            void *event_data,
+                                            size_t event_data_size,
+                                            TickType_t ticks_to_wait,
+                                            Priority_t priority)
+        {
+            if (event_base == nullptr || (event_data == nullptr && event_data_size > 0))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            Event_t event;
+            event.base = event_base;
+            event.id = event_id;
+            event.size = static_cast<uint32_t>(event_data_size);
+            if (event_data_size > sizeof(event.inlineData))
+            {
+                event.heapData = new (std::nothrow) uint8_t[event_data_size];
+                if (event.heapData == nullptr)
+                {
+                    return ESP_ERR_NO_MEM;
+                }
+                heapPayload.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (event_data_size > 0)
+            {
+                memcpy(event.data(), event_data, event_data_size);
+            }
+            if (TryPostOnce(event, priority) || (ticks_to_wait > 0 && WaitAndPost(event, priority, ticks_to_wait) == ESP_OK))
+            {
+                return ESP_OK;
+            }
+            delete[] event.heapData;
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return ESP_ERR_TIMEOUT;
+        }
+
+        /**
+         * @brief sleep until the dispatcher frees a cell ( see WakePosters() ) or ticks_to_wait runs out
+         */
+        esp_err_t ESPEventAPILockFree::WaitAndPost(Event_t &event, Priority_t priority, TickType_t ticks_to_wait)
+        {
+            const bool forever = (ticks_to_wait == portMAX_DELAY);
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<uint64_t>(ticks_to_wait) * portTICK_PERIOD_MS);
+            esp_err_t ret = ESP_ERR_TIMEOUT;
+            waitingPosters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                // the dispatcher takes spaceLock after its pop : a cell freed between our try and our wait is not missed
+                std::unique_lock<std::mutex> guard(spaceLock);
+                while (running.load(std::memory_order_relaxed))
+                {
+                    if (TryPostOnce(event, priority))
+                    {
+                        ret = ESP_OK;
+                        break;
+                    }
+                    if (forever)
+                    {
+                        spaceCond.wait(guard);
+                    }
+                    else if (spaceCond.wait_until(guard, deadline) == std::cv_status::timeout)
+                    {
+                        ret = TryPostOnce(event, priority) ? ESP_OK : ESP_ERR_TIMEOUT;
+                        break;
+                    }
+                }
+            }
+            waitingPosters.fetch_sub(1);
+            return ret;
+        }
+
+        void ESPEventAPILockFree::WakePosters()
+        {
+            // pairs with the increment in WaitAndPost() : either the poster sees the free cell or we see it waiting
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waitingPosters.load(std::memory_order_relaxed) > 0)
+            {
+                std::lock_guard<std::mutex> guard(spaceLock);
+                spaceCond.notify_all();
+            }
+        }
+
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+        esp_err_t ESPEventAPILockFree::post_from_isr(esp_event_base_t event_base,
+                                                     int32_t event_id,
+                                                     void *event_data,
+                                                     size_t event_data_size)
+        {
+            if (event_base == nullptr || (event_data == nullptr && event_data_size > 0) || event_data_size > CONFIG_EVENT_LOCKFREE_INLINE_DATA_SIZE)
+            {
+                return ESP_ERR_INVALID_ARG; // no allocation from an isr
+            }
+            Event_t event;
+            event.base = event_base;
+            event.id = event_id;
+            event.size = static_cast<uint32_t>(event_data_size);
+            if (event_data_size > 0)
+            {
+                memcpy(event.inlineData, event_data, event_data_size);
+            }
+            if (TryPostOnce(event, get_base_priority(event_base), true))
+            {
+                return ESP_OK;
+            }
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return ESP_ERR_TIMEOUT;
+        }
+#endif
+
+        bool ESPEventAPILockFree::TryPostOnce(Event_t &event, Priority_t priority, bool fromIsr)
+        {
+            const size_t lane = static_cast<size_t>(priority);
+            if (!lanes[lane].try_push(event))
+            {
+                return false;
+            }
+            posted[lane].fetch_add(1, std::memory_order_relaxed);
+            WakeDispatcher(fromIsr);
+            return true;
+        }
+
+        /**
+         * @brief on ESP32 the dispatcher sleeps on its task notification : no lock taken, safe from an isr
+         */
+        void ESPEventAPILockFree::WakeDispatcher(bool fromIsr)
+        {
+            // pairs with the fence in DispatcherLoop : either the dispatcher sees the event or we see it sleeping
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!sleeping.load(std::memory_order_relaxed) && running.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+#ifdef ESP_PLATFORM
+            TaskHandle_t handle = dispatcherTask.load(std::memory_order_acquire);
+            if (handle == nullptr)
+            {
+                return;
+            }
+            if (fromIsr)
+            {
+                BaseType_t woken = pdFALSE;
+                vTaskNotifyGiveFromISR(handle, &woken);
+                if (woken == pdTRUE)
+                {
+                    portYIELD_FROM_ISR();
+                }
+            }
+            else
+            {
+                xTaskNotifyGive(handle);
+            }
+#else
+            (void)fromIsr; // no isr on linux
+            std::lock_guard<std::mutex> guard(wakeLock);
+            wakeCond.notify_one();
+#endif
+        }
+
+        /**
+         * @brief called with sleeping set : returns on a wake, or after 100 ms
+         */
+        void ESPEventAPILockFree::SleepDispatcher()
+        {
+#ifdef ESP_PLATFORM
+            if (lanes[1].empty() && lanes[0].empty() && running.load(std::memory_order_relaxed))
+            {
+                // a give between the check and the take is kept in the notification count
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            }
+#else
+            std::unique_lock<std::mutex> guard(wakeLock);
+            if (lanes[1].empty() && lanes[0].empty() && running.load(std::memory_order_relaxed))
+            {
+                wakeCond.wait_for(guard, std::chrono::milliseconds(100));
+            }
+#endif
+        }
+
+        /**
+         * @brief the high lane is always drained first, low events run when no high event is waiting
+         */
+        void ESPEventAPILockFree::DispatcherLoop()
+        {
+            Event_t event;
+#ifdef ESP_PLATFORM
+            dispatcherTask.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+#endif
+            while (running.load(std::memory_order_relaxed))
+            {
+                if (lanes[1].try_pop(event) || lanes[0].try_pop(event))
+                {
+                    WakePosters();
+                    Dispatch(event);
+                    continue;
+                }
+                sleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                SleepDispatcher();
+                sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        void ESPEventAPILockFree::CallHandlers(const Table_t &handlers, const Key_t &key, Event_t &event, bool &handled)
+        {
+            auto found = handlers.find(key);
+            if (found == handlers.end())
+            {
+                return;
+            }
+            for (const auto &handler : found->second)
+            {
+                handler.handler(handler.arg, event.base, event.id, event.data());
+                handled = true;
+            }
+        }
+
+        void ESPEventAPILockFree::Dispatch(Event_t &event)
+        {
+            dispatchEpoch.fetch_add(1, std::memory_order_seq_cst); // odd : dispatching, ordered before the table load
+            const std::shared_ptr<const Table_t> handlers = LoadTable();
+            bool handled = false;
+            CallHandlers(*handlers, Key_t{event.base, event.id}, event, handled);
+            if (event.id != ESP_EVENT_ANY_ID)
+            {
+                CallHandlers(*handlers, Key_t{event.base, ESP_EVENT_ANY_ID}, event, handled);
+            }
+            CallHandlers(*handlers, Key_t{ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID}, event, handled);
+            bool hooked = false;
+            CallHandlers(*handlers, Key_t{DONE_HOOK_BASE, 0}, event, hooked);
+            dispatchEpoch.fetch_add(1, std::memory_order_seq_cst); // even : idle
+            if (!handled)
+            {
+                unhandled.fetch_add(1, std::memory_order_relaxed);
+            }
+            dispatched.fetch_add(1, std::memory_order_relaxed);
+            delete[] event.heapData;
+            event.heapData = nullptr;
+        }
+
+        ESPEventAPILockFree::Stats_t ESPEventAPILockFree::get_stats() const
+        {
+            Stats_t stats{};
+            stats.posted[0] = posted[0].load(std::memory_order_relaxed);
+            stats.posted[1] = posted[1].load(std::memory_order_relaxed);
+            stats.dropped = dropped.load(std::memory_order_relaxed);
+            stats.dispatched = dispatched.load(std::memory_order_relaxed);
+            stats.unhandled = unhandled.load(std::memory_order_relaxed);
+            stats.heapPayload = heapPayload.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        void ESPEventAPILockFree::reset_stats()
+        {
+            posted[0].store(0, std::memory_order_relaxed);
+            posted[1].store(0, std::memory_order_relaxed);
+            dropped.store(0, std::memory_order_relaxed);
+            dispatched.store(0, std::memory_order_relaxed);
+            unhandled.store(0, std::memory_order_relaxed);
+            heapPayload.store(0, std::memory_order_relaxed);
+        }
+
+    } // event
+
+} // idf
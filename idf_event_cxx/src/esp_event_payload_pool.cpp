@@ -0,0 +1,184 @@
+#include "esp_event_payload_pool.hpp"
+#include <cstring>
+#include <new>
+
+namespace idf
+{
+
+    namespace event
+    {
+        constexpr std::array<size_t, EventPayloadPool::CLASS_COUNT> EventPayloadPool::CLASS_SIZE;
+
+        PayloadRef::PayloadRef(const PayloadRef &other) : slot(other.slot)
+        {
+            if (slot != nullptr)
+            {
+                slot->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void *PayloadRef::data() const
+        {
+            return (slot != nullptr) ? slot->data() : nullptr;
+        }
+
+        size_t PayloadRef::size() const
+        {
+            return (slot != nullptr) ? slot->size : 0;
+        }
+
+        void PayloadRef::reset()
+        {
+            if (slot != nullptr)
+            {
+                if (slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    slot->pool->release(slot);
+                }
+                slot = nullptr;
+            }
+        }
+
+        /**
+         * @brief allocates the slabs, the only allocation of the pool
+         */
+        EventPayloadPool::EventPayloadPool(size_t slotsPerClass)
+        {
+            static_assert(sizeof(Slot_t) <= HEADER_SIZE, "slot header does not fit");
+            for (size_t c = 0; c < CLASS_COUNT; c++)
+            {
+                auto sizeClass = std::unique_ptr<Class_t>(new Class_t(slotsPerClass));
+                sizeClass->slots = slotsPerClass;
+                sizeClass->stride = HEADER_SIZE + CLASS_SIZE[c];
+                sizeClass->slab = std::unique_ptr<uint8_t[]>(new uint8_t[sizeClass->stride * slotsPerClass]);
+                for (size_t i = 0; i < slotsPerClass; i++)
+                {
+                    Slot_t *slot = new (&sizeClass->slab[i * sizeClass->stride]) Slot_t;
+                    slot->pool = this;
+                    slot->refs.store(0, std::memory_order_relaxed);
+                    slot->size = 0;
+                    slot->sizeClass = static_cast<uint8_t>(c);
+                    sizeClass->freeSlots.try_push(slot);
+                }
+                classes[c] = std::move(sizeClass);
+            }
+        }
+
+        PayloadRef EventPayloadPool::acquire(const void *data, size_t size)
+        {
+            size_t c = 0;
+            while (c < CLASS_COUNT && CLASS_SIZE[c] < size)
+            {
+                c++;
+            }
+            if (c == CLASS_COUNT)
+            {
+                oversize.fetch_add(1, std::memory_order_relaxed);
+                return PayloadRef();
+            }
+            Class_t &sizeClass = *classes[c];
+            Slot_t *slot = nullptr;
+            if (!sizeClass.freeSlots.try_pop(slot))
+            {
+                exhausted.fetch_add(1, std::memory_order_relaxed);
+                return PayloadRef();
+            }
+            slot->refs.store(1, std::memory_order_relaxed);
+            slot->size = static_cast<uint16_t>(size);
+            if (size > 0 && data != nullptr)
+            {
+                memcpy(slot->data(), data, size);
+            }
+            acquired.fetch_add(1, std::memory_order_relaxed);
+            const uint16_t inUse = sizeClass.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (inUse > sizeClass.highWater.load(std::memory_order_relaxed))
+            {
+                sizeClass.highWater.store(inUse, std::memory_order_relaxed);
+            }
+            return PayloadRef(slot);
+        }
+
+        void EventPayloadPool::release(Slot_t *slot)
+        {
+            Class_t &sizeClass = *classes[slot->sizeClass];
+            sizeClass.inUse.fetch_sub(1, std::memory_order_relaxed);
+            released.fetch_add(1, std::memory_order_relaxed);
+            sizeClass.freeSlots.try_push(slot); // never full : the queue holds every slot of the class
+        }
+
+        bool EventPayloadPool::owns(const void *data) const
+        {
+            const uint8_t *ptr = static_cast<const uint8_t *>(data);
+            for (const auto &sizeClass : classes)
+            {
+                const uint8_t *begin = sizeClass->slab.get();
+                const uint8_t *end = begin + sizeClass->stride * sizeClass->slots;
+                if (ptr >= begin + HEADER_SIZE && ptr < end)
+                {
+                    return ((ptr - begin) % sizeClass->stride) == HEADER_SIZE;
+                }
+            }
+            return false;
+        }
+
+        PayloadRef EventPayloadPool::retain(void *data)
+        {
+            if (data == nullptr || !owns(data))
+            {
+                return PayloadRef();
+            }
+            Slot_t *slot = reinterpret_cast<Slot_t *>(static_cast<uint8_t *>(data) - HEADER_SIZE);
+            slot->refs.fetch_add(1, std::memory_order_relaxed);
+            return PayloadRef(slot);
+        }
+
+        void EventPayloadPool::to_wire(PayloadRef &&ref, void *wire)
+        {
+            memcpy(wire, &ref.slot, WIRE_SIZE);
+            ref.slot = nullptr; // the reference now travels with the event
+        }
+
+        PayloadRef EventPayloadPool::from_wire(void *wire)
+        {
+            Slot_t *slot = nullptr;
+            memcpy(&slot, wire, WIRE_SIZE);
+            return PayloadRef(slot);
+        }
+
+        void *EventPayloadPool::wire_data(void *wire)
+        {
+            Slot_t *slot = nullptr;
+            memcpy(&slot, wire, WIRE_SIZE);
+            return (slot != nullptr) ? slot->data() : nullptr;
+        }
+
+        EventPayloadPool::Stats_t EventPayloadPool::get_stats() const
+        {
+            Stats_t stats{};
+            stats.acquired = acquired.load(std::memory_order_relaxed);
+            stats.released = released.load(std::memory_order_relaxed);
+            stats.exhausted = exhausted.load(std::memory_order_relaxed);
+            stats.oversize = oversize.load(std::memory_order_relaxed);
+            for (size_t c = 0; c < CLASS_COUNT; c++)
+            {
+                stats.inUse[c] = classes[c]->inUse.load(std::memory_order_relaxed);
+                stats.highWater[c] = classes[c]->highWater.load(std::memory_order_relaxed);
+            }
+            return stats;
+        }
+
+        void EventPayloadPool::reset_stats()
+        {
+            acquired.store(0, std::memory_order_relaxed);
+            released.store(0, std::memory_order_relaxed);
+            exhausted.store(0, std::memory_order_relaxed);
+            oversize.store(0, std::memory_order_relaxed);
+            for (auto &sizeClass : classes)
+            {
+                sizeClass->highWater.store(sizeClass->inUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+
+    } // event
+
+} // idf
@@ -0,0 +1,463 @@
+#include "timer_wheel.hpp"
+#include "esp_log.h"
+
+static const char TAG[] = "TimerWheel";
+#ifndef ESP_PLATFORM
+static const auto hostEpoch = std::chrono::steady_clock::now();
+#endif
+
+TimerWheel::TimerWheel(uint32_t tickMs, Clock_t _clock) : tickUs(static_cast<uint64_t>(tickMs ? tickMs : 1) * 1000), clock(std::move(_clock))
+{
+    now = NowUs() / tickUs;
+#ifdef ESP_PLATFORM
+    if (clock != nullptr)
+    {
+        return;
+    }
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = DriverCallback;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = TAG;
+    esp_err_t ret = esp_timer_create(&timer_args, &driverTimer);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "driver timer create ERROR %s", esp_err_to_name(ret));
+    }
+#endif
+}
+
+TimerWheel::~TimerWheel()
+{
+#ifdef ESP_PLATFORM
+    if (driverTimer != nullptr)
+    {
+        esp_timer_stop(driverTimer);
+        esp_timer_delete(driverTimer);
+    }
+#else
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        exiting = true;
+        wake.notify_one();
+    }
+    if (driver.joinable())
+    {
+        driver.join();
+    }
+#endif
+}
+
+TimerWheel &TimerWheel::Default()
+{
+    static TimerWheel defaultWheel;
+    return defaultWheel;
+}
+
+uint64_t TimerWheel::NowUs() const
+{
+    if (clock != nullptr)
+    {
+        return clock();
+    }
+#ifdef ESP_PLATFORM
+    return static_cast<uint64_t>(esp_timer_get_time());
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostEpoch).count();
+#endif
+}
+
+/**
+ * @brief put a node in the slot matching its expiry, must be called with lock held
+ */
+void TimerWheel::Link(Node &node)
+{
+    Node **head = &expired;
+    if (node.expires > now)
+    {
+        const uint64_t delta = node.expires - now;
+        uint64_t expires = node.expires;
+        uint32_t level = 0;
+        while (level < LEVELS - 1 && delta >= (1ULL << (LEVEL_BITS * (level + 1))))
+        {
+            level++;
+        }
+        if (delta >= (1ULL << (LEVEL_BITS * LEVELS)))
+        {
+            expires = now + (1ULL << (LEVEL_BITS * LEVELS)) - 1; // out of range : parked, re-placed on cascade
+        }
+        const uint32_t slot = (expires >> (LEVEL_BITS * level)) & (SLOTS - 1);
+        head = &slots[level][slot];
+        occupied[level] |= 1ULL << slot;
+    }
+    node.head = head;
+    node.prev = nullptr;
+    node.next = *head;
+    if (*head != nullptr)
+    {
+        (*head)->prev = &node;
+    }
+    *head = &node;
+}
+
+void TimerWheel::Unlink(Node &node)
+{
+    if (node.head == nullptr)
+    {
+        return;
+    }
+    if (node.prev != nullptr)
+        node.prev->next = node.next;
+    else
+        *node.head = node.next;
+    if (node.next != nullptr)
+        node.next->prev = node.prev;
+    if (*node.head == nullptr && node.head != &expired)
+    {
+        const size_t index = node.head - &slots[0][0];
+        occupied[index / SLOTS] &= ~(1ULL << (index % SLOTS));
+    }
+    node.prev = node.next = nullptr;
+    node.head = nullptr;
+}
+
+void TimerWheel::Cascade(uint32_t level, uint32_t slot)
+{
+    Node *node = slots[level][slot];
+    slots[level][slot] = nullptr;
+    occupied[level] &= ~(1ULL << slot);
+    while (node != nullptr)
+    {
+        Node *next = node->next;
+        node->head = nullptr;
+        Link(*node);
+        stats.cascaded++;
+        node = next;
+    }
+}
+
+/**
+ * @brief move the level 0 slot of the current tick to the expired list
+ */
+void TimerWheel::ExpireSlot(uint32_t index)
+{
+    Node *node = slots[0][index];
+    slots[0][index] = nullptr;
+    occupied[0] &= ~(1ULL << index);
+    while (node != nullptr)
+    {
+        Node *next = node->next;
+        node->head = nullptr;
+        Link(*node); // expires == now
+        node = next;
+    }
+}
+
+/**
+ * @brief next tick with something to do : an occupied level 0 slot in this rotation, or the next cascade
+ */
+uint64_t TimerWheel::NextWakeTick() const
+{
+    if (active == 0)
+    {
+        return 0;
+    }
+    if (expired != nullptr)
+    {
+        return now;
+    }
+    const uint32_t index = now & (SLOTS - 1);
+    const uint64_t ahead = (index == SLOTS - 1) ? 0 : (occupied[0] & (~0ULL << (index + 1)));
+    if (ahead != 0)
+    {
+        return now - index + __builtin_ctzll(ahead);
+    }
+    return (now | (SLOTS - 1)) + 1;
+}
+
+esp_err_t TimerWheel::Start(Node &node, uint64_t delayUs, uint64_t periodUs)
+{
+    if (node.callback == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint64_t due = NowUs() + delayUs;
+    std::lock_guard<std::mutex> guard(lock);
+    Unlink(node);
+    if (!node.armed)
+    {
+        node.armed = true;
+        active++;
+    }
+    node.expires = (due + tickUs - 1) / tickUs; // round up : never early
+    if (node.expires <= now)
+    {
+        node.expires = now + 1;
+    }
+    node.periodTicks = static_cast<uint32_t>(periodUs ? ToTicks(periodUs) : 0);
+    Link(node);
+    if (driverWake == 0 || node.expires < driverWake)
+    {
+        DriverArm(NextWakeTick());
+    }
+    return ESP_OK;
+}
+
+esp_err_t TimerWheel::Stop(Node &node)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    Unlink(node);
+    if (node.armed)
+    {
+        node.armed = false;
+        active--;
+    }
+    // the callback may use the owner : wait unless it is the one stopping itself
+    while (firing == &node && driverThread.load() != std::this_thread::get_id())
+    {
+        guard.unlock();
+        std::this_thread::yield();
+        guard.lock();
+    }
+    return ESP_OK;
+}
+
+bool TimerWheel::IsActive(const Node &node)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return node.armed;
+}
+
+/**
+ * @brief move the wheel to \c nowUs, then run every due callback as one batch.
+ * empty level 0 slots are skipped, only cascade boundaries are visited one by one
+ */
+void TimerWheel::Advance(uint64_t nowUs)
+{
+    driverThread.store(std::this_thread::get_id());
+    const uint64_t target = nowUs / tickUs;
+    std::unique_lock<std::mutex> guard(lock);
+    while (now < target)
+    {
+        const uint64_t boundary = (now | (SLOTS - 1)) + 1;
+        const uint64_t limit = (target < boundary) ? target : boundary - 1;
+        const uint32_t index = now & (SLOTS - 1);
+        const uint32_t last = limit & (SLOTS - 1);
+        uint64_t window = (index == SLOTS - 1) ? 0 : (occupied[0] & (~0ULL << (index + 1)));
+        if (last < SLOTS - 1)
+        {
+            window &= (1ULL << (last + 1)) - 1;
+        }
+        if (window != 0)
+        {
+            now = now - index + __builtin_ctzll(window);
+            ExpireSlot(now & (SLOTS - 1));
+            continue;
+        }
+        now = limit;
+        if (now == target)
+        {
+            break;
+        }
+        now = boundary;
+        for (uint32_t level = 1; level < LEVELS; level++)
+        {
+            const uint32_t slot = (now >> (LEVEL_BITS * level)) & (SLOTS - 1);
+            Cascade(level, slot);
+            if (slot != 0)
+            {
+                break;
+            }
+        }
+        ExpireSlot(0);
+    }
+    bool any = false;
+    while (expired != nullptr)
+    {
+        Node &node = *expired;
+        Unlink(node);
+        const bool periodic = node.periodTicks > 0;
+        if (!periodic)
+        {
+            node.armed = false;
+            active--;
+        }
+        const uint64_t dueUs = node.expires * tickUs;
+        if (nowUs > dueUs && nowUs - dueUs > stats.maxLateUs)
+        {
+            stats.maxLateUs = static_cast<uint32_t>(nowUs - dueUs);
+        }
+        firing = &node;
+        stats.fired++;
+        any = true;
+        guard.unlock();
+        node.callback();
+        guard.lock();
+        firing = nullptr;
+        if (periodic && node.armed && node.head == nullptr) // not stopped nor restarted by the callback
+        {
+            node.expires += node.periodTicks;
+            if (node.expires <= now)
+            {
+                node.expires = now + 1; // fell behind : skip the missed periods
+            }
+            Link(node);
+        }
+    }
+    if (any)
+    {
+        stats.batches++;
+    }
+    driverWake = 0;
+    DriverArm(NextWakeTick());
+}
+
+TimerWheel::Stats_t TimerWheel::GetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Stats_t ret = stats;
+    ret.active = active;
+    return ret;
+}
+
+void TimerWheel::ResetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stats = Stats_t{};
+}
+
+#ifdef ESP_PLATFORM
+void TimerWheel::DriverArm(uint64_t wakeTick)
+{
+    if (driverTimer == nullptr)
+    {
+        return;
+    }
+    esp_timer_stop(driverTimer); // ESP_ERR_INVALID_STATE if not running
+    driverWake = wakeTick;
+    if (wakeTick == 0)
+    {
+        return;
+    }
+    const uint64_t wakeUs = wakeTick * tickUs;
+    const uint64_t nowUs = NowUs();
+    esp_timer_start_once(driverTimer, (wakeUs > nowUs) ? (wakeUs - nowUs) : 0);
+}
+
+void TimerWheel::DriverCallback(void *arg)
+{
+    TimerWheel *wheel = static_cast<TimerWheel *>(arg);
+    wheel->Advance(wheel->NowUs());
+}
+#else
+void TimerWheel::DriverArm(uint64_t wakeTick)
+{
+    driverWake = wakeTick;
+    if (clock != nullptr)
+    {
+        return;
+    }
+    if (wakeTick != 0 && !driver.joinable())
+    {
+        driver = std::thread(&TimerWheel::DriverLoop, this);
+    }
+    wake.notify_one();
+}
+
+void TimerWheel::DriverLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!exiting)
+    {
+        if (driverWake == 0)
+        {
+            wake.wait(guard);
+            continue;
+        }
+        const auto deadline = hostEpoch + std::chrono::microseconds(driverWake * tickUs);
+        if (wake.wait_until(guard, deadline) == std::cv_status::timeout)
+        {
+            guard.unlock();
+            Advance(NowUs());
+            guard.lock();
+        }
+    }
+}
+#endif
+
+WheelTimer::WheelTimer(std::function<void()> _timeout_cb, const std::string &timer_name, TimerWheel &_wheel)
+    : wheel(_wheel), timeout_cb(_timeout_cb), name(timer_name)
+{
+    node.callback = [this]()
+    {
+        if (currentType == ONCE)
+        {
+            currentType = NONE;
+        }
+        if (timeout_cb != nullptr)
+        {
+            timeout_cb();
+        }
+    };
+}
+
+WheelTimer::WheelTimer(const std::string &timer_name, TimerWheel &_wheel) : WheelTimer(nullptr, timer_name, _wheel)
+{
+}
+
+WheelTimer::~WheelTimer()
+{
+    wheel.Stop(node);
+}
+
+/**
+ * @brief Set the Callback function, only while the timer is stopped
+ */
+void WheelTimer::setCallback(std::function<void()> _timeout_cb) noexcept
+{
+    if (_timeout_cb != nullptr && !wheel.IsActive(node))
+    {
+        timeout_cb = _timeout_cb;
+    }
+}
+
+esp_err_t WheelTimer::start(TimerType type)
+{
+    if (timeout_cb == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint64_t us = static_cast<uint64_t>(period.count());
+    esp_err_t ret = wheel.Start(node, us, (type == PERIODIC) ? us : 0);
+    if (ret == ESP_OK)
+    {
+        currentType = type;
+    }
+    else
+    {
+        ESP_LOGE(name.c_str(), "start ERROR %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t WheelTimer::stop() noexcept
+{
+    esp_err_t ret = wheel.Stop(node);
+    currentType = NONE;
+    return ret;
+}
+
+esp_err_t WheelTimer::reset_periodic()
+{
+    return start(PERIODIC); // Start() moves a running node
+}
+
+esp_err_t WheelTimer::reset_once()
+{
+    return start(ONCE);
+}
+
+bool WheelTimer::is_active()
+{
+    return wheel.IsActive(node);
+}
@@ -0,0 +1,298 @@
+/**
+ * @file test_input_scanner.cpp
+ * @brief InputScanner on SimInputBackend : button clicks, level hold, quadrature and bounce replayed on a
+ * manual clock, then the benchmark of 64 inputs : cpu per pass and edge to handler latency on the scanner
+ * thread ( ./host_test/run.sh input_scanner )
+ */
+#include "host_test.hpp"
+#include "input_scanner.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+struct Recorder_t
+{
+    std::vector<InputEvent_t> events;
+    static void Handler(void *ctx, const InputEvent_t &event) { static_cast<Recorder_t *>(ctx)->events.push_back(event); }
+    size_t Count(InputEvent_t::Kind_t kind) const
+    {
+        size_t count = 0;
+        for (const auto &event : events)
+        {
+            count += (event.kind == kind);
+        }
+        return count;
+    }
+};
+
+// one pass per ms, like a busy scanner
+struct Replay_t
+{
+    SimInputBackend backend;
+    InputScanner scanner{backend};
+    uint32_t nowMs = 1000;
+    Replay_t() { backend.SetTime(nowMs); }
+    void RunTo(uint32_t untilMs)
+    {
+        for (; nowMs < untilMs; nowMs++)
+        {
+            backend.SetTime(nowMs);
+            scanner.ScanOnce(nowMs);
+        }
+    }
+    void Run(uint32_t ms) { RunTo(nowMs + ms); }
+};
+
+static void TestButton()
+{
+    Replay_t replay;
+    Recorder_t rec;
+    uint16_t id = InputScanner::NO_DEVICE;
+    CHECK(replay.scanner.AddButton(0, Recorder_t::Handler, &rec, InputButtonConfig_t(), &id) == ESP_OK);
+    CHECK(replay.scanner.AddButton(0, Recorder_t::Handler, &rec) == ESP_ERR_INVALID_STATE);
+    CHECK(replay.scanner.AddButton(InputBackend::MAX_PINS, Recorder_t::Handler, &rec) == ESP_ERR_INVALID_ARG);
+    replay.Run(10);
+
+    // single click : active low, 100 ms press
+    const uint32_t pressMs = replay.backend.NowMs(); // the edge time
+    replay.backend.SetLevel(0, 0);
+    replay.Run(100);
+    CHECK(replay.scanner.GetState(id));
+    replay.backend.SetLevel(0, 1);
+    replay.Run(400);
+    CHECK_EQ(rec.events.size(), 3u);
+    CHECK(rec.events[0].kind == InputEvent_t::PRESSED);
+    CHECK_EQ(rec.events[0].timeMs, pressMs + 50); // debounce
+    CHECK(rec.events[1].kind == InputEvent_t::RELEASED);
+    CHECK(rec.events[2].kind == InputEvent_t::CLICK);
+    CHECK_EQ(rec.events[2].value, 1);
+
+    // double click
+    rec.events.clear();
+    for (int i = 0; i < 2; i++)
+    {
+        replay.backend.SetLevel(0, 0);
+        replay.Run(100);
+        replay.backend.SetLevel(0, 1);
+        replay.Run(100);
+    }
+    replay.Run(400);
+    CHECK_EQ(rec.Count(InputEvent_t::PRESSED), 2u);
+    CHECK_EQ(rec.Count(InputEvent_t::CLICK), 1u);
+    CHECK(!rec.events.empty() && rec.events.back().kind == InputEvent_t::CLICK && rec.events.back().value == 2);
+
+    // long click
+    rec.events.clear();
+    replay.backend.SetLevel(0, 0);
+    replay.Run(400);
+    CHECK_EQ(rec.Count(InputEvent_t::LONG_DETECTED), 1u);
+    replay.backend.SetLevel(0, 1);
+    replay.Run(400);
+    CHECK_EQ(rec.Count(InputEvent_t::LONG_CLICK), 1u);
+    CHECK_EQ(rec.Count(InputEvent_t::CLICK), 0u);
+
+    // contact bounce shorter than the debounce never reaches the handler
+    rec.events.clear();
+    srand(11);
+    bool level = true;
+    for (int i = 0; i < 2000; i++)
+    {
+        level = !level;
+        replay.backend.SetLevel(0, level);
+        replay.Run(1 + rand() % 40);
+    }
+    replay.backend.SetLevel(0, 1);
+    replay.Run(400);
+    CHECK_EQ(rec.events.size(), 0u);
+
+    // removed : the pin is free again and nothing is reported
+    CHECK(replay.scanner.Remove(id) == ESP_OK);
+    CHECK(replay.scanner.Remove(id) == ESP_ERR_NOT_FOUND);
+    replay.backend.SetLevel(0, 0);
+    replay.Run(400);
+    CHECK_EQ(rec.events.size(), 0u);
+    CHECK(replay.scanner.AddButton(0, Recorder_t::Handler, &rec) == ESP_OK);
+}
+
+static void TestLevel()
+{
+    Replay_t replay;
+    Recorder_t rec;
+    InputLevelConfig_t config;
+    config.debounceMs = 80;
+    config.holdMs = 1000;
+    CHECK(replay.scanner.AddLevel(1, Recorder_t::Handler, &rec, config) == ESP_OK);
+    replay.Run(10);
+    // pir : a 10 ms glitch, then two real pulses within the hold time
+    replay.backend.SetLevel(1, 1);
+    replay.Run(10);
+    replay.backend.SetLevel(1, 0);
+    replay.Run(200);
+    CHECK_EQ(rec.events.size(), 0u);
+    for (int i = 0; i < 2; i++)
+    {
+        replay.backend.SetLevel(1, 1);
+        replay.Run(200);
+        replay.backend.SetLevel(1, 0);
+        replay.Run(200);
+    }
+    CHECK_EQ(rec.Count(InputEvent_t::ON), 2u);
+    CHECK_EQ(rec.Count(InputEvent_t::OFF), 2u);
+    CHECK_EQ(rec.Count(InputEvent_t::HOLD_ON), 1u);
+    CHECK_EQ(rec.Count(InputEvent_t::HOLD_OFF), 0u);
+    replay.Run(1000);
+    CHECK_EQ(rec.Count(InputEvent_t::HOLD_OFF), 1u);
+}
+
+static void TestQuadrature()
+{
+    Replay_t replay;
+    Recorder_t rec;
+    CHECK(replay.scanner.AddQuadrature(2, 3, Recorder_t::Handler, &rec) == ESP_OK);
+    CHECK(replay.scanner.AddQuadrature(4, 4, Recorder_t::Handler, &rec) != ESP_OK);
+    replay.Run(10);
+    // pulled up : rests on A = B = 1, one detent is 4 gray code transitions
+    static const uint8_t CW[] = {0b11, 0b01, 0b00, 0b10, 0b11};
+    auto turn = [&](int detents) {
+        for (int d = 0; d < abs(detents); d++)
+        {
+            for (int i = 1; i < 5; i++)
+            {
+                const uint8_t ab = (detents > 0) ? CW[i] : CW[4 - i];
+                replay.backend.SetLevel(2, ab & 2);
+                replay.backend.SetLevel(3, ab & 1);
+                replay.Run(2);
+            }
+        }
+    };
+    turn(3);
+    turn(-2);
+    CHECK_EQ(rec.events.size(), 5u);
+    int position = 0;
+    for (const auto &event : rec.events)
+    {
+        CHECK(event.kind == InputEvent_t::STEP);
+        position += event.value;
+    }
+    CHECK_EQ(position, 1);
+    CHECK(rec.events.size() == 5 && rec.events[2].value == 1 && rec.events[3].value == -1);
+}
+
+static std::atomic<uint64_t> lastPressNs{0};
+static std::atomic<int> presses{0};
+static uint64_t NowNs()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+static void CountPress(void *, const InputEvent_t &event)
+{
+    if (event.kind == InputEvent_t::PRESSED)
+    {
+        lastPressNs = NowNs();
+        presses++;
+    }
+}
+
+static void Benchmark()
+{
+    constexpr int INPUTS = 64;
+    constexpr int PASSES = 2000;
+    {
+        // worst case : every input polled and fed on every pass
+        SimInputBackend backend;
+        backend.SetTime(0);
+        InputScanner scanner(backend);
+        InputButtonConfig_t config;
+        config.interrupt = false;
+        for (int pin = 0; pin < INPUTS; pin++)
+        {
+            CHECK(scanner.AddButton(pin, CountPress, nullptr, config) == ESP_OK);
+        }
+        const double ns = host_test::NsPer(PASSES, [&] {
+            for (uint32_t ms = 0; ms < PASSES; ms++)
+            {
+                backend.SetTime(ms);
+                scanner.ScanOnce(ms);
+            }
+        });
+        printf("64 polled inputs : %.0f ns per pass, %.1f ns per input\n", ns, ns / INPUTS);
+    }
+    {
+        // interrupt inputs at rest : a pass only drains the empty edge ring
+        SimInputBackend backend;
+        backend.SetTime(0);
+        InputScanner scanner(backend);
+        for (int pin = 0; pin < INPUTS; pin++)
+        {
+            CHECK(scanner.AddButton(pin, CountPress, nullptr) == ESP_OK);
+        }
+        const double ns = host_test::NsPer(PASSES, [&] {
+            for (uint32_t ms = 0; ms < PASSES; ms++)
+            {
+                backend.SetTime(ms);
+                scanner.ScanOnce(ms);
+            }
+        });
+        printf("64 idle interrupt inputs : %.0f ns per pass\n", ns);
+    }
+    {
+        // scanner thread asleep on the edge ring, no debounce : edge to PRESSED handler
+        SimInputBackend backend;
+        InputScanner scanner(backend);
+        InputButtonConfig_t config;
+        config.debounceMs = 0;
+        for (int pin = 0; pin < INPUTS; pin++)
+        {
+            CHECK(scanner.AddButton(pin, CountPress, nullptr, config) == ESP_OK);
+        }
+        CHECK(scanner.Start() == ESP_OK);
+        std::this_thread::sleep_for(milliseconds(50));
+        constexpr int EDGES = 200;
+        double totalUs = 0;
+        double maxUs = 0;
+        int missed = 0;
+        for (int i = 0; i < EDGES; i++)
+        {
+            const int pin = i % INPUTS;
+            const int before = presses.load();
+            const uint64_t start = NowNs();
+            backend.SetLevel(pin, 0);
+            const auto deadline = steady_clock::now() + seconds(1);
+            while (presses.load() == before && steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+            if (presses.load() == before)
+            {
+                missed++;
+            }
+            else
+            {
+                const double us = (lastPressNs.load() - start) / 1000.0;
+                totalUs += us;
+                maxUs = (us > maxUs) ? us : maxUs;
+            }
+            backend.SetLevel(pin, 1);
+            std::this_thread::sleep_for(milliseconds(2));
+        }
+        const InputScanner::Stats_t stats = scanner.GetStats();
+        printf("edge to handler : %.1f us average, %.1f us max over %d edges ( %u passes, longest %u us )\n",
+               totalUs / EDGES, maxUs, EDGES, stats.scans, stats.maxScanUs);
+        CHECK_EQ(missed, 0);
+        CHECK_EQ(stats.edgesDropped, 0u);
+        CHECK(scanner.Stop() == ESP_OK);
+    }
+}
+
+int main()
+{
+    TestButton();
+    TestLevel();
+    TestQuadrature();
+    Benchmark();
+    HOST_TEST_END();
+}
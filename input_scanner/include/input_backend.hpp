@@ -0,0 +1,103 @@
+#ifndef __INPUT_BACKEND_H__
+#define __INPUT_BACKEND_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include <atomic>
+#include <cstdint>
+
+#ifdef ESP_PLATFORM
+#include "driver/gpio.h"
+#endif
+
+/**
+ * @brief where the InputScanner reads its pins : every level in one 64 bits read,
+ * optionally an edge hook ( called from the GPIO ISR on target ) to wake the scanner, and the clock
+ */
+class InputBackend
+{
+public:
+    static constexpr uint8_t MAX_PINS = 64;
+    enum Pull_t : uint8_t
+    {
+        PULL_NONE,
+        PULL_UP,
+        PULL_DOWN,
+    };
+    // edge on \c pin, \c level sampled at the edge
+    using EdgeHook_t = void (*)(void *ctx, uint8_t pin, bool level, bool fromIsr);
+
+    virtual ~InputBackend() = default;
+    /**
+     * @brief set the pin as input
+     *
+     * @param interrupt report edges through the hook, else the pin is only polled
+     */
+    virtual esp_err_t ConfigurePin(uint8_t pin, Pull_t pull, bool interrupt) = 0;
+    // stop reporting the edges of \c pin
+    virtual void ReleasePin(uint8_t pin) {}
+    // bit n : level of pin n
+    virtual uint64_t ReadLevels() = 0;
+    // time base of the passes and edges, esp_timer ( steady clock on host ), ISR safe
+    virtual uint32_t NowMs();
+
+    void SetEdgeHook(EdgeHook_t hook, void *ctx)
+    {
+        edgeCtx = ctx;
+        edgeHook = hook;
+    }
+
+protected:
+    EdgeHook_t edgeHook = nullptr;
+    void *edgeCtx = nullptr;
+};
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief GPIO matrix backend : levels straight from the GPIO_IN registers, edges from the shared GPIO ISR service
+ */
+class GpioInputBackend : public InputBackend
+{
+public:
+    GpioInputBackend() = default;
+    ~GpioInputBackend();
+    esp_err_t ConfigurePin(uint8_t pin, Pull_t pull, bool interrupt) override;
+    void ReleasePin(uint8_t pin) override;
+    uint64_t ReadLevels() override;
+
+private:
+    struct PinArg_t
+    {
+        GpioInputBackend *self;
+        uint8_t pin;
+    };
+    static void IRAM_ATTR Isr(void *arg);
+    PinArg_t args[GPIO_NUM_MAX] = {};
+    uint64_t isrPins = 0;
+};
+#endif
+
+/**
+ * @brief simulated pins for host builds and replays : SetLevel() is the "hardware", an edge on an
+ * interrupt pin calls the hook like the ISR would
+ */
+class SimInputBackend : public InputBackend
+{
+public:
+    esp_err_t ConfigurePin(uint8_t pin, Pull_t pull, bool interrupt) override;
+    void ReleasePin(uint8_t pin) override;
+    uint64_t ReadLevels() override { return levels.load(std::memory_order_acquire); }
+    void SetLevel(uint8_t pin, bool level);
+    uint32_t NowMs() override;
+    // replay : the clock stops at \c ms and only moves with the next SetTime()
+    void SetTime(uint32_t ms);
+
+private:
+    std::atomic<uint64_t> levels{0};
+    std::atomic<bool> manualClock{false};
+    std::atomic<uint32_t> manualMs{0};
+    std::atomic<uint64_t> isrPins{0};
+};
+
+#endif // __INPUT_BACKEND_H__
@@ -0,0 +1,235 @@
+#ifndef __INPUT_SCANNER_H__
+#define __INPUT_SCANNER_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "input_backend.hpp"
+#include "mpmc_queue.hpp"
+#include "_pthread.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <condition_variable>
+#endif
+
+#ifndef CONFIG_INPUT_SCANNER_PERIOD_MS
+#define CONFIG_INPUT_SCANNER_PERIOD_MS 10
+#endif
+#ifndef CONFIG_INPUT_SCANNER_EDGE_QUEUE_SIZE
+#define CONFIG_INPUT_SCANNER_EDGE_QUEUE_SIZE 64
+#endif
+#ifndef CONFIG_INPUT_SCANNER_TASK_STACK
+#define CONFIG_INPUT_SCANNER_TASK_STACK 3072
+#endif
+#ifndef CONFIG_INPUT_SCANNER_TASK_PRIORITY
+#define CONFIG_INPUT_SCANNER_TASK_PRIORITY 5
+#endif
+
+// what a device reports, see InputScanner
+struct InputEvent_t
+{
+    enum Kind_t : uint8_t
+    {
+        PRESSED,       // button : debounced press
+        RELEASED,      // button : debounced release
+        CLICK,         // button : \c value clicks ( 1, 2, 3 .. ) once the double click gap elapsed
+        LONG_DETECTED, // button : still pressed after the long click time
+        LONG_CLICK,    // button : single click that was a long one
+        ON,            // level : debounced active level
+        OFF,           // level : debounced inactive level
+        HOLD_ON,       // level with hold : became active
+        HOLD_OFF,      // level with hold : inactive for the whole hold time
+        STEP,          // quadrature : \c value detents ( +1 / -1 )
+    };
+    uint16_t device;
+    Kind_t kind;
+    int8_t value;
+    uint32_t timeMs;
+};
+
+struct InputButtonConfig_t
+{
+    uint16_t debounceMs = 50;
+    uint16_t longMs = 200;
+    uint16_t gapMs = 300; // double click window
+    bool activeLow = true;
+    InputBackend::Pull_t pull = InputBackend::PULL_UP;
+    bool interrupt = true;
+};
+struct InputLevelConfig_t
+{
+    uint16_t debounceMs = 50;
+    uint32_t holdMs = 0; // 0 : no HOLD_ON / HOLD_OFF
+    bool activeLow = false;
+    InputBackend::Pull_t pull = InputBackend::PULL_NONE;
+    bool interrupt = true;
+};
+struct InputQuadratureConfig_t
+{
+    uint8_t stepsPerDetent = 4; // gray code transitions per STEP event
+    InputBackend::Pull_t pull = InputBackend::PULL_UP;
+    bool interrupt = true;
+};
+
+/**
+ * @brief one task for every button, level input ( PIR, switch ) and quadrature encoder.
+ * a pass reads all the pins in one InputBackend::ReadLevels() and runs the per-device state machine
+ * ( debounce, click count, long press, hold timeout, quadrature decoding ) on a compact Device_t.
+ * interrupt pins push their edges into a lock-free ring from the ISR and wake the task :
+ * it only ticks every CONFIG_INPUT_SCANNER_PERIOD_MS while a device is busy ( debouncing, counting clicks .. )
+ * or a pin is polled, otherwise it sleeps until the next edge.
+ * handlers run on the scanner task, after the pass, they must stay short.
+ *
+ *  InputScanner::Default().AddButton(0, [](void *ctx, const InputEvent_t &e) { ... }, this);
+ */
+class InputScanner
+{
+public:
+    using Handler_t = void (*)(void *ctx, const InputEvent_t &event);
+    using Pull_t = InputBackend::Pull_t;
+    using ButtonConfig_t = InputButtonConfig_t;
+    using LevelConfig_t = InputLevelConfig_t;
+    using QuadratureConfig_t = InputQuadratureConfig_t;
+    struct Stats_t
+    {
+        uint32_t scans;        // passes
+        uint32_t events;       // handler calls
+        uint32_t edges;        // edges from the ring
+        uint32_t edgesDropped; // ring full, the level was caught by the next pass
+        uint32_t maxScanUs;    // longest pass, handlers excluded
+    };
+    static constexpr uint16_t NO_DEVICE = 0xFFFF;
+
+    explicit InputScanner(InputBackend &backend, uint32_t periodMs = CONFIG_INPUT_SCANNER_PERIOD_MS);
+    ~InputScanner();
+    InputScanner(const InputScanner &) = delete;
+    InputScanner &operator=(const InputScanner &) = delete;
+
+    // scanner on the GPIO backend ( simulated pins on host ), started on first use
+    static InputScanner &Default();
+
+    /**
+     * @brief register a device, its pins are configured through the backend
+     *
+     * @param id device id written back, it is InputEvent_t::device
+     * @return esp_err_t ESP_ERR_INVALID_ARG bad pin or no handler, ESP_ERR_INVALID_STATE pin already used
+     */
+    esp_err_t AddButton(uint8_t pin, Handler_t handler, void *ctx, const ButtonConfig_t &config = ButtonConfig_t(), uint16_t *id = nullptr);
+    esp_err_t AddLevel(uint8_t pin, Handler_t handler, void *ctx, const LevelConfig_t &config = LevelConfig_t(), uint16_t *id = nullptr);
+    esp_err_t AddQuadrature(uint8_t pinA, uint8_t pinB, Handler_t handler, void *ctx, const QuadratureConfig_t &config = QuadratureConfig_t(), uint16_t *id = nullptr);
+    // the pins are released, the id is not reused
+    esp_err_t Remove(uint16_t id);
+    esp_err_t SetHold(uint16_t id, uint32_t holdMs);
+    // debounced state : pressed / active
+    bool GetState(uint16_t id);
+
+    esp_err_t Start(const char *name = "input", int stack = CONFIG_INPUT_SCANNER_TASK_STACK, int prio = CONFIG_INPUT_SCANNER_TASK_PRIORITY, int core = 0);
+    esp_err_t Stop();
+
+    /**
+     * @brief one pass at \c nowMs : drain the edge ring, read the levels, run the state machines, call the handlers.
+     * the scanner task calls it, replays and tests may call it directly ( without Start() )
+     *
+     * @return true a device is busy : the next pass should come within the period
+     */
+    bool ScanOnce(uint32_t nowMs);
+
+    Stats_t GetStats();
+    void ResetStats();
+
+private:
+    enum Type_t : uint8_t
+    {
+        TYPE_NONE,
+        TYPE_BUTTON,
+        TYPE_LEVEL,
+        TYPE_QUADRATURE,
+    };
+    // 40 bytes on target
+    struct Device_t
+    {
+        Handler_t handler;
+        void *ctx;
+        uint32_t changeMs; // last raw change
+        uint32_t markMs;   // button : press start, level : last time active
+        uint32_t clickMs;  // button : last release
+        uint32_t holdMs;
+        uint16_t debounceMs;
+        uint16_t longMs;
+        uint16_t gapMs;
+        Type_t type;
+        uint8_t pinA;
+        uint8_t pinB;
+        uint8_t clicks;
+        int8_t steps;      // quadrature : transitions not reported yet
+        uint8_t quad : 2;  // quadrature : last A B
+        uint8_t detent : 3;
+        bool activeLow : 1;
+        bool raw : 1;      // last sample, active high
+        bool stable : 1;   // debounced
+        bool longSeen : 1; // button : LONG_DETECTED sent for this press
+        bool longPress : 1;
+        bool hold : 1;
+        bool polled : 1;
+    };
+    struct Edge_t
+    {
+        uint32_t timeMs;
+        uint8_t pin;
+        bool level;
+    };
+
+    esp_err_t Add(Device_t &device, Pull_t pull, bool interrupt, uint16_t *id);
+    void Feed(uint16_t id, Device_t &device, uint64_t levels, uint32_t nowMs);
+    void FeedEdge(const Edge_t &edge);
+    void FeedButton(uint16_t id, Device_t &device, bool active, uint32_t nowMs);
+    void FeedLevel(uint16_t id, Device_t &device, bool active, uint32_t nowMs);
+    void FeedQuadrature(uint16_t id, Device_t &device, uint8_t ab, uint32_t nowMs);
+    static bool Busy(const Device_t &device);
+    void Emit(uint16_t id, InputEvent_t::Kind_t kind, int8_t value, uint32_t nowMs);
+    static void OnEdge(void *ctx, uint8_t pin, bool level, bool fromIsr);
+    void Wake(bool fromIsr);
+    void WaitWake(uint32_t timeoutMs); // UINT32_MAX : until woken
+    void TaskLoop();
+
+    InputBackend &backend;
+    const uint32_t periodMs;
+    std::mutex passLock; // one pass at a time, handlers included
+    std::mutex lock;     // devices
+    std::vector<Device_t> devices;
+    uint16_t pinDevice[InputBackend::MAX_PINS];
+    uint32_t polledCount = 0;
+    idf::MPMCQueue<Edge_t> edges;
+    struct Pending_t
+    {
+        Handler_t handler;
+        void *ctx;
+        InputEvent_t event;
+    };
+    std::vector<Pending_t> pending;  // pass output, filled under the lock
+    std::vector<Pending_t> dispatch; // swapped with pending, handlers called without the lock
+
+    std::unique_ptr<AladinPthread_t> thread{nullptr};
+    std::atomic<bool> exiting{false};
+#ifdef ESP_PLATFORM
+    std::atomic<TaskHandle_t> taskHandle{nullptr};
+#else
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    bool woken = false;
+#endif
+
+    Stats_t stats{};
+    std::atomic<uint32_t> edgeCount{0};
+    std::atomic<uint32_t> edgeDropped{0};
+};
+
+#endif // __INPUT_SCANNER_H__
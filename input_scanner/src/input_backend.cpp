@@ -0,0 +1,149 @@
+#include "input_backend.hpp"
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#else
+#include <chrono>
+#endif
+
+uint32_t InputBackend::NowMs()
+{
+#ifdef ESP_PLATFORM
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+#else
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+#ifdef ESP_PLATFORM
+
+GpioInputBackend::~GpioInputBackend()
+{
+    for (uint8_t pin = 0; pin < GPIO_NUM_MAX; pin++)
+    {
+        ReleasePin(pin);
+    }
+}
+
+esp_err_t GpioInputBackend::ConfigurePin(uint8_t pin, Pull_t pull, bool interrupt)
+{
+    if (!GPIO_IS_VALID_GPIO(pin))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_config_t io_conf = {};
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.intr_type = interrupt ? GPIO_INTR_ANYEDGE : GPIO_INTR_DISABLE;
+    io_conf.pin_bit_mask = (1ULL << pin);
+    io_conf.pull_up_en = (pull == PULL_UP) ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE;
+    io_conf.pull_down_en = (pull == PULL_DOWN) ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE;
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK || !interrupt)
+    {
+        return ret;
+    }
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) // already installed by another component
+    {
+        return ret;
+    }
+    args[pin] = {this, pin};
+    ret = gpio_isr_handler_add(static_cast<gpio_num_t>(pin), Isr, &args[pin]);
+    if (ret == ESP_OK)
+    {
+        isrPins |= (1ULL << pin);
+    }
+    return ret;
+}
+
+void GpioInputBackend::ReleasePin(uint8_t pin)
+{
+    if (pin < GPIO_NUM_MAX && (isrPins & (1ULL << pin)))
+    {
+        gpio_isr_handler_remove(static_cast<gpio_num_t>(pin));
+        isrPins &= ~(1ULL << pin);
+    }
+}
+
+/**
+ * @brief every input level in two register reads
+ */
+uint64_t GpioInputBackend::ReadLevels()
+{
+    uint64_t levels = REG_READ(GPIO_IN_REG);
+#ifdef GPIO_IN1_REG
+    levels |= static_cast<uint64_t>(REG_READ(GPIO_IN1_REG)) << 32;
+#endif
+    return levels;
+}
+
+void IRAM_ATTR GpioInputBackend::Isr(void *arg)
+{
+    PinArg_t *pinArg = static_cast<PinArg_t *>(arg);
+    GpioInputBackend *self = pinArg->self;
+    if (self->edgeHook != nullptr)
+    {
+        self->edgeHook(self->edgeCtx, pinArg->pin, gpio_get_level(static_cast<gpio_num_t>(pinArg->pin)) != 0, true);
+    }
+}
+#endif
+
+/**
+ * @brief a pulled up pin idles high, like the real one
+ */
+esp_err_t SimInputBackend::ConfigurePin(uint8_t pin, Pull_t pull, bool interrupt)
+{
+    if (pin >= MAX_PINS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (pull == PULL_UP)
+    {
+        levels.fetch_or(1ULL << pin, std::memory_order_acq_rel);
+    }
+    else if (pull == PULL_DOWN)
+    {
+        levels.fetch_and(~(1ULL << pin), std::memory_order_acq_rel);
+    }
+    if (interrupt)
+    {
+        isrPins.fetch_or(1ULL << pin, std::memory_order_acq_rel);
+    }
+    return ESP_OK;
+}
+
+void SimInputBackend::ReleasePin(uint8_t pin)
+{
+    if (pin < MAX_PINS)
+    {
+        isrPins.fetch_and(~(1ULL << pin), std::memory_order_acq_rel);
+    }
+}
+
+void SimInputBackend::SetLevel(uint8_t pin, bool level)
+{
+    if (pin >= MAX_PINS)
+    {
+        return;
+    }
+    const uint64_t bit = 1ULL << pin;
+    const uint64_t previous = level ? levels.fetch_or(bit, std::memory_order_acq_rel) : levels.fetch_and(~bit, std::memory_order_acq_rel);
+    const bool changed = ((previous & bit) != 0) != level;
+    if (changed && (isrPins.load(std::memory_order_acquire) & bit) && edgeHook != nullptr)
+    {
+        edgeHook(edgeCtx, pin, level, false);
+    }
+}
+
+uint32_t SimInputBackend::NowMs()
+{
+    return manualClock.load(std::memory_order_acquire) ? manualMs.load(std::memory_order_acquire) : InputBackend::NowMs();
+}
+
+void SimInputBackend::SetTime(uint32_t ms)
+{
+    manualMs.store(ms, std::memory_order_release);
+    manualClock.store(true, std::memory_order_release);
+}
@@ -0,0 +1,533 @@
+#include "input_scanner.hpp"
+#include "esp_log.h"
+#include <chrono>
+#include <thread>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#endif
+
+static const char TAG[] = "InputScanner";
+
+static uint64_t NowUs()
+{
+#ifdef ESP_PLATFORM
+    return static_cast<uint64_t>(esp_timer_get_time());
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// wrap safe, 0 if \c since is ahead ( an edge stamped after the pass started )
+static inline uint32_t Elapsed(uint32_t now, uint32_t since)
+{
+    return (static_cast<int32_t>(now - since) > 0) ? (now - since) : 0;
+}
+
+// gray code transition ( previous A B << 2 | new A B ) -> step, +1 when A leads B
+static constexpr int8_t QUADRATURE_TABLE[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+
+InputScanner::InputScanner(InputBackend &_backend, uint32_t _periodMs)
+    : backend(_backend), periodMs(_periodMs ? _periodMs : 1), edges(CONFIG_INPUT_SCANNER_EDGE_QUEUE_SIZE)
+{
+    for (auto &id : pinDevice)
+    {
+        id = NO_DEVICE;
+    }
+    devices.reserve(16);
+    pending.reserve(16);
+    dispatch.reserve(16);
+    backend.SetEdgeHook(OnEdge, this);
+}
+
+InputScanner::~InputScanner()
+{
+    Stop();
+    backend.SetEdgeHook(nullptr, nullptr);
+}
+
+InputScanner &InputScanner::Default()
+{
+#ifdef ESP_PLATFORM
+    static GpioInputBackend defaultBackend;
+#else
+    static SimInputBackend defaultBackend;
+#endif
+    static InputScanner defaultScanner(defaultBackend);
+    static const esp_err_t started = defaultScanner.Start();
+    (void)started;
+    return defaultScanner;
+}
+
+esp_err_t InputScanner::Add(Device_t &device, Pull_t pull, bool interrupt, uint16_t *id)
+{
+    const bool twoPins = device.type == TYPE_QUADRATURE;
+    if (device.handler == nullptr || device.pinA >= InputBackend::MAX_PINS || (twoPins && (device.pinB >= InputBackend::MAX_PINS || device.pinB == device.pinA)))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (devices.size() >= NO_DEVICE || pinDevice[device.pinA] != NO_DEVICE || (twoPins && pinDevice[device.pinB] != NO_DEVICE))
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        esp_err_t ret = backend.ConfigurePin(device.pinA, pull, interrupt);
+        if (ret == ESP_OK && twoPins)
+        {
+            ret = backend.ConfigurePin(device.pinB, pull, interrupt);
+        }
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "pin %d config ERROR %s", device.pinA, esp_err_to_name(ret));
+            return ret;
+        }
+        const uint64_t levels = backend.ReadLevels();
+        const bool active = ((levels >> device.pinA) & 1) != device.activeLow;
+        device.raw = device.stable = active;
+        device.quad = (((levels >> device.pinA) & 1) << 1) | ((levels >> device.pinB) & 1);
+        device.changeMs = device.markMs = device.clickMs = backend.NowMs();
+        device.polled = !interrupt;
+        if (device.polled)
+        {
+            polledCount++;
+        }
+        const uint16_t index = static_cast<uint16_t>(devices.size());
+        devices.push_back(device);
+        pinDevice[device.pinA] = index;
+        if (twoPins)
+        {
+            pinDevice[device.pinB] = index;
+        }
+        if (pending.capacity() < devices.size() * 2)
+        {
+            pending.reserve(devices.size() * 2);
+            dispatch.reserve(devices.size() * 2);
+        }
+        if (id != nullptr)
+        {
+            *id = index;
+        }
+    }
+    Wake(false);
+    return ESP_OK;
+}
+
+esp_err_t InputScanner::AddButton(uint8_t pin, Handler_t handler, void *ctx, const ButtonConfig_t &config, uint16_t *id)
+{
+    Device_t device{};
+    device.type = TYPE_BUTTON;
+    device.handler = handler;
+    device.ctx = ctx;
+    device.pinA = device.pinB = pin;
+    device.debounceMs = config.debounceMs;
+    device.longMs = config.longMs;
+    device.gapMs = config.gapMs;
+    device.activeLow = config.activeLow;
+    return Add(device, config.pull, config.interrupt, id);
+}
+
+esp_err_t InputScanner::AddLevel(uint8_t pin, Handler_t handler, void *ctx, const LevelConfig_t &config, uint16_t *id)
+{
+    Device_t device{};
+    device.type = TYPE_LEVEL;
+    device.handler = handler;
+    device.ctx = ctx;
+    device.pinA = device.pinB = pin;
+    device.debounceMs = config.debounceMs;
+    device.holdMs = config.holdMs;
+    device.activeLow = config.activeLow;
+    return Add(device, config.pull, config.interrupt, id);
+}
+
+esp_err_t InputScanner::AddQuadrature(uint8_t pinA, uint8_t pinB, Handler_t handler, void *ctx, const QuadratureConfig_t &config, uint16_t *id)
+{
+    Device_t device{};
+    device.type = TYPE_QUADRATURE;
+    device.handler = handler;
+    device.ctx = ctx;
+    device.pinA = pinA;
+    device.pinB = pinB;
+    device.detent = (config.stepsPerDetent == 0) ? 1 : ((config.stepsPerDetent > 7) ? 7 : config.stepsPerDetent);
+    return Add(device, config.pull, config.interrupt, id);
+}
+
+esp_err_t InputScanner::Remove(uint16_t id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (id >= devices.size() || devices[id].type == TYPE_NONE)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    Device_t &device = devices[id];
+    backend.ReleasePin(device.pinA);
+    pinDevice[device.pinA] = NO_DEVICE;
+    if (device.type == TYPE_QUADRATURE)
+    {
+        backend.ReleasePin(device.pinB);
+        pinDevice[device.pinB] = NO_DEVICE;
+    }
+    if (device.polled)
+    {
+        polledCount--;
+    }
+    device.type = TYPE_NONE;
+    return ESP_OK;
+}
+
+esp_err_t InputScanner::SetHold(uint16_t id, uint32_t holdMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (id >= devices.size() || devices[id].type != TYPE_LEVEL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    devices[id].holdMs = holdMs;
+    return ESP_OK;
+}
+
+bool InputScanner::GetState(uint16_t id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return (id < devices.size()) ? devices[id].stable : false;
+}
+
+void InputScanner::Emit(uint16_t id, InputEvent_t::Kind_t kind, int8_t value, uint32_t nowMs)
+{
+    const Device_t &device = devices[id];
+    pending.push_back(Pending_t{device.handler, device.ctx, InputEvent_t{id, kind, value, nowMs}});
+}
+
+/**
+ * @brief debounce, then click counting : CLICK ( or LONG_CLICK ) is sent once no new press came within the gap
+ */
+void InputScanner::FeedButton(uint16_t id, Device_t &device, bool active, uint32_t nowMs)
+{
+    if (active != device.raw)
+    {
+        device.raw = active;
+        device.changeMs = nowMs;
+    }
+    if (device.raw != device.stable && Elapsed(nowMs, device.changeMs) >= device.debounceMs)
+    {
+        device.stable = device.raw;
+        if (device.stable)
+        {
+            device.markMs = device.changeMs;
+            device.longSeen = false;
+            if (device.clicks < UINT8_MAX)
+            {
+                device.clicks++;
+            }
+            Emit(id, InputEvent_t::PRESSED, 0, nowMs);
+        }
+        else
+        {
+            if (Elapsed(device.changeMs, device.markMs) >= device.longMs)
+            {
+                device.longPress = true;
+            }
+            device.clickMs = device.changeMs;
+            Emit(id, InputEvent_t::RELEASED, 0, nowMs);
+        }
+    }
+    if (device.stable && !device.longSeen && Elapsed(nowMs, device.markMs) >= device.longMs)
+    {
+        device.longSeen = true;
+        Emit(id, InputEvent_t::LONG_DETECTED, 0, nowMs);
+    }
+    if (!device.stable && !device.raw && device.clicks > 0 && Elapsed(nowMs, device.clickMs) >= device.gapMs)
+    {
+        if (!device.longPress)
+        {
+            Emit(id, InputEvent_t::CLICK, static_cast<int8_t>(device.clicks > INT8_MAX ? INT8_MAX : device.clicks), nowMs);
+        }
+        else if (device.clicks == 1) // a long press inside a multi click is not reported
+        {
+            Emit(id, InputEvent_t::LONG_CLICK, 1, nowMs);
+        }
+        device.clicks = 0;
+        device.longPress = false;
+    }
+}
+
+/**
+ * @brief debounce, then the hold : HOLD_ON on the first active level, HOLD_OFF once inactive for holdMs
+ */
+void InputScanner::FeedLevel(uint16_t id, Device_t &device, bool active, uint32_t nowMs)
+{
+    if (active != device.raw)
+    {
+        device.raw = active;
+        device.changeMs = nowMs;
+    }
+    if (device.raw != device.stable && Elapsed(nowMs, device.changeMs) >= device.debounceMs)
+    {
+        device.stable = device.raw;
+        device.markMs = device.changeMs;
+        Emit(id, device.stable ? InputEvent_t::ON : InputEvent_t::OFF, 0, nowMs);
+        if (device.stable && device.holdMs > 0 && !device.hold)
+        {
+            device.hold = true;
+            Emit(id, InputEvent_t::HOLD_ON, 0, nowMs);
+        }
+    }
+    if (device.hold && !device.stable && Elapsed(nowMs, device.markMs) >= device.holdMs)
+    {
+        device.hold = false;
+        Emit(id, InputEvent_t::HOLD_OFF, 0, nowMs);
+    }
+}
+
+void InputScanner::FeedQuadrature(uint16_t id, Device_t &device, uint8_t ab, uint32_t nowMs)
+{
+    if (ab == device.quad)
+    {
+        return;
+    }
+    device.steps += QUADRATURE_TABLE[(device.quad << 2) | ab];
+    device.quad = ab;
+    if (device.steps >= device.detent)
+    {
+        device.steps -= device.detent;
+        Emit(id, InputEvent_t::STEP, 1, nowMs);
+    }
+    else if (device.steps <= -device.detent)
+    {
+        device.steps += device.detent;
+        Emit(id, InputEvent_t::STEP, -1, nowMs);
+    }
+}
+
+void InputScanner::Feed(uint16_t id, Device_t &device, uint64_t levels, uint32_t nowMs)
+{
+    switch (device.type)
+    {
+    case TYPE_BUTTON:
+        FeedButton(id, device, ((levels >> device.pinA) & 1) != device.activeLow, nowMs);
+        break;
+    case TYPE_LEVEL:
+        FeedLevel(id, device, ((levels >> device.pinA) & 1) != device.activeLow, nowMs);
+        break;
+    case TYPE_QUADRATURE:
+        FeedQuadrature(id, device, (((levels >> device.pinA) & 1) << 1) | ((levels >> device.pinB) & 1), nowMs);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief an edge carries the level at ISR time : the quadrature decoder sees every transition even between passes
+ */
+void InputScanner::FeedEdge(const Edge_t &edge)
+{
+    const uint16_t id = pinDevice[edge.pin];
+    if (id == NO_DEVICE)
+    {
+        return;
+    }
+    Device_t &device = devices[id];
+    const uint32_t timeMs = (Elapsed(edge.timeMs, device.changeMs) > 0) ? edge.timeMs : device.changeMs;
+    switch (device.type)
+    {
+    case TYPE_BUTTON:
+        FeedButton(id, device, edge.level != device.activeLow, timeMs);
+        break;
+    case TYPE_LEVEL:
+        FeedLevel(id, device, edge.level != device.activeLow, timeMs);
+        break;
+    case TYPE_QUADRATURE:
+        FeedQuadrature(id, device, (edge.pin == device.pinA) ? ((edge.level << 1) | (device.quad & 1)) : ((device.quad & 2) | edge.level), timeMs);
+        break;
+    default:
+        break;
+    }
+}
+
+bool InputScanner::Busy(const Device_t &device)
+{
+    switch (device.type)
+    {
+    case TYPE_BUTTON:
+        return device.raw != device.stable || (device.stable ? !device.longSeen : device.clicks > 0);
+    case TYPE_LEVEL:
+        return device.raw != device.stable || (device.hold && !device.stable);
+    default:
+        return false;
+    }
+}
+
+bool InputScanner::ScanOnce(uint32_t nowMs)
+{
+    std::lock_guard<std::mutex> passGuard(passLock);
+    bool busy = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const uint64_t startUs = NowUs();
+        Edge_t edge;
+        while (edges.try_pop(edge))
+        {
+            stats.edges++;
+            FeedEdge(edge);
+        }
+        // an edge lost on a full ring : every device looks at this sample
+        const uint32_t dropped = edgeDropped.load(std::memory_order_relaxed);
+        const bool all = dropped != stats.edgesDropped;
+        stats.edgesDropped = dropped;
+        const uint64_t levels = backend.ReadLevels();
+        for (uint16_t id = 0; id < devices.size(); id++)
+        {
+            Device_t &device = devices[id];
+            if (device.type == TYPE_NONE)
+            {
+                continue;
+            }
+            if (all || device.polled || Busy(device))
+            {
+                Feed(id, device, levels, nowMs);
+            }
+            busy |= device.polled || Busy(device);
+        }
+        stats.scans++;
+        stats.events += pending.size();
+        const uint32_t scanUs = static_cast<uint32_t>(NowUs() - startUs);
+        if (scanUs > stats.maxScanUs)
+        {
+            stats.maxScanUs = scanUs;
+        }
+        dispatch.clear();
+        dispatch.swap(pending);
+    }
+    for (const auto &item : dispatch)
+    {
+        item.handler(item.ctx, item.event);
+    }
+    return busy;
+}
+
+void InputScanner::OnEdge(void *ctx, uint8_t pin, bool level, bool fromIsr)
+{
+    InputScanner *self = static_cast<InputScanner *>(ctx);
+    if (!self->edges.try_push(Edge_t{self->backend.NowMs(), pin, level}))
+    {
+        self->edgeDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    self->Wake(fromIsr);
+}
+
+#ifdef ESP_PLATFORM
+void InputScanner::Wake(bool fromIsr)
+{
+    TaskHandle_t handle = taskHandle.load(std::memory_order_acquire);
+    if (handle == nullptr)
+    {
+        return;
+    }
+    if (fromIsr)
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(handle, &woken);
+        if (woken == pdTRUE)
+        {
+            portYIELD_FROM_ISR();
+        }
+    }
+    else
+    {
+        xTaskNotifyGive(handle);
+    }
+}
+
+void InputScanner::WaitWake(uint32_t timeoutMs)
+{
+    const TickType_t ticks = (timeoutMs == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    ulTaskNotifyTake(pdTRUE, ticks ? ticks : 1);
+}
+#else
+void InputScanner::Wake(bool fromIsr)
+{
+    std::lock_guard<std::mutex> guard(wakeLock);
+    woken = true;
+    wake.notify_one();
+}
+
+void InputScanner::WaitWake(uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> guard(wakeLock);
+    if (timeoutMs == UINT32_MAX)
+    {
+        wake.wait(guard, [this]()
+                  { return woken; });
+    }
+    else
+    {
+        wake.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this]()
+                      { return woken; });
+    }
+    woken = false;
+}
+#endif
+
+/**
+ * @brief sleeps until an edge while nothing is busy, ticks at the scan period otherwise
+ */
+void InputScanner::TaskLoop()
+{
+#ifdef ESP_PLATFORM
+    taskHandle.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+#endif
+    while (!exiting)
+    {
+        const bool busy = ScanOnce(backend.NowMs());
+        WaitWake(busy ? periodMs : UINT32_MAX);
+    }
+#ifdef ESP_PLATFORM
+    taskHandle.store(nullptr, std::memory_order_release);
+#endif
+}
+
+esp_err_t InputScanner::Start(const char *name, int stack, int prio, int core)
+{
+    if (thread != nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    exiting = false;
+    thread = std::make_unique<AladinPthread_t>(name, core, stack, prio, &InputScanner::TaskLoop, this);
+    return ESP_OK;
+}
+
+esp_err_t InputScanner::Stop()
+{
+    if (thread == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    exiting = true;
+#ifdef ESP_PLATFORM
+    while (thread->Joinable() && taskHandle.load(std::memory_order_acquire) == nullptr)
+    {
+        std::this_thread::yield(); // the loop has not published its handle yet
+    }
+#endif
+    Wake(false);
+    thread->Join();
+    thread.reset();
+    return ESP_OK;
+}
+
+InputScanner::Stats_t InputScanner::GetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Stats_t ret = stats;
+    ret.edgesDropped = edgeDropped.load(std::memory_order_relaxed);
+    return ret;
+}
+
+void InputScanner::ResetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stats = Stats_t{};
+    stats.edgesDropped = edgeDropped.load(std::memory_order_relaxed); // keeps the "new drop" detection of ScanOnce()
+}
@@ -14,33 +14,28 @@
 #define MQTT_H
 #include "config.hpp"
 #include "system.hpp"
+#include "spsc_ring.hpp"
+#include "publish_coalescer.hpp"
 #include "esp_attr.h"
 #include "esp_system.h"
 #include "mqtt_client.h"
 #include <esp_types.h>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <list>
+#include <atomic>
+#include <chrono>
 #define _DEVICENAME "rami"
+#ifndef CONFIG_MQTT_RECEIVE_RING_SIZE
+#define CONFIG_MQTT_RECEIVE_RING_SIZE 4096
+#endif
+#ifndef CONFIG_MQTT_COALESCE_WINDOW_MS
+#define CONFIG_MQTT_COALESCE_WINDOW_MS 200
+#endif
 class Mqtt;
 extern std::shared_ptr<Mqtt> MqttClass;
 
-class MqttStringConstruct
-{
-public:
-	explicit MqttStringConstruct(const char* _topic, const std::size_t topicLen, const char* _data, const std::size_t dataLen) : data(std::string(_data, dataLen)),
-		topic(std::string(_topic, topicLen))
-	{
-	}
-	MqttStringConstruct() = delete;
-	MqttStringConstruct(const MqttStringConstruct&) = delete;
-	MqttStringConstruct(MqttStringConstruct&) = delete;
-	MqttStringConstruct(MqttStringConstruct&&) = delete;
-	const std::string data;
-	const std::string topic;
-};
-
-
 class Mqtt
 {
 private:
@@ -55,7 +50,13 @@ private:
 		esp_mqtt_client_handle_t clentAPIHandle;
 		esp_mqtt_client_config_t activeAPIConfig;
 	} MqttUserConfig;
-	QueueHandle_t mqttRecieveDataQueue{ nullptr };
+	// received topic + payload, copied inline by the mqtt task and read in place by the consumer
+	SpscByteRing<CONFIG_MQTT_RECEIVE_RING_SIZE> receiveRing;
+	// state / retained messages waiting for the flush window, latest value per topic
+	PublishCoalescer outbox;
+	std::unique_ptr<ESPTimer> outboxTimer;
+	std::atomic_bool outboxArmed{ false };
+	std::chrono::milliseconds coalesceWindow{ CONFIG_MQTT_COALESCE_WINDOW_MS };
 	const uint8_t MAX_DISCONNECTION_COUNT = 10;
 	bool isInitialized = false;
 	bool isConnected = false;
@@ -95,15 +96,28 @@ public:
 	void AddToSubscribeList(std::string&& topic);
 	void AddToSubscribeList(const std::string& topic);
 	esp_err_t Publish(const MqttMsg_t& msg) const;
+	// msgId : id carried by the PUBACK ( EVENT_PUBLISH data ), 0 for QoS 0
+	esp_err_t Publish(const MqttMsg_t& msg, int* msgId) const;
 	esp_err_t Publish(const std::string&, const std::string&, const uint8_t qos = 1, const bool retained = false) const;
 	esp_err_t Publish(const char*, const char*, const uint8_t qos = 1, const bool retained = false) const;
 	esp_err_t Publish(const char*, const std::string&, const uint8_t qos = 1, const bool retained = false) const;
 	esp_err_t Publish(std::pair<std::string, std::string> data, const uint8_t qos = 1, const bool retained = false) const;
 	static esp_err_t PublishStaticPair(Mqtt * ptr, std::pair<std::string, std::string> data, const uint8_t qos = 1, const bool retained = false);
+	// stage a state message, only the latest value per topic is sent when the coalesce window expires
+	esp_err_t PublishCoalesced(const std::string& topic, const std::string& data, const uint8_t qos = 1, const bool retained = true);
+	esp_err_t PublishCoalesced(std::pair<std::string, std::string> data, const uint8_t qos = 1, const bool retained = true);
+	// send staged messages now
+	esp_err_t FlushCoalesced();
+	void SetCoalesceWindow(std::chrono::milliseconds window);
+	PublishCoalescer::Stats_t GetCoalesceStats();
 	const std::string& GetTopicBase() const;
 	esp_err_t SetLastWill(const std::string& LwTopic, const std::string& lwMsg);
 	void ResetDisconnectionCounter();
-	QueueHandle_t GetDataReceiverHandle();
+	// single consumer : view the oldest received message (woken by EVENT_DATA), valid until ReleaseData()
+	bool PeekData(std::string_view& topic, std::string_view& data);
+	void ReleaseData();
+	// pushed / dropped / high water (bytes) of the receive ring
+	SpscByteRing<CONFIG_MQTT_RECEIVE_RING_SIZE>::Stats_t GetDataStats() const;
 
 private:
 	//CONFIG OVERRIDE
@@ -115,6 +129,7 @@ private:
 	void DisconnectedHandler();
 	void DataHandlerStatic(const char* topicBuffer, const int topic_len, const char* dataBuffer, const int data_len);
 	void DataHandlerToQueue(const char* topicBuffer, const int topic_len, const char* dataBuffer, const int data_len);
+	esp_err_t Enqueue(const std::string& topic, const std::string& payload, const uint8_t qos, const bool retained);
 
 	static void MQTTEventCallbackHandler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
 	//generate topics from Mac string
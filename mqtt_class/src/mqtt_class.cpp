@@ -15,18 +15,25 @@
 #if (DEBUG_MQTT == VERBOS)
 #define LOG_MQTT ESP_LOGI
 #define LOG_MQTT_V ESP_LOGI
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_VERBOSE
 #elif (DEBUG_MQTT == INFO)
 #define LOG_MQTT ESP_LOGI
 #define LOG_MQTT_V ESP_LOGD
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_INFO
 #else
 #define LOG_MQTT ESP_LOGD
 #define LOG_MQTT_V ESP_LOGV
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_WARN
 #endif
 
 #include "assertion_tools.h"
 #include "mqtt_class.h"
 #include "nvs_tools.h"
 #include "utilities.hpp"
+#include "fast_format.hpp"
 #include <memory>
 #include <string>
 const esp_mqtt_client_config_t Mqtt::mqttDefaultCfg;
@@ -47,10 +54,20 @@ RTC_DATA_ATTR uint8_t Mqtt::disconnectionCounter;
  * @brief Constructor , rest topic and config
  *
  */
-Mqtt::Mqtt(EventLoop_p_t& eventLoop) : Loop(eventLoop)
+Mqtt::Mqtt(EventLoop_p_t& eventLoop) : Loop(eventLoop),
+outbox([this](const std::string& topic, const std::string& payload, uint8_t qos, bool retained) { return this->Enqueue(topic, payload, qos, retained); })
 {
-	mqttRecieveDataQueue = xQueueCreate(10, sizeof(void*));
-
+	outboxTimer = std::make_unique<ESPTimer>([this]() {
+		outboxArmed = false;
+		if (FlushCoalesced() != ESP_OK && outbox.Pending() > 0 && !outboxArmed.exchange(true))
+		{
+			// refused messages stay staged, tried again after another window
+			if (outboxTimer->start_once(coalesceWindow) != ESP_OK)
+			{
+				outboxArmed = false;
+			}
+		}
+		}, "mqttOutbox");
 	privateTopicList.clear();
 }
 
@@ -73,15 +90,18 @@ esp_err_t Mqtt::Init(const std::string& device, const esp_mqtt_client_config_t&
 	MqttUserConfig.activeAPIConfig = mqttCfg;
 	uint8_t mac[6];
 	esp_efuse_mac_get_default(mac);
-	std::string clienID = tools::MacToStr(mac, 4, false);
-	MqttUserConfig.deviceStr += clienID;
-	MqttUserConfig.activeAPIConfig.host = clienID.c_str();
+	// last 4 bytes of the mac, kept in the config : the client reads host / client_id after Init returns
+	char clientID[9];
+	ffmt::format_to_n(clientID, FMT_COMPILE("{:02X}{:02X}{:02X}{:02X}"), mac[2], mac[3], mac[4], mac[5]);
+	MqttUserConfig.clienId = clientID;
+	MqttUserConfig.deviceStr += clientID;
+	MqttUserConfig.activeAPIConfig.host = MqttUserConfig.clienId.c_str();
 	MqttUserConfig.activeAPIConfig.client_id = MqttUserConfig.deviceStr.c_str();
-	const std::string prefix = "mqtt://";
+	constexpr std::string_view prefix = "mqtt://";
 	ESP_LOGW(TAG, "server=%s , port=%d ", MqttUserConfig.serverStr.c_str(), MqttUserConfig.port);
 	if (MqttUserConfig.serverStr.compare(0, prefix.size(), prefix) != 0)
 	{
-		MqttUserConfig.serverStr = prefix + MqttUserConfig.serverStr;
+		MqttUserConfig.serverStr.insert(0, prefix.data(), prefix.size());
 	}
 	MqttUserConfig.activeAPIConfig.uri = MqttUserConfig.serverStr.c_str();
 	MqttUserConfig.activeAPIConfig.port = MqttUserConfig.port;
@@ -108,8 +128,8 @@ esp_err_t Mqtt::Init(const std::string& device, const esp_mqtt_client_config_t&
 
 Mqtt::~Mqtt()
 {
+	outboxTimer.reset();
 	Disconnect();
-	vQueueDelete(mqttRecieveDataQueue);
 	esp_mqtt_client_destroy(MqttUserConfig.clentAPIHandle);
 	isInitialized = false;
 }
@@ -121,6 +141,18 @@ Mqtt::~Mqtt()
  * @return esp_err_t
  */
 esp_err_t Mqtt::Publish(const MqttMsg_t& msg) const
+{
+	return Publish(msg, nullptr);
+}
+
+/**
+ * @brief publish a message and report its id, matched by the PUBACK ( EVENT_PUBLISH data )
+ *
+ * @param msg struct containing message context and settings
+ * @param msgId message id written back, may be nullptr
+ * @return esp_err_t
+ */
+esp_err_t Mqtt::Publish(const MqttMsg_t& msg, int* msgId) const
 {
 	if (!isInitialized)
 		return ESP_ERR_INVALID_STATE;
@@ -145,6 +177,10 @@ esp_err_t Mqtt::Publish(const MqttMsg_t& msg) const
 		LOGE(TAG, "ERRRO Sending Message in topic %s with Qos %d with error", msg.topic.c_str(), msg.qos);
 		return (ESP_FAIL);
 	}
+	if (msgId != nullptr)
+	{
+		*msgId = ret;
+	}
 	return (ESP_OK);
 }
 void Mqtt::AddToSubscribeList(const std::string& topic)
@@ -218,6 +254,70 @@ esp_err_t Mqtt::Publish(const char* topic, const std::string& data, const uint8_
 	return Publish(msg);
 }
 
+/**
+ * @brief stage a state / retained message, a pending message on the same topic is replaced
+ * the first staged message arms the coalesce window, all pending messages are sent when it expires
+ *
+ * @param topic
+ * @param data
+ * @param qos
+ * @param retained
+ * @return esp_err_t
+ */
+esp_err_t Mqtt::PublishCoalesced(const std::string& topic, const std::string& data, const uint8_t qos, const bool retained)
+{
+	esp_err_t ret = outbox.Stage(topic, data, qos, retained);
+	if (ret != ESP_OK)
+	{
+		return ret;
+	}
+	if (!outboxArmed.exchange(true))
+	{
+		ret = outboxTimer->start_once(coalesceWindow);
+		if (ret != ESP_OK)
+		{
+			outboxArmed = false;
+			return FlushCoalesced(); // no window, send now
+		}
+	}
+	return ESP_OK;
+}
+
+esp_err_t Mqtt::PublishCoalesced(std::pair<std::string, std::string> data, const uint8_t qos, const bool retained)
+{
+	return PublishCoalesced(data.first, data.second, qos, retained);
+}
+
+/**
+ * @brief hand a message to the client outbox, sent later by the mqtt task ( never blocks on the socket )
+ */
+esp_err_t Mqtt::Enqueue(const std::string& topic, const std::string& payload, const uint8_t qos, const bool retained)
+{
+	ASSERT_INIT_AND_RETURN_ERR(Mqtt::isInitialized, TAG)
+		const int ret = esp_mqtt_client_enqueue(MqttUserConfig.clentAPIHandle, topic.c_str(), payload.c_str(), payload.length(), qos, retained, true);
+	if (ret == -1)
+	{
+		LOGE(TAG, "ERRRO queuing Message in topic %s with Qos %d", topic.c_str(), qos);
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+esp_err_t Mqtt::FlushCoalesced()
+{
+	return outbox.Flush();
+}
+
+void Mqtt::SetCoalesceWindow(std::chrono::milliseconds window)
+{
+	coalesceWindow = window;
+}
+
+PublishCoalescer::Stats_t Mqtt::GetCoalesceStats()
+{
+	return outbox.GetStats();
+}
+
 /**
  * @brief subscribe to a topic , mqtt must be connected
  *
@@ -358,7 +458,7 @@ void Mqtt::MQTTEventCallbackHandler(void* handler_args, esp_event_base_t base, i
 	case MQTT_EVENT_PUBLISHED:
 	{
 		ESP_LOGV(TAG, "EVENT PUBLISHED OK");
-		_this->Loop->post_event(_this->EVENT_PUBLISH);
+		_this->Loop->post_event_data(_this->EVENT_PUBLISH, event_data->msg_id);
 		break;
 	}
 	case MQTT_EVENT_DATA:
@@ -393,22 +493,40 @@ void Mqtt::DataHandlerStatic(const char* topicBuffer, const int topic_len, const
 void Mqtt::DataHandlerToQueue(const char* topicBuffer, const int topic_len, const char* dataBuffer, const int data_len)
 {
 	LOG_MQTT_V(TAG, " message HANDLER  %.*s, on topic %.*s", data_len, dataBuffer, topic_len, topicBuffer);
-	MqttStringConstruct* const msg = new MqttStringConstruct(topicBuffer, topic_len, dataBuffer, data_len);
-	auto ret = xQueueSend(this->mqttRecieveDataQueue, (void*)(&msg), pdMS_TO_TICKS(200));
-	if (ret != pdPASS)
-	{
-		delete msg;
-	}
-	else
+	// never blocks the mqtt task : a full ring drops the message and counts it
+	if (!receiveRing.Push(std::string_view(topicBuffer, topic_len), std::string_view(dataBuffer, data_len)))
 	{
-		Loop->post_event(this->EVENT_DATA);
+		LOGW(TAG, "receive ring full, message on %.*s dropped", topic_len, topicBuffer);
+		return;
 	}
+	Loop->post_event(this->EVENT_DATA);
 	return;
 }
 
-QueueHandle_t Mqtt::GetDataReceiverHandle()
+/**
+ * @brief view the oldest received message in place
+ * must be called from one consumer task only
+ *
+ * @param topic [out] topic view into the ring
+ * @param data [out] payload view into the ring
+ * @return true a message is available , false nothing received
+ */
+bool Mqtt::PeekData(std::string_view& topic, std::string_view& data)
+{
+	return receiveRing.Peek(topic, data);
+}
+
+/**
+ * @brief release the message returned by PeekData(), its views become invalid
+ */
+void Mqtt::ReleaseData()
+{
+	receiveRing.Release();
+}
+
+SpscByteRing<CONFIG_MQTT_RECEIVE_RING_SIZE>::Stats_t Mqtt::GetDataStats() const
 {
-	return this->mqttRecieveDataQueue;
+	return receiveRing.GetStats();
 }
 
 /**
@@ -0,0 +1,271 @@
+/**
+ * @file test_nvs_cache.cpp
+ * @brief NvsCache against an in-memory NVSHandle : coalescing, one commit per namespace, read back,
+ * failed writes kept dirty, delayed flush on the flush task ( ./host_test/run.sh nvs_cache )
+ */
+#include "host_test.hpp"
+#include "nvs_cache.h"
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <set>
+#include <thread>
+
+// flash of the fake handles : "namespace/key" -> bytes
+static std::map<std::string, std::string> flash;
+static std::mutex flashLock;
+static std::atomic<int> commits{0};
+static std::atomic<int> opens{0};
+static std::set<std::thread::id> commitThreads;
+static std::string failingKey; // set_* of this key fails
+
+class FakeHandle : public nvs::NVSHandle
+{
+public:
+    explicit FakeHandle(const char *_ns) : ns(_ns) {}
+    esp_err_t set_string(const char *key, const char *value) override
+    {
+        return Write(key, std::string(value) + '\0');
+    }
+    esp_err_t get_string(const char *key, char *out, size_t len) override
+    {
+        std::string value;
+        esp_err_t ret = Read(key, value);
+        if (ret == ESP_OK)
+        {
+            memcpy(out, value.data(), std::min(len, value.size()));
+        }
+        return ret;
+    }
+    esp_err_t get_item_size(nvs::ItemType, const char *key, size_t &size) override
+    {
+        std::string value;
+        esp_err_t ret = Read(key, value);
+        size = value.size();
+        return ret;
+    }
+    esp_err_t set_typed_item(nvs::ItemType, const char *key, const void *data, size_t size) override
+    {
+        return Write(key, std::string(static_cast<const char *>(data), size));
+    }
+    esp_err_t get_typed_item(nvs::ItemType, const char *key, void *data, size_t size) override
+    {
+        std::string value;
+        esp_err_t ret = Read(key, value);
+        if (ret == ESP_OK)
+        {
+            memcpy(data, value.data(), std::min(size, value.size()));
+        }
+        return ret;
+    }
+    esp_err_t erase_item(const char *key) override
+    {
+        std::lock_guard<std::mutex> guard(flashLock);
+        flash.erase(ns + "/" + key);
+        return ESP_OK;
+    }
+    esp_err_t erase_all() override { return ESP_OK; }
+    esp_err_t commit() override
+    {
+        std::lock_guard<std::mutex> guard(flashLock);
+        commits++;
+        commitThreads.insert(std::this_thread::get_id());
+        return ESP_OK;
+    }
+
+private:
+    esp_err_t Write(const char *key, const std::string &value)
+    {
+        std::lock_guard<std::mutex> guard(flashLock);
+        if (failingKey == key)
+        {
+            return ESP_ERR_NVS_NO_FREE_PAGES;
+        }
+        flash[ns + "/" + key] = value;
+        return ESP_OK;
+    }
+    esp_err_t Read(const char *key, std::string &value)
+    {
+        std::lock_guard<std::mutex> guard(flashLock);
+        auto it = flash.find(ns + "/" + key);
+        if (it == flash.end())
+        {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        value = it->second;
+        return ESP_OK;
+    }
+    const std::string ns;
+};
+
+static std::shared_ptr<nvs::NVSHandle> OpenFake(const char *nameSpace, nvs_open_mode, esp_err_t *err)
+{
+    opens++;
+    *err = ESP_OK;
+    return std::make_shared<FakeHandle>(nameSpace);
+}
+
+static void Reset()
+{
+    std::lock_guard<std::mutex> guard(flashLock);
+    flash.clear();
+    commitThreads.clear();
+    failingKey.clear();
+    commits = 0;
+    opens = 0;
+}
+
+static void TestCoalescing()
+{
+    Reset();
+    NvsCache cache(OpenFake, 0);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        CHECK(cache.set("blind", "position", i) == ESP_OK);
+    }
+    const int8_t negative = -5;
+    CHECK(cache.set("blind", "neg", negative) == ESP_OK);
+    CHECK(cache.setS("vswitch", "name", "hall") == ESP_OK);
+    CHECK(cache.set("vswitch", "level", 1.5f) == ESP_OK);
+    CHECK_EQ(cache.GetPendingCount(), 4u);
+    CHECK_EQ(commits.load(), 0); // nothing reaches flash before the flush
+    CHECK(cache.commit() == ESP_OK);
+    CHECK_EQ(commits.load(), 2); // one per namespace
+    CHECK_EQ(cache.GetPendingCount(), 0u);
+    const NvsCache::Stats_t stats = cache.GetStats();
+    CHECK_EQ(stats.writes, 13u);
+    CHECK_EQ(stats.coalesced, 9u);
+    CHECK_EQ(stats.commits, 2u);
+    CHECK_EQ(stats.bytesWritten, 1u + 1u + 5u + std::to_string(1.5f).size() + 1u);
+
+    // unchanged values do not dirty the key
+    CHECK(cache.set("blind", "position", static_cast<uint8_t>(9)) == ESP_OK);
+    CHECK_EQ(cache.GetPendingCount(), 0u);
+    CHECK_EQ(cache.GetStats().unchanged, 1u);
+    CHECK(cache.commit() == ESP_OK);
+    CHECK_EQ(commits.load(), 2);
+}
+
+static void TestReadBack()
+{
+    Reset();
+    NvsCache cache(OpenFake, 0);
+    const bool on = true;
+    cache.set("blind", "position", static_cast<uint8_t>(42));
+    cache.set("blind", "neg", static_cast<int16_t>(-300));
+    cache.set("blind", "on", on);
+    cache.setS("vswitch", "name", "kitchen");
+    cache.set("vswitch", "level", 0.25f);
+    CHECK(cache.commit() == ESP_OK);
+    CHECK(cache.invalidate("blind") == ESP_OK);
+    CHECK(cache.invalidate("vswitch") == ESP_OK);
+    cache.ResetStats();
+
+    uint8_t position = 0;
+    int16_t negative = 0;
+    bool flag = false;
+    std::string name;
+    float level = 0;
+    CHECK(cache.get("blind", "position", position) == ESP_OK && position == 42);
+    CHECK(cache.get("blind", "neg", negative) == ESP_OK && negative == -300); // sign extended from flash
+    CHECK(cache.get("blind", "on", flag) == ESP_OK && flag);
+    CHECK(cache.getS("vswitch", "name", name) == ESP_OK && name == "kitchen");
+    CHECK(cache.get("vswitch", "level", level) == ESP_OK && level == 0.25f);
+    CHECK_EQ(cache.GetStats().misses, 5u);
+    CHECK(cache.get("blind", "position", position) == ESP_OK);
+    CHECK_EQ(cache.GetStats().hits, 1u);
+
+    uint32_t missing = 0;
+    CHECK(cache.get("blind", "missing", missing) == ESP_ERR_NVS_NOT_FOUND);
+    // a pending key read with another type
+    cache.set("blind", "position", static_cast<uint8_t>(1));
+    CHECK(cache.get("blind", "position", missing) == ESP_ERR_NVS_TYPE_MISMATCH);
+}
+
+static void TestFailedWriteStaysDirty()
+{
+    Reset();
+    NvsCache cache(OpenFake, 0);
+    {
+        std::lock_guard<std::mutex> guard(flashLock);
+        failingKey = "bad";
+    }
+    cache.set("ns", "good", static_cast<uint32_t>(1));
+    cache.set("ns", "bad", static_cast<uint32_t>(2));
+    CHECK(cache.commit() == ESP_ERR_NVS_NO_FREE_PAGES);
+    CHECK_EQ(cache.GetPendingCount(), 1u);
+    CHECK_EQ(cache.GetStats().errors, 1u);
+    {
+        std::lock_guard<std::mutex> guard(flashLock);
+        failingKey.clear();
+        CHECK(flash.count("ns/good") == 1 && flash.count("ns/bad") == 0);
+    }
+    CHECK(cache.commit() == ESP_OK);
+    CHECK_EQ(cache.GetPendingCount(), 0u);
+    std::lock_guard<std::mutex> guard(flashLock);
+    CHECK(flash.count("ns/bad") == 1);
+}
+
+static bool WaitFor(const std::function<bool()> &done, int ms)
+{
+    for (int i = 0; i < ms && !done(); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return done();
+}
+
+static void TestDelayedFlush()
+{
+    Reset();
+    {
+        NvsCache cache(OpenFake, 30);
+        const auto start = std::chrono::steady_clock::now();
+        for (uint16_t i = 0; i < 100; i++)
+        {
+            cache.set("blind", "position", i);
+            cache.set("vswitch", "state", static_cast<uint8_t>(i & 1));
+        }
+        CHECK(WaitFor([&]()
+                      { return cache.GetPendingCount() == 0; },
+                      2000));
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        CHECK(elapsed >= std::chrono::milliseconds(30)); // not before the delay
+        CHECK_EQ(commits.load(), 2);                     // 200 writes, one flush
+        {
+            std::lock_guard<std::mutex> guard(flashLock);
+            CHECK(commitThreads.size() == 1 && commitThreads.count(std::this_thread::get_id()) == 0); // flush task
+        }
+        // a retried failure is flushed again after another delay
+        {
+            std::lock_guard<std::mutex> guard(flashLock);
+            failingKey = "state";
+        }
+        cache.set("vswitch", "state", static_cast<uint8_t>(7));
+        CHECK(WaitFor([&]()
+                      { return cache.GetStats().errors >= 1; },
+                      2000));
+        {
+            std::lock_guard<std::mutex> guard(flashLock);
+            failingKey.clear();
+        }
+        CHECK(WaitFor([&]()
+                      { return cache.GetPendingCount() == 0; },
+                      2000));
+        // pending at destruction : committed by the destructor
+        cache.set("blind", "position", static_cast<uint16_t>(1000));
+    }
+    std::lock_guard<std::mutex> guard(flashLock);
+    uint16_t position = 0;
+    memcpy(&position, flash["blind/position"].data(), sizeof(position));
+    CHECK_EQ(position, 1000);
+}
+
+int main()
+{
+    TestCoalescing();
+    TestReadBack();
+    TestFailedWriteStaysDirty();
+    TestDelayedFlush();
+    HOST_TEST_END();
+}
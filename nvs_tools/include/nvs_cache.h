@@ -0,0 +1,184 @@
+/**
+ * @file nvs_cache.h
+ * @author Rami
+ * @brief write-back cache in front of the NVS namespaces
+ * @version 0.1
+ * @date 2021-06-12
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_NVS_CACHE_H_
+#define COMPONENTS_CPP_UTILS_NVS_CACHE_H_
+#include "sdkconfig.h"
+#include "debug_tools.h"
+#include <nvs.h>
+#include <nvs_handle.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#ifndef CONFIG_NVS_CACHE_FLUSH_DELAY_MS
+#define CONFIG_NVS_CACHE_FLUSH_DELAY_MS 5000
+#endif
+#ifndef CONFIG_NVS_CACHE_FLUSH_STACK
+#define CONFIG_NVS_CACHE_FLUSH_STACK 4096
+#endif
+#ifndef CONFIG_NVS_CACHE_FLUSH_PRIORITY
+#define CONFIG_NVS_CACHE_FLUSH_PRIORITY 2
+#endif
+
+/**
+ * @brief keeps NVS keys in RAM, writes are coalesced per key and flushed
+ * to flash in one commit per namespace : by the flush task after a delay, on commit() or before reboot.
+ * a namespace accessed through the cache should not be written with NVS directly
+ */
+class NvsCache
+{
+	protected:
+	static constexpr char TAG[] = "NVS_CACHE";
+
+	public:
+	struct Stats_t
+	{
+		uint32_t hits = 0;		   // reads served from RAM
+		uint32_t misses = 0;	   // reads that went to flash
+		uint32_t writes = 0;	   // set() calls that changed a value
+		uint32_t unchanged = 0;	   // set() calls with the value already stored
+		uint32_t coalesced = 0;	   // writes that replaced a still pending write
+		uint32_t commits = 0;	   // namespace commits
+		uint32_t bytesWritten = 0; // payload bytes handed to flash
+		uint32_t errors = 0;
+	};
+	// opens a namespace, the default one uses nvs::open_nvs_handle on the "nvs" partition
+	using HandleOpener_t = std::function<std::shared_ptr<nvs::NVSHandle>(const char *nameSpace, nvs_open_mode openMode, esp_err_t *err)>;
+
+	explicit NvsCache(HandleOpener_t opener = nullptr, uint32_t flushDelayMs = CONFIG_NVS_CACHE_FLUSH_DELAY_MS);
+	~NvsCache();
+	NvsCache(const NvsCache &) = delete;
+	NvsCache &operator=(const NvsCache &) = delete;
+
+	// shared cache used by the components, flushed by the shutdown handler
+	static NvsCache &Default();
+
+	//get a key (all integer types)
+	template <typename T>
+	esp_err_t get(const char *nameSpace, const char *key, T &result);
+	// workaround for float
+	esp_err_t get(const char *nameSpace, const char *key, float &result);
+	//set a key (all integer types), only marked dirty
+	template <typename T>
+	esp_err_t set(const char *nameSpace, const char *key, const T &data);
+	esp_err_t set(const char *nameSpace, const char *key, const float &data);
+	//get string key
+	esp_err_t getS(const char *nameSpace, const char *key, std::string &result);
+	// set a string key, only marked dirty
+	esp_err_t setS(const char *nameSpace, const char *key, const std::string &value);
+	// write every dirty key and commit, one commit per namespace
+	esp_err_t commit();
+	// drop cached values of a namespace ( pending writes are flushed first )
+	esp_err_t invalidate(const char *nameSpace);
+	//
+	Stats_t GetStats();
+	void ResetStats();
+	size_t GetPendingCount();
+
+	private:
+	struct Entry_t
+	{
+		nvs::ItemType type = nvs::ItemType::ANY;
+		uint64_t raw = 0;	// integer value, sign extended
+		std::string str{};	// string value
+		bool dirty = false; // not yet written to flash
+	};
+	// (namespace, key) : keeps the keys of a namespace adjacent for the flush
+	using Key_t = std::pair<std::string, std::string>;
+
+	template <typename T>
+	static constexpr nvs::ItemType ItemTypeOf();
+	esp_err_t Store(const char *nameSpace, const char *key, nvs::ItemType type, uint64_t raw, const std::string *str);
+	esp_err_t Load(const char *nameSpace, const char *key, nvs::ItemType type, Entry_t *&out);
+	esp_err_t FlushLocked();
+	esp_err_t WriteEntry(nvs::NVSHandle &handle, const char *key, const Entry_t &entry);
+	void ArmFlush();
+	// flush task : sleeps until a write is pending, waits the delay, then commits
+	void FlushLoop();
+	static void ShutdownHandler();
+
+	HandleOpener_t opener;
+	std::map<Key_t, Entry_t> entries{};
+	size_t pendingCount = 0;
+	Stats_t stats{};
+	std::recursive_mutex lock;
+	const std::chrono::milliseconds flushDelay;
+	std::thread flusher;
+	std::mutex flushLock; // taken after lock, never before
+	std::condition_variable flushWake;
+	bool flushArmed = false;
+	bool exiting = false;
+};
+
+template <typename T>
+constexpr nvs::ItemType NvsCache::ItemTypeOf()
+{
+	static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "NvsCache only stores integer types, strings and floats");
+	using U = typename std::conditional<std::is_enum<T>::value, std::underlying_type<T>, std::common_type<T>>::type::type;
+	if (std::is_same<U, bool>::value)
+		return nvs::ItemType::U8;
+	if (sizeof(U) == 1)
+		return std::is_signed<U>::value ? nvs::ItemType::I8 : nvs::ItemType::U8;
+	if (sizeof(U) == 2)
+		return std::is_signed<U>::value ? nvs::ItemType::I16 : nvs::ItemType::U16;
+	if (sizeof(U) == 4)
+		return std::is_signed<U>::value ? nvs::ItemType::I32 : nvs::ItemType::U32;
+	return std::is_signed<U>::value ? nvs::ItemType::I64 : nvs::ItemType::U64;
+}
+
+/**
+ * @brief Retrieve a value by key, from RAM if cached
+ *
+ * @param [in] nameSpace namespace of the key
+ * @param [in] key The key to read from the namespace.
+ * @param [out] result value read
+ */
+template <typename T>
+esp_err_t NvsCache::get(const char *nameSpace, const char *key, T &result)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	Entry_t *entry = nullptr;
+	esp_err_t ret = Load(nameSpace, key, ItemTypeOf<T>(), entry);
+	if (ret == ESP_OK)
+	{
+		result = static_cast<T>(entry->raw);
+	}
+	return ret;
+}
+
+/**
+ * @brief Set a value by key, written to flash on the next flush
+ *
+ * @param [in] nameSpace namespace of the key
+ * @param [in] key The key to set in the namespace.
+ * @param [in] data The value to set for the key.
+ */
+template <typename T>
+esp_err_t NvsCache::set(const char *nameSpace, const char *key, const T &data)
+{
+	constexpr nvs::ItemType type = ItemTypeOf<T>();
+	uint64_t raw = 0;
+	if (std::is_signed<T>::value)
+		raw = static_cast<uint64_t>(static_cast<int64_t>(data));
+	else
+		raw = static_cast<uint64_t>(data);
+	return Store(nameSpace, key, type, raw, nullptr);
+}
+
+#endif /* COMPONENTS_CPP_UTILS_NVS_CACHE_H_ */
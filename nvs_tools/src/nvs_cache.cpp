@@ -0,0 +1,442 @@
+/**
+ * @file nvs_cache.cpp
+ * @author rami
+ * @brief
+ * @version 0.1
+ * @date 2021-06-12
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "debug_tools.h"
+
+#if (DEBUG_STORAGE == VERBOS)
+#define LOG_STORAGE ESP_LOGI
+#define LOG_STORAGE_V ESP_LOGI
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_VERBOSE
+#elif (DEBUG_STORAGE == INFO)
+#define LOG_STORAGE ESP_LOGI
+#define LOG_STORAGE_V ESP_LOGD
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_INFO
+#else
+#define LOG_STORAGE ESP_LOGD
+#define LOG_STORAGE_V ESP_LOGV
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_WARN
+#endif
+
+#include "nvs_cache.h"
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_system.h>
+#include <nvs_flash.h>
+#ifdef ESP_PLATFORM
+#include "esp_pthread.h"
+#endif
+#include <memory>
+#include <string>
+
+const char NvsCache::TAG[];
+
+// payload size encoded in the low nibble of nvs::ItemType
+static inline size_t ItemSize(nvs::ItemType type)
+{
+	return static_cast<uint8_t>(type) & 0x0f;
+}
+
+static inline bool ItemIsSigned(nvs::ItemType type)
+{
+	return (static_cast<uint8_t>(type) & 0xf0) == 0x10;
+}
+
+/**
+ * @brief open a namespace on the default partition, initializing nvs_flash if needed
+ */
+static std::shared_ptr<nvs::NVSHandle> OpenDefaultHandle(const char *nameSpace, nvs_open_mode openMode, esp_err_t *err)
+{
+	std::shared_ptr<nvs::NVSHandle> handle = nvs::open_nvs_handle(nameSpace, openMode, err);
+	if (*err == ESP_ERR_NVS_NOT_INITIALIZED && nvs_flash_init() == ESP_OK)
+	{
+		handle = nvs::open_nvs_handle(nameSpace, openMode, err);
+	}
+	return handle;
+}
+
+/**
+ * @brief Constructor
+ *
+ * @param opener namespace opener, nullptr for the default partition ( a fake NVSHandle can be injected here )
+ * @param flushDelayMs delay between the first pending write and the automatic flush, 0 : no flush task,
+ * pending writes wait for commit()
+ */
+NvsCache::NvsCache(HandleOpener_t _opener, uint32_t flushDelayMs) : opener(_opener ? _opener : OpenDefaultHandle), flushDelay(flushDelayMs)
+{
+	if (flushDelayMs == 0)
+	{
+		return;
+	}
+	// flash writes need more stack than the timer daemon task has
+#ifdef ESP_PLATFORM
+	esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+	cfg.stack_size = CONFIG_NVS_CACHE_FLUSH_STACK;
+	cfg.prio = CONFIG_NVS_CACHE_FLUSH_PRIORITY;
+	cfg.thread_name = TAG;
+	esp_pthread_set_cfg(&cfg);
+#endif
+	flusher = std::thread(&NvsCache::FlushLoop, this);
+#ifdef ESP_PLATFORM
+	cfg = esp_pthread_get_default_config();
+	esp_pthread_set_cfg(&cfg);
+#endif
+}
+
+/**
+ * @brief Desctructor : flush pending writes
+ */
+NvsCache::~NvsCache()
+{
+	if (flusher.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> guard(flushLock);
+			exiting = true;
+		}
+		flushWake.notify_one();
+		flusher.join();
+	}
+	commit();
+}
+
+NvsCache &NvsCache::Default()
+{
+	static NvsCache defaultCache;
+	static const bool shutdownRegistered = (esp_register_shutdown_handler(&NvsCache::ShutdownHandler) == ESP_OK);
+	(void)shutdownRegistered;
+	return defaultCache;
+}
+
+/**
+ * @brief called by esp_restart() (reboot command, OTA ..) : nothing pending is lost
+ */
+void NvsCache::ShutdownHandler()
+{
+	Default().commit();
+}
+
+void NvsCache::FlushLoop()
+{
+	std::unique_lock<std::mutex> guard(flushLock);
+	while (!exiting)
+	{
+		flushWake.wait(guard, [this]()
+					   { return flushArmed || exiting; });
+		// writes made during the delay join this flush, the destructor commits what is left
+		if (flushWake.wait_for(guard, flushDelay, [this]()
+							   { return exiting; }))
+		{
+			break;
+		}
+		flushArmed = false;
+		guard.unlock();
+		const bool failed = (commit() != ESP_OK) && (GetPendingCount() > 0);
+		guard.lock();
+		flushArmed |= failed; // retried after another delay
+	}
+}
+
+/**
+ * @brief wake the flush task for the first pending write
+ * must be called with lock held
+ */
+void NvsCache::ArmFlush()
+{
+	if (!flusher.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(flushLock);
+		if (flushArmed)
+		{
+			return;
+		}
+		flushArmed = true;
+	}
+	flushWake.notify_one();
+}
+
+/**
+ * @brief store a value in RAM and mark it dirty, unchanged values are ignored
+ */
+esp_err_t NvsCache::Store(const char *nameSpace, const char *key, nvs::ItemType type, uint64_t raw, const std::string *str)
+{
+	if (nameSpace == nullptr || key == nullptr)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	auto [it, inserted] = entries.try_emplace(Key_t(nameSpace, key));
+	Entry_t &entry = it->second;
+	if (!inserted && entry.type == type && ((str != nullptr) ? (entry.str == *str) : (entry.raw == raw)))
+	{
+		stats.unchanged++;
+		return ESP_OK;
+	}
+	if (entry.dirty)
+	{
+		stats.coalesced++;
+	}
+	else
+	{
+		pendingCount++;
+	}
+	entry.type = type;
+	entry.raw = raw;
+	if (str != nullptr)
+		entry.str = *str;
+	else
+		entry.str.clear();
+	entry.dirty = true;
+	stats.writes++;
+	ArmFlush();
+	return ESP_OK;
+}
+
+/**
+ * @brief find a value in RAM, read and cache it from flash otherwise
+ * must be called with lock held
+ */
+esp_err_t NvsCache::Load(const char *nameSpace, const char *key, nvs::ItemType type, Entry_t *&out)
+{
+	if (nameSpace == nullptr || key == nullptr)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	const Key_t cacheKey(nameSpace, key);
+	auto it = entries.find(cacheKey);
+	if (it != entries.end())
+	{
+		if (it->second.type == type)
+		{
+			stats.hits++;
+			out = &it->second;
+			return ESP_OK;
+		}
+		if (it->second.dirty)
+		{
+			return ESP_ERR_NVS_TYPE_MISMATCH;
+		}
+	}
+	stats.misses++;
+	esp_err_t ret = ESP_FAIL;
+	std::shared_ptr<nvs::NVSHandle> handle = opener(nameSpace, NVS_READONLY, &ret);
+	if (ret != ESP_OK || handle == nullptr)
+	{
+		LOG_STORAGE_V(TAG, "%s open for reading failed %s", nameSpace, esp_err_to_name(ret));
+		return (ret != ESP_OK) ? ret : ESP_FAIL;
+	}
+	Entry_t entry;
+	entry.type = type;
+	if (type == nvs::ItemType::SZ)
+	{
+		size_t size = 0;
+		ret = handle->get_item_size(nvs::ItemType::SZ, key, size);
+		if (ret == ESP_OK && size > 0)
+		{
+			std::unique_ptr<char[]> buf = std::unique_ptr<char[]>(new char[size]);
+			ret = handle->get_string(key, buf.get(), size);
+			if (ret == ESP_OK)
+			{
+				entry.str.assign(buf.get(), size - 1); // drop '\0'
+			}
+		}
+	}
+	else
+	{
+		const size_t size = ItemSize(type);
+		ret = handle->get_typed_item(type, key, &entry.raw, size);
+		if (ret == ESP_OK && ItemIsSigned(type) && size < sizeof(entry.raw))
+		{
+			const uint64_t signBit = 1ULL << (size * 8 - 1);
+			entry.raw = (entry.raw ^ signBit) - signBit; // sign extend
+		}
+	}
+	if (ret != ESP_OK)
+	{
+		LOG_STORAGE_V(TAG, "%s Error getting key: %s %s", nameSpace, key, esp_err_to_name(ret));
+		return ret;
+	}
+	auto &slot = entries[cacheKey];
+	slot = std::move(entry);
+	out = &slot;
+	return ESP_OK;
+}
+
+esp_err_t NvsCache::WriteEntry(nvs::NVSHandle &handle, const char *key, const Entry_t &entry)
+{
+	if (entry.type == nvs::ItemType::SZ)
+	{
+		return handle.set_string(key, entry.str.c_str());
+	}
+	return handle.set_typed_item(entry.type, key, &entry.raw, ItemSize(entry.type));
+}
+
+/**
+ * @brief write all dirty keys, one handle and one commit per namespace
+ * must be called with lock held
+ */
+esp_err_t NvsCache::FlushLocked()
+{
+	if (pendingCount == 0)
+	{
+		return ESP_OK;
+	}
+	esp_err_t ret = ESP_OK;
+	auto it = entries.begin();
+	while (it != entries.end())
+	{
+		const std::string &nameSpace = it->first.first;
+		auto nsEnd = it;
+		bool anyDirty = false;
+		while (nsEnd != entries.end() && nsEnd->first.first == nameSpace)
+		{
+			anyDirty |= nsEnd->second.dirty;
+			++nsEnd;
+		}
+		if (!anyDirty)
+		{
+			it = nsEnd;
+			continue;
+		}
+		esp_err_t err = ESP_FAIL;
+		std::shared_ptr<nvs::NVSHandle> handle = opener(nameSpace.c_str(), NVS_READWRITE, &err);
+		if (err != ESP_OK || handle == nullptr)
+		{
+			LOGE(TAG, "%s open for writing failed %s", nameSpace.c_str(), esp_err_to_name(err));
+			stats.errors++;
+			ret = (err != ESP_OK) ? err : ESP_FAIL;
+			it = nsEnd;
+			continue;
+		}
+		for (; it != nsEnd; ++it)
+		{
+			Entry_t &entry = it->second;
+			if (!entry.dirty)
+			{
+				continue;
+			}
+			err = WriteEntry(*handle, it->first.second.c_str(), entry);
+			if (err != ESP_OK)
+			{
+				LOGE(TAG, "%s Error setting key: %s %s", nameSpace.c_str(), it->first.second.c_str(), esp_err_to_name(err));
+				stats.errors++;
+				ret = err;
+				continue; // stays dirty, retried on next flush
+			}
+			entry.dirty = false;
+			pendingCount--;
+			stats.bytesWritten += (entry.type == nvs::ItemType::SZ) ? (entry.str.size() + 1) : ItemSize(entry.type);
+		}
+		err = handle->commit();
+		stats.commits++;
+		if (err != ESP_OK)
+		{
+			LOGE(TAG, "%s commit failed %s", nameSpace.c_str(), esp_err_to_name(err));
+			stats.errors++;
+			ret = err;
+		}
+	}
+	LOG_STORAGE_V(TAG, "flushed, %d key(s) still pending", static_cast<int>(pendingCount));
+	return ret;
+}
+
+esp_err_t NvsCache::commit()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	return FlushLocked();
+}
+
+esp_err_t NvsCache::invalidate(const char *nameSpace)
+{
+	if (nameSpace == nullptr)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	esp_err_t ret = FlushLocked();
+	auto it = entries.lower_bound(Key_t(nameSpace, ""));
+	while (it != entries.end() && it->first.first == nameSpace)
+	{
+		if (it->second.dirty)
+		{
+			++it; // failed to flush, keep it
+			continue;
+		}
+		it = entries.erase(it);
+	}
+	return ret;
+}
+
+esp_err_t NvsCache::getS(const char *nameSpace, const char *key, std::string &result)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	Entry_t *entry = nullptr;
+	esp_err_t ret = Load(nameSpace, key, nvs::ItemType::SZ, entry);
+	if (ret == ESP_OK)
+	{
+		result = entry->str;
+	}
+	return ret;
+}
+
+esp_err_t NvsCache::setS(const char *nameSpace, const char *key, const std::string &value)
+{
+	return Store(nameSpace, key, nvs::ItemType::SZ, 0, &value);
+}
+
+esp_err_t NvsCache::set(const char *nameSpace, const char *key, const float &data)
+{
+	return setS(nameSpace, key, std::to_string(data));
+}
+
+/**
+ * @brief workarround for float storage : stored as string like NVS::set(float)
+ */
+esp_err_t NvsCache::get(const char *nameSpace, const char *key, float &result)
+{
+	std::string buf_float;
+	esp_err_t ret = getS(nameSpace, key, buf_float);
+	if (ret != ESP_OK)
+	{
+		return ret;
+	}
+	try
+	{
+		result = std::stof(buf_float);
+	}
+	catch (const std::exception &e)
+	{
+		ret = ESP_FAIL;
+	}
+	return ret;
+}
+
+NvsCache::Stats_t NvsCache::GetStats()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	return stats;
+}
+
+void NvsCache::ResetStats()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	stats = Stats_t{};
+}
+
+size_t NvsCache::GetPendingCount()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	return pendingCount;
+}
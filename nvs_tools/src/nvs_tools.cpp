@@ -13,12 +13,18 @@
 #if (DEBUG_STORAGE == VERBOS)
 #define LOG_STORAGE ESP_LOGI
 #define LOG_STORAGE_V ESP_LOGI
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_VERBOSE
 #elif (DEBUG_STORAGE == INFO)
 #define LOG_STORAGE ESP_LOGI
 #define LOG_STORAGE_V ESP_LOGD
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_INFO
 #else
 #define LOG_STORAGE ESP_LOGD
 #define LOG_STORAGE_V ESP_LOGV
+#undef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL DLOG_WARN
 #endif
 
 #include "nvs_tools.h"
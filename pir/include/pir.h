@@ -1,35 +1,30 @@
 #ifndef __PIR_H__
 #define __PIR_H__
-#include "task_tools.h"
 #include "driver/gpio.h"
 #include "freertos/event_groups.h"
 #include "system.hpp"
+#include "input_scanner.hpp"
 
-class PIR : public Task
+class PIR
 {
     private:
-    bool status;
+    bool status = false;
     std::chrono::seconds timeOut = 30s;
-    unsigned long PIRTimeout;
-    EventGroupHandle_t events;
     gpio_num_t pin;
-    static const uint16_t ISR_EVENT = BIT(5);
-    static IRAM_ATTR void ISR_Handler(void* arg);
+    uint16_t inputId = InputScanner::NO_DEVICE;
     const char* TAG;
     EventLoop_p_t loop;
+    static void OnInput(void* ctx, const InputEvent_t& event);
     public:
     ~PIR();
     PIR(EventLoop_p_t& _loop, gpio_num_t, gpio_mode_t);
-    void run(TimerHandle_t arg);
-    bool PIRLastStatus;
+    bool PIRLastStatus = false;
     void setup(gpio_num_t, gpio_mode_t mode);
     bool Status();
     bool GetVal() { return status; }
     static const uint16_t Changed_EVENT = BIT(5);
-    void SetTimeout(const std::chrono::seconds& s)
-    {
-        timeOut = s;
-    }
+    // EVENT_PIR_OFF once the pin stayed low for this long
+    void SetTimeout(const std::chrono::seconds& s);
     const Event_t EVENT_PIR_OFF = { TAG, EventID_t(0) };
     const Event_t EVENT_PIR_ON = { TAG, EventID_t(1) };
     const Event_t EVENT_PIR_CHANGED = { TAG, EventID_t(2) };
@@ -39,17 +34,14 @@ class PIR : public Task
 
 };
 
-class SWITCH : public Task
+class SWITCH
 {
     private:
-    volatile bool status, lastStatus;
-    volatile EventGroupHandle_t SWITCH_events;
+    bool status = false;
     gpio_num_t pin;
-    const EventBits_t ISR_EVENT = BIT(0);
-    const EventBits_t Changed_EVENT = BIT(2);
+    uint16_t inputId = InputScanner::NO_DEVICE;
     EventLoop_p_t loop;
-    static IRAM_ATTR void ISR_Handler(void* arg);
-    void run(void* arg);
+    static void OnInput(void* ctx, const InputEvent_t& event);
     public:
     ~SWITCH();
     SWITCH(EventLoop_p_t&, gpio_num_t, gpio_mode_t);
@@ -2,7 +2,7 @@
 #include "esp_log.h"
 #include "string.h"
 
-PIR::PIR(EventLoop_p_t& _loop, gpio_num_t pin, gpio_mode_t mode) : Task("PIR", 2048, 2, 1), TAG("PIR"),
+PIR::PIR(EventLoop_p_t& _loop, gpio_num_t pin, gpio_mode_t mode) : TAG("PIR"),
 loop(_loop)
 {
   setup(pin, mode);
@@ -10,30 +10,31 @@ loop(_loop)
 
 PIR::~PIR()
 {
+  InputScanner::Default().Remove(inputId);
 }
 
+/**
+ * @brief the pin is a level input of the shared InputScanner : 80 ms debounce ( the old 20 ms + 3 x 20 ms check ),
+ * the hold keeps PIR ON until the pin stayed low for timeOut
+ */
 void PIR::setup(gpio_num_t _pin, gpio_mode_t _mode)
 {
   pin = _pin;
-  events = xEventGroupCreate();
-  gpio_config_t io_conf;
-  memset(&io_conf, 0, sizeof(gpio_config_t));
-  io_conf.mode = GPIO_MODE_INPUT;
-  io_conf.intr_type = GPIO_INTR_ANYEDGE;
-  io_conf.pin_bit_mask = (1ULL << pin);
-  io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-  io_conf.pull_up_en = GPIO_PULLUP_DISABLE;
-  gpio_config(&io_conf);
-  gpio_install_isr_service(0);
-  gpio_isr_handler_add(pin, ISR_Handler, this);
-  PIRLastStatus = false;
-  PIRTimeout = 0;
-  StartTask(this);
+  InputLevelConfig_t config;
+  config.debounceMs = 80;
+  config.holdMs = duration_cast<std::chrono::milliseconds>(timeOut).count();
+  config.pull = InputBackend::PULL_NONE;
+  esp_err_t ret = InputScanner::Default().AddLevel(pin, OnInput, this, config, &inputId);
+  if (ret != ESP_OK)
+  {
+    ESP_LOGE(TAG, "input register ERROR %s", esp_err_to_name(ret));
+  }
 }
-void IRAM_ATTR PIR::ISR_Handler(void* arg)
+
+void PIR::SetTimeout(const std::chrono::seconds& s)
 {
-  PIR* _this = (PIR*)(arg);
-  xEventGroupSetBitsFromISR(_this->events, _this->ISR_EVENT, 0);
+  timeOut = s;
+  InputScanner::Default().SetHold(inputId, duration_cast<std::chrono::milliseconds>(timeOut).count());
 }
 
 bool PIR::Status()
@@ -41,101 +42,57 @@ bool PIR::Status()
   return PIRLastStatus;
 }
 
-void PIR::run(void* arg)
+void PIR::OnInput(void* ctx, const InputEvent_t& event)
 {
-  while (1)
+  PIR* _this = static_cast<PIR*>(ctx);
+  switch (event.kind)
   {
-    auto bit = xEventGroupWaitBits(events, this->ISR_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(duration_cast<std::chrono::milliseconds>(timeOut).count()));
-    auto _now = GET_NOW_SECONDS;
-    if (bit & ISR_EVENT)
-    {
-      std::this_thread::sleep_for(20ms);
-      status = gpio_get_level(pin);
-      bool error = false;
-      for (int i = 0; i < 3; i++)
-      {
-        if (status != gpio_get_level(pin))
-        {
-          error = true;
-        }
-        std::this_thread::sleep_for(20ms);
-      }
-      if (error)
-        continue;
-      if (status)
-      {
-        loop->post_event(EVENT_PIR_PIN_ON);
-      }
-      else
-      {
-        loop->post_event(EVENT_PIR_PIN_OFF);
-      }
-      if (status && status == PIRLastStatus)
-      {
-
-        PIRTimeout = _now + (timeOut.count());
-        continue;
-      }
-    }
-    else
-    {
-      status = gpio_get_level(pin);
-    }
-    if (PIRLastStatus != status)
-    {
-      //
-      loop->post_event(EVENT_PIR_CHANGED);
-      if (status)
-      {
-        PIRTimeout = _now + (timeOut.count());
-        PIRLastStatus = status;
-        ESP_LOGI("pir", "PIR on");
-        loop->post_event(EVENT_PIR_ON);
-      }
-      else
-      {
-        if (_now > PIRTimeout)
-        {
-          ESP_LOGI("pir", "PIR off");
-          PIRLastStatus = status;
-          loop->post_event(EVENT_PIR_OFF);
-          continue;
-        }
-      }
-    }
+  case InputEvent_t::ON:
+    _this->status = true;
+    _this->loop->post_event(_this->EVENT_PIR_PIN_ON);
+    break;
+  case InputEvent_t::OFF:
+    _this->status = false;
+    _this->loop->post_event(_this->EVENT_PIR_PIN_OFF);
+    break;
+  case InputEvent_t::HOLD_ON:
+    ESP_LOGI("pir", "PIR on");
+    _this->PIRLastStatus = true;
+    _this->loop->post_event(_this->EVENT_PIR_CHANGED);
+    _this->loop->post_event(_this->EVENT_PIR_ON);
+    break;
+  case InputEvent_t::HOLD_OFF:
+    ESP_LOGI("pir", "PIR off");
+    _this->PIRLastStatus = false;
+    _this->loop->post_event(_this->EVENT_PIR_CHANGED);
+    _this->loop->post_event(_this->EVENT_PIR_OFF);
+    break;
+  default:
+    break;
   }
 }
 
-SWITCH::SWITCH(EventLoop_p_t& _loop, gpio_num_t _pin, gpio_mode_t _mode) : Task("switvch"), loop(_loop)
+SWITCH::SWITCH(EventLoop_p_t& _loop, gpio_num_t _pin, gpio_mode_t _mode) : loop(_loop)
 {
   Setup(_pin, _mode);
 }
 
-void SWITCH::Setup(gpio_num_t _pin, gpio_mode_t _mode)
+SWITCH::~SWITCH()
 {
-  pin = _pin;
-  SWITCH_events = xEventGroupCreate();
-  gpio_config_t io_conf;
-  memset(&io_conf, 0, sizeof(gpio_config_t));
-  io_conf.mode = _mode;
-  io_conf.intr_type = GPIO_INTR_ANYEDGE;
-  io_conf.pin_bit_mask = (1ULL << pin);
-  io_conf.pull_down_en = GPIO_PULLDOWN_ENABLE;
-  io_conf.pull_up_en = GPIO_PULLUP_DISABLE;
-  gpio_config(&io_conf);
-  gpio_install_isr_service(0);
-  gpio_isr_handler_add(pin, ISR_Handler, this);
-  status = gpio_get_level(pin);
-  StartTask(this);
-
+  InputScanner::Default().Remove(inputId);
 }
 
-
-void IRAM_ATTR SWITCH::ISR_Handler(void* arg)
+void SWITCH::Setup(gpio_num_t _pin, gpio_mode_t _mode)
 {
-  SWITCH* _this = static_cast<SWITCH*>(arg);
-  xEventGroupSetBitsFromISR(_this->SWITCH_events, _this->ISR_EVENT, 0);
-  _this->status = gpio_get_level(_this->pin);
+  pin = _pin;
+  InputLevelConfig_t config;
+  config.pull = InputBackend::PULL_DOWN;
+  esp_err_t ret = InputScanner::Default().AddLevel(pin, OnInput, this, config, &inputId);
+  if (ret != ESP_OK)
+  {
+    ESP_LOGE("SW", "input register ERROR %s", esp_err_to_name(ret));
+  }
+  status = InputScanner::Default().GetState(inputId);
 }
 
 bool SWITCH::Status()
@@ -143,29 +100,25 @@ bool SWITCH::Status()
   return status;
 }
 
-void SWITCH::run(void* arg)
+void SWITCH::OnInput(void* ctx, const InputEvent_t& event)
 {
-  while (1)
+  SWITCH* _this = static_cast<SWITCH*>(ctx);
+  if (event.kind != InputEvent_t::ON && event.kind != InputEvent_t::OFF)
+  {
+    return;
+  }
+  _this->status = (event.kind == InputEvent_t::ON);
+  _this->loop->post_event(EVENT_SW_CHANGED);
+  if (_this->status)
+  {
+    ESP_LOGI("SW", "SW on");
+    _this->loop->post_event(EVENT_SW_ON);
+  }
+  else
   {
-    xEventGroupWaitBits(this->SWITCH_events, this->ISR_EVENT, pdTRUE, pdTRUE, portMAX_DELAY);
-    if (status != lastStatus)
-    {
-      xEventGroupSetBits(SWITCH_events, Changed_EVENT);
-      loop->post_event(EVENT_SW_CHANGED);
-      if (status)
-      {
-        ESP_LOGI("SW", "SW on");
-        loop->post_event(EVENT_SW_ON);
-      }
-      else
-      {
-        ESP_LOGI("SW", "SW off");
-        loop->post_event(EVENT_SW_OFF);
-      }
-      lastStatus = status;
-    }
-    vTaskDelay(pdMS_TO_TICKS(500));
+    ESP_LOGI("SW", "SW off");
+    _this->loop->post_event(EVENT_SW_OFF);
   }
 }
 
-SWITCH* Switch;
\ No newline at end of file
+SWITCH* Switch;
@@ -0,0 +1,374 @@
+/**
+ * @file test_base64.cpp
+ * @brief Base64 on each path ( SCALAR, SSSE3, AVX2 ) : round trips of 0..600 bytes identical to the old
+ * bytewise encoder, out buffers without slack, bad characters at every offset of the SIMD blocks, STRICT
+ * padding and trailing bit rejection, LENIENT whitespace and padding. the benchmark reports GB/s of input
+ * from 64 B to 1 MB against the old tools::base64Encode / base64Decode ( ./host_test/run.sh base64 )
+ */
+#include "base64.hpp"
+#include "host_test.hpp"
+#include <string>
+#include <vector>
+
+static const Base64::Path_t kPaths[] = {Base64::SCALAR, Base64::SSSE3, Base64::AVX2};
+static const char *kPathNames[] = {"scalar", "ssse3", "avx2"};
+
+// the bytewise functions tools::base64Encode / base64Decode had before Base64
+namespace legacy
+{
+    static const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                          "abcdefghijklmnopqrstuvwxyz"
+                                          "0123456789+/";
+
+    static void a3_to_a4(unsigned char *a4, unsigned char *a3)
+    {
+        a4[0] = (a3[0] & 0xfc) >> 2;
+        a4[1] = ((a3[0] & 0x03) << 4) + ((a3[1] & 0xf0) >> 4);
+        a4[2] = ((a3[1] & 0x0f) << 2) + ((a3[2] & 0xc0) >> 6);
+        a4[3] = (a3[2] & 0x3f);
+    }
+
+    static void a4_to_a3(unsigned char *a3, unsigned char *a4)
+    {
+        a3[0] = (a4[0] << 2) + ((a4[1] & 0x30) >> 4);
+        a3[1] = ((a4[1] & 0xf) << 4) + ((a4[2] & 0x3c) >> 2);
+        a3[2] = ((a4[2] & 0x3) << 6) + a4[3];
+    }
+
+    static unsigned char b64_lookup(unsigned char c)
+    {
+        if (c >= 'A' && c <= 'Z')
+            return c - 'A';
+        if (c >= 'a' && c <= 'z')
+            return c - 71;
+        if (c >= '0' && c <= '9')
+            return c + 4;
+        if (c == '+')
+            return 62;
+        if (c == '/')
+            return 63;
+        return 255;
+    }
+
+    static bool Encode(const std::string &in, std::string *out)
+    {
+        int i = 0, j = 0;
+        size_t enc_len = 0;
+        unsigned char a3[3];
+        unsigned char a4[4];
+        out->resize((in.size() + 2 - ((in.size() + 2) % 3)) / 3 * 4);
+        int input_len = in.size();
+        std::string::const_iterator input = in.begin();
+        while (input_len--)
+        {
+            a3[i++] = *(input++);
+            if (i == 3)
+            {
+                a3_to_a4(a4, a3);
+                for (i = 0; i < 4; i++)
+                {
+                    (*out)[enc_len++] = kBase64Alphabet[a4[i]];
+                }
+                i = 0;
+            }
+        }
+        if (i)
+        {
+            for (j = i; j < 3; j++)
+            {
+                a3[j] = '\0';
+            }
+            a3_to_a4(a4, a3);
+            for (j = 0; j < i + 1; j++)
+            {
+                (*out)[enc_len++] = kBase64Alphabet[a4[j]];
+            }
+            while ((i++ < 3))
+            {
+                (*out)[enc_len++] = '=';
+            }
+        }
+        return (enc_len == out->size());
+    }
+
+    static bool Decode(const std::string &in, std::string *out)
+    {
+        int i = 0, j = 0;
+        size_t dec_len = 0;
+        unsigned char a3[3];
+        unsigned char a4[4];
+        int input_len = in.size();
+        std::string::const_iterator input = in.begin();
+        int numEq = 0;
+        for (std::string::const_reverse_iterator it = in.rbegin(); it != in.rend() && *it == '='; ++it)
+        {
+            ++numEq;
+        }
+        out->resize(((6 * in.size()) / 8) - numEq);
+        while (input_len--)
+        {
+            if (*input == '=')
+            {
+                break;
+            }
+            a4[i++] = *(input++);
+            if (i == 4)
+            {
+                for (i = 0; i < 4; i++)
+                {
+                    a4[i] = b64_lookup(a4[i]);
+                }
+                a4_to_a3(a3, a4);
+                for (i = 0; i < 3; i++)
+                {
+                    (*out)[dec_len++] = a3[i];
+                }
+                i = 0;
+            }
+        }
+        if (i)
+        {
+            for (j = i; j < 4; j++)
+            {
+                a4[j] = '\0';
+            }
+            for (j = 0; j < 4; j++)
+            {
+                a4[j] = b64_lookup(a4[j]);
+            }
+            a4_to_a3(a3, a4);
+            for (j = 0; j < i - 1; j++)
+            {
+                (*out)[dec_len++] = a3[j];
+            }
+        }
+        return (dec_len == out->size());
+    }
+} // namespace legacy
+
+static std::string Bytes(size_t length, uint32_t seed)
+{
+    std::string bytes(length, '\0');
+    for (char &c : bytes)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        c = static_cast<char>(seed >> 24);
+    }
+    return bytes;
+}
+
+static std::string Encode(std::string_view in, Base64::Path_t path)
+{
+    std::string text(Base64::EncodedLength(in.size()), '\0');
+    size_t written = 0;
+    CHECK_EQ(Base64::Encode(in, text.data(), text.size(), &written, path), ESP_OK);
+    CHECK_EQ(written, text.size());
+    return text;
+}
+
+// decoded into a buffer of exactly \c room bytes, on the heap so ASan sees a write past it
+static esp_err_t Decode(std::string_view in, std::string &out, Base64::Mode_t mode, Base64::Path_t path, size_t room)
+{
+    std::vector<uint8_t> buffer(room);
+    size_t written = 0;
+    const esp_err_t ret = Base64::Decode(in, buffer.data(), buffer.size(), &written, mode, path);
+    out.assign(reinterpret_cast<const char *>(buffer.data()), written);
+    return ret;
+}
+
+static esp_err_t Decode(std::string_view in, std::string &out, Base64::Mode_t mode = Base64::STRICT, Base64::Path_t path = Base64::SCALAR)
+{
+    return Decode(in, out, mode, path, Base64::DecodedLength(in.size()));
+}
+
+static void TestRoundTrip(Base64::Path_t path)
+{
+    int identical = 0, decoded = 0;
+    for (size_t length = 0; length < 600; length++)
+    {
+        const std::string bytes = Bytes(length, static_cast<uint32_t>(length));
+        const std::string text = Encode(bytes, path);
+        std::string old;
+        legacy::Encode(bytes, &old);
+        identical += (text == old);
+        std::string back, exact;
+        // with the slack of DecodedLength(), then into exactly the decoded size
+        decoded += (Decode(text, back, Base64::STRICT, path) == ESP_OK && back == bytes);
+        decoded += (Decode(text, exact, Base64::STRICT, path, length) == ESP_OK && exact == bytes);
+        decoded += (Decode(text, back, Base64::LENIENT, path) == ESP_OK && back == bytes);
+    }
+    CHECK_EQ(identical, 600);
+    CHECK_EQ(decoded, 3 * 600);
+    // every value of every position
+    std::string all;
+    for (int i = 0; i < 256 * 3; i++)
+    {
+        all += static_cast<char>(i);
+    }
+    std::string back;
+    CHECK_EQ(Decode(Encode(all, path), back, Base64::STRICT, path), ESP_OK);
+    CHECK(back == all);
+    // one byte short : the bytes that fit, then ESP_ERR_INVALID_SIZE
+    const std::string bytes = Bytes(100, 7);
+    CHECK_EQ(Decode(Encode(bytes, path), back, Base64::STRICT, path, 99), ESP_ERR_INVALID_SIZE);
+    CHECK(back == bytes.substr(0, back.size()));
+    char small[3];
+    size_t written = 1;
+    CHECK_EQ(Base64::Encode("abcd", small, sizeof(small), &written, path), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(written, 0u);
+}
+
+static void TestBadCharacters(Base64::Path_t path)
+{
+    // a bad character at each offset of two AVX2 blocks : refused, what came before decoded
+    const std::string bytes = Bytes(96, 3);
+    const std::string text = Encode(bytes, path);
+    int refused = 0, prefix = 0;
+    for (size_t i = 0; i < 64; i++)
+    {
+        for (const char bad : {'*', '\0', '\x80', '\xff', '-', '_'})
+        {
+            std::string copy = text;
+            copy[i] = bad;
+            std::string back;
+            refused += (Decode(copy, back, Base64::STRICT, path) == ESP_ERR_INVALID_ARG);
+            refused += (Decode(copy, back, Base64::LENIENT, path) == ESP_ERR_INVALID_ARG);
+            prefix += (back.size() <= i / 4 * 3 && back == bytes.substr(0, back.size()));
+        }
+    }
+    CHECK_EQ(refused, 2 * 64 * 6);
+    CHECK_EQ(prefix, 64 * 6);
+}
+
+static void TestStrict()
+{
+    std::string out;
+    CHECK_EQ(Decode("", out), ESP_OK);
+    CHECK(out.empty());
+    CHECK_EQ(Decode("QQ==", out), ESP_OK);
+    CHECK(out == "A");
+    CHECK_EQ(Decode("QUI=", out), ESP_OK);
+    CHECK(out == "AB");
+    // padding : missing, short, too long, in the middle, alone
+    for (const char *bad : {"QQ", "QUI", "QQ=", "QQ===", "Q===", "====", "QQ==QUJD", "QUJD=", "QQ=A", "=QUJ"})
+    {
+        CHECK_EQ(Decode(bad, out), ESP_ERR_INVALID_ARG);
+    }
+    // the unused bits of the last character must be 0
+    CHECK_EQ(Decode("QR==", out), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(Decode("QUJ=", out), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(Decode("QUK=", out), ESP_ERR_INVALID_ARG);
+    // no whitespace
+    CHECK_EQ(Decode("QUJD\n", out), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(Decode("QU JD", out), ESP_ERR_INVALID_ARG);
+    // the same, lenient
+    CHECK_EQ(Decode("QR==", out, Base64::LENIENT), ESP_OK);
+    CHECK(out == "A");
+    CHECK_EQ(Decode("QQ", out, Base64::LENIENT), ESP_OK);
+    CHECK(out == "A");
+    CHECK_EQ(Decode("QUI", out, Base64::LENIENT), ESP_OK);
+    CHECK(out == "AB");
+    CHECK_EQ(Decode("Q", out, Base64::LENIENT), ESP_ERR_INVALID_ARG);
+}
+
+static void TestLenient(Base64::Path_t path)
+{
+    // PEM : 64 character lines, CRLF, the blob indented
+    const std::string bytes = Bytes(1000, 11);
+    const std::string text = Encode(bytes, path);
+    std::string pem = "  ";
+    for (size_t i = 0; i < text.size(); i += 64)
+    {
+        pem += text.substr(i, 64) + "\r\n";
+    }
+    pem += "\t \n";
+    std::string back;
+    CHECK_EQ(Decode(pem, back, Base64::LENIENT, path), ESP_OK);
+    CHECK(back == bytes);
+    CHECK_EQ(Decode(pem, back, Base64::STRICT, path), ESP_ERR_INVALID_ARG);
+    // whitespace inside a quartet, and anything after the first '=' ignored
+    CHECK_EQ(Decode("Q U\nJ\tD QQ==garbage*", back, Base64::LENIENT, path), ESP_OK);
+    CHECK(back == "ABCA");
+    CHECK_EQ(Decode(" \r\n", back, Base64::LENIENT, path), ESP_OK);
+    CHECK(back.empty());
+    // other control characters are not whitespace
+    CHECK_EQ(Decode("QUJD\vQUJD", back, Base64::LENIENT, path), ESP_ERR_INVALID_ARG);
+}
+
+static double GBps(size_t bytes, double ns)
+{
+    return static_cast<double>(bytes) / ns;
+}
+
+static void Bench()
+{
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    const char *build = "sanitizer build, several times slower than -O2";
+#else
+    const char *build = "no sanitizer";
+#endif
+    printf("GB/s of input ( %s ), best path on this cpu : %s\n", build, kPathNames[Base64::BestPath()]);
+    printf("   size | encode legacy scalar ssse3  avx2 | decode legacy scalar ssse3  avx2\n");
+    for (const size_t size : {size_t{64}, size_t{1024}, size_t{16384}, size_t{1} << 20})
+    {
+        const std::string bytes = Bytes(size, 5);
+        const std::string text = Encode(bytes, Base64::SCALAR);
+        const size_t rounds = (size_t{4} << 20) / size; // 4 MB per cell
+        std::string legacyOut;
+        std::vector<char> encoded(Base64::EncodedLength(size));
+        std::vector<uint8_t> decoded(Base64::DecodedLength(text.size()));
+        size_t written = 0;
+        double encode[4], decode[4];
+        encode[0] = GBps(size, host_test::NsPer(rounds, [&]() {
+                             for (size_t r = 0; r < rounds; r++)
+                             {
+                                 legacy::Encode(bytes, &legacyOut);
+                             }
+                         }));
+        decode[0] = GBps(text.size(), host_test::NsPer(rounds, [&]() {
+                             for (size_t r = 0; r < rounds; r++)
+                             {
+                                 legacy::Decode(text, &legacyOut);
+                             }
+                         }));
+        CHECK(legacyOut == bytes);
+        for (int p = 0; p < 3; p++)
+        {
+            encode[p + 1] = GBps(size, host_test::NsPer(rounds, [&]() {
+                                     for (size_t r = 0; r < rounds; r++)
+                                     {
+                                         Base64::Encode(bytes, encoded.data(), encoded.size(), &written, kPaths[p]);
+                                     }
+                                 }));
+            decode[p + 1] = GBps(text.size(), host_test::NsPer(rounds, [&]() {
+                                     for (size_t r = 0; r < rounds; r++)
+                                     {
+                                         Base64::Decode(text, decoded.data(), decoded.size(), &written, Base64::STRICT, kPaths[p]);
+                                     }
+                                 }));
+            CHECK_EQ(written, size);
+        }
+        CHECK(encode[1] > encode[0]);
+        CHECK(decode[1] > decode[0]);
+        printf("%5zu %s |        %6.2f %6.2f %5.2f %5.2f |        %6.2f %6.2f %5.2f %5.2f\n",
+               size < 1024 ? size : size >> 10, size < 1024 ? "B" : "K",
+               encode[0], encode[1], encode[2], encode[3], decode[0], decode[1], decode[2], decode[3]);
+    }
+}
+
+int main()
+{
+    for (int p = 0; p < 3; p++)
+    {
+        if (Base64::BestPath() < kPaths[p])
+        {
+            printf("%s : not supported by this cpu, runs the best path there is\n", kPathNames[p]);
+        }
+        TestRoundTrip(kPaths[p]);
+        TestBadCharacters(kPaths[p]);
+        TestLenient(kPaths[p]);
+    }
+    TestStrict();
+    Bench();
+    HOST_TEST_END();
+}
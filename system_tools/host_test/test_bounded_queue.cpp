@@ -0,0 +1,215 @@
+/**
+ * @file test_bounded_queue.cpp
+ * @brief BoundedQueue : exactly once delivery with 1 to 8 producers and consumers, move only elements,
+ * batch push / pop, timeouts and the SafeQueue facade. the benchmark reports ops/s and the push to pop
+ * latency percentiles against SafeQueue for the same threads ( ./host_test/run.sh bounded_queue )
+ */
+#include "bounded_queue.hpp"
+#include "_pthread.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct Item_t
+{
+    uint64_t pushedNs;
+    uint32_t producer;
+    uint32_t seq;
+};
+
+static uint64_t NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static void TestMoveOnly()
+{
+    BoundedQueue<std::unique_ptr<int>> queue(3); // rounded to 4
+    CHECK_EQ(queue.capacity(), 4u);
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.try_push(std::make_unique<int>(i)));
+    }
+    CHECK(!queue.try_push(std::make_unique<int>(9)));
+    CHECK(!queue.push_for(std::make_unique<int>(9), std::chrono::milliseconds(5)));
+    std::unique_ptr<int> out;
+    CHECK(queue.try_pop(out));
+    CHECK_EQ(*out, 0);
+    std::unique_ptr<int> batch[8];
+    CHECK_EQ(queue.try_pop_n(batch, 8), 3u);
+    CHECK_EQ(*batch[2], 3);
+    CHECK(!queue.try_pop(out));
+    CHECK(!queue.pop_for(out, std::chrono::milliseconds(5)));
+    CHECK_EQ(queue.pop_n(batch, 8, std::chrono::milliseconds(5)), 0u);
+
+    std::unique_ptr<int> in[6];
+    for (int i = 0; i < 6; i++)
+    {
+        in[i] = std::make_unique<int>(10 + i);
+    }
+    CHECK_EQ(queue.try_push_n(in, 6), 4u); // the rest stays with the caller
+    CHECK(in[4] != nullptr);
+    CHECK_EQ(queue.pop_n(batch, 8, std::chrono::milliseconds(5)), 4u);
+    CHECK_EQ(*batch[3], 13);
+}
+
+static void TestFacade()
+{
+    BoundedQueue<int> queue(4);
+    queue.enqueue(7);
+    CHECK_EQ(queue.dequeue(), 7);
+    CHECK(!queue.dequeue_wait_for(std::chrono::milliseconds(5)).has_value());
+    // an element pushed while the consumer is parked wakes it
+    std::thread late([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.enqueue(8);
+    });
+    const auto value = queue.dequeue_wait_for(std::chrono::seconds(5));
+    CHECK(value.has_value() && *value == 8);
+    late.join();
+}
+
+/**
+ * @brief \c producers push \c perProducer items each, \c consumers pop them.
+ * returns the ops/s, fills the sorted latencies ( ns ) and counts the items seen not exactly once
+ */
+template <typename Push, typename Pop>
+static double Run(int producers, int consumers, uint32_t perProducer, Push push, Pop pop, std::vector<uint64_t> &latencies, int &errors)
+{
+    const uint64_t total = static_cast<uint64_t>(producers) * perProducer;
+    std::vector<std::atomic<uint8_t>> seen(total);
+    std::atomic<uint64_t> popped{0};
+    std::atomic<int> bad{0};
+    std::vector<std::vector<uint64_t>> lat(consumers);
+    std::vector<std::thread> threads;
+    const auto start = Clock::now();
+    for (int c = 0; c < consumers; c++)
+    {
+        threads.emplace_back([&, c]() {
+            lat[c].reserve(total / consumers + 1);
+            Item_t item{};
+            while (popped.load(std::memory_order_relaxed) < total)
+            {
+                if (!pop(item))
+                {
+                    continue;
+                }
+                popped++;
+                lat[c].push_back(NowNs() - item.pushedNs);
+                const uint64_t index = static_cast<uint64_t>(item.producer) * perProducer + item.seq;
+                if (index >= total || seen[index].fetch_add(1) != 0)
+                {
+                    bad++;
+                }
+            }
+        });
+    }
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&, p]() {
+            for (uint32_t i = 0; i < perProducer; i++)
+            {
+                push(Item_t{NowNs(), static_cast<uint32_t>(p), i});
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (uint64_t i = 0; i < total; i++)
+    {
+        bad += (seen[i].load() != 1);
+    }
+    errors = bad;
+    latencies.clear();
+    for (auto &l : lat)
+    {
+        latencies.insert(latencies.end(), l.begin(), l.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return total / seconds;
+}
+
+static uint64_t Percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+static void Bench()
+{
+    constexpr uint32_t TOTAL = 200000;
+    for (int threads : {1, 2, 4, 8})
+    {
+        const uint32_t perProducer = TOTAL / threads;
+        std::vector<uint64_t> latencies;
+        int errors = 0;
+
+        BoundedQueue<Item_t, true> bounded(256);
+        const double boundedOps = Run(
+            threads, threads, perProducer, [&](Item_t &&item) { bounded.push(std::move(item)); },
+            [&](Item_t &item) { return bounded.pop_for(item, std::chrono::milliseconds(10)); }, latencies, errors);
+        CHECK_EQ(errors, 0);
+        const uint64_t b50 = Percentile(latencies, 0.5), b99 = Percentile(latencies, 0.99), b999 = Percentile(latencies, 0.999);
+
+        // the batch consumer : one wake for up to 16 elements
+        BoundedQueue<Item_t, true> batched(256);
+        Item_t pending[16];
+        size_t pendingCount = 0, pendingNext = 0;
+        std::mutex pendingLock; // consumers share one staging buffer : keeps Run() generic
+        const double batchOps = Run(
+            threads, threads, perProducer, [&](Item_t &&item) { batched.push(std::move(item)); },
+            [&](Item_t &item) {
+                std::lock_guard<std::mutex> guard(pendingLock);
+                if (pendingNext == pendingCount)
+                {
+                    pendingNext = 0;
+                    pendingCount = batched.pop_n(pending, 16, std::chrono::milliseconds(10));
+                    if (pendingCount == 0)
+                    {
+                        return false;
+                    }
+                }
+                item = pending[pendingNext++];
+                return true;
+            },
+            latencies, errors);
+        CHECK_EQ(errors, 0);
+
+        SafeQueue<Item_t> safe;
+        const double safeOps = Run(
+            threads, threads, perProducer, [&](Item_t &&item) { safe.enqueue(item); },
+            [&](Item_t &item) {
+                auto value = safe.dequeue_wait_for(std::chrono::milliseconds(10));
+                if (!value)
+                {
+                    return false;
+                }
+                item = *value;
+                return true;
+            },
+            latencies, errors);
+        CHECK_EQ(errors, 0);
+
+        printf("%d producers / %d consumers : BoundedQueue %.2f Mops/s ( p50 %llu ns, p99 %llu ns, p99.9 %llu ns ), "
+               "pop_n %.2f Mops/s, SafeQueue %.2f Mops/s ( p50 %llu ns, p99 %llu ns, p99.9 %llu ns )\n",
+               threads, threads, boundedOps / 1e6, (unsigned long long)b50, (unsigned long long)b99, (unsigned long long)b999,
+               batchOps / 1e6, safeOps / 1e6, (unsigned long long)Percentile(latencies, 0.5),
+               (unsigned long long)Percentile(latencies, 0.99), (unsigned long long)Percentile(latencies, 0.999));
+    }
+}
+
+int main()
+{
+    TestMoveOnly();
+    TestFacade();
+    Bench();
+    HOST_TEST_END();
+}
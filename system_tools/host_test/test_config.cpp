@@ -0,0 +1,393 @@
+/**
+ * @file test_config.cpp
+ * @brief Config dispatch of inbound mqtt commands : route from the topic suffix ( substring fallback ),
+ * filtered parse that drops the sub objects of unknown classes and keeps system_request_*. the benchmark
+ * routes messages with unrelated siblings through the wrapper and the old full parse + map lookup,
+ * msgs/s and peak heap of one message. the dumps : a clean fragment is reused, a dirty one re-rendered,
+ * an override that looks classes up does not deadlock, and the dump of 50 classes against the old
+ * json of everything, allocations and us per dump ( ./host_test/run.sh config )
+ */
+#include "config.hpp"
+#include "host_test.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <thread>
+#include <vector>
+
+// heap use of the code under test : every operator new is counted
+namespace heap
+{
+    static std::atomic<size_t> live{0};
+    static std::atomic<size_t> peak{0};
+    static std::atomic<size_t> allocations{0};
+    static constexpr size_t HEADER = alignof(std::max_align_t);
+
+    static void Reset()
+    {
+        peak = live.load();
+        allocations = 0;
+    }
+    // bytes over what was live at Reset()
+    static size_t PeakSince(size_t base) { return peak - base; }
+} // namespace heap
+
+void *operator new(size_t size)
+{
+    char *block = static_cast<char *>(malloc(size + heap::HEADER));
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t *>(block) = size;
+    const size_t live = heap::live += size;
+    size_t peak = heap::peak;
+    while (live > peak && !heap::peak.compare_exchange_weak(peak, live))
+    {
+    }
+    heap::allocations++;
+    return block + heap::HEADER;
+}
+void operator delete(void *pointer) noexcept
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+    char *block = static_cast<char *>(pointer) - heap::HEADER;
+    heap::live -= *reinterpret_cast<size_t *>(block);
+    free(block);
+}
+void operator delete(void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+// a class that records what reaches it
+class Probe_t : public Config
+{
+public:
+    explicit Probe_t(const char *_name) : Config(_name), name(_name) {}
+    const std::string name;
+    json lastConfig;
+    json lastCommand;
+    int configs = 0;
+    int commands = 0;
+    int value = 0;
+
+    mutable int renders = 0;
+    mutable int statusRenders = 0;
+    std::function<void()> onRender = nullptr;
+
+    // what the old dispatch reached through the protected virtual
+    esp_err_t Apply(const json &config_in) { return SetConfigurationParameters(config_in); }
+    esp_err_t Render(json &config_out) const { return GetConfiguration(config_out); }
+    // a change outside SetConfigurationParameters, like vswitch_t::Set
+    void SetValue(int _value, bool mark)
+    {
+        value = _value;
+        if (mark)
+        {
+            MarkConfigDirty();
+        }
+    }
+    void TrackStatus() { MarkStatusDirty(); }
+
+protected:
+    esp_err_t SetConfigurationParameters(const json &config_in) override
+    {
+        configs++;
+        lastConfig = config_in;
+        const json &own = config_in.at(name);
+        if (own.contains("value"))
+        {
+            value = own["value"];
+        }
+        return ESP_OK;
+    }
+    esp_err_t MqttCommandCallBack(const json &config_in) override
+    {
+        commands++;
+        lastCommand = config_in;
+        return ESP_OK;
+    }
+    esp_err_t GetConfiguration(json &config_out) const override
+    {
+        renders++;
+        if (onRender != nullptr)
+        {
+            onRender();
+        }
+        config_out[name] = {{"value", value}, {"label", "living room"}, {"levels", {10, 20, 30}}};
+        return ESP_OK;
+    }
+    esp_err_t GetConfigurationStatus(json &config_out) const override
+    {
+        statusRenders++;
+        config_out[name] = {{"alive", true}};
+        return ESP_OK;
+    }
+};
+
+static esp_err_t Route(const char *topic, const std::string &payload)
+{
+    return ConfigAction::MqttCommandCallBackWrapper(topic, payload);
+}
+
+static void TestRouting(Probe_t &a, Probe_t &b)
+{
+    // suffix
+    CHECK_EQ(Route("home/dev/config", R"({"config":{"probeA":{"value":3}}})"), ESP_OK);
+    CHECK_EQ(a.configs, 1);
+    CHECK_EQ(a.value, 3);
+    CHECK_EQ(Route("home/dev/action", R"({"command":{"probeB":{"open":1}}})"), ESP_OK);
+    CHECK_EQ(b.commands, 1);
+    CHECK(b.lastCommand.contains("probeB"));
+    // the suffix wins over a substring elsewhere in the topic
+    CHECK_EQ(Route("actions/dev/config", R"({"config":{"probeA":{"value":4}}})"), ESP_OK);
+    CHECK_EQ(a.value, 4);
+    CHECK_EQ(b.commands, 1);
+    // substring fallback
+    CHECK_EQ(Route("home/dev/config_set", R"({"config":{"probeA":{"value":5}}})"), ESP_OK);
+    CHECK_EQ(a.value, 5);
+    CHECK_EQ(Route("home/action/dev", R"({"command":{"probeA":{"x":1}}})"), ESP_OK);
+    CHECK_EQ(a.commands, 1);
+    // no route : nothing parsed, nothing called
+    CHECK_EQ(Route("home/dev/state", R"({"config":{"probeA":{"value":9}}})"), ESP_ERR_INVALID_RESPONSE);
+    CHECK_EQ(a.value, 5);
+    CHECK_EQ(Route("home/dev/config", "{not json"), ESP_ERR_INVALID_STATE);
+}
+
+static void TestFilteredParse(Probe_t &a)
+{
+    // unknown classes and foreign roots never reach the class
+    CHECK_EQ(Route("home/dev/config", R"({"junk":[1,2,3],"config":{"ghost":{"x":1},"probeA":{"value":7},"other":{"deep":{"y":[1]}}},"command":{"probeA":{}}})"), ESP_OK);
+    CHECK_EQ(a.value, 7);
+    CHECK_EQ(a.lastConfig.size(), 1u);
+    CHECK(a.lastConfig.contains("probeA"));
+    CHECK(!a.lastConfig.contains("ghost"));
+    CHECK(!a.lastConfig.contains("other"));
+    // only unknown classes : nothing to dispatch
+    const int configs = a.configs;
+    CHECK_EQ(Route("home/dev/config", R"({"config":{"ghost":{"value":1}}})"), ESP_FAIL);
+    CHECK_EQ(a.configs, configs);
+    // the action root is "command", a "config" root on an action topic is dropped
+    const int commands = a.commands;
+    CHECK_EQ(Route("home/dev/action", R"({"config":{"probeA":{"value":1}}})"), ESP_FAIL);
+    CHECK_EQ(a.commands, commands);
+    CHECK_EQ(a.value, 7);
+    // system requests are kept on the action route only
+    CHECK_EQ(Route("home/dev/action", R"({"command":{"ghost":{},"system_request_config":{}}})"), ESP_OK);
+    const std::string response = ConfigAction::LastActionResponse();
+    CHECK(response.rfind("{\"config\":{", 0) == 0);
+    CHECK(response.find("\"probeA\":{\"label\":\"living room\",\"levels\":[10,20,30],\"value\":7}") != std::string::npos);
+    CHECK_EQ(Route("home/dev/action", R"({"command":{"system_request_status":{}}})"), ESP_OK);
+    CHECK(ConfigAction::LastActionResponse().find("\"probeB\":{\"alive\":true}") != std::string::npos);
+    CHECK_EQ(Route("home/dev/config", R"({"config":{"system_request_config":{}}})"), ESP_FAIL);
+}
+
+// the pre-index dispatch : full parse, substring route, map lookup per key
+static esp_err_t OldRoute(const std::string &topic, const std::string &data)
+{
+    const json parent = json::parse(data);
+    if (topic.find("config") == std::string::npos || !parent.contains("config"))
+    {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    auto &list = Config::GetListOfConfig();
+    for (const auto &sub : parent["config"].items())
+    {
+        const char *tag = sub.key().c_str();
+        if (list.count(tag) > 0)
+        {
+            return static_cast<Probe_t *>(list[tag])->Apply(parent["config"]);
+        }
+    }
+    return ESP_FAIL;
+}
+
+static void Bench(Probe_t &a)
+{
+    // 20 classes registered, each message targets one and carries the state of 12 other devices
+    std::vector<std::unique_ptr<Probe_t>> others;
+    std::vector<std::string> names;
+    for (int i = 0; i < 18; i++)
+    {
+        names.push_back("class" + std::to_string(i));
+    }
+    for (const std::string &name : names)
+    {
+        others.emplace_back(new Probe_t(name.c_str()));
+    }
+    std::string payload = R"({"config":{)";
+    for (int i = 0; i < 12; i++)
+    {
+        payload += "\"device" + std::to_string(i) + R"(":{"name":"living room lamp","levels":[10,20,30,40,50,60],"schedule":{"on":"07:00","off":"23:30"}},)";
+    }
+    payload += R"("probeA":{"value":1}},"meta":{"source":"dashboard","user":"admin","tags":["a","b","c"]}})";
+    const std::string topic = "home/esp32/dev/config";
+
+    constexpr int MESSAGES = 3000;
+    size_t base = heap::live;
+    heap::Reset();
+    const double newNs = host_test::NsPer(MESSAGES, [&]()
+                                          {
+        for (int i = 0; i < MESSAGES; i++)
+        {
+            Route(topic.c_str(), payload);
+        } });
+    const size_t newPeak = heap::PeakSince(base);
+    const size_t newAllocs = heap::allocations / MESSAGES;
+
+    base = heap::live;
+    heap::Reset();
+    const double oldNs = host_test::NsPer(MESSAGES, [&]()
+                                          {
+        for (int i = 0; i < MESSAGES; i++)
+        {
+            OldRoute(topic, payload);
+        } });
+    const size_t oldPeak = heap::PeakSince(base);
+    const size_t oldAllocs = heap::allocations / MESSAGES;
+    CHECK(newPeak < oldPeak);
+    CHECK(newAllocs < oldAllocs);
+    CHECK_EQ(a.value, 1);
+    printf("%zu byte message, 20 classes : routed + filtered %.0f msgs/s, %zu allocations, peak heap %zu B | "
+           "full parse + map %.0f msgs/s, %zu allocations, peak heap %zu B\n",
+           payload.size(), 1e9 / newNs, newAllocs, newPeak, 1e9 / oldNs, oldAllocs, oldPeak);
+}
+
+static void TestFragments(Probe_t &a, Probe_t &b)
+{
+    ConfigAction::PrintDumpAllJsonConfig();
+    const int renders = a.renders;
+    const int statusRenders = b.statusRenders;
+    // clean : reused
+    const std::string first = ConfigAction::PrintDumpAllJsonConfig();
+    CHECK_EQ(a.renders, renders);
+    CHECK(ConfigAction::PrintDumpAllJsonConfig() == first);
+    // a change that does not mark keeps the cached fragment, the marked one is re-rendered once
+    a.SetValue(11, false);
+    CHECK(ConfigAction::PrintDumpAllJsonConfig() == first);
+    a.SetValue(12, true);
+    const std::string changed = ConfigAction::PrintDumpAllJsonConfig();
+    CHECK_EQ(a.renders, renders + 1);
+    CHECK(changed.find("\"value\":12") != std::string::npos);
+    ConfigAction::PrintDumpAllJsonConfig();
+    CHECK_EQ(a.renders, renders + 1);
+    // a config message marks the target only
+    const int bRenders = b.renders;
+    Route("home/dev/config", R"({"config":{"probeA":{"value":13}}})");
+    ConfigAction::PrintDumpAllJsonConfig();
+    CHECK_EQ(a.renders, renders + 2);
+    CHECK_EQ(b.renders, bRenders);
+    // untracked status on every dump, tracked status only when marked
+    ConfigAction::PrintDumpAllJsonStatus();
+    ConfigAction::PrintDumpAllJsonStatus();
+    CHECK_EQ(b.statusRenders, statusRenders + 2);
+    b.TrackStatus();
+    ConfigAction::PrintDumpAllJsonStatus();
+    ConfigAction::PrintDumpAllJsonStatus();
+    CHECK_EQ(b.statusRenders, statusRenders + 3);
+}
+
+// an override that routes a message ( registry lookup ) while the dump renders it
+static void TestRenderLookup(Probe_t &a)
+{
+    std::atomic<bool> done{false};
+    a.onRender = []() { Route("home/dev/config", R"({"config":{"probeB":{"value":2}}})"); };
+    a.SetValue(14, true);
+    std::thread dump([&]() {
+        ConfigAction::PrintDumpAllJsonConfig();
+        done = true;
+    });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK(done);
+    if (!done)
+    {
+        printf("the dump deadlocked on the registry lock\n");
+        fflush(stdout);
+        _Exit(1);
+    }
+    dump.join();
+    a.onRender = nullptr;
+    CHECK(ConfigAction::PrintDumpAllJsonConfig().find("\"probeB\":{\"label\":\"living room\",\"levels\":[10,20,30],\"value\":2}") != std::string::npos);
+}
+
+static void BenchDump(Probe_t &a)
+{
+    std::vector<std::unique_ptr<Probe_t>> probes;
+    std::vector<std::string> names;
+    for (int i = 0; i < 48; i++)
+    {
+        names.push_back("dump" + std::to_string(i)); // 50 with probeA and probeB
+    }
+    for (const std::string &name : names)
+    {
+        probes.emplace_back(new Probe_t(name.c_str()));
+    }
+    ConfigAction::PrintDumpAllJsonConfig(); // first render, buffers at capacity
+
+    constexpr int DUMPS = 2000;
+    std::string out;
+    heap::Reset();
+    const double cleanNs = host_test::NsPer(DUMPS, [&]()
+                                            {
+        for (int i = 0; i < DUMPS; i++)
+        {
+            out = ConfigAction::PrintDumpAllJsonConfig();
+        } });
+    const double cleanAllocs = static_cast<double>(heap::allocations) / DUMPS;
+
+    heap::Reset();
+    const double oneNs = host_test::NsPer(DUMPS, [&]()
+                                          {
+        for (int i = 0; i < DUMPS; i++)
+        {
+            probes[i % probes.size()]->SetValue(i, true);
+            out = ConfigAction::PrintDumpAllJsonConfig();
+        } });
+    const double oneAllocs = static_cast<double>(heap::allocations) / DUMPS;
+
+    // the old dump : one json of every class, dumped
+    std::string old;
+    heap::Reset();
+    const double oldNs = host_test::NsPer(DUMPS, [&]()
+                                          {
+        for (int i = 0; i < DUMPS; i++)
+        {
+            json all;
+            for (const auto &listed : Config::GetListOfConfig())
+            {
+                static_cast<Probe_t *>(listed.second)->Render(all["config"]);
+            }
+            old = all.dump();
+        } });
+    const double oldAllocs = static_cast<double>(heap::allocations) / DUMPS;
+    CHECK(old == out);
+    CHECK(cleanAllocs < 2);
+    CHECK(cleanNs < oldNs);
+    printf("50 classes, %zu byte dump : cached %.2f us, %.1f allocations | one dirty %.2f us, %.1f allocations | "
+           "json of everything %.2f us, %.1f allocations\n",
+           out.size(), cleanNs / 1000, cleanAllocs, oneNs / 1000, oneAllocs, oldNs / 1000, oldAllocs);
+}
+
+int main()
+{
+    Probe_t a("probeA");
+    Probe_t b("probeB");
+    TestRouting(a, b);
+    TestFilteredParse(a);
+    Bench(a);
+    TestFragments(a, b);
+    TestRenderLookup(a);
+    BenchDump(a);
+    HOST_TEST_END();
+}
@@ -0,0 +1,176 @@
+/**
+ * @file test_fast_format.cpp
+ * @brief ffmt : format_to_n cut at outSize - 1, terminated, nothing written past it and the full length
+ * reported, output past the 128 char stack buffer, append / format / formatted_size. tools::stringf below
+ * and from 128 chars ( its second vsnprintf pass ). the benchmark builds topics and a long response both
+ * ways, ns and allocations per call ( ./host_test/run.sh fast_format )
+ */
+#include "fast_format.hpp"
+#include "utilities.hpp"
+#include "host_test.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// allocations of operator new, per call in the benchmark
+static std::atomic<long> allocations{0};
+
+void *operator new(size_t size)
+{
+    void *block = malloc(size ? size : 1);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    allocations++;
+    return block;
+}
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+static void TestStringf()
+{
+    CHECK(tools::stringf("%s/%d", "room", 42) == "room/42");
+    CHECK(tools::stringf("") == "");
+    // 127 chars : the stack buffer, 128 and more : the second pass into the string
+    for (const size_t length : {size_t{127}, size_t{128}, size_t{129}, size_t{1000}})
+    {
+        const std::string text(length - 4, 'a');
+        const std::string out = tools::stringf("%s|%03d", text.c_str(), 7);
+        CHECK_EQ(out.size(), length);
+        CHECK(out == text + "|007");
+        CHECK_EQ(out.c_str()[length], '\0');
+    }
+    // the format string longer than the output, and the other way round
+    const std::string longFormat = std::string(200, ' ') + "%d";
+    CHECK(tools::stringf(longFormat, 5) == std::string(200, ' ') + "5");
+    CHECK_EQ(tools::stringf("%300d", 1).size(), 300u);
+}
+
+static void TestFormatToN()
+{
+    char out[16];
+    ffmt::Result_t result = ffmt::format_to_n(out, FMT_COMPILE("{}/{}"), "room", 42);
+    CHECK(result.text == "room/42");
+    CHECK_EQ(result.size, 7u);
+    CHECK(!result.truncated());
+    CHECK_EQ(out[7], '\0');
+    CHECK(std::string_view(result) == "room/42");
+
+    // 15 chars fit in 16
+    result = ffmt::format_to_n(out, FMT_COMPILE("{}"), "123456789012345");
+    CHECK(result.text == "123456789012345" && !result.truncated());
+    // cut : the size it needed, terminated, nothing past outSize
+    char guarded[12];
+    memset(guarded, '#', sizeof(guarded));
+    result = ffmt::format_to_n(guarded, 8, FMT_COMPILE("{}-{:04}"), "abcdef", 12);
+    CHECK(result.text == "abcdef-");
+    CHECK_EQ(result.size, 11u);
+    CHECK(result.truncated());
+    CHECK_EQ(guarded[7], '\0');
+    CHECK_EQ(guarded[8], '#');
+    result = ffmt::format_to_n(guarded, 1, FMT_COMPILE("{}"), 12345);
+    CHECK(result.text.empty() && result.size == 5 && guarded[0] == '\0');
+    memset(guarded, '#', sizeof(guarded));
+    result = ffmt::format_to_n(guarded, 0, FMT_COMPILE("{}"), 12345);
+    CHECK(result.text.empty() && result.size == 5 && guarded[1] == '#');
+
+    // past 128 chars : into an array that large, and cut into 16 past the spilled stack buffer
+    const std::string text(300, 'x');
+    char big[400];
+    result = ffmt::format_to_n(big, FMT_COMPILE("{}:{}"), text, 1);
+    CHECK(result.text == text + ":1");
+    result = ffmt::format_to_n(out, FMT_COMPILE("{}:{}"), text, 1);
+    CHECK_EQ(result.size, 302u);
+    CHECK(result.text == text.substr(0, 15));
+
+    std::string response = "Config";
+    ffmt::append(response, FMT_COMPILE(" to {} returned code {}"), "nvs", -1);
+    CHECK(response == "Config to nvs returned code -1");
+    CHECK(ffmt::format(FMT_COMPILE("{:.2f}|{:>5}|{:x}"), 21.456, "ab", 255) == "21.46|   ab|ff");
+    CHECK_EQ(ffmt::formatted_size(FMT_COMPILE("{}_{}"), "abc", 12345), 9u);
+    ffmt::Buffer<16> buffer;
+    ffmt::format_to(buffer, FMT_COMPILE("{}"), 1);
+    ffmt::format_to(buffer, FMT_COMPILE("/{}"), text);
+    CHECK_EQ(buffer.size(), 302u);
+}
+
+static void Bench()
+{
+    constexpr int CALLS = 100000;
+    const std::string room = "living_room", name = "blind", mac = "AABBCCDDEEFF";
+    size_t sink = 0;
+
+    // a HASS topic : short, fits the 128 char stack buffer of stringf
+    long start = allocations.load();
+    const double stringfNs = host_test::NsPer(CALLS, [&]() {
+        for (int i = 0; i < CALLS; i++)
+        {
+            sink += tools::stringf("%s/%s_%s/%s%d", room.c_str(), name.c_str(), mac.c_str(), "relay", i).size();
+        }
+    });
+    const double stringfAllocs = static_cast<double>(allocations.load() - start) / CALLS;
+    start = allocations.load();
+    const double formatNs = host_test::NsPer(CALLS, [&]() {
+        for (int i = 0; i < CALLS; i++)
+        {
+            sink += ffmt::format(FMT_COMPILE("{}/{}_{}/{}{}"), room, name, mac, "relay", i).size();
+        }
+    });
+    const double formatAllocs = static_cast<double>(allocations.load() - start) / CALLS;
+    start = allocations.load();
+    char topic[64];
+    const double toNNs = host_test::NsPer(CALLS, [&]() {
+        for (int i = 0; i < CALLS; i++)
+        {
+            sink += ffmt::format_to_n(topic, FMT_COMPILE("{}/{}_{}/{}{}"), room, name, mac, "relay", i).size;
+        }
+    });
+    const double toNAllocs = static_cast<double>(allocations.load() - start) / CALLS;
+    CHECK(std::string(topic) == tools::stringf("%s/%s_%s/%s%d", room.c_str(), name.c_str(), mac.c_str(), "relay", CALLS - 1));
+
+    // a config response past 128 chars : the second vsnprintf pass
+    const std::string payload(150, 'p');
+    start = allocations.load();
+    const double longStringfNs = host_test::NsPer(CALLS, [&]() {
+        for (int i = 0; i < CALLS; i++)
+        {
+            sink += tools::stringf("config %s to %s returned code %d", payload.c_str(), "nvs", i).size();
+        }
+    });
+    const double longStringfAllocs = static_cast<double>(allocations.load() - start) / CALLS;
+    start = allocations.load();
+    char response[256];
+    const double longToNNs = host_test::NsPer(CALLS, [&]() {
+        for (int i = 0; i < CALLS; i++)
+        {
+            sink += ffmt::format_to_n(response, FMT_COMPILE("config {} to {} returned code {}"), payload, "nvs", i).size;
+        }
+    });
+    const double longToNAllocs = static_cast<double>(allocations.load() - start) / CALLS;
+    CHECK(std::string(response) == tools::stringf("config %s to %s returned code %d", payload.c_str(), "nvs", CALLS - 1));
+    CHECK(sink != 0);
+    // the times depend on the build ( fmt under ASan against an uninstrumented vsnprintf ), the heap does not
+    CHECK(toNAllocs == 0);
+    CHECK(longToNAllocs == 0);
+    CHECK(longStringfAllocs >= 2);
+    printf("topic ( 40 chars ) : stringf %.0f ns %.1f allocs | ffmt::format %.0f ns %.1f allocs | format_to_n %.0f ns %.1f allocs ( %.1fx )\n",
+           stringfNs, stringfAllocs, formatNs, formatAllocs, toNNs, toNAllocs, stringfNs / toNNs);
+    printf("response ( 180 chars ) : stringf %.0f ns %.1f allocs | format_to_n %.0f ns %.1f allocs ( %.1fx )\n",
+           longStringfNs, longStringfAllocs, longToNNs, longToNAllocs, longStringfNs / longToNNs);
+}
+
+int main()
+{
+    TestStringf();
+    TestFormatToN();
+    Bench();
+    HOST_TEST_END();
+}
@@ -0,0 +1,155 @@
+/**
+ * @file test_publish_coalescer.cpp
+ * @brief PublishCoalescer on a fake sink : latest value wins per topic, a message restaged while the
+ * sink runs goes out on the next flush, the pass stops at the first refusal and the refused message
+ * and the rest are retried by the next one ( ./host_test/run.sh publish_coalescer )
+ */
+#include "publish_coalescer.hpp"
+#include "host_test.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+struct Sent_t
+{
+    std::string topic;
+    std::string payload;
+    uint8_t qos;
+    bool retained;
+};
+
+class FakeSink
+{
+public:
+    std::vector<Sent_t> sent{};
+    size_t calls = 0;
+    size_t accept = SIZE_MAX;                                // calls accepted before a refusal
+    std::function<void(const std::string &topic)> onCall{}; // runs inside the sink call
+
+    PublishCoalescer::Sink_t Sink()
+    {
+        return [this](const std::string &topic, const std::string &payload, uint8_t qos, bool retained) -> esp_err_t {
+            calls++;
+            if (onCall)
+            {
+                onCall(topic);
+            }
+            if (accept == 0)
+            {
+                return ESP_FAIL;
+            }
+            accept--;
+            sent.push_back(Sent_t{topic, payload, qos, retained});
+            return ESP_OK;
+        };
+    }
+};
+
+static void TestLatestWins()
+{
+    FakeSink fake;
+    PublishCoalescer outbox(fake.Sink());
+    CHECK_EQ(outbox.Stage("", "x"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(outbox.Stage("a/state", "1"), ESP_OK);
+    CHECK_EQ(outbox.Stage("b/state", "on", 0, false), ESP_OK);
+    CHECK_EQ(outbox.Stage("a/state", "2"), ESP_OK);
+    CHECK_EQ(outbox.Stage("a/state", "3", 2, false), ESP_OK);
+    CHECK_EQ(outbox.Pending(), 2u);
+    CHECK_EQ(outbox.Flush(), ESP_OK);
+    CHECK_EQ(fake.sent.size(), 2u);
+    CHECK(fake.sent[0].topic == "a/state" && fake.sent[0].payload == "3");
+    CHECK_EQ(fake.sent[0].qos, 2);
+    CHECK(!fake.sent[0].retained);
+    CHECK(fake.sent[1].topic == "b/state" && fake.sent[1].payload == "on");
+    const PublishCoalescer::Stats_t stats = outbox.GetStats();
+    CHECK_EQ(stats.staged, 4u);
+    CHECK_EQ(stats.coalesced, 2u);
+    CHECK_EQ(stats.published, 2u);
+    CHECK_EQ(stats.bytes, 3u);
+    CHECK_EQ(stats.flushes, 1u);
+    // nothing pending : no call, no flush counted
+    CHECK_EQ(outbox.Flush(), ESP_OK);
+    CHECK_EQ(fake.calls, 2u);
+    CHECK_EQ(outbox.GetStats().flushes, 1u);
+    outbox.Clear();
+    CHECK_EQ(outbox.Pending(), 0u);
+}
+
+static void TestRestageDuringSink()
+{
+    FakeSink fake;
+    PublishCoalescer outbox(fake.Sink());
+    outbox.Stage("a/state", "old");
+    outbox.Stage("b/state", "b");
+    // the sink is called without the lock : staging from it does not block
+    fake.onCall = [&](const std::string &topic) {
+        if (topic == "a/state")
+        {
+            outbox.Stage("a/state", "new");
+        }
+    };
+    CHECK_EQ(outbox.Flush(), ESP_OK);
+    fake.onCall = nullptr;
+    CHECK_EQ(fake.sent.size(), 2u);
+    CHECK(fake.sent[0].payload == "old");
+    CHECK_EQ(outbox.Pending(), 1u);
+    CHECK_EQ(outbox.Flush(), ESP_OK);
+    CHECK_EQ(fake.sent.size(), 3u);
+    CHECK(fake.sent[2].topic == "a/state" && fake.sent[2].payload == "new");
+    CHECK_EQ(outbox.Pending(), 0u);
+}
+
+static void TestRefusal()
+{
+    FakeSink fake;
+    PublishCoalescer outbox(fake.Sink());
+    for (const char *topic : {"a", "b", "c", "d"})
+    {
+        outbox.Stage(topic, std::string("v") + topic);
+    }
+    // the second call is refused : one attempt for it, none for the rest
+    fake.accept = 1;
+    CHECK_EQ(outbox.Flush(), ESP_FAIL);
+    CHECK_EQ(fake.calls, 2u);
+    CHECK_EQ(fake.sent.size(), 1u);
+    CHECK_EQ(outbox.Pending(), 3u);
+    CHECK_EQ(outbox.GetStats().errors, 1u);
+
+    // refused again right away : still one call per flush
+    fake.accept = 0;
+    CHECK_EQ(outbox.Flush(), ESP_FAIL);
+    CHECK_EQ(fake.calls, 3u);
+    CHECK_EQ(outbox.Pending(), 3u);
+
+    // a value restaged while refused wins on the retry
+    outbox.Stage("c", "vc2");
+    CHECK_EQ(outbox.Pending(), 3u);
+    fake.accept = SIZE_MAX;
+    CHECK_EQ(outbox.Flush(), ESP_OK);
+    CHECK_EQ(fake.sent.size(), 4u);
+    CHECK(fake.sent[1].topic == "b" && fake.sent[2].payload == "vc2" && fake.sent[3].topic == "d");
+    CHECK_EQ(outbox.Pending(), 0u);
+
+    // restaged during the refused call : the new value stays pending once, not twice
+    outbox.Stage("a", "va2");
+    fake.accept = 0;
+    fake.onCall = [&](const std::string &topic) { outbox.Stage(topic, "va3"); };
+    CHECK_EQ(outbox.Flush(), ESP_FAIL);
+    fake.onCall = nullptr;
+    CHECK_EQ(outbox.Pending(), 1u);
+    fake.accept = SIZE_MAX;
+    CHECK_EQ(outbox.Flush(), ESP_OK);
+    CHECK(fake.sent.back().payload == "va3");
+
+    PublishCoalescer nowhere(nullptr);
+    nowhere.Stage("a", "x");
+    CHECK_EQ(nowhere.Flush(), ESP_ERR_INVALID_STATE);
+}
+
+int main()
+{
+    TestLatestWins();
+    TestRestageDuringSink();
+    TestRefusal();
+    HOST_TEST_END();
+}
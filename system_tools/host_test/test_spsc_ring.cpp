@@ -0,0 +1,194 @@
+/**
+ * @file test_spsc_ring.cpp
+ * @brief SpscByteRing stress : one producer and one consumer thread, mqtt sized records.
+ * lossless run ( the producer retries ) checks every byte and the order, the paced run pushes
+ * 100k messages/s and drops on full like Mqtt::DataHandlerToQueue ( ./host_test/run.sh spsc_ring )
+ */
+#include "host_test.hpp"
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+static constexpr size_t RING_SIZE = 4096; // CONFIG_MQTT_RECEIVE_RING_SIZE default
+using Ring_t = SpscByteRing<RING_SIZE>;
+
+// topic "home/<room>/<n>/state" and a payload whose size and bytes come from n
+static std::string Topic(uint32_t n)
+{
+    return "home/room" + std::to_string(n % 7) + "/" + std::to_string(n) + "/state";
+}
+static size_t PayloadSize(uint32_t n)
+{
+    return (n * 2654435761u) % 400; // 0 .. 399, some records skip the end of the buffer
+}
+static char PayloadByte(uint32_t n, size_t i)
+{
+    return static_cast<char>('a' + (n + i) % 26);
+}
+
+// checks one record, \c n is read back from the topic
+static bool CheckRecord(std::string_view topic, std::string_view payload, uint32_t &n)
+{
+    const size_t last = topic.rfind('/');
+    const size_t first = topic.rfind('/', last - 1);
+    if (last == std::string_view::npos || first == std::string_view::npos)
+    {
+        return false;
+    }
+    n = static_cast<uint32_t>(std::stoul(std::string(topic.substr(first + 1, last - first - 1))));
+    if (topic != Topic(n) || payload.size() != PayloadSize(n))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < payload.size(); i++)
+    {
+        if (payload[i] != PayloadByte(n, i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void TestLossless()
+{
+    static Ring_t ring;
+    constexpr uint32_t COUNT = 200000;
+    std::atomic<uint32_t> retries{0};
+    std::thread producer([&]()
+                         {
+                             std::string payload;
+                             for (uint32_t n = 0; n < COUNT;)
+                             {
+                                 const std::string topic = Topic(n);
+                                 payload.resize(PayloadSize(n));
+                                 for (size_t i = 0; i < payload.size(); i++)
+                                     payload[i] = PayloadByte(n, i);
+                                 if (ring.Push(topic, payload))
+                                     n++;
+                                 else
+                                 {
+                                     retries++;
+                                     std::this_thread::yield();
+                                 }
+                             } });
+    uint32_t expected = 0;
+    uint32_t corrupt = 0;
+    while (expected < COUNT)
+    {
+        std::string_view topic, payload;
+        if (!ring.Peek(topic, payload))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t n = 0;
+        if (!CheckRecord(topic, payload, n) || n != expected)
+        {
+            corrupt++;
+        }
+        ring.Release();
+        expected++;
+    }
+    producer.join();
+    const Ring_t::Stats_t stats = ring.GetStats();
+    CHECK_EQ(corrupt, 0u);
+    CHECK(ring.Empty());
+    CHECK_EQ(stats.pushed, COUNT);
+    CHECK_EQ(stats.dropped, retries.load());
+    CHECK(stats.highWater <= RING_SIZE);
+    printf("lossless : %u records, %u full retries, high water %u / %zu bytes\n", stats.pushed, retries.load(), stats.highWater, RING_SIZE);
+}
+
+static void TestPaced()
+{
+    static Ring_t ring;
+    constexpr uint32_t RATE = 100000; // messages / s
+    constexpr uint32_t COUNT = RATE;  // one second
+    std::atomic<bool> done{false};
+    std::thread producer([&]()
+                         {
+                             std::string payload;
+                             const auto start = std::chrono::steady_clock::now();
+                             for (uint32_t n = 0; n < COUNT; n++)
+                             {
+                                 const auto due = start + std::chrono::nanoseconds(static_cast<uint64_t>(n) * 1000000000ull / RATE);
+                                 while (std::chrono::steady_clock::now() < due)
+                                 {
+                                     std::this_thread::yield(); // the consumer may share the core
+                                 }
+                                 payload.resize(PayloadSize(n));
+                                 for (size_t i = 0; i < payload.size(); i++)
+                                     payload[i] = PayloadByte(n, i);
+                                 ring.Push(Topic(n), payload); // full : dropped, the mqtt task never waits
+                             }
+                             done = true; });
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t received = 0;
+    uint32_t corrupt = 0;
+    uint32_t outOfOrder = 0;
+    int64_t previous = -1;
+    while (true)
+    {
+        std::string_view topic, payload;
+        if (!ring.Peek(topic, payload))
+        {
+            if (done && ring.Empty())
+                break;
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t n = 0;
+        if (!CheckRecord(topic, payload, n))
+            corrupt++;
+        else if (static_cast<int64_t>(n) <= previous)
+            outOfOrder++;
+        previous = n;
+        ring.Release();
+        received++;
+    }
+    producer.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const Ring_t::Stats_t stats = ring.GetStats();
+    CHECK_EQ(corrupt, 0u);
+    CHECK_EQ(outOfOrder, 0u);
+    CHECK_EQ(stats.pushed + stats.dropped, COUNT);
+    CHECK_EQ(received, stats.pushed);
+    CHECK(stats.pushed > 0);
+    printf("paced : %u sent in %.2f s ( %.0f msg/s ), %u received, %u dropped, high water %u bytes\n",
+           COUNT, seconds, COUNT / seconds, received, stats.dropped, stats.highWater);
+}
+
+static void TestLimits()
+{
+    static SpscByteRing<64> ring;
+    std::string big(ring.Capacity() - 8, 'x'); // the whole buffer, only from offset 0
+    CHECK(!ring.Push("", big + "y"));           // never fits
+    CHECK(ring.Push("", big));
+    CHECK(!ring.Push("t", "")); // full
+    std::string_view topic, payload;
+    CHECK(ring.Peek(topic, payload) && topic.empty() && payload.size() == big.size());
+    ring.Release();
+    CHECK(ring.Empty());
+    CHECK_EQ(ring.GetStats().dropped, 2u);
+    // wrap : records that do not fit before the end restart at the beginning,
+    // up to MaxRecord() whatever the position
+    for (int i = 0; i < 1000; i++)
+    {
+        const std::string data(static_cast<size_t>(i % ring.MaxRecord()), static_cast<char>('0' + i % 10));
+        CHECK(ring.Push("w", data));
+        CHECK(ring.Peek(topic, payload) && topic == "w" && payload == data);
+        ring.Release();
+    }
+    CHECK(ring.Empty());
+}
+
+int main()
+{
+    TestLimits();
+    TestLossless();
+    TestPaced();
+    HOST_TEST_END();
+}
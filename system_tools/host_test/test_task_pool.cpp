@@ -0,0 +1,313 @@
+/**
+ * @file test_task_pool.cpp
+ * @brief TaskPool : high priority jobs before low ones, an idle worker stealing from a busy one, SubmitThen
+ * chains, exceptions through the futures, SubmitAfter on the timer wheel, queued jobs drained on shutdown
+ * and a delayed job dropped ( not leaked ) when it expires during the shutdown. the benchmark runs short
+ * jobs on the pool against a thread spawned per job ( ./host_test/run.sh task_pool )
+ */
+#include "task_pool.hpp"
+#include "timer_wheel.hpp"
+#include "host_test.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+// live blocks of operator new : the shutdown test checks nothing is left behind
+static std::atomic<long> liveBlocks{0};
+
+void *operator new(size_t size)
+{
+    void *block = malloc(size ? size : 1);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    liveBlocks++;
+    return block;
+}
+void operator delete(void *pointer) noexcept
+{
+    if (pointer != nullptr)
+    {
+        liveBlocks--;
+        free(pointer);
+    }
+}
+void operator delete(void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+// parks the worker running it until released
+class Gate
+{
+public:
+    std::atomic<bool> held{false};
+    std::atomic<bool> open{false};
+    TaskPool::Job_t Job()
+    {
+        return [this]() {
+            held = true;
+            while (!open.load())
+            {
+                std::this_thread::sleep_for(milliseconds(1));
+            }
+        };
+    }
+    void WaitHeld()
+    {
+        while (!held.load())
+        {
+            std::this_thread::yield();
+        }
+    }
+};
+
+static bool WaitExecuted(TaskPool &pool, uint32_t count)
+{
+    const auto deadline = steady_clock::now() + seconds(10);
+    while (pool.GetStats().executed < count)
+    {
+        if (steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    return true;
+}
+
+static void TestPriority()
+{
+    TaskPool pool(1);
+    Gate gate;
+    CHECK_EQ(pool.Post(gate.Job()), ESP_OK);
+    gate.WaitHeld();
+    std::mutex orderLock;
+    std::string order;
+    auto Record = [&](char c) {
+        return [&, c]() {
+            std::lock_guard<std::mutex> guard(orderLock);
+            order += c;
+        };
+    };
+    for (char c : {'a', 'b', 'c'})
+    {
+        pool.Post(Record(c), TaskPool::PRIO_LOW);
+    }
+    for (char c : {'X', 'Y'})
+    {
+        pool.Post(Record(c), TaskPool::PRIO_HIGH);
+    }
+    CHECK_EQ(pool.Post(nullptr), ESP_ERR_INVALID_ARG);
+    gate.open = true;
+    CHECK(WaitExecuted(pool, 6));
+    // the high jobs first, each lane newest first ( the owner pops LIFO )
+    std::lock_guard<std::mutex> guard(orderLock);
+    CHECK(order == "YXcba");
+}
+
+static void TestStealing()
+{
+    TaskPool pool(2);
+    pool.ResetStats();
+    Gate gate;
+    std::atomic<int> done{0};
+    // posted from a worker : the jobs stay on its deque, the other worker has to steal them
+    pool.Post([&]() {
+        for (int i = 0; i < 20; i++)
+        {
+            pool.Post([&]() { done++; });
+        }
+        gate.Job()();
+    });
+    gate.WaitHeld();
+    const auto deadline = steady_clock::now() + seconds(10);
+    while (done.load() < 20 && steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    CHECK_EQ(done.load(), 20);
+    CHECK_EQ(pool.GetStats().stolen, 20u); // the owner was parked the whole time
+    gate.open = true;
+    CHECK(WaitExecuted(pool, 21));
+}
+
+static void TestFutures()
+{
+    TaskPool pool(2);
+    auto value = pool.Submit([]() { return 6; });
+    CHECK_EQ(value.get(), 6);
+
+    auto chained = pool.SubmitThen([]() { return std::string("pool"); }, [](std::string s) { return s.size(); });
+    CHECK_EQ(chained.get(), 4u);
+    std::atomic<bool> firstRan{false};
+    auto afterVoid = pool.SubmitThen([&]() { firstRan = true; }, [&]() { return firstRan.load(); });
+    CHECK(afterVoid.get());
+
+    auto failing = pool.Submit([]() -> int { throw std::runtime_error("job failed"); });
+    bool caught = false;
+    try
+    {
+        failing.get();
+    }
+    catch (const std::runtime_error &e)
+    {
+        caught = std::string(e.what()) == "job failed";
+    }
+    CHECK(caught);
+    // a throwing first step reaches the future of the chain
+    std::atomic<bool> nextRan{false};
+    auto failingFirst = pool.SubmitThen([]() -> int { throw std::logic_error("first"); }, [&](int v) { nextRan = true; return v; });
+    caught = false;
+    try
+    {
+        failingFirst.get();
+    }
+    catch (const std::logic_error &e)
+    {
+        caught = std::string(e.what()) == "first";
+    }
+    CHECK(caught);
+    CHECK(!nextRan.load());
+    auto failingVoid = pool.SubmitThen([]() { throw std::logic_error("void"); }, []() { return 1; });
+    caught = false;
+    try
+    {
+        failingVoid.get();
+    }
+    catch (const std::logic_error &)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+    auto thrownNext = pool.SubmitThen([]() { return 1; }, [](int) -> int { throw std::logic_error("next"); });
+    caught = false;
+    try
+    {
+        thrownNext.get();
+    }
+    catch (const std::logic_error &)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+}
+
+static void TestSubmitAfter()
+{
+    TaskPool pool(1);
+    std::atomic<int64_t> ranAfterUs{-1};
+    const auto start = steady_clock::now();
+    CHECK_EQ(pool.SubmitAfter(milliseconds(30), [&]() { ranAfterUs = duration_cast<microseconds>(steady_clock::now() - start).count(); }), ESP_OK);
+    CHECK_EQ(pool.SubmitAfter(milliseconds(1), nullptr), ESP_ERR_INVALID_ARG);
+    std::this_thread::sleep_for(milliseconds(10));
+    CHECK_EQ(ranAfterUs.load(), -1);
+    CHECK(WaitExecuted(pool, 1));
+    CHECK(ranAfterUs.load() >= 30000);
+    CHECK(ranAfterUs.load() < 500000);
+}
+
+static void TestShutdown()
+{
+    // queued jobs are run before the workers exit
+    std::atomic<int> ran{0};
+    Gate gate;
+    auto pool = std::make_unique<TaskPool>(1);
+    pool->Post(gate.Job());
+    gate.WaitHeld();
+    for (int i = 0; i < 50; i++)
+    {
+        pool->Post([&]() { ran++; });
+    }
+    std::thread stopper([&]() { pool.reset(); });
+    std::this_thread::sleep_for(milliseconds(20));
+    gate.open = true;
+    stopper.join();
+    CHECK_EQ(ran.load(), 50);
+
+    // a delayed job expiring while the pool stops : refused, its timer freed
+    Gate busy;
+    std::atomic<bool> delayedRan{false};
+    std::atomic<esp_err_t> lateRet{ESP_OK};
+    const long blocks = liveBlocks.load();
+    pool = std::make_unique<TaskPool>(1);
+    TaskPool *raw = pool.get();
+    pool->Post([&]() {
+        busy.Job()();
+        lateRet = raw->Post([]() {});
+    });
+    busy.WaitHeld();
+    CHECK_EQ(pool->SubmitAfter(milliseconds(20), [&]() { delayedRan = true; }), ESP_OK);
+    stopper = std::thread([&]() { pool.reset(); });
+    std::this_thread::sleep_for(milliseconds(150)); // the timer fires inside the destructor
+    busy.open = true;
+    stopper.join();
+    CHECK(!delayedRan.load());
+    CHECK_EQ(lateRet.load(), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(liveBlocks.load(), blocks);
+}
+
+static void Bench()
+{
+    constexpr int JOBS = 20000;
+    std::atomic<int> done{0};
+    const auto Work = [&]() {
+        volatile uint32_t x = 0;
+        for (int i = 0; i < 200; i++)
+        {
+            x = x + i;
+        }
+        done++;
+    };
+
+    TaskPool pool(2);
+    const double poolNs = host_test::NsPer(JOBS, [&]() {
+        for (int i = 0; i < JOBS; i++)
+        {
+            pool.Post(Work);
+        }
+        while (done.load() < JOBS)
+        {
+            std::this_thread::yield();
+        }
+    });
+    CHECK_EQ(done.load(), JOBS);
+
+    // the old way : a task per job
+    constexpr int SPAWNS = 2000;
+    done = 0;
+    const double spawnNs = host_test::NsPer(SPAWNS, [&]() {
+        for (int i = 0; i < SPAWNS; i++)
+        {
+            std::thread(Work).detach();
+        }
+        while (done.load() < SPAWNS)
+        {
+            std::this_thread::yield();
+        }
+    });
+    const TaskPool::Stats_t stats = pool.GetStats();
+    printf("short jobs : pool ( 2 workers ) %.0f k jobs/s, %.2f us/job, %u sleeps | thread per job %.0f k jobs/s, %.2f us/job ( %.0fx )\n",
+           1e6 / poolNs, poolNs / 1000, stats.sleeps, 1e6 / spawnNs, spawnNs / 1000, spawnNs / poolNs);
+    CHECK(poolNs < spawnNs);
+}
+
+int main()
+{
+    TestPriority();
+    TestStealing();
+    TestFutures();
+    TestSubmitAfter();
+    TestShutdown();
+    Bench();
+    HOST_TEST_END();
+}
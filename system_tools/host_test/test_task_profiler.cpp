@@ -0,0 +1,151 @@
+/**
+ * @file test_task_profiler.cpp
+ * @brief TaskProfiler on a SimulatedTaskTable, no timer wheel ( Sample() driven here ) : rolling cpu,
+ * alarms raised once, slots freed by gone tasks, a table larger than MAX_TASKS counted as truncated and
+ * an unreadable one counted apart. the overhead run samples a full table and checks the pass time
+ * against the budget ( ./host_test/run.sh task_profiler )
+ */
+#include "task_profiler.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <vector>
+
+static constexpr uint32_t PERIOD_US = 1000000;
+
+static void TestCpuAndAlarms()
+{
+    SimulatedTaskTable table(false);
+    const size_t idle = table.Add("IDLE0", 0, 600, 0.70f, 0);
+    const size_t busy = table.Add("busy", 5, 2000, 0.30f, 0);
+    TaskProfiler::Config_t config;
+    config.window = 4;
+    config.cpuAlarm = 80;
+    config.stackAlarm = 256;
+    TaskProfiler profiler(config, table.Source(), nullptr);
+    int alarms = 0;
+    profiler.SetAlarmFunction([&](const TaskProfiler::TaskInfo_t &task, TaskProfiler::Alarm_t alarm) { alarms++; });
+
+    uint32_t nowMs = 0;
+    CHECK_EQ(profiler.Sample(nowMs), ESP_OK); // primes
+    for (int i = 0; i < 4; i++)
+    {
+        table.Advance(PERIOD_US);
+        nowMs += 1000;
+        CHECK_EQ(profiler.Sample(nowMs), ESP_OK);
+    }
+    TaskProfiler::TaskInfo_t tasks[4];
+    CHECK_EQ(profiler.GetTasks(tasks, 4), 2u);
+    CHECK_EQ(tasks[busy].cpu, 300);
+    CHECK_EQ(tasks[idle].cpu, 700);
+    CHECK_EQ(alarms, 0);
+
+    // over 80 % : one alarm until it clears
+    table.SetLoad(busy, 0.90f);
+    table.SetLoad(idle, 0.10f);
+    for (int i = 0; i < 4; i++)
+    {
+        table.Advance(PERIOD_US);
+        nowMs += 1000;
+        profiler.Sample(nowMs);
+    }
+    profiler.GetTasks(tasks, 4);
+    CHECK_EQ(tasks[busy].cpu, 900);
+    CHECK_EQ(tasks[busy].peakCpu, 900);
+    CHECK_EQ(tasks[busy].alarms, TaskProfiler::ALARM_CPU);
+    CHECK_EQ(alarms, 1);
+    table.SetStackFree(busy, 100);
+    table.Advance(PERIOD_US);
+    profiler.Sample(nowMs += 1000);
+    CHECK_EQ(alarms, 2);
+    CHECK_EQ(profiler.GetStats().alarms, 2u);
+
+    // a gone task frees its slot, the next one takes it
+    CHECK_EQ(table.Remove(busy), ESP_OK);
+    table.Advance(PERIOD_US);
+    profiler.Sample(nowMs += 1000);
+    CHECK_EQ(profiler.GetTasks(tasks, 4), 1u);
+    table.Add("late", 3, 1500, 0.05f);
+    table.Advance(PERIOD_US);
+    profiler.Sample(nowMs += 1000);
+    CHECK_EQ(profiler.GetTasks(tasks, 4), 2u);
+    CHECK_EQ(tasks[busy].minStackFree, 1500u);
+
+    // records of the last sample, one per task
+    TaskProfiler::Record_t records[8];
+    CHECK_EQ(profiler.GetRecords(records, 8, nowMs - 1), 2u);
+    std::string binary;
+    profiler.RenderBinary(binary);
+    CHECK_EQ(binary.size(), 8 + 2 * 24 + 2 * sizeof(TaskProfiler::Record_t));
+}
+
+static void TestTruncatedAndUnread()
+{
+    SimulatedTaskTable table(false);
+    for (size_t i = 0; i < TaskProfiler::MAX_TASKS + 3; i++)
+    {
+        table.Add(("task" + std::to_string(i)).c_str(), 1, 2000, 0.01f);
+    }
+    bool readable = true;
+    TaskProfiler profiler(TaskProfiler::Config_t(), [&](TaskProfiler::TaskSample_t *tasks, size_t max, uint32_t &totalRunTime) -> size_t {
+        return readable ? table.Read(tasks, max, totalRunTime) : 0;
+    },
+                          nullptr);
+    CHECK_EQ(profiler.Sample(0), ESP_OK);
+    TaskProfiler::TaskInfo_t tasks[TaskProfiler::MAX_TASKS + 3];
+    CHECK_EQ(profiler.GetTasks(tasks, TaskProfiler::MAX_TASKS + 3), TaskProfiler::MAX_TASKS);
+    CHECK_EQ(profiler.GetStats().truncated, 1u);
+
+    // the source fails : an error of its own, the truncated count does not move
+    readable = false;
+    CHECK_EQ(profiler.Sample(1000), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(profiler.Sample(2000), ESP_ERR_INVALID_SIZE);
+    TaskProfiler::Stats_t stats = profiler.GetStats();
+    CHECK_EQ(stats.unread, 2u);
+    CHECK_EQ(stats.truncated, 1u);
+    CHECK_EQ(stats.samples, 1u);
+    readable = true;
+    CHECK_EQ(profiler.Sample(3000), ESP_OK);
+    CHECK_EQ(profiler.GetStats().truncated, 2u);
+}
+
+// a full table every pass : the sample has to stay inside the default budget
+static void TestOverheadBudget()
+{
+    SimulatedTaskTable table(false);
+    for (size_t i = 0; i < TaskProfiler::MAX_TASKS; i++)
+    {
+        table.Add(("task" + std::to_string(i)).c_str(), static_cast<uint8_t>(i % 24), 1000 + 64 * i, 1.0f / TaskProfiler::MAX_TASKS, i % 2);
+    }
+    TaskProfiler::Config_t config;
+    config.window = TaskProfiler::MAX_WINDOW;
+    TaskProfiler profiler(config, table.Source(), nullptr);
+    constexpr int SAMPLES = 5000;
+    std::vector<uint32_t> passUs;
+    passUs.reserve(SAMPLES);
+    uint32_t nowMs = 0;
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        table.Advance(PERIOD_US);
+        profiler.Sample(nowMs += 1000);
+        passUs.push_back(profiler.GetStats().lastUs);
+    }
+    std::sort(passUs.begin(), passUs.end());
+    const TaskProfiler::Stats_t stats = profiler.GetStats();
+    const uint32_t p50 = passUs[SAMPLES / 2];
+    const uint32_t p99 = passUs[SAMPLES * 99 / 100];
+    CHECK_EQ(stats.samples, static_cast<uint32_t>(SAMPLES));
+    CHECK_EQ(stats.records, static_cast<uint32_t>((SAMPLES - 1) * TaskProfiler::MAX_TASKS));
+    CHECK(p99 < config.budgetUs);
+    // a scheduler hiccup may land over the budget, not a share of the passes
+    CHECK(stats.overBudget <= SAMPLES / 100);
+    printf("%u tasks, %d samples : pass p50 %u us, p99 %u us, max %u us, %u over the %u us budget\n",
+           static_cast<unsigned>(TaskProfiler::MAX_TASKS), SAMPLES, p50, p99, stats.maxUs, stats.overBudget, config.budgetUs);
+}
+
+int main()
+{
+    TestCpuAndAlarms();
+    TestTruncatedAndUnread();
+    TestOverheadBudget();
+    HOST_TEST_END();
+}
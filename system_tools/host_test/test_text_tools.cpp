@@ -0,0 +1,304 @@
+/**
+ * @file test_text_tools.cpp
+ * @brief text tools edge cases : Split against std::getline, Trim of blank strings, Parse range and
+ * trailing text, To fallbacks. built twice, the second time without floating point from_chars ( the
+ * strtod path of the ESP-IDF 4.x toolchains ). the benchmark splits, trims, folds and parses 1 MB of
+ * mqtt like lines against the old istringstream / atoi path ( ./host_test/run.sh text_tools )
+ */
+#include <charconv>
+#ifdef TEXT_TOOLS_STRTOD
+#undef __cpp_lib_to_chars
+#endif
+#include "text_tools.hpp"
+#include "host_test.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+static std::vector<std::string> Getline(const std::string &source, char delimiter)
+{
+    std::vector<std::string> tokens;
+    std::istringstream iss(source);
+    std::string token;
+    while (std::getline(iss, token, delimiter))
+    {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+static std::vector<std::string> Tokens(std::string_view source, char delimiter, text::Split_t flags = text::Split_t::NONE)
+{
+    std::vector<std::string> tokens;
+    for (const std::string_view token : text::Split(source, delimiter, flags))
+    {
+        tokens.emplace_back(token);
+    }
+    return tokens;
+}
+
+static void TestSplit()
+{
+    for (const char *source : {"", ",", ",,", "a", "a,,b,", ",,,x", "a,b", " a , b ", "abc,"})
+    {
+        const bool same = Tokens(source, ',') == Getline(source, ',');
+        CHECK(same);
+        if (!same)
+        {
+            printf("    getline parity \"%s\"\n", source);
+        }
+    }
+    const std::vector<std::string> trimmed = Tokens(" a , ,b\t,\r\n", ',', text::Split_t::TRIM | text::Split_t::SKIP_EMPTY);
+    CHECK_EQ(trimmed.size(), 2u);
+    CHECK(trimmed[0] == "a" && trimmed[1] == "b");
+    CHECK(Tokens(" , ,", ',', text::Split_t::TRIM | text::Split_t::SKIP_EMPTY).empty());
+    // SKIP_EMPTY alone keeps blank tokens
+    CHECK_EQ(Tokens(" ,,x", ',', text::Split_t::SKIP_EMPTY).size(), 2u);
+    // the tokens are views into the source
+    const std::string source = "ab,cd";
+    const text::SplitRange range = text::Split(source, ',');
+    auto it = range.begin();
+    CHECK(it->data() == source.data());
+    ++it;
+    CHECK(it->data() == source.data() + 3);
+    CHECK(++it == range.end());
+}
+
+static void TestTrimAndCase()
+{
+    CHECK(text::Trim("").empty());
+    CHECK(text::Trim(" \t\r\n").empty());
+    CHECK(text::Trim(" a b ") == "a b");
+    CHECK(text::TrimLeft("  x ") == "x ");
+    CHECK(text::TrimRight("  x ") == "  x");
+    CHECK(text::Trim("--x--", "-") == "x");
+    std::string str = "  keep  ";
+    str.reserve(64);
+    const size_t capacity = str.capacity();
+    CHECK(text::TrimInPlace(str) == "keep");
+    CHECK_EQ(str.capacity(), capacity);
+    str = "   ";
+    CHECK(text::TrimInPlace(str).empty());
+
+    std::string mixed = "Open-ON_12\xc3\xa9";
+    CHECK(text::ToLowerInPlace(mixed) == "open-on_12\xc3\xa9"); // ASCII only, utf-8 bytes untouched
+    CHECK(text::ToUpperInPlace(mixed) == "OPEN-ON_12\xc3\xa9");
+    CHECK(text::EqualsIgnoreCase("Stop", "sTOP"));
+    CHECK(!text::EqualsIgnoreCase("Stop", "Stops"));
+    CHECK(!text::EqualsIgnoreCase("[", "{")); // differ by the case bit, not letters
+    CHECK(text::StartsWith("homeassistant/status", "homeassistant/"));
+    CHECK(!text::StartsWith("home", "homeassistant"));
+    CHECK(text::EndsWith("42%", "%"));
+    CHECK(!text::EndsWith("%", "42%"));
+    static_assert(text::Trim("  c ") == "c", "constexpr");
+}
+
+static void TestParse()
+{
+    uint8_t u8 = 7;
+    CHECK_EQ(text::Parse("255", u8), ESP_OK);
+    CHECK_EQ(u8, 255);
+    CHECK_EQ(text::Parse("256", u8), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(text::Parse("-1", u8), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(u8, 255); // untouched on error
+    CHECK_EQ(text::Parse("+42", u8), ESP_OK);
+    CHECK_EQ(u8, 42);
+    for (const char *bad : {"", "+", "+-1", " 1", "1 ", "1a", "0x10", "--1"})
+    {
+        CHECK_EQ(text::Parse(bad, u8), ESP_ERR_INVALID_ARG);
+    }
+    int64_t i64 = 0;
+    CHECK_EQ(text::Parse("-9223372036854775808", i64), ESP_OK);
+    CHECK(i64 == INT64_MIN);
+    CHECK_EQ(text::Parse("9223372036854775808", i64), ESP_ERR_INVALID_SIZE);
+    int16_t hex = 0;
+    CHECK_EQ(text::Parse("7fff", hex, 16), ESP_OK);
+    CHECK_EQ(hex, 0x7fff);
+    // a view into a longer buffer : the parse stops at its end
+    const std::string_view cell = std::string_view("123456").substr(0, 3);
+    uint32_t u32 = 0;
+    CHECK_EQ(text::Parse(cell, u32), ESP_OK);
+    CHECK_EQ(u32, 123u);
+
+    float f = 0;
+    CHECK_EQ(text::Parse("913.57", f), ESP_OK);
+    CHECK(std::fabs(f - 913.57f) < 1e-3f);
+    CHECK_EQ(text::Parse("+2.5e1", f), ESP_OK);
+    CHECK(f == 25.0f);
+    CHECK_EQ(text::Parse("12.", f), ESP_OK);
+    CHECK(f == 12.0f);
+    CHECK_EQ(text::Parse("1e39", f), ESP_ERR_INVALID_SIZE);
+    CHECK(f == 12.0f);
+    for (const char *bad : {"", "+", "1e", "1e-", " 1", "1 ", "1.2.3", "abc"})
+    {
+        CHECK_EQ(text::Parse(bad, f), ESP_ERR_INVALID_ARG);
+    }
+    double d = 0;
+    CHECK_EQ(text::Parse("-0.125", d), ESP_OK);
+    CHECK(d == -0.125);
+}
+
+static void TestTo()
+{
+    CHECK_EQ(text::To<int>(" 42 \r\n"), 42);
+    CHECK_EQ(text::To<int>("42%"), 42);
+    CHECK_EQ(text::To<int>("-7 C"), -7);
+    CHECK_EQ(text::To<int>("abc", -1), -1);
+    CHECK_EQ(text::To<int>("", -1), -1);
+    CHECK_EQ(text::To<int>("-", -1), -1);
+    CHECK_EQ(text::To<uint8_t>("300", 9), 9); // does not fit : the fallback, not a wrap
+    CHECK_EQ(text::To<int>("99999999999", -1), -1);
+    CHECK(text::To<float>("1e") == 1.0f);
+    CHECK(text::To<float>("1e-") == 1.0f);
+    CHECK(text::To<float>("2.5e-1x") == 0.25f);
+    CHECK(text::To<float>(".5") == 0.5f);
+    CHECK(text::To<float>("1e39", -1.0f) == -1.0f);
+}
+
+// 1 MB of lines like " Open , -42,  913.57 ,ON,6553 "
+static std::string MqttLines(size_t bytes)
+{
+    static const char *const WORDS[] = {"Open", "close", "STOP", "On", "off"};
+    std::string out;
+    out.reserve(bytes + 64);
+    for (uint32_t n = 0; out.size() < bytes; n++)
+    {
+        out += ' ';
+        out += WORDS[n % 5];
+        out += " , " + std::to_string(static_cast<int>(n % 201) - 100) + ",  ";
+        out += std::to_string(n % 1000) + "." + std::to_string(n % 97) + " ,";
+        out += (n & 1) ? "ON" : "OFF";
+        out += ',' + std::to_string(n % 65536) + " \n";
+    }
+    return out;
+}
+
+static std::string OldTrim(const std::string &str)
+{
+    const size_t first = str.find_first_not_of(' ');
+    if (first == std::string::npos)
+    {
+        return str;
+    }
+    return str.substr(first, str.find_last_not_of(' ') - first + 1);
+}
+
+static std::vector<std::string> OldSplit(const std::string &source, char delimiter)
+{
+    std::vector<std::string> strings;
+    std::istringstream iss(source);
+    std::string s;
+    while (std::getline(iss, s, delimiter))
+    {
+        strings.push_back(OldTrim(s));
+    }
+    return strings;
+}
+
+template <typename F>
+static double BestMs(F &&fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < 5; i++)
+    {
+        best = std::min(best, host_test::NsPer(1, fn) / 1e6);
+    }
+    return best;
+}
+
+static void Bench()
+{
+    const std::string input = MqttLines(1 << 20);
+    std::vector<std::string> lines;
+    for (const std::string_view line : text::Split(input, '\n'))
+    {
+        lines.emplace_back(line);
+    }
+
+    // split, trim, lower the words, sum the numbers : the old path
+    long oldSum = 0;
+    const double oldMs = BestMs([&]() {
+        oldSum = 0;
+        for (const std::string &line : lines)
+        {
+            std::vector<std::string> cells = OldSplit(line, ',');
+            if (cells.size() != 5)
+            {
+                continue;
+            }
+            std::transform(cells[0].begin(), cells[0].end(), cells[0].begin(), ::tolower);
+            oldSum += (cells[0] == "stop") + std::atoi(cells[1].c_str()) + static_cast<long>(std::atof(cells[2].c_str())) +
+                      (cells[3] == "ON") + std::atoi(cells[4].c_str());
+        }
+    });
+
+    // the same with text : views, no copy, no allocation
+    long newSum = 0;
+    const double newMs = BestMs([&]() {
+        newSum = 0;
+        for (const std::string &line : lines)
+        {
+            std::string_view cells[5];
+            size_t count = 0;
+            for (const std::string_view cell : text::Split(line, ',', text::Split_t::TRIM))
+            {
+                if (count == 5)
+                {
+                    count++;
+                    break;
+                }
+                cells[count++] = cell;
+            }
+            if (count != 5)
+            {
+                continue;
+            }
+            int level = 0, value = 0;
+            float reading = 0;
+            text::Parse(cells[1], level);
+            text::Parse(cells[2], reading);
+            text::Parse(cells[4], value);
+            newSum += text::EqualsIgnoreCase(cells[0], "stop") + level + static_cast<long>(reading) + (cells[3] == "ON") + value;
+        }
+    });
+    CHECK_EQ(newSum, oldSum);
+
+    // splitting alone
+    size_t oldBytes = 0, newBytes = 0;
+    const double oldSplitMs = BestMs([&]() {
+        oldBytes = 0;
+        for (const std::string &cell : OldSplit(input, ','))
+        {
+            oldBytes += cell.size();
+        }
+    });
+    const double newSplitMs = BestMs([&]() {
+        newBytes = 0;
+        for (const std::string_view cell : text::Split(input, ','))
+        {
+            newBytes += text::Trim(cell, " ").size();
+        }
+    });
+    CHECK_EQ(newBytes, oldBytes);
+
+    printf("%zu bytes, %zu lines : split + trim istringstream %.2f ms, text::Split %.2f ms | "
+           "split, trim, lower, parse %.2f ms -> %.2f ms ( %.1fx )%s\n",
+           input.size(), lines.size(), oldSplitMs, newSplitMs, oldMs, newMs, oldMs / newMs,
+#ifdef TEXT_TOOLS_STRTOD
+           ", strtod path"
+#else
+           ""
+#endif
+    );
+}
+
+int main()
+{
+    TestSplit();
+    TestTrimAndCase();
+    TestParse();
+    TestTo();
+    Bench();
+    HOST_TEST_END();
+}
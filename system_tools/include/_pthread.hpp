@@ -6,6 +6,7 @@
 #include <functional>
 #include <queue>
 #include <condition_variable>
+#include <optional>
 
 #ifdef ESP_PLATFORM
 #include <esp_pthread.h>
@@ -89,8 +90,10 @@ public:
   // Add an element to the queue.
   void enqueue(T value)
   {
-    std::unique_lock lock(mutex);
-    queue.push(value);
+    {
+      std::unique_lock lock(mutex);
+      queue.push(std::move(value));
+    }
     cond.notify_one();
   }
 
@@ -104,23 +107,22 @@ public:
       // release lock as long as the wait and reaquire it afterwards.
       cond.wait(lock);
     }
-    T val = queue.front();
+    T val = std::move(queue.front());
     queue.pop();
     return val;
   }
   // Get the "front"-element.
-  // If the queue is empty, wait till a element is avaiable.
-
+  // If the queue is empty, wait up to ms for an element, nullopt if none came.
+  // ( BoundedQueue in bounded_queue.hpp has the same interface, bounded and lock-free )
   std::optional<T> dequeue_wait_for(std::chrono::milliseconds ms)
   {
     std::unique_lock lock(mutex);
-    bool res = cond.wait_for(lock, ms) != std::cv_status::timeout;
-    if (queue.empty() || res)
+    // items already queued are taken at once, spurious wakeups keep waiting
+    if (!cond.wait_for(lock, ms, [this]() { return !queue.empty(); }))
     {
-      //ESP_LOGE("queue", "empty or timed out = %d", res);
       return std::nullopt;
     }
-    T val = queue.front();
+    T val = std::move(queue.front());
     queue.pop();
     return val;
   }
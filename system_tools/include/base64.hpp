@@ -0,0 +1,71 @@
+#ifndef __ALADIN_BASE64_H__
+#define __ALADIN_BASE64_H__
+#pragma once
+
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief table driven base64 ( RFC 4648 alphabet, '=' padding ) into caller buffers, nothing allocated.
+ * the scalar path goes through a 256 byte decode table four characters at a time,
+ * host builds on x86 also get SSSE3 / AVX2 paths, picked at run time.
+ *
+ *  char text[Base64::EncodedLength(sizeof(frame))];
+ *  size_t len = 0;
+ *  Base64::Encode(std::string_view(frame, sizeof(frame)), text, sizeof(text), &len);
+ */
+class Base64
+{
+public:
+    enum Mode_t : uint8_t
+    {
+        STRICT,  // length multiple of 4, padding only at the end, no whitespace, zero trailing bits
+        LENIENT, // whitespace skipped, padding optional, stops at the first '='
+    };
+    enum Path_t : uint8_t
+    {
+        SCALAR,
+        SSSE3, // x86 host builds only
+        AVX2,  // x86 host builds only
+        AUTO,  // best one the cpu supports
+    };
+
+    static constexpr size_t EncodedLength(size_t length)
+    {
+        return (length + 2) / 3 * 4;
+    }
+    // upper bound, the exact length depends on padding and whitespace
+    static constexpr size_t DecodedLength(size_t length)
+    {
+        return (length + 3) / 4 * 3;
+    }
+
+    /**
+     * @brief encode \c in with padding, no terminating 0
+     *
+     * @param written characters written
+     * @param path a path the cpu does not support falls back to the best one it does
+     * @return esp_err_t ESP_ERR_INVALID_SIZE \c outSize below EncodedLength()
+     */
+    static esp_err_t Encode(std::string_view in, char *out, size_t outSize, size_t *written, Path_t path = AUTO);
+
+    /**
+     * @brief decode \c in, the SIMD paths need 16 / 32 bytes of room past the data
+     * to run up to the end, the last blocks go through the scalar path otherwise
+     *
+     * @param written bytes written, also on error : what was decoded before
+     * @return esp_err_t ESP_ERR_INVALID_ARG bad character, padding or length,
+     * ESP_ERR_INVALID_SIZE \c out too small
+     */
+    static esp_err_t Decode(std::string_view in, uint8_t *out, size_t outSize, size_t *written, Mode_t mode = STRICT, Path_t path = AUTO);
+
+    static Path_t BestPath();
+
+private:
+    static Path_t Resolve(Path_t path);
+    static esp_err_t DecodeTail(std::string_view in, size_t &pos, uint8_t *out, size_t outSize, size_t &w, Mode_t mode, bool &done);
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef __ALADIN_BOUNDED_QUEUE_H__
+#define __ALADIN_BOUNDED_QUEUE_H__
+#pragma once
+
+#include "mpmc_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+/**
+ * @brief bounded multi producer / multi consumer queue with blocking waits, on top of idf::MPMCQueue.
+ * push / pop go through the lock-free cells, a waiting side spins \c spin tries then parks on a condition
+ * variable. the other side only takes the mutex to notify when someone is parked, so an uncontended
+ * push / pop never locks.
+ * enqueue() / dequeue() / dequeue_wait_for() keep the SafeQueue interface, but enqueue() blocks while full.
+ *
+ *  BoundedQueue<std::unique_ptr<Frame_t>> frames(16);
+ *  frames.push(std::move(frame));            // producer
+ *  size_t n = frames.pop_n(batch, 8, 100ms); // consumer, up to 8 at once
+ *
+ * @tparam T element type, default constructible and movable ( move only is fine )
+ */
+template <typename T, bool PADDED = false>
+class BoundedQueue
+{
+public:
+    static constexpr uint32_t DEFAULT_SPIN = 64;
+
+    /**
+     * @param capacity rounded up to a power of two
+     * @param spin tries before parking, 0 : park at once
+     */
+    explicit BoundedQueue(size_t capacity, uint32_t _spin = DEFAULT_SPIN) : queue(capacity), spin(_spin)
+    {
+    }
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // never blocks, false : full
+    template <typename U>
+    bool try_push(U &&item)
+    {
+        if (!queue.try_push(std::forward<U>(item)))
+        {
+            return false;
+        }
+        Pushed();
+        return true;
+    }
+
+    // never blocks, false : empty
+    bool try_pop(T &item)
+    {
+        if (!queue.try_pop(item))
+        {
+            return false;
+        }
+        Popped();
+        return true;
+    }
+
+    // never blocks, moves from \c first, returns how many were stored
+    template <typename It>
+    size_t try_push_n(It first, size_t count)
+    {
+        const size_t n = queue.try_push_n(first, count);
+        if (n > 0)
+        {
+            Pushed(n);
+        }
+        return n;
+    }
+
+    // never blocks, returns how many were taken
+    template <typename It>
+    size_t try_pop_n(It out, size_t max)
+    {
+        const size_t n = queue.try_pop_n(out, max);
+        if (n > 0)
+        {
+            Popped(n);
+        }
+        return n;
+    }
+
+    // waits for room
+    void push(T &&item)
+    {
+        Wait(waitingProducers, notFull, std::chrono::steady_clock::time_point::max(), [&]() { return queue.try_push(std::move(item)); });
+        Pushed();
+    }
+
+    // false : still full after \c timeout, \c item is left untouched
+    bool push_for(T &&item, std::chrono::milliseconds timeout)
+    {
+        if (!Wait(waitingProducers, notFull, std::chrono::steady_clock::now() + timeout, [&]() { return queue.try_push(std::move(item)); }))
+        {
+            return false;
+        }
+        Pushed();
+        return true;
+    }
+
+    // waits for an element
+    void pop(T &item)
+    {
+        Wait(waitingConsumers, notEmpty, std::chrono::steady_clock::time_point::max(), [&]() { return queue.try_pop(item); });
+        Popped();
+    }
+
+    // false : still empty after \c timeout
+    bool pop_for(T &item, std::chrono::milliseconds timeout)
+    {
+        if (!Wait(waitingConsumers, notEmpty, std::chrono::steady_clock::now() + timeout, [&]() { return queue.try_pop(item); }))
+        {
+            return false;
+        }
+        Popped();
+        return true;
+    }
+
+    /**
+     * @brief waits up to \c timeout for at least one element, then takes up to \c max without waiting more
+     *
+     * @return size_t elements taken, 0 timed out
+     */
+    template <typename It>
+    size_t pop_n(It out, size_t max, std::chrono::milliseconds timeout)
+    {
+        size_t n = 0;
+        if (max == 0 || !Wait(waitingConsumers, notEmpty, std::chrono::steady_clock::now() + timeout, [&]() { return (n = queue.try_pop_n(out, max)) > 0; }))
+        {
+            return 0;
+        }
+        Popped(n);
+        return n;
+    }
+
+    // SafeQueue interface
+    void enqueue(T value)
+    {
+        push(std::move(value));
+    }
+    T dequeue()
+    {
+        T item{};
+        pop(item);
+        return item;
+    }
+    std::optional<T> dequeue_wait_for(std::chrono::milliseconds ms)
+    {
+        T item{};
+        if (!pop_for(item, ms))
+        {
+            return std::nullopt;
+        }
+        return std::optional<T>(std::move(item));
+    }
+
+    size_t size_approx() const { return queue.size_approx(); }
+    bool empty() const { return queue.empty(); }
+    size_t capacity() const { return queue.capacity(); }
+
+private:
+    /**
+     * @brief spin on \c attempt, then park until it succeeds or \c deadline passes.
+     * the waiter count is raised before the last attempt under the mutex, and the other side reads it after
+     * its own operation ( both behind a full fence ) : either the attempt sees the element / room,
+     * or the other side sees the waiter and notifies under the mutex, after the wait started
+     */
+    template <typename Attempt>
+    bool Wait(std::atomic<uint32_t> &waiting, std::condition_variable &cond, std::chrono::steady_clock::time_point deadline, Attempt attempt)
+    {
+        for (uint32_t i = 0; i < spin; i++)
+        {
+            if (attempt())
+            {
+                return true;
+            }
+            if (i >= spin / 2)
+            {
+                std::this_thread::yield();
+            }
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        waiting.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool done = attempt();
+        while (!done)
+        {
+            bool timedOut = false;
+            if (deadline == std::chrono::steady_clock::time_point::max())
+            {
+                cond.wait(guard);
+            }
+            else
+            {
+                timedOut = (cond.wait_until(guard, deadline) == std::cv_status::timeout);
+            }
+            done = attempt();
+            if (timedOut)
+            {
+                break;
+            }
+        }
+        waiting.fetch_sub(1, std::memory_order_relaxed);
+        return done;
+    }
+
+    void Wake(std::atomic<uint32_t> &waiting, std::condition_variable &cond, size_t count)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        if (count > 1)
+        {
+            cond.notify_all();
+        }
+        else
+        {
+            cond.notify_one();
+        }
+    }
+    void Pushed(size_t count = 1) { Wake(waitingConsumers, notEmpty, count); }
+    void Popped(size_t count = 1) { Wake(waitingProducers, notFull, count); }
+
+    idf::MPMCQueue<T, PADDED> queue;
+    const uint32_t spin;
+    std::mutex lock; // parking only
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::atomic<uint32_t> waitingConsumers{0};
+    std::atomic<uint32_t> waitingProducers{0};
+};
+
+#endif
@@ -5,11 +5,15 @@
 #include "sdkconfig.h"
 #include <cstring>
 #include <functional>
+#include <atomic>
 #include <list>
 #include <map>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <stdint.h>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <chrono>
 #include "utilities.hpp"
@@ -23,8 +27,19 @@ class Config // base class // need to be used with another class abstract explic
 private:
     static std::string actionResponse;
     static std::map<const char *, Config *, StrCompare> listOfConfig; // list where all classes pointer are stored when calling  InitThisConfig()
+    static std::unordered_map<std::string_view, Config *> configIndex; // same classes, keyed by the interned m_name for O(1) dispatch
     static const int STR_MAX_SIZE = 15;
+    static std::string dumpBuffer; // reused output buffer of the config/status dumps
+    static std::vector<Config *> dumpList; // classes of the running dump, copied from listOfConfig
+    static std::mutex dumpLock;   // listOfConfig and configIndex, held only for lookups and ( un ) registering
+    static std::mutex renderLock; // one dump at a time : dumpBuffer, dumpList and the fragments
     const std::string m_name; // member name // used to differ from the abstract class' TAG, connot copy the original class' TAG
+    // pre-rendered json members ( "tag":{...} without the outer braces ) spliced by the dumps
+    std::string configFragment{};
+    std::string statusFragment{};
+    std::atomic<bool> configDirty{true}; // set from any task, cleared by the dump before it renders
+    std::atomic<bool> statusDirty{true};
+    std::atomic<bool> statusTracked{false}; // set by MarkStatusDirty(), untracked status is rendered on every dump
 public:
     // contructor : initialize variable name/isconfigured ..etc
     Config(const char *name);
@@ -51,7 +66,16 @@ public:
 
 private:
     friend class ConfigAction;
-    static esp_err_t _MqttCommandCallBackWrapper(const std::string &topic, const std::string &data);
+    // route of an inbound mqtt message, decided from the topic suffix
+    enum class Route_t : uint8_t
+    {
+        NONE,
+        CONFIG,
+        ACTION,
+    };
+    static esp_err_t _MqttCommandCallBackWrapper(std::string_view topic, std::string_view data);
+    static Route_t RouteTopic(std::string_view topic);
+    static Config *FindConfig(std::string_view name);
 
     template <typename T>
     esp_err_t AddConfigToHash(const std::string &key, const T &val) noexcept(false);
@@ -62,6 +86,8 @@ private:
     // NOT USED
     static std::string DumpAllJsonConfig();
     static std::string DumpAllJsonStatus();
+    static const std::string &RenderAllJson(bool status);
+    const std::string &GetFragment(bool status);
     static esp_err_t ParseJsonToConfig(const json &j_parent) noexcept(false);
     static esp_err_t ParseJsonToCommands(const json &j_parent) noexcept(false);
 
@@ -71,6 +97,18 @@ private:
 
 protected:
     bool isConfigured = false;
+    /**
+     * @brief invalidate the cached configuration json. SetConfigurationParameters and the commands mark it already :
+     * any other change of a value emitted by GetConfiguration ( a setter, a button, RestoreDefault.. ) must call it,
+     * or the dumps keep serving the cached fragment
+     */
+    void MarkConfigDirty() { configDirty = true; }
+    // invalidate the cached status json, once called the status is re-rendered only when marked dirty again
+    void MarkStatusDirty()
+    {
+        statusDirty = true;
+        statusTracked = true;
+    }
     virtual esp_err_t RestoreDefault();
     // load params from NVS
     virtual esp_err_t LoadFromNVS();
@@ -79,8 +117,9 @@ protected:
     // exctract configuration from a json object and set them , not all params are required
     virtual esp_err_t SetConfigurationParameters(const json &config_in);
     // return json with all current configured parameters
+    // called by the dumps outside the registry lock : may look classes up or route a message, must not dump or destroy a Config
     virtual esp_err_t GetConfiguration(json &config_out) const;
-    // return json with all current status values
+    // return json with all current status values, same restriction as GetConfiguration
     virtual esp_err_t GetConfigurationStatus(json &config_out) const;
 
     virtual esp_err_t MqttCommandCallBack(const json &config_in);
@@ -249,7 +288,7 @@ public:
     static esp_err_t RunDiagnoseAll() { return Config::DiagnoseAll(); };
     static const std::string &LastActionResponse() { return Config::GetActionResponse(); }
     static esp_err_t AddSystemInfotoJson(json &j) { return Config::AddSystemInfo(j); };
-    static esp_err_t MqttCommandCallBackWrapper(const std::string &topic, const std::string &data) // helper to access private function from Config class
+    static esp_err_t MqttCommandCallBackWrapper(std::string_view topic, std::string_view data) // helper to access private function from Config class
     {
         return Config::_MqttCommandCallBackWrapper(topic, data);
     }
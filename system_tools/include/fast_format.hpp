@@ -0,0 +1,123 @@
+#ifndef __ALADIN_FAST_FORMAT_H__
+#define __ALADIN_FAST_FORMAT_H__
+#pragma once
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/*
+ * the vendored fmt ( 6.0 ) has no FMT_COMPILE yet : a compile string is the FMT_STRING type, its parts are
+ * parsed by the compiler ( fmt::compile ) and checked against the argument types at the call site
+ */
+#ifndef FMT_COMPILE
+#define FMT_COMPILE(s) FMT_STRING(s)
+#endif
+
+/**
+ * @brief formatting without the heap for the hot paths, on top of fmt compiled formats :
+ * a bad format string or a wrong argument type does not build.
+ * the text goes into a caller buffer ( format_to_n ), a stack fmt::memory_buffer ( Buffer / format_to )
+ * or straight at the end of an existing string ( append ).
+ *
+ *  char topic[64];
+ *  std::string_view view = ffmt::format_to_n(topic, FMT_COMPILE("{}/{}_{}"), room, name, mac);
+ *  ffmt::append(response, FMT_COMPILE(" config to {} returned code {}"), tag, ret);
+ */
+namespace ffmt
+{
+    // stack buffer, spills to the heap past N chars ( fmt default is 500, too much for small task stacks )
+    template <size_t N = 128>
+    using Buffer = fmt::basic_memory_buffer<char, N>;
+
+    struct Result_t
+    {
+        std::string_view text; // what fits, terminated
+        size_t size;           // length of the whole text
+        bool truncated() const { return size > text.size(); }
+        operator std::string_view() const { return text; }
+    };
+
+    namespace detail
+    {
+        template <typename... Args, typename S>
+        inline auto Compile(const S &)
+        {
+            fmt::internal::check_format_string<Args...>(S{});
+            return fmt::compile<Args...>(S{});
+        }
+
+        // through a stack buffer : fmt writes whole runs there, a truncating iterator goes char by char
+        template <size_t N, typename S, typename... Args>
+        inline Result_t FormatToN(char *out, size_t outSize, const S &format, const Args &...args)
+        {
+            Buffer<N> buffer;
+            fmt::format_to(std::back_inserter(buffer), Compile<Args...>(format), args...);
+            if (outSize == 0)
+            {
+                return Result_t{std::string_view(), buffer.size()};
+            }
+            const size_t length = std::min(buffer.size(), outSize - 1);
+            memcpy(out, buffer.data(), length);
+            out[length] = '\0';
+            return Result_t{std::string_view(out, length), buffer.size()};
+        }
+    } // namespace detail
+
+    /**
+     * @brief format into \c out, cut at outSize - 1 and always terminated
+     *
+     * @return Result_t view of the text in \c out and the length it needed
+     */
+    template <typename S, typename... Args, std::enable_if_t<fmt::is_compile_string<S>::value, int> = 0>
+    inline Result_t format_to_n(char *out, size_t outSize, const S &format, const Args &...args)
+    {
+        return detail::FormatToN<128>(out, outSize, format, args...);
+    }
+
+    // the stack buffer as large as \c out : a text that fits does not touch the heap
+    template <size_t N, typename S, typename... Args, std::enable_if_t<fmt::is_compile_string<S>::value, int> = 0>
+    inline Result_t format_to_n(char (&out)[N], const S &format, const Args &...args)
+    {
+        return detail::FormatToN<(N > 128 ? N : 128)>(out, N, format, args...);
+    }
+
+    // append to a Buffer, not terminated ( buffer.data(), buffer.size() )
+    template <size_t N, typename S, typename... Args, std::enable_if_t<fmt::is_compile_string<S>::value, int> = 0>
+    inline void format_to(Buffer<N> &buffer, const S &format, const Args &...args)
+    {
+        fmt::format_to(std::back_inserter(buffer), detail::Compile<Args...>(format), args...);
+    }
+
+    // append to \c out : formatted on the stack, \c out grows once
+    template <typename S, typename... Args, std::enable_if_t<fmt::is_compile_string<S>::value, int> = 0>
+    inline std::string &append(std::string &out, const S &format, const Args &...args)
+    {
+        Buffer<> buffer;
+        format_to(buffer, format, args...);
+        return out.append(buffer.data(), buffer.size());
+    }
+
+    // new string of the exact size
+    template <typename S, typename... Args, std::enable_if_t<fmt::is_compile_string<S>::value, int> = 0>
+    inline std::string format(const S &format, const Args &...args)
+    {
+        Buffer<> buffer;
+        format_to(buffer, format, args...);
+        return std::string(buffer.data(), buffer.size());
+    }
+
+    template <typename S, typename... Args, std::enable_if_t<fmt::is_compile_string<S>::value, int> = 0>
+    inline size_t formatted_size(const S &format, const Args &...args)
+    {
+        return fmt::formatted_size(detail::Compile<Args...>(format), args...);
+    }
+} // namespace ffmt
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __ALADIN_PUBLISH_COALESCER_H__
+#define __ALADIN_PUBLISH_COALESCER_H__
+#pragma once
+
+#include "esp_err.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief outbound stage for state / retained topics : "latest value wins" per topic.
+ * messages are staged, a newer message on a pending topic replaces the older one,
+ * and Flush() hands everything pending to the client in one pass.
+ * the owner decides when to flush ( timer window, end of a status sweep .. )
+ *
+ * the sink is client agnostic, ex with idf::mqtt::Client :
+ *  PublishCoalescer outbox([&client](const std::string &topic, const std::string &payload, uint8_t qos, bool retained) {
+ *      return client.publish(topic, idf::mqtt::StringMessage{payload, idf::mqtt::QoS(qos), idf::mqtt::Retain(retained)}) ? ESP_OK : ESP_FAIL; });
+ */
+class PublishCoalescer
+{
+public:
+    using Sink_t = std::function<esp_err_t(const std::string &topic, const std::string &payload, uint8_t qos, bool retained)>;
+    struct Stats_t
+    {
+        uint32_t staged = 0;    // Stage() calls
+        uint32_t coalesced = 0; // staged messages that replaced a pending one
+        uint32_t flushes = 0;   // Flush() passes that sent something
+        uint32_t published = 0; // messages handed to the sink
+        uint32_t bytes = 0;     // payload bytes handed to the sink
+        uint32_t errors = 0;    // sink refusals ( the flush stops, messages stay pending )
+    };
+
+    explicit PublishCoalescer(Sink_t sink);
+    PublishCoalescer(const PublishCoalescer &) = delete;
+    PublishCoalescer &operator=(const PublishCoalescer &) = delete;
+
+    // stage a message, replaces a pending message on the same topic
+    esp_err_t Stage(const std::string &topic, const std::string &payload, uint8_t qos = 1, bool retained = true);
+    // send the pending messages to the sink in one pass, stops at the first refusal
+    esp_err_t Flush();
+    // drop pending messages and forget known topics
+    void Clear();
+    size_t Pending();
+    Stats_t GetStats();
+    void ResetStats();
+
+private:
+    struct Entry_t
+    {
+        std::string payload{};
+        uint8_t qos = 0;
+        bool retained = false;
+        bool pending = false;
+    };
+    Sink_t sink;
+    // topics are kept after a flush so node and payload capacity are reused on the next sweep
+    std::map<std::string, Entry_t> entries{};
+    size_t pendingCount = 0;
+    Stats_t stats{};
+    std::mutex lock;      // entries / stats
+    std::mutex flushLock; // one flush at a time, the sink is called without holding lock
+    std::string sendBuffer{};
+};
+
+#endif // __ALADIN_PUBLISH_COALESCER_H__
@@ -0,0 +1,161 @@
+#ifndef __ALADIN_SPSC_RING_H__
+#define __ALADIN_SPSC_RING_H__
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * @brief single producer / single consumer byte ring storing records of two strings inline
+ * ( ex : mqtt topic + payload ). a record is [u32 firstLen][u32 secondLen][first][second], padded to 4 bytes
+ * and never split across the end of the buffer, so the consumer gets contiguous string_views into the ring
+ * that stay valid until Release().
+ *
+ * @tparam SIZE ring size in bytes, power of two
+ */
+template <size_t SIZE>
+class SpscByteRing
+{
+    static_assert(SIZE >= 64 && (SIZE & (SIZE - 1)) == 0, "SpscByteRing size must be a power of two >= 64");
+
+public:
+    struct Stats_t
+    {
+        uint32_t pushed;
+        uint32_t dropped;   // records rejected because the ring was full / too big
+        uint32_t highWater; // max bytes used at once
+    };
+
+    SpscByteRing() = default;
+    SpscByteRing(const SpscByteRing &) = delete;
+    SpscByteRing &operator=(const SpscByteRing &) = delete;
+
+    /**
+     * @brief copy a record into the ring, never blocks (producer side)
+     *
+     * @return true stored , false dropped (ring full)
+     */
+    bool Push(std::string_view first, std::string_view second)
+    {
+        const size_t need = RecordSize(first.size(), second.size());
+        if (need > SIZE)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        const uint32_t t = tail.load(std::memory_order_acquire);
+        const size_t pos = h & (SIZE - 1);
+        const size_t contiguous = SIZE - pos;
+        const size_t skip = (need > contiguous) ? contiguous : 0; // record goes to the start of the buffer
+        const size_t used = h - t;
+        if (used + skip + need > SIZE)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (skip >= HEADER_SIZE)
+        {
+            WriteU32(pos, PAD_MARKER);
+        }
+        const size_t start = (pos + skip) & (SIZE - 1);
+        WriteU32(start, static_cast<uint32_t>(first.size()));
+        WriteU32(start + 4, static_cast<uint32_t>(second.size()));
+        if (!first.empty())
+            memcpy(&buffer[start + HEADER_SIZE], first.data(), first.size());
+        if (!second.empty())
+            memcpy(&buffer[start + HEADER_SIZE + first.size()], second.data(), second.size());
+        head.store(static_cast<uint32_t>(h + skip + need), std::memory_order_release);
+        pushed.fetch_add(1, std::memory_order_relaxed);
+        const uint32_t nowUsed = static_cast<uint32_t>(used + skip + need);
+        if (nowUsed > highWater.load(std::memory_order_relaxed))
+        {
+            highWater.store(nowUsed, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * @brief view the oldest record without removing it (consumer side)
+     *
+     * @return true a record is available , false ring empty
+     */
+    bool Peek(std::string_view &first, std::string_view &second)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        const uint32_t h = head.load(std::memory_order_acquire);
+        while (t != h)
+        {
+            const size_t pos = t & (SIZE - 1);
+            const size_t contiguous = SIZE - pos;
+            if (contiguous < HEADER_SIZE || ReadU32(pos) == PAD_MARKER)
+            {
+                t += contiguous; // producer wrapped here
+                tail.store(t, std::memory_order_release);
+                continue;
+            }
+            const uint32_t firstLen = ReadU32(pos);
+            const uint32_t secondLen = ReadU32(pos + 4);
+            const char *data = reinterpret_cast<const char *>(&buffer[pos + HEADER_SIZE]);
+            first = std::string_view(data, firstLen);
+            second = std::string_view(data + firstLen, secondLen);
+            peekedSize = RecordSize(firstLen, secondLen);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief drop the record returned by the last Peek(), its views become invalid
+     */
+    void Release()
+    {
+        if (peekedSize == 0)
+            return;
+        tail.store(tail.load(std::memory_order_relaxed) + peekedSize, std::memory_order_release);
+        peekedSize = 0;
+    }
+
+    bool Empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+    size_t Used() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    static constexpr size_t Capacity() { return SIZE; }
+    // largest record ( both strings ) an empty ring always takes, a bigger one ( up to SIZE - 8 bytes )
+    // only fits when the write position leaves room for it before the end of the buffer
+    static constexpr size_t MaxRecord() { return SIZE / 2 - HEADER_SIZE; }
+
+    Stats_t GetStats() const
+    {
+        return {pushed.load(std::memory_order_relaxed), dropped.load(std::memory_order_relaxed), highWater.load(std::memory_order_relaxed)};
+    }
+    void ResetStats()
+    {
+        pushed.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+        highWater.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t HEADER_SIZE = 8;
+    static constexpr uint32_t PAD_MARKER = 0xFFFFFFFF;
+    static constexpr size_t RecordSize(size_t firstLen, size_t secondLen) { return (HEADER_SIZE + firstLen + secondLen + 3) & ~static_cast<size_t>(3); }
+    void WriteU32(size_t pos, uint32_t val) { memcpy(&buffer[pos], &val, sizeof(val)); }
+    uint32_t ReadU32(size_t pos) const
+    {
+        uint32_t val;
+        memcpy(&val, &buffer[pos], sizeof(val));
+        return val;
+    }
+
+    alignas(4) std::array<uint8_t, SIZE> buffer{};
+    std::atomic<uint32_t> head{0}; // written by the producer only
+    std::atomic<uint32_t> tail{0}; // written by the consumer only
+    size_t peekedSize = 0;         // consumer side
+    std::atomic<uint32_t> pushed{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<uint32_t> highWater{0};
+};
+
+#endif // __ALADIN_SPSC_RING_H__
@@ -0,0 +1,205 @@
+#ifndef __ALADIN_TASK_POOL_H__
+#define __ALADIN_TASK_POOL_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "_pthread.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#ifndef CONFIG_TASK_POOL_WORKERS
+#define CONFIG_TASK_POOL_WORKERS 2
+#endif
+#ifndef CONFIG_TASK_POOL_STACK
+#define CONFIG_TASK_POOL_STACK 4096
+#endif
+#ifndef CONFIG_TASK_POOL_PRIORITY
+#define CONFIG_TASK_POOL_PRIORITY 5
+#endif
+
+/**
+ * @brief fixed set of workers ( AladinPthread_t, pinned round robin on the cores ) running short jobs,
+ * instead of a new FreeRTOS task and stack per one-shot job.
+ * every worker owns a deque per priority : it pops its own jobs LIFO and steals the oldest job of the others when idle.
+ * high priority jobs are taken before any low priority one.
+ * jobs must not block for long ( a blocking loop keeps its own task ), delayed jobs go through SubmitAfter().
+ *
+ *  auto result = TaskPool::Default().Submit([]() { return 42; });
+ *  TaskPool::Default().SubmitAfter(10s, []() { esp_restart(); });
+ */
+class TaskPool
+{
+public:
+    enum Priority_t
+    {
+        PRIO_LOW = 0,
+        PRIO_HIGH = 1,
+    };
+    struct Stats_t
+    {
+        uint32_t submitted = 0; // jobs queued
+        uint32_t executed = 0;  // jobs run
+        uint32_t stolen = 0;    // jobs run by another worker than the one they were queued on
+        uint32_t sleeps = 0;    // a worker found nothing to do
+    };
+    using Job_t = std::function<void()>;
+
+    explicit TaskPool(size_t workers = CONFIG_TASK_POOL_WORKERS, int stack = CONFIG_TASK_POOL_STACK, int prio = CONFIG_TASK_POOL_PRIORITY, const char *name = "pool");
+    ~TaskPool();
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    // shared pool, started on first use
+    static TaskPool &Default();
+
+    /**
+     * @brief queue a job, fire and forget
+     *
+     * @return esp_err_t ESP_ERR_INVALID_STATE if the pool is stopping
+     */
+    esp_err_t Post(Job_t job, Priority_t prio = PRIO_LOW);
+
+    /**
+     * @brief queue a job and get its result ( or its exception ) through a future
+     */
+    template <typename F>
+    auto Submit(F &&fn, Priority_t prio = PRIO_LOW) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+        auto ret = task->get_future();
+        Post([task]()
+             { (*task)(); },
+             prio);
+        return ret;
+    }
+
+    /**
+     * @brief continuation : \c next gets the result of \c first, it is queued on the worker that ran \c first
+     * once \c first returned, no worker waits in between. an exception of \c first skips \c next and
+     * reaches the returned future.
+     */
+    template <typename F, typename C>
+    auto SubmitThen(F &&first, C &&next, Priority_t prio = PRIO_LOW)
+    {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        if constexpr (std::is_void_v<R>)
+        {
+            using N = std::invoke_result_t<std::decay_t<C>>;
+            auto task = std::make_shared<std::packaged_task<N(std::exception_ptr)>>(
+                [then = std::forward<C>(next)](std::exception_ptr error) mutable
+                {
+                    if (error)
+                    {
+                        std::rethrow_exception(error);
+                    }
+                    return then();
+                });
+            auto ret = task->get_future();
+            Post([this, fn = std::forward<F>(first), task, prio]() mutable
+                 {
+                     std::exception_ptr error = nullptr;
+                     try
+                     {
+                         fn();
+                     }
+                     catch (...)
+                     {
+                         error = std::current_exception();
+                     }
+                     Post([task, error]()
+                          { (*task)(error); },
+                          prio); },
+                 prio);
+            return ret;
+        }
+        else
+        {
+            using N = std::invoke_result_t<std::decay_t<C>, R>;
+            auto task = std::make_shared<std::packaged_task<N(std::exception_ptr, std::shared_ptr<R>)>>(
+                [then = std::forward<C>(next)](std::exception_ptr error, std::shared_ptr<R> value) mutable
+                {
+                    if (error)
+                    {
+                        std::rethrow_exception(error);
+                    }
+                    return then(std::move(*value));
+                });
+            auto ret = task->get_future();
+            Post([this, fn = std::forward<F>(first), task, prio]() mutable
+                 {
+                     std::exception_ptr error = nullptr;
+                     std::shared_ptr<R> value = nullptr;
+                     try
+                     {
+                         value = std::make_shared<R>(fn());
+                     }
+                     catch (...)
+                     {
+                         error = std::current_exception();
+                     }
+                     Post([task, error, value]()
+                          { (*task)(error, value); },
+                          prio); },
+                 prio);
+            return ret;
+        }
+    }
+
+    /**
+     * @brief queue a job once \c delay elapsed, the delay runs on the shared TimerWheel and holds no worker
+     */
+    template <typename r, typename p>
+    esp_err_t SubmitAfter(const std::chrono::duration<r, p> &delay, Job_t job, Priority_t prio = PRIO_LOW)
+    {
+        return PostAfter(std::chrono::duration_cast<std::chrono::microseconds>(delay).count(), std::move(job), prio);
+    }
+
+    /**
+     * @brief drop-in for AsyncTask(cb, tag, arg) : runs \c cb(arg) on the pool
+     */
+    static esp_err_t Async(std::function<void(void *)> cb, const char *tag = "Async", void *arg = nullptr);
+
+    size_t GetWorkerCount() const { return workers.size(); }
+    Stats_t GetStats() const;
+    void ResetStats();
+
+private:
+    struct Worker_t
+    {
+        std::mutex lock;
+        std::deque<Job_t> jobs[2]; // per Priority_t
+        std::unique_ptr<AladinPthread_t> thread{nullptr};
+    };
+    void WorkerLoop(size_t index);
+    bool Take(size_t index, Job_t &job);
+    bool PopLocal(Worker_t &worker, int prio, Job_t &job);
+    bool Steal(Worker_t &worker, int prio, Job_t &job);
+    esp_err_t PostAfter(int64_t delayUs, Job_t job, Priority_t prio);
+
+    std::vector<std::unique_ptr<Worker_t>> workers;
+    std::atomic<uint32_t> nextWorker{0}; // round robin for jobs posted from outside the pool
+    std::atomic<uint32_t> pending{0};    // jobs queued, not taken yet
+    std::atomic<uint32_t> sleeping{0};
+    std::atomic<bool> exiting{false};
+    std::mutex idleLock;
+    std::condition_variable wake;
+
+    std::atomic<uint32_t> submitted{0};
+    std::atomic<uint32_t> executed{0};
+    std::atomic<uint32_t> stolen{0};
+    std::atomic<uint32_t> sleeps{0};
+};
+
+#endif // __ALADIN_TASK_POOL_H__
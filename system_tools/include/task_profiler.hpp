@@ -0,0 +1,277 @@
+#ifndef __ALADIN_TASK_PROFILER_H__
+#define __ALADIN_TASK_PROFILER_H__
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "timer_wheel.hpp"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef CONFIG_TASK_PROFILER_MAX_TASKS
+#define CONFIG_TASK_PROFILER_MAX_TASKS 32
+#endif
+#ifndef CONFIG_TASK_PROFILER_TABLE_SPARE
+#define CONFIG_TASK_PROFILER_TABLE_SPARE 8
+#endif
+#ifndef CONFIG_TASK_PROFILER_RING_RECORDS
+#define CONFIG_TASK_PROFILER_RING_RECORDS 256
+#endif
+#ifndef CONFIG_TASK_PROFILER_PERIOD_MS
+#define CONFIG_TASK_PROFILER_PERIOD_MS 1000
+#endif
+#ifndef CONFIG_TASK_PROFILER_WINDOW
+#define CONFIG_TASK_PROFILER_WINDOW 10
+#endif
+#ifndef CONFIG_TASK_PROFILER_STACK_ALARM
+#define CONFIG_TASK_PROFILER_STACK_ALARM 256
+#endif
+#ifndef CONFIG_TASK_PROFILER_CPU_ALARM
+#define CONFIG_TASK_PROFILER_CPU_ALARM 90
+#endif
+#ifndef CONFIG_TASK_PROFILER_BUDGET_US
+#define CONFIG_TASK_PROFILER_BUDGET_US 500
+#endif
+#ifndef CONFIG_TASK_PROFILER_PUBLISH_EVERY
+#define CONFIG_TASK_PROFILER_PUBLISH_EVERY 0
+#endif
+
+struct TaskProfilerConfig_t
+{
+    uint32_t periodMs = CONFIG_TASK_PROFILER_PERIOD_MS;
+    uint8_t window = CONFIG_TASK_PROFILER_WINDOW;         // samples of the rolling cpu, 1 .. MAX_WINDOW
+    uint32_t stackAlarm = CONFIG_TASK_PROFILER_STACK_ALARM; // free stack ( bytes ) under which a task alarms, 0 : none
+    uint8_t cpuAlarm = CONFIG_TASK_PROFILER_CPU_ALARM;     // rolling % of one core over which a task alarms, 0 : none
+    uint32_t budgetUs = CONFIG_TASK_PROFILER_BUDGET_US;    // a sample taking longer is counted over budget
+    uint16_t publishEvery = CONFIG_TASK_PROFILER_PUBLISH_EVERY; // samples between two publishes, 0 : none
+    bool binary = false;                                   // publish RenderBinary() instead of the json
+};
+
+/**
+ * @brief sampling profiler of the FreeRTOS tasks : every \c periodMs the task table ( uxTaskGetSystemState ) is
+ * read once, each task leaves a 16 byte record ( cpu of the sample, free stack, state ) in a fixed ring,
+ * and its cpu is averaged over the last \c window samples. crossing the stack or cpu threshold raises an alarm
+ * ( once, until it clears ). nothing is allocated after the constructor, except by the publish / render calls.
+ * cpu is in permille of one core, like vTaskGetRunTimeStats : the tasks add up to 1000 x cores.
+ * host builds read a SimulatedTaskTable instead of the scheduler.
+ *
+ *  TaskProfiler profiler;
+ *  profiler.SetPublishFunction([](const std::string& topic, const std::string& payload) {
+ *      return mqtt.Publish(topic, payload, 0, false); }, "home/esp/profiler");
+ *  profiler.Start();
+ *  TaskProfilerStatus status(profiler); // "task_profiler" in the status dump
+ */
+class TaskProfiler
+{
+public:
+    static constexpr size_t MAX_TASKS = CONFIG_TASK_PROFILER_MAX_TASKS;
+    static constexpr size_t MAX_WINDOW = 16;
+    static constexpr size_t NAME_SIZE = 16;
+
+    // one task as read from the scheduler ( or the simulated table )
+    struct TaskSample_t
+    {
+        uint32_t number;    // xTaskNumber, unique while the task lives
+        char name[NAME_SIZE];
+        uint32_t runTime;   // run time counter
+        uint32_t stackFree; // high water mark, bytes
+        uint8_t state;      // eTaskState
+        uint8_t priority;
+        int8_t core;        // -1 : no affinity
+    };
+    /**
+     * @brief read the task table
+     *
+     * @return size_t tasks in the table, only the first \c max are written, 0 : the table could not be read.
+     * \c totalRunTime : run time counter of the clock
+     */
+    using Source_t = std::function<size_t(TaskSample_t *tasks, size_t max, uint32_t &totalRunTime)>;
+    using Publish_t = std::function<esp_err_t(const std::string &topic, const std::string &payload)>;
+    using Config_t = TaskProfilerConfig_t;
+
+    // binary record of one task in one sample
+    struct Record_t
+    {
+        uint32_t timeMs;
+        uint32_t runDelta;  // run time counter since the previous sample
+        uint32_t stackFree;
+        uint16_t cpu;       // permille of one core over this sample
+        uint8_t slot;       // GetTasks() index
+        uint8_t state;
+    };
+    static_assert(sizeof(Record_t) == 16, "Record_t is part of the binary format");
+
+    enum Alarm_t : uint8_t
+    {
+        ALARM_STACK = 1,
+        ALARM_CPU = 2,
+    };
+    struct TaskInfo_t
+    {
+        char name[NAME_SIZE];
+        uint32_t number;
+        uint16_t cpu;          // rolling, permille of one core
+        uint16_t peakCpu;      // highest cpu of a single sample
+        uint32_t stackFree;
+        uint32_t minStackFree;
+        uint8_t state;
+        uint8_t priority;
+        int8_t core;
+        uint8_t alarms;        // Alarm_t raised
+        uint8_t slot;
+    };
+    // raised alarm, called after the sample outside the lock
+    using AlarmFunction_t = std::function<void(const TaskInfo_t &task, Alarm_t alarm)>;
+
+    struct Stats_t
+    {
+        uint32_t samples;
+        uint32_t records;    // written to the ring
+        uint32_t alarms;     // raised
+        uint32_t overBudget; // samples slower than budgetUs
+        uint32_t lastUs;     // time of the last sample
+        uint32_t maxUs;
+        uint32_t truncated;  // samples with more tasks than MAX_TASKS
+        uint32_t unread;     // samples whose task table could not be read
+        uint32_t published;
+        uint32_t errors;     // publish failures
+    };
+
+    /**
+     * @param source nullptr : uxTaskGetSystemState() on target, SimulatedTaskTable::Default() on host
+     * @param wheel sampling timer, nullptr : nothing is armed, the caller drives Sample() ( tests )
+     */
+    explicit TaskProfiler(const Config_t &config = Config_t(), Source_t source = nullptr, TimerWheel *wheel = &TimerWheel::Default());
+    ~TaskProfiler();
+    TaskProfiler(const TaskProfiler &) = delete;
+    TaskProfiler &operator=(const TaskProfiler &) = delete;
+
+    esp_err_t Start();
+    esp_err_t Stop();
+
+    void SetAlarmFunction(AlarmFunction_t alarm);
+    void SetPublishFunction(Publish_t publish, const std::string &topic);
+
+    /**
+     * @brief one pass : read the tasks, write their records, update the rolling cpu and the alarms,
+     * publish when due. the first pass only primes the counters
+     *
+     * @return esp_err_t ESP_ERR_INVALID_STATE no source, ESP_ERR_INVALID_SIZE the source returned nothing
+     */
+    esp_err_t Sample(uint32_t nowMs);
+    esp_err_t Sample() { return Sample(NowMs()); }
+
+    // tasks alive at the last sample, in slot order
+    size_t GetTasks(TaskInfo_t *tasks, size_t max);
+    // records of the ring newer than \c sinceMs, oldest first
+    size_t GetRecords(Record_t *records, size_t max, uint32_t sinceMs = 0);
+
+    /**
+     * @brief compact json :
+     * {"period":ms,"samples":n,"us":last,"max_us":max,"over":overBudget,
+     *  "tasks":[["name",cpu,peak,stackFree,minStackFree,state,priority,core,alarms],...]}
+     */
+    void RenderJson(nlohmann::json &out);
+    /**
+     * @brief binary : "TPRF" u8 version u8 tasks u16 records, then per task u8 slot u8 alarms u16 cpu u32 minStackFree
+     * char name[16], then the records of the last sample ( Record_t, little endian )
+     */
+    void RenderBinary(std::string &out);
+
+    uint32_t NowMs() const;
+    Config_t GetConfig();
+    void SetConfig(const Config_t &config);
+    Stats_t GetStats();
+    void ResetStats();
+
+private:
+    struct Slot_t
+    {
+        TaskInfo_t info;
+        uint32_t lastRunTime;
+        uint32_t deltas[MAX_WINDOW];
+        uint32_t seen;  // sample that last read the task
+        uint8_t filled; // deltas valid, a new task averages over what it has
+        bool used;
+    };
+
+    static Source_t DefaultSource();
+    Slot_t *FindSlot(const TaskSample_t &task);
+    void Update(Slot_t &slot, const TaskSample_t &task, uint32_t totalDelta, uint32_t nowMs);
+    void Push(const Record_t &record);
+    void RenderJsonLocked(nlohmann::json &out);
+    void RenderBinaryLocked(std::string &out);
+
+    Config_t config;
+    Source_t source;
+    TimerWheel *const wheel;
+    WheelTimer_p_t timer{nullptr};
+    std::mutex passLock; // Sample(), the publish and alarm functions run without \c lock
+    std::mutex lock;
+    std::vector<TaskSample_t> scratch;
+    std::vector<Slot_t> slots;
+    std::vector<Record_t> ring;
+    size_t ringHead = 0;  // next record
+    size_t ringCount = 0;
+    uint32_t lastRecords = 0; // records of the last sample
+    uint32_t totals[MAX_WINDOW] = {};
+    uint32_t lastTotal = 0;
+    bool primed = false;
+    std::vector<std::pair<TaskInfo_t, Alarm_t>> raised;
+    AlarmFunction_t alarmFunction = nullptr;
+    Publish_t publish = nullptr;
+    std::string topic;
+    std::string payload; // publish buffer, keeps its capacity
+    Stats_t stats{};
+};
+
+/**
+ * @brief task table for host builds : run time advances with Advance() ( or with the wall clock when
+ * \c realTime ), each task takes \c load of one core
+ *
+ *  SimulatedTaskTable table(false);
+ *  size_t wifi = table.Add("wifi", 23, 1800, 0.12f, 0);
+ *  TaskProfiler profiler(config, table.Source(), nullptr);
+ *  table.Advance(1000000); profiler.Sample(1000);
+ */
+class SimulatedTaskTable
+{
+public:
+    explicit SimulatedTaskTable(bool realTime = false);
+    // table behind the host TaskProfiler, advances with the wall clock
+    static SimulatedTaskTable &Default();
+
+    size_t Add(const char *name, uint8_t priority, uint32_t stackFree, float load, int8_t core = -1);
+    esp_err_t Remove(size_t id);
+    esp_err_t SetLoad(size_t id, float load);
+    esp_err_t SetStackFree(size_t id, uint32_t stackFree);
+    esp_err_t SetState(size_t id, uint8_t state);
+    void Advance(uint32_t us);
+
+    size_t Read(TaskProfiler::TaskSample_t *tasks, size_t max, uint32_t &totalRunTime);
+    TaskProfiler::Source_t Source();
+
+private:
+    struct Task_t
+    {
+        TaskProfiler::TaskSample_t sample;
+        float load;
+        double runTime;
+        bool alive;
+    };
+    void AdvanceLocked(uint64_t us);
+
+    std::mutex lock;
+    std::vector<Task_t> tasks;
+    uint32_t nextNumber = 1;
+    uint64_t totalUs = 0;
+    const bool realTime;
+    uint64_t lastUs = 0;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __ALADIN_TASK_PROFILER_STATUS_H__
+#define __ALADIN_TASK_PROFILER_STATUS_H__
+#pragma once
+
+#include "config.hpp"
+#include "task_profiler.hpp"
+
+/**
+ * @brief TaskProfiler in the status dump ( system_request_status ) :
+ * "task_profiler":{"period":..,"samples":..,"us":..,"max_us":..,"over":..,"tasks":[[...],...]}
+ */
+class TaskProfilerStatus : public Config
+{
+public:
+    static constexpr char TAG[] = "task_profiler";
+
+    explicit TaskProfilerStatus(TaskProfiler &profiler);
+
+protected:
+    esp_err_t GetConfigurationStatus(json &config_out) const override;
+
+private:
+    TaskProfiler &profiler;
+};
+
+#endif
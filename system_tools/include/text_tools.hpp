@@ -0,0 +1,316 @@
+#ifndef __ALADIN_TEXT_TOOLS_H__
+#define __ALADIN_TEXT_TOOLS_H__
+#pragma once
+
+#include "esp_err.h"
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief text helpers on std::string_view, nothing allocated : the views point into the source,
+ * which must outlive them. ASCII only ( no locale ), numbers through std::from_chars.
+ *
+ *  for (std::string_view cell : text::Split(payload, ',', text::Split_t::TRIM))
+ *  {
+ *      uint16_t value = 0;
+ *      if (text::Parse(cell, value) != ESP_OK) return ESP_ERR_INVALID_ARG;
+ *  }
+ */
+namespace text
+{
+    static constexpr std::string_view WHITESPACE = " \t\r\n";
+
+    constexpr std::string_view TrimLeft(std::string_view str, std::string_view chars = WHITESPACE)
+    {
+        const size_t first = str.find_first_not_of(chars);
+        return (first == std::string_view::npos) ? std::string_view() : str.substr(first);
+    }
+    constexpr std::string_view TrimRight(std::string_view str, std::string_view chars = WHITESPACE)
+    {
+        const size_t last = str.find_last_not_of(chars);
+        return (last == std::string_view::npos) ? std::string_view() : str.substr(0, last + 1);
+    }
+    constexpr std::string_view Trim(std::string_view str, std::string_view chars = WHITESPACE)
+    {
+        return TrimRight(TrimLeft(str, chars), chars);
+    }
+    // erase the ends of \c str, keeps its capacity
+    inline std::string &TrimInPlace(std::string &str, std::string_view chars = WHITESPACE)
+    {
+        const std::string_view view = Trim(str, chars);
+        const size_t first = view.empty() ? 0 : static_cast<size_t>(view.data() - str.data());
+        str.erase(first + view.size()).erase(0, first);
+        return str;
+    }
+
+    constexpr char ToLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+    }
+    constexpr char ToUpper(char c)
+    {
+        return (c >= 'a' && c <= 'z') ? static_cast<char>(c & ~0x20) : c;
+    }
+    inline std::string &ToLowerInPlace(std::string &str)
+    {
+        for (char &c : str)
+        {
+            c = ToLower(c);
+        }
+        return str;
+    }
+    inline std::string &ToUpperInPlace(std::string &str)
+    {
+        for (char &c : str)
+        {
+            c = ToUpper(c);
+        }
+        return str;
+    }
+    constexpr bool EqualsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (ToLower(a[i]) != ToLower(b[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    constexpr bool StartsWith(std::string_view str, std::string_view prefix)
+    {
+        return str.substr(0, prefix.size()) == prefix;
+    }
+    constexpr bool EndsWith(std::string_view str, std::string_view suffix)
+    {
+        return str.size() >= suffix.size() && str.substr(str.size() - suffix.size()) == suffix;
+    }
+
+    enum class Split_t : uint8_t
+    {
+        NONE = 0,
+        TRIM = 1,       // tokens without WHITESPACE at the ends
+        SKIP_EMPTY = 2, // no empty tokens ( after TRIM )
+    };
+    constexpr Split_t operator|(Split_t a, Split_t b)
+    {
+        return static_cast<Split_t>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+    }
+    constexpr bool operator&(Split_t a, Split_t b)
+    {
+        return (static_cast<uint8_t>(a) & static_cast<uint8_t>(b)) != 0;
+    }
+
+    /**
+     * @brief lazy split : each step finds the next delimiter, the tokens are views into the source.
+     * same tokens as std::getline : "a,,b," gives "a" "" "b", an empty source gives none
+     */
+    class SplitRange
+    {
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const std::string_view *;
+            using reference = const std::string_view &;
+
+            iterator() = default;
+            iterator(std::string_view source, char _delimiter, Split_t _flags) : rest(source), delimiter(_delimiter), flags(_flags), done(false)
+            {
+                Next();
+            }
+            reference operator*() const { return token; }
+            pointer operator->() const { return &token; }
+            iterator &operator++()
+            {
+                Next();
+                return *this;
+            }
+            iterator operator++(int)
+            {
+                iterator previous = *this;
+                Next();
+                return previous;
+            }
+            bool operator==(const iterator &other) const
+            {
+                return done == other.done && (done || rest.data() == other.rest.data());
+            }
+            bool operator!=(const iterator &other) const { return !(*this == other); }
+
+        private:
+            void Next()
+            {
+                while (!rest.empty())
+                {
+                    const size_t pos = rest.find(delimiter);
+                    token = rest.substr(0, pos);
+                    rest = (pos == std::string_view::npos) ? std::string_view(rest.data() + rest.size(), 0) : rest.substr(pos + 1);
+                    if (flags & Split_t::TRIM)
+                    {
+                        token = Trim(token);
+                    }
+                    if (!token.empty() || !(flags & Split_t::SKIP_EMPTY))
+                    {
+                        return;
+                    }
+                }
+                done = true;
+                token = std::string_view();
+            }
+
+            std::string_view rest;
+            std::string_view token;
+            char delimiter = 0;
+            Split_t flags = Split_t::NONE;
+            bool done = true;
+        };
+
+        SplitRange(std::string_view _source, char _delimiter, Split_t _flags) : source(_source), delimiter(_delimiter), flags(_flags) {}
+        iterator begin() const { return iterator(source, delimiter, flags); }
+        iterator end() const { return iterator(); }
+
+    private:
+        std::string_view source;
+        char delimiter;
+        Split_t flags;
+    };
+
+    inline SplitRange Split(std::string_view source, char delimiter, Split_t flags = Split_t::NONE)
+    {
+        return SplitRange(source, delimiter, flags);
+    }
+
+    namespace detail
+    {
+        // from_chars takes no '+'
+        constexpr std::string_view SkipPlus(std::string_view str)
+        {
+            return (str.size() > 1 && str[0] == '+' && str[1] != '-') ? str.substr(1) : str;
+        }
+    } // namespace detail
+
+    /**
+     * @brief the whole of \c str as a number, no whitespace, a leading '+' is taken
+     *
+     * @return ESP_ERR_INVALID_ARG not a number / trailing characters, ESP_ERR_INVALID_SIZE out of the range of T,
+     * \c value is only written on ESP_OK
+     */
+    template <typename T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value, int> = 0>
+    inline esp_err_t Parse(std::string_view str, T &value, int base = 10)
+    {
+        str = detail::SkipPlus(str);
+        T result{};
+        const auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), result, base);
+        if (error == std::errc::result_out_of_range)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (error != std::errc() || end != str.data() + str.size())
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        value = result;
+        return ESP_OK;
+    }
+
+    template <typename T, std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+    inline esp_err_t Parse(std::string_view str, T &value)
+    {
+        str = detail::SkipPlus(str);
+        if (str.empty())
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        T result{};
+        const auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), result);
+        if (error == std::errc::result_out_of_range)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (error != std::errc() || end != str.data() + str.size())
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        value = result;
+#else
+        // no floating point from_chars in this toolchain : strtod on a terminated copy
+        char buffer[40];
+        if (str.size() >= sizeof(buffer) || str[0] == ' ' || (str[0] >= '\t' && str[0] <= '\r'))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        memcpy(buffer, str.data(), str.size());
+        buffer[str.size()] = '\0';
+        char *end = nullptr;
+        const double result = strtod(buffer, &end);
+        if (end != buffer + str.size())
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (result > std::numeric_limits<T>::max() || result < std::numeric_limits<T>::lowest())
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        value = static_cast<T>(result);
+#endif
+        return ESP_OK;
+    }
+
+    /**
+     * @brief atoi / atof like : whitespace around and trailing text are ignored ( "42%" -> 42 )
+     *
+     * @return T the number at the start of \c str, \c fallback when there is none or it does not fit in T
+     */
+    template <typename T>
+    inline T To(std::string_view str, T fallback = T{})
+    {
+        str = Trim(str);
+        size_t length = 0;
+        const bool number = std::is_floating_point<T>::value;
+        while (length < str.size())
+        {
+            const char c = str[length];
+            const bool sign = (c == '-' || c == '+') && (length == 0 || (number && ToLower(str[length - 1]) == 'e'));
+            const bool digit = (c >= '0' && c <= '9') || (number && (c == '.' || ToLower(c) == 'e'));
+            if (!sign && !digit)
+            {
+                break;
+            }
+            length++;
+        }
+        T value = fallback;
+        for (; length > 0; length--) // "1e" "1e-" and alike : retry without the last character
+        {
+            const esp_err_t ret = Parse(str.substr(0, length), value);
+            if (ret == ESP_OK)
+            {
+                return value;
+            }
+            if (ret == ESP_ERR_INVALID_SIZE)
+            {
+                break;
+            }
+        }
+        return fallback;
+    }
+} // namespace text
+
+#endif
@@ -12,8 +12,8 @@
 #ifndef _UTILITIES_H
 #define _UTILITIES_H
 
-#ifdef ESP_PLATFORM
 #include "esp_system.h"
+#ifdef ESP_PLATFORM
 #include <esp_heap_caps.h>
 
 #else
@@ -26,9 +26,11 @@ typedef int multi_heap_info_t;
 #include "string.h"
 #include <array>
 #include <chrono>
+#include <cstring>
 #include <memory>
 #include <regex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "esp_netif_ip_addr.h"
 
@@ -82,7 +84,7 @@ public:
     static std::string ipToString(uint8_t *ip);
     static std::string ipToString(const esp_ip4_addr_t &ipadd);
 
-    static std::vector<std::string> split(std::string source, char delimiter);
+    static std::vector<std::string> split(std::string_view source, char delimiter);
     static std::string toLower(std::string &value);
     static std::string trim(const std::string &str);
     static std::string dumpHeapInfo(uint8_t type = 0);
@@ -179,6 +181,7 @@ static inline unsigned long long operator"" _MB(unsigned long long x)
     return x * 1024 * 1024;
 }
 
+#ifdef ESP_PLATFORM
 uint32_t IRAM_ATTR tools::getCycleCount()
 {
     uint32_t ccount;
@@ -186,6 +189,7 @@ uint32_t IRAM_ATTR tools::getCycleCount()
                          : "=a"(ccount));
     return ccount;
 }
+#endif
 
 template <typename InputIt, typename SourceLen, typename T, std::size_t size>
 void tools::copy_min_to_buffer(InputIt source, SourceLen source_length, T (&target)[size])
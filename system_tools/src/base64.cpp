@@ -0,0 +1,357 @@
+#include "base64.hpp"
+#include <array>
+
+#if !defined(ESP_PLATFORM) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+static constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                    "abcdefghijklmnopqrstuvwxyz"
+                                    "0123456789+/";
+static constexpr uint8_t BAD = 0xFF;
+
+// character -> 6 bits, BAD for everything else ( '=' and whitespace included )
+static constexpr std::array<uint8_t, 256> kDecode = []() {
+    std::array<uint8_t, 256> table{};
+    for (auto &v : table)
+    {
+        v = BAD;
+    }
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        table[static_cast<uint8_t>(kAlphabet[i])] = i;
+    }
+    return table;
+}();
+
+static inline bool IsSpace(uint8_t c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+#ifdef BASE64_X86
+/*
+ * SIMD paths after W. Mula / D. Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions".
+ * each 128 bit lane handles 12 bytes <-> 16 characters, the decoders only report a block as bad :
+ * the scalar path then decodes it and tells padding / whitespace / errors apart
+ */
+__attribute__((target("ssse3"))) static inline __m128i EncodeLane(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t0, t1);
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12 : offset to add for each range
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+__attribute__((target("ssse3"))) static void EncodeSsse3(const uint8_t *src, size_t n, size_t &pos, char *dst, size_t &w)
+{
+    // reads 16 bytes for 12
+    while (n - pos >= 16)
+    {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + w), EncodeLane(in));
+        pos += 12;
+        w += 16;
+    }
+}
+
+__attribute__((target("avx2"))) static void EncodeAvx2(const uint8_t *src, size_t n, size_t &pos, char *dst, size_t &w)
+{
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                             1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // reads 28 bytes for 24 : 12 per lane
+    while (n - pos >= 28)
+    {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        in = _mm256_shuffle_epi8(in, shuffle);
+        const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t0, t1);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + w), _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices));
+        pos += 24;
+        w += 32;
+    }
+}
+
+__attribute__((target("ssse3"))) static void DecodeSsse3(const uint8_t *src, size_t n, size_t &pos, uint8_t *out, size_t outSize, size_t &w)
+{
+    // high nibble -> offset, low nibble -> mask of the valid high nibbles
+    const __m128i shiftLut = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i maskLut = _mm_setr_epi8(0xa8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8,
+                                          0xf8, 0xf8, 0xf0, 0x54, 0x50, 0x50, 0x50, 0x54);
+    const __m128i bitLut = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    // writes 16 bytes for 12
+    while (n - pos >= 16 && outSize - w >= 16)
+    {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+        const __m128i high = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+        const __m128i low = _mm_and_si128(in, nibble);
+        const __m128i bad = _mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(maskLut, low), _mm_shuffle_epi8(bitLut, high)), _mm_setzero_si128());
+        if (_mm_movemask_epi8(bad) != 0)
+        {
+            return;
+        }
+        // '/' shares its high nibble with '+'
+        const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+        const __m128i shift = _mm_or_si128(_mm_andnot_si128(slash, _mm_shuffle_epi8(shiftLut, high)), _mm_and_si128(slash, _mm_set1_epi8(16)));
+        const __m128i values = _mm_add_epi8(in, shift);
+        const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        const __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        const __m128i bytes = _mm_shuffle_epi8(words, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + w), bytes);
+        pos += 16;
+        w += 12;
+    }
+}
+
+__attribute__((target("avx2"))) static void DecodeAvx2(const uint8_t *src, size_t n, size_t &pos, uint8_t *out, size_t outSize, size_t &w)
+{
+    const __m256i shiftLut = _mm256_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i maskLut = _mm256_setr_epi8(0xa8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8,
+                                             0xf8, 0xf8, 0xf0, 0x54, 0x50, 0x50, 0x50, 0x54,
+                                             0xa8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8,
+                                             0xf8, 0xf8, 0xf0, 0x54, 0x50, 0x50, 0x50, 0x54);
+    const __m256i bitLut = _mm256_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    // writes 32 bytes for 24
+    while (n - pos >= 32 && outSize - w >= 32)
+    {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos));
+        const __m256i high = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+        const __m256i low = _mm256_and_si256(in, nibble);
+        const __m256i bad = _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(maskLut, low), _mm256_shuffle_epi8(bitLut, high)), _mm256_setzero_si256());
+        if (_mm256_movemask_epi8(bad) != 0)
+        {
+            return;
+        }
+        const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+        const __m256i shift = _mm256_blendv_epi8(_mm256_shuffle_epi8(shiftLut, high), _mm256_set1_epi8(16), slash);
+        const __m256i values = _mm256_add_epi8(in, shift);
+        const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i words = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        // 12 bytes at the start of each lane -> 24 contiguous
+        const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, pack), _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + w), bytes);
+        pos += 32;
+        w += 24;
+    }
+}
+#endif
+
+Base64::Path_t Base64::BestPath()
+{
+#ifdef BASE64_X86
+    static const Path_t best = __builtin_cpu_supports("avx2") ? AVX2 : (__builtin_cpu_supports("ssse3") ? SSSE3 : SCALAR);
+    return best;
+#else
+    return SCALAR;
+#endif
+}
+
+Base64::Path_t Base64::Resolve(Path_t path)
+{
+    const Path_t best = BestPath();
+    return path < best ? path : best;
+}
+
+esp_err_t Base64::Encode(std::string_view in, char *out, size_t outSize, size_t *written, Path_t path)
+{
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(in.data());
+    const size_t n = in.size();
+    if (written != nullptr)
+    {
+        *written = 0;
+    }
+    if (outSize < EncodedLength(n))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t pos = 0, w = 0;
+#ifdef BASE64_X86
+    path = Resolve(path);
+    if (path == AVX2)
+    {
+        EncodeAvx2(src, n, pos, out, w);
+    }
+    if (path >= SSSE3)
+    {
+        EncodeSsse3(src, n, pos, out, w);
+    }
+#else
+    (void)path;
+#endif
+    for (; n - pos >= 3; pos += 3, w += 4)
+    {
+        const uint32_t v = (src[pos] << 16) | (src[pos + 1] << 8) | src[pos + 2];
+        out[w] = kAlphabet[v >> 18];
+        out[w + 1] = kAlphabet[(v >> 12) & 0x3F];
+        out[w + 2] = kAlphabet[(v >> 6) & 0x3F];
+        out[w + 3] = kAlphabet[v & 0x3F];
+    }
+    if (n - pos == 2)
+    {
+        const uint32_t v = (src[pos] << 8) | src[pos + 1];
+        out[w++] = kAlphabet[v >> 10];
+        out[w++] = kAlphabet[(v >> 4) & 0x3F];
+        out[w++] = kAlphabet[(v << 2) & 0x3F];
+        out[w++] = '=';
+    }
+    else if (n - pos == 1)
+    {
+        out[w++] = kAlphabet[src[pos] >> 2];
+        out[w++] = kAlphabet[(src[pos] << 4) & 0x3F];
+        out[w++] = '=';
+        out[w++] = '=';
+    }
+    if (written != nullptr)
+    {
+        *written = w;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief one quartet the fast loops stopped at : whitespace, padding, end of input, bad character or no room.
+ * \c done when the data ended
+ */
+esp_err_t Base64::DecodeTail(std::string_view in, size_t &pos, uint8_t *out, size_t outSize, size_t &w, Mode_t mode, bool &done)
+{
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(in.data());
+    const size_t n = in.size();
+    uint8_t q[4];
+    size_t count = 0;
+    while (pos < n && count < 4)
+    {
+        const uint8_t c = src[pos];
+        if (kDecode[c] != BAD)
+        {
+            q[count++] = kDecode[c];
+            pos++;
+        }
+        else if (c == '=')
+        {
+            break;
+        }
+        else if (mode == LENIENT && IsSpace(c))
+        {
+            pos++;
+        }
+        else
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (count == 4)
+    {
+        if (outSize - w < 3)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        out[w++] = (q[0] << 2) | (q[1] >> 4);
+        out[w++] = (q[1] << 4) | (q[2] >> 2);
+        out[w++] = (q[2] << 6) | q[3];
+        return ESP_OK;
+    }
+    done = true;
+    if (count == 0)
+    {
+        // lenient : anything after a '=' is ignored
+        return (pos == n || mode == LENIENT) ? ESP_OK : ESP_ERR_INVALID_ARG;
+    }
+    if (count == 1)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mode == STRICT)
+    {
+        size_t padding = 0;
+        for (; pos < n && src[pos] == '='; pos++)
+        {
+            padding++;
+        }
+        const uint8_t unused = (count == 2) ? (q[1] & 0x0F) : (q[2] & 0x03);
+        if (count + padding != 4 || pos != n || unused != 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (outSize - w < count - 1)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    out[w++] = (q[0] << 2) | (q[1] >> 4);
+    if (count == 3)
+    {
+        out[w++] = (q[1] << 4) | (q[2] >> 2);
+    }
+    return ESP_OK;
+}
+
+esp_err_t Base64::Decode(std::string_view in, uint8_t *out, size_t outSize, size_t *written, Mode_t mode, Path_t path)
+{
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(in.data());
+    const size_t n = in.size();
+    size_t pos = 0, w = 0;
+    esp_err_t ret = (mode == STRICT && (n % 4) != 0) ? ESP_ERR_INVALID_ARG : ESP_OK;
+    bool done = false;
+#ifdef BASE64_X86
+    path = Resolve(path);
+#else
+    (void)path;
+#endif
+    while (ret == ESP_OK && !done)
+    {
+#ifdef BASE64_X86
+        if (path == AVX2)
+        {
+            DecodeAvx2(src, n, pos, out, outSize, w);
+        }
+        if (path >= SSSE3)
+        {
+            DecodeSsse3(src, n, pos, out, outSize, w);
+        }
+#endif
+        // whole quartets of alphabet characters, four table lookups each
+        for (; n - pos >= 4 && outSize - w >= 3; pos += 4, w += 3)
+        {
+            const uint32_t a = kDecode[src[pos]];
+            const uint32_t b = kDecode[src[pos + 1]];
+            const uint32_t c = kDecode[src[pos + 2]];
+            const uint32_t d = kDecode[src[pos + 3]];
+            if ((a | b | c | d) == BAD)
+            {
+                break;
+            }
+            const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+            out[w] = v >> 16;
+            out[w + 1] = v >> 8;
+            out[w + 2] = v;
+        }
+        ret = DecodeTail(in, pos, out, outSize, w, mode, done);
+    }
+    if (written != nullptr)
+    {
+        *written = w;
+    }
+    return ret;
+}
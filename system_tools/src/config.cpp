@@ -5,15 +5,21 @@
 #ifdef ESP_PLATFORM
 #include "utilities.hpp"
 #endif
+#include "fast_format.hpp"
 #include "esp_exception.hpp"
 #include "esp_log.h"
 #include <sstream>
 #include <thread>
 #include <map>
-#include "FreeRTOS.hpp"
+#include "task_pool.hpp"
 std::map<const char *, Config *, StrCompare> Config::listOfConfig{};
+std::unordered_map<std::string_view, Config *> Config::configIndex{};
 // std::map<std::string, std::string> Config::configHashStr{};
 std::string Config::actionResponse{};
+std::string Config::dumpBuffer{};
+std::vector<Config *> Config::dumpList{};
+std::mutex Config::dumpLock{};
+std::mutex Config::renderLock{};
 // std::string Config::CommandResponse{};
 
 /**
@@ -34,12 +40,27 @@ esp_err_t Config::AssertPercentage(int num)
 
 Config::~Config()
 {
-    listOfConfig.erase(m_name.c_str());
+    std::lock_guard<std::mutex> render(renderLock); // a running dump may hold this instance
+    std::lock_guard<std::mutex> guard(dumpLock);
+    const auto listed = listOfConfig.find(m_name.c_str());
+    if (listed == listOfConfig.end() || listed->second != this)
+    {
+        return; // refused duplicate, the entries belong to the first class of that name
+    }
+    listOfConfig.erase(listed);
+    configIndex.erase(m_name);
 };
 
 Config::Config(const char *name) : m_name(std::string(name))
 {
-    listOfConfig[m_name.c_str()] = this;
+    // a class may be built late ( function static ) while a dump walks the list or a message looks it up
+    std::lock_guard<std::mutex> guard(dumpLock);
+    if (!listOfConfig.emplace(m_name.c_str(), this).second)
+    {
+        ESP_LOGE("Config", "a config named '%s' is already registered, this one is ignored", m_name.c_str());
+        return;
+    }
+    configIndex.emplace(m_name, this); // key views m_name, which lives as long as this instance
 } // constructor that only copies the name // usually called with original class' TAG
 
 /**
@@ -59,6 +80,7 @@ void Config::LoadConfig()
     {
         RestoreDefault();
     }
+    MarkConfigDirty();
 }
 
 /**
@@ -72,7 +94,7 @@ void Config::LoadConfig()
  */
 esp_err_t Config::AssertStrFind(const std::string &str, const char *key)
 {
-    if (str.find(key) != -1)
+    if (str.find(key) != std::string::npos)
         return ESP_OK;
     else
     {
@@ -92,7 +114,7 @@ esp_err_t Config::AssertStrFind(const std::string &str, const char *key)
 esp_err_t Config::AssertStrFind(const char *str, const char *key)
 {
     std::string compareString = (str);
-    return AssertStrFind(str, key);
+    return AssertStrFind(compareString, key);
 }
 
 esp_err_t Config::AddSystemInfo(json &info)
@@ -201,21 +223,81 @@ std::map<const char *, Config *, StrCompare> &Config::GetListOfConfig()
     return listOfConfig;
 }
 
-esp_err_t Config::_MqttCommandCallBackWrapper(const std::string &topic, const std::string &data)
+/**
+ * @brief find a registered config class by its name
+ *
+ * @param name config name (usually the class TAG)
+ * @return Config* nullptr if not registered
+ */
+Config *Config::FindConfig(std::string_view name)
 {
+    std::lock_guard<std::mutex> guard(dumpLock);
+    const auto it = configIndex.find(name);
+    return (it != configIndex.end()) ? it->second : nullptr;
+}
+
+/**
+ * @brief decide where an inbound message goes from its topic
+ * topics are expected to end with "/config" or "/action", any other topic
+ * falls back to searching the whole string as before
+ *
+ * @param topic mqtt topic
+ * @return Route_t
+ */
+Config::Route_t Config::RouteTopic(std::string_view topic)
+{
+    constexpr std::string_view CONFIG_SUFFIX = "config";
+    constexpr std::string_view ACTION_SUFFIX = "action";
+    const size_t slash = topic.rfind('/');
+    const std::string_view suffix = (slash != std::string_view::npos) ? topic.substr(slash + 1) : topic;
+    if (suffix == CONFIG_SUFFIX)
+        return Route_t::CONFIG;
+    if (suffix == ACTION_SUFFIX)
+        return Route_t::ACTION;
+    if (topic.find(CONFIG_SUFFIX) != std::string_view::npos)
+        return Route_t::CONFIG;
+    if (topic.find(ACTION_SUFFIX) != std::string_view::npos)
+        return Route_t::ACTION;
+    return Route_t::NONE;
+}
+
+esp_err_t Config::_MqttCommandCallBackWrapper(std::string_view topic, std::string_view data)
+{
+    const Route_t route = RouteTopic(topic);
+    if (route == Route_t::NONE)
+    {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
     try
     {
-        json j_parent = json::parse(data); // try to parse // will throw
-        esp_err_t ret = ESP_ERR_INVALID_RESPONSE;
-        if (topic.find("config") != -1)
+        // filtered parse : only the routed root object and the sub objects that belong to a registered
+        // config (or a system request) are kept, everything else is skipped without being stored
+        const char *rootKey = (route == Route_t::CONFIG) ? "config" : "command";
+        bool inRoot = false; // the callback still sees the members of a skipped root, they are not looked up
+        const json::parser_callback_t filter = [route, rootKey, &inRoot](int depth, json::parse_event_t event, json &parsed) -> bool
         {
-            return ParseJsonToConfig(j_parent);
-        }
-        if (topic.find("action") != -1)
+            if (event != json::parse_event_t::key)
+                return true;
+            const std::string &key = parsed.get_ref<const std::string &>();
+            if (depth == 1)
+                return inRoot = (key == rootKey);
+            if (depth == 2)
+            {
+                if (!inRoot)
+                    return false;
+                if ((FindConfig(key) != nullptr) || (route == Route_t::ACTION && key.rfind("system_request_", 0) == 0))
+                    return true;
+                ESP_LOGE("Config", "target class '%s' not found", key.c_str()); // skipped, never reaches ParseJsonTo..
+                return false;
+            }
+            return true;
+        };
+        const json j_parent = json::parse(data.begin(), data.end(), filter); // will throw
+        if (route == Route_t::CONFIG)
         {
-            return ParseJsonToCommands(j_parent);
+            return ParseJsonToConfig(j_parent);
         }
-        return ret;
+        return ParseJsonToCommands(j_parent);
     }
     catch (const json::exception &e)
     {
@@ -247,38 +329,37 @@ esp_err_t Config::ParseJsonToCommands(const json &j_parent)
             actionResponse = "";
             for (const auto &sub_json : j_parent["command"].items()) // get sub objects : ex rgb / wifi ..etc
             {
-                auto &list = Config::GetListOfConfig();   // get configguration list
-                const char *tag = sub_json.key().c_str(); // get json object key ( ex rgb )
-                if (list.count(tag) > 0)                  // match the key in json object with a config tag ( exist ?)
+                const char *tag = sub_json.key().c_str();           // get json object key ( ex rgb )
+                Config *targetClass = FindConfig(sub_json.key()); // match the key in json object with a config tag ( exist ?)
+                if (targetClass != nullptr)
                 {
                     // matched // initiate config
-                    Config *targetClass = list[tag]; // get the config class
-                    if (targetClass != nullptr)
+                    const json &jsonCommand = j_parent["command"]; // pass the prespective sub json object
+                    esp_err_t ret = targetClass->MqttCommandCallBack(jsonCommand);
+                    targetClass->MarkConfigDirty(); // a command may change parameters as well
+                    ffmt::append(actionResponse, FMT_COMPILE(" Command to {} return code {}"), tag, static_cast<int>(ret));
+                    if (ret == ESP_OK)
                     {
-                        const json &jsonCommand = j_parent["command"]; // pass the prespective sub json object
-                        esp_err_t ret = targetClass->MqttCommandCallBack(jsonCommand);
-                        actionResponse += tools::stringf(" Command to %s return code %d", tag, static_cast<int>(ret));
-                        if (ret == ESP_OK)
-                        {
-                            return ret;
-                        }
+                        return ret;
                     }
                 }
                 else if (sub_json.key() == "system_request_reboot")
                 {
                     actionResponse = (" Command to reboot OK");
-                    FreeRTOSV2::StartTask([](void *arg)
-                                        { std::this_thread::sleep_for(10s); esp_restart(); });
+                    TaskPool::Default().SubmitAfter(10s, []()
+                                                    { esp_restart(); });
                     return ESP_OK;
                 }
                 else if (sub_json.key() == "system_request_config")
                 {
-                    actionResponse = Config::DumpAllJsonConfig();
+                    std::lock_guard<std::mutex> guard(renderLock);
+                    actionResponse = RenderAllJson(false); // copy into the existing capacity
                     return ESP_OK;
                 }
                 else if (sub_json.key() == "system_request_status")
                 {
-                    actionResponse = Config::DumpAllJsonStatus();
+                    std::lock_guard<std::mutex> guard(renderLock);
+                    actionResponse = RenderAllJson(true);
                     return ESP_OK;
                 }
             }
@@ -295,24 +376,21 @@ esp_err_t Config::ParseJsonToConfig(const json &j_parent)
             actionResponse = "";
             for (const auto &sub_json : j_parent["config"].items()) // get sub objects : ex rgb / wifi ..etc
             {
-                const char *tag = sub_json.key().c_str(); // get json object key ( ex rgb )
-                auto &list = Config::GetListOfConfig();   // get configguration list
-                if (list.count(tag) > 0)                  // match the key in json object with a config tag
+                const char *tag = sub_json.key().c_str();           // get json object key ( ex rgb )
+                Config *targetClass = FindConfig(sub_json.key()); // match the key in json object with a config tag
+                if (targetClass != nullptr)
                 {
-                    Config *targetClass = list[tag];             // get the config class
                     const json &jsonConfig = j_parent["config"]; // pass the prespective sub json object
-                    if (targetClass != nullptr)
+                    esp_err_t ret = targetClass->SetConfigurationParameters(jsonConfig);
+                    targetClass->MarkConfigDirty();
+                    ffmt::append(actionResponse, FMT_COMPILE(" config to {} returned code {}"), tag, static_cast<int>(ret));
+                    if (ret == ESP_OK)
+                    {
+                        return ret;
+                    }
+                    else
                     {
-                        esp_err_t ret = targetClass->SetConfigurationParameters(jsonConfig);
-                        actionResponse += tools::stringf(" config to %s returned code %d", tag, static_cast<int>(ret));
-                        if (ret == ESP_OK)
-                        {
-                            return ret;
-                        }
-                        else
-                        {
-                            ESP_LOGE("Config", "target class %s could not handle data", tag);
-                        }
+                        ESP_LOGE("Config", "target class %s could not handle data", tag);
                     }
                 }
                 else
@@ -325,40 +403,99 @@ esp_err_t Config::ParseJsonToConfig(const json &j_parent)
     return ESP_FAIL;
 }
 
-std::string Config::DumpAllJsonConfig()
+/**
+ * @brief return the pre-rendered json members of this class, re-rendered only if dirty
+ *
+ * @param status true : status fragment , false : configuration fragment
+ * @return const std::string& members without the outer braces, empty if the class adds nothing
+ */
+const std::string &Config::GetFragment(bool status)
 {
-    const auto &listOfAllConfigClasses = Config::GetListOfConfig();
-    std::string retStr;
-    json FullConfig = {};
-    FullConfig["config"] = {};
-    for (const auto &conf : listOfAllConfigClasses)
+    std::string &fragment = status ? statusFragment : configFragment;
+    std::atomic<bool> &dirty = status ? statusDirty : configDirty;
+    if (!dirty && (!status || statusTracked))
     {
-        Config *_this_config = conf.second;
-        if (_this_config != nullptr)
-        {
-            _this_config->GetConfiguration(FullConfig["config"]);
-        }
+        return fragment;
     }
-    retStr = FullConfig.dump(-1, ' ', true);
-    // ESP_LOGI("config dump", "%s", retStr.c_str());
-    return retStr;
+    dirty = false; // a change made while this renders marks it again
+    json section = json::object();
+    if (status)
+    {
+        GetConfigurationStatus(section);
+    }
+    else
+    {
+        GetConfiguration(section);
+    }
+    fragment.clear();
+    if (section.is_object() && !section.empty())
+    {
+        const std::string rendered = section.dump(-1, ' ', true);
+        fragment.assign(rendered, 1, rendered.size() - 2); // strip '{' '}'
+    }
+    return fragment;
 }
 
-std::string Config::DumpAllJsonStatus()
+/**
+ * @brief splice every class fragment into the shared dump buffer
+ * must be called with renderLock held. the classes are copied out of the registry, the virtuals render
+ * without dumpLock : an override may look classes up, a class destroyed meanwhile waits for the dump
+ *
+ * @param status true : {"status":{..}} , false : {"config":{..}}
+ * @return const std::string& dumpBuffer
+ */
+const std::string &Config::RenderAllJson(bool status)
 {
-    const auto &list = Config::GetListOfConfig();
-    std::string retStr;
-    json FullStatus = {};
-    FullStatus["status"] = {};
-    for (const auto &[tag, configPointer] : list)
     {
-        Config *_this = configPointer;
-        if (_this != nullptr)
+        std::lock_guard<std::mutex> guard(dumpLock);
+        dumpList.clear(); // keeps capacity, allocates only when classes were added
+        for (const auto &listed : listOfConfig)
         {
-            _this->GetConfigurationStatus(FullStatus["status"]);
+            dumpList.push_back(listed.second);
         }
     }
-    retStr = FullStatus.dump(-1, ' ', true);
+    dumpBuffer.clear(); // keeps capacity from the previous dump
+    dumpBuffer += status ? "{\"status\":{" : "{\"config\":{";
+    bool first = true;
+    for (Config *configPointer : dumpList)
+    {
+        if (configPointer == nullptr)
+        {
+            continue;
+        }
+        try
+        {
+            const std::string &fragment = configPointer->GetFragment(status);
+            if (fragment.empty())
+            {
+                continue;
+            }
+            if (!first)
+            {
+                dumpBuffer += ',';
+            }
+            dumpBuffer += fragment;
+            first = false;
+        }
+        catch (const std::exception &e)
+        {
+            ESP_LOGE("config", "error while trying to dump %s : %s", configPointer->m_name.c_str(), e.what());
+        }
+    }
+    dumpBuffer += "}}";
+    return dumpBuffer;
+}
+
+std::string Config::DumpAllJsonConfig()
+{
+    std::lock_guard<std::mutex> guard(renderLock);
+    return RenderAllJson(false);
+}
+
+std::string Config::DumpAllJsonStatus()
+{
+    std::lock_guard<std::mutex> guard(renderLock);
+    const std::string &retStr = RenderAllJson(true);
     ESP_LOGI("status", "%s", retStr.c_str());
     return retStr;
 }
@@ -0,0 +1,126 @@
+#include "publish_coalescer.hpp"
+#include "esp_log.h"
+#include <utility>
+
+static const char TAG[] = "Coalescer";
+
+PublishCoalescer::PublishCoalescer(Sink_t _sink) : sink(std::move(_sink))
+{
+}
+
+/**
+ * @brief stage a message for the next flush
+ *
+ * @param topic
+ * @param payload
+ * @param qos
+ * @param retained
+ * @return esp_err_t ESP_ERR_INVALID_ARG if topic is empty
+ */
+esp_err_t PublishCoalescer::Stage(const std::string &topic, const std::string &payload, uint8_t qos, bool retained)
+{
+    if (topic.empty())
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    Entry_t &entry = entries[topic];
+    if (entry.pending)
+    {
+        stats.coalesced++;
+    }
+    else
+    {
+        entry.pending = true;
+        pendingCount++;
+    }
+    entry.payload.assign(payload); // reuses the capacity of the previous value
+    entry.qos = qos;
+    entry.retained = retained;
+    stats.staged++;
+    return ESP_OK;
+}
+
+/**
+ * @brief hand every pending message to the sink
+ * a message restaged while the flush runs is sent on the next flush.
+ * the pass stops at the first refusal : the client is full or offline, the rest waits
+ *
+ * @return esp_err_t ESP_OK or the sink error ( the refused message and the rest stay pending )
+ */
+esp_err_t PublishCoalescer::Flush()
+{
+    if (sink == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    std::lock_guard<std::mutex> flushGuard(flushLock);
+    esp_err_t ret = ESP_OK;
+    uint32_t sent = 0;
+    std::unique_lock<std::mutex> guard(lock);
+    for (auto &[topic, entry] : entries)
+    {
+        if (!entry.pending)
+        {
+            continue;
+        }
+        // the node stays valid : entries are only erased by Clear() which also takes flushLock
+        sendBuffer.assign(entry.payload);
+        const uint8_t qos = entry.qos;
+        const bool retained = entry.retained;
+        entry.pending = false;
+        pendingCount--;
+        guard.unlock();
+        const esp_err_t err = sink(topic, sendBuffer, qos, retained);
+        guard.lock();
+        if (err != ESP_OK)
+        {
+            stats.errors++;
+            ret = err;
+            if (!entry.pending) // not restaged meanwhile, retry on next flush
+            {
+                entry.pending = true;
+                pendingCount++;
+            }
+            break;
+        }
+        sent++;
+        stats.published++;
+        stats.bytes += sendBuffer.size();
+    }
+    if (sent)
+    {
+        stats.flushes++;
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "flush : %d message(s) left pending", static_cast<int>(pendingCount));
+    }
+    return ret;
+}
+
+void PublishCoalescer::Clear()
+{
+    std::lock_guard<std::mutex> flushGuard(flushLock);
+    std::lock_guard<std::mutex> guard(lock);
+    entries.clear();
+    pendingCount = 0;
+}
+
+size_t PublishCoalescer::Pending()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return pendingCount;
+}
+
+PublishCoalescer::Stats_t PublishCoalescer::GetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void PublishCoalescer::ResetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stats = Stats_t{};
+}
@@ -0,0 +1,226 @@
+#include "task_pool.hpp"
+#include "timer_wheel.hpp"
+#include "esp_log.h"
+#include <string>
+#include <utility>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#endif
+
+static const char TAG[] = "TaskPool";
+
+// worker running on this thread, to keep the jobs it posts local
+static thread_local TaskPool *currentPool = nullptr;
+static thread_local size_t currentIndex = 0;
+
+TaskPool::TaskPool(size_t workerCount, int stack, int prio, const char *name)
+{
+    if (workerCount == 0)
+    {
+        workerCount = 1;
+    }
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        workers.push_back(std::make_unique<Worker_t>());
+    }
+    for (size_t i = 0; i < workerCount; i++)
+    {
+#ifdef ESP_PLATFORM
+        const int core = i % portNUM_PROCESSORS;
+#else
+        const int core = 0;
+#endif
+        workers[i]->thread = std::make_unique<AladinPthread_t>(name, core, stack, prio, &TaskPool::WorkerLoop, this, i);
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(idleLock);
+        exiting = true;
+        wake.notify_all();
+    }
+    for (auto &worker : workers)
+    {
+        worker->thread->Join();
+    }
+}
+
+TaskPool &TaskPool::Default()
+{
+    static TaskPool defaultPool;
+    return defaultPool;
+}
+
+/**
+ * @brief jobs posted by a worker stay on its deque, others are spread round robin
+ */
+esp_err_t TaskPool::Post(Job_t job, Priority_t prio)
+{
+    if (job == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (exiting)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const size_t index = (currentPool == this) ? currentIndex : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    Worker_t &worker = *workers[index];
+    pending.fetch_add(1); // before the push : a taker never sees more jobs than pending, seq_cst pairs with WorkerLoop()
+    {
+        std::lock_guard<std::mutex> guard(worker.lock);
+        worker.jobs[prio].push_back(std::move(job));
+    }
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    if (sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> guard(idleLock);
+        wake.notify_one();
+    }
+    return ESP_OK;
+}
+
+bool TaskPool::PopLocal(Worker_t &worker, int prio, Job_t &job)
+{
+    std::lock_guard<std::mutex> guard(worker.lock);
+    if (worker.jobs[prio].empty())
+    {
+        return false;
+    }
+    job = std::move(worker.jobs[prio].back()); // newest : still hot in cache
+    worker.jobs[prio].pop_back();
+    return true;
+}
+
+bool TaskPool::Steal(Worker_t &worker, int prio, Job_t &job)
+{
+    std::unique_lock<std::mutex> guard(worker.lock, std::try_to_lock);
+    if (!guard.owns_lock() || worker.jobs[prio].empty())
+    {
+        return false;
+    }
+    job = std::move(worker.jobs[prio].front()); // oldest : least likely to be wanted by its owner
+    worker.jobs[prio].pop_front();
+    return true;
+}
+
+/**
+ * @brief own high, others high, own low, others low
+ */
+bool TaskPool::Take(size_t index, Job_t &job)
+{
+    for (int prio = PRIO_HIGH; prio >= PRIO_LOW; prio--)
+    {
+        if (PopLocal(*workers[index], prio, job))
+        {
+            return true;
+        }
+        for (size_t i = 1; i < workers.size(); i++)
+        {
+            if (Steal(*workers[(index + i) % workers.size()], prio, job))
+            {
+                stolen.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskPool::WorkerLoop(size_t index)
+{
+    currentPool = this;
+    currentIndex = index;
+    Job_t job{nullptr};
+    while (true)
+    {
+        if (pending.load() > 0 && Take(index, job))
+        {
+            pending.fetch_sub(1);
+            job();
+            job = nullptr; // release the captures now, not with the next job
+            executed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(idleLock);
+        if (exiting)
+        {
+            return;
+        }
+        sleeping.fetch_add(1);
+        if (pending.load() == 0)
+        {
+            sleeps.fetch_add(1, std::memory_order_relaxed);
+            wake.wait(guard, [this]()
+                      { return pending.load() > 0 || exiting.load(); });
+        }
+        sleeping.fetch_sub(1);
+    }
+}
+
+/**
+ * @brief one-shot WheelTimer per delayed job, deleted by the job itself ( the wheel waits for its callback to return ).
+ * if the pool is stopping the callback deletes it : the wheel does not touch a one-shot node after its callback
+ */
+esp_err_t TaskPool::PostAfter(int64_t delayUs, Job_t job, Priority_t prio)
+{
+    if (job == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    WheelTimer *timer = new WheelTimer("pool delay");
+    timer->setCallback([this, timer, job, prio]()
+                       {
+                           if (Post([timer, job]()
+                                    {
+                                        delete timer;
+                                        job();
+                                    },
+                                    prio) != ESP_OK)
+                           {
+                               ESP_LOGE(TAG, "delayed job dropped, pool stopping");
+                               delete timer; // last use of the captures
+                           } });
+    esp_err_t ret = timer->start_once(std::chrono::microseconds(delayUs > 0 ? delayUs : 0));
+    if (ret != ESP_OK)
+    {
+        delete timer;
+    }
+    return ret;
+}
+
+esp_err_t TaskPool::Async(std::function<void(void *)> cb, const char *tag, void *arg)
+{
+    if (cb == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = Default().Post([cb, arg]()
+                                   { cb(arg); });
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(tag, " couldn't post job %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+TaskPool::Stats_t TaskPool::GetStats() const
+{
+    Stats_t ret;
+    ret.submitted = submitted.load(std::memory_order_relaxed);
+    ret.executed = executed.load(std::memory_order_relaxed);
+    ret.stolen = stolen.load(std::memory_order_relaxed);
+    ret.sleeps = sleeps.load(std::memory_order_relaxed);
+    return ret;
+}
+
+void TaskPool::ResetStats()
+{
+    submitted.store(0, std::memory_order_relaxed);
+    executed.store(0, std::memory_order_relaxed);
+    stolen.store(0, std::memory_order_relaxed);
+    sleeps.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,614 @@
+#include "task_profiler.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+static const char TAG[] = "TaskProfiler";
+
+TaskProfiler::TaskProfiler(const Config_t &_config, Source_t _source, TimerWheel *_wheel) : config(_config),
+                                                                                           source(_source),
+                                                                                           wheel(_wheel)
+{
+    config.window = std::min<uint8_t>(std::max<uint8_t>(config.window, 1), MAX_WINDOW);
+    if (source == nullptr)
+    {
+        source = DefaultSource();
+    }
+    // everything the passes use is allocated here
+    scratch.resize(MAX_TASKS);
+    slots.resize(MAX_TASKS);
+    ring.resize(std::max(CONFIG_TASK_PROFILER_RING_RECORDS, 1));
+    raised.reserve(MAX_TASKS * 2);
+    if (wheel != nullptr)
+    {
+        timer = std::make_unique<WheelTimer>([this]()
+                                             { Sample(NowMs()); },
+                                             "task profiler", *wheel);
+    }
+}
+
+TaskProfiler::~TaskProfiler()
+{
+    // waits for a running pass
+    timer.reset();
+}
+
+esp_err_t TaskProfiler::Start()
+{
+    if (timer == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint32_t periodMs = GetConfig().periodMs;
+    return timer->start_periodic(std::chrono::milliseconds(std::max<uint32_t>(periodMs, 1)));
+}
+
+esp_err_t TaskProfiler::Stop()
+{
+    if (timer == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return timer->stop();
+}
+
+void TaskProfiler::SetAlarmFunction(AlarmFunction_t alarm)
+{
+    std::lock_guard<std::mutex> guard(passLock);
+    alarmFunction = alarm;
+}
+
+void TaskProfiler::SetPublishFunction(Publish_t _publish, const std::string &_topic)
+{
+    std::lock_guard<std::mutex> guard(passLock);
+    publish = _publish;
+    topic = _topic;
+}
+
+/**
+ * @brief uxTaskGetSystemState() into a buffer sized from uxTaskGetNumberOfTasks() ( at least MAX_TASKS ) plus
+ * TABLE_SPARE entries. it returns nothing when the table does not fit : the buffer then grows to the current
+ * count and the read is retried, so a table larger than MAX_TASKS is still counted ( truncated ), not lost
+ */
+TaskProfiler::Source_t TaskProfiler::DefaultSource()
+{
+#ifdef ESP_PLATFORM
+#if (configUSE_TRACE_FACILITY == 1)
+    const size_t size = std::max<size_t>(uxTaskGetNumberOfTasks(), MAX_TASKS) + CONFIG_TASK_PROFILER_TABLE_SPARE;
+    auto buffer = std::make_shared<std::vector<TaskStatus_t>>(size);
+    return [buffer](TaskSample_t *tasks, size_t max, uint32_t &totalRunTime) -> size_t
+    {
+        size_t count = uxTaskGetSystemState(buffer->data(), buffer->size(), &totalRunTime);
+        const size_t needed = (count == 0) ? uxTaskGetNumberOfTasks() + CONFIG_TASK_PROFILER_TABLE_SPARE : 0;
+        if (needed > buffer->size())
+        {
+            // more tasks than ever before : the only allocation after the constructor
+            ESP_LOGW(TAG, "task table of %u tasks, buffer grows", static_cast<unsigned>(needed - CONFIG_TASK_PROFILER_TABLE_SPARE));
+            buffer->resize(needed);
+            count = uxTaskGetSystemState(buffer->data(), buffer->size(), &totalRunTime);
+        }
+        for (size_t i = 0; i < count && i < max; i++)
+        {
+            const TaskStatus_t &status = (*buffer)[i];
+            TaskSample_t &task = tasks[i];
+            task.number = status.xTaskNumber;
+            strncpy(task.name, status.pcTaskName, NAME_SIZE - 1);
+            task.name[NAME_SIZE - 1] = '\0';
+            task.runTime = status.ulRunTimeCounter;
+            task.stackFree = status.usStackHighWaterMark;
+            task.state = static_cast<uint8_t>(status.eCurrentState);
+            task.priority = static_cast<uint8_t>(status.uxCurrentPriority);
+#if (configTASKLIST_INCLUDE_COREID == 1)
+            task.core = (status.xCoreID == tskNO_AFFINITY) ? -1 : static_cast<int8_t>(status.xCoreID);
+#else
+            task.core = -1;
+#endif
+        }
+        return count;
+    };
+#else
+    ESP_LOGW(TAG, "configUSE_TRACE_FACILITY is off, no task table");
+    return nullptr;
+#endif
+#else
+    return SimulatedTaskTable::Default().Source();
+#endif
+}
+
+esp_err_t TaskProfiler::Sample(uint32_t nowMs)
+{
+    std::lock_guard<std::mutex> pass(passLock);
+    if (source == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t totalRunTime = 0;
+    const size_t count = source(scratch.data(), scratch.size(), totalRunTime);
+    const size_t n = std::min(count, scratch.size());
+    bool publishNow = false;
+    bool binary = false;
+    raised.clear();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (count == 0)
+        {
+            // no table at all : not a truncation
+            if (stats.unread++ == 0)
+            {
+                ESP_LOGW(TAG, "task table could not be read");
+            }
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (count > scratch.size())
+        {
+            if (stats.truncated++ == 0)
+            {
+                ESP_LOGW(TAG, "task table of %u tasks, %u profiled", static_cast<unsigned>(count), static_cast<unsigned>(n));
+            }
+        }
+        const uint32_t sample = ++stats.samples;
+        const size_t w = sample % config.window;
+        const uint32_t totalDelta = primed ? totalRunTime - lastTotal : 0;
+        lastTotal = totalRunTime;
+        totals[w] = totalDelta;
+        lastRecords = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            Slot_t *slot = FindSlot(scratch[i]);
+            if (slot == nullptr)
+            {
+                continue; // MAX_TASKS tasks tracked already
+            }
+            Update(*slot, scratch[i], totalDelta, nowMs);
+            slot->seen = sample;
+        }
+        // tasks gone since the previous sample free their slot
+        for (Slot_t &slot : slots)
+        {
+            if (slot.used && slot.seen != sample)
+            {
+                slot.used = false;
+            }
+        }
+        primed = true;
+        const uint32_t elapsedUs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        stats.lastUs = elapsedUs;
+        stats.maxUs = std::max(stats.maxUs, elapsedUs);
+        if (elapsedUs > config.budgetUs)
+        {
+            stats.overBudget++;
+        }
+        publishNow = (publish != nullptr) && (config.publishEvery > 0) && (sample % config.publishEvery == 0);
+        binary = config.binary;
+        if (publishNow)
+        {
+            if (binary)
+            {
+                RenderBinaryLocked(payload);
+            }
+            else
+            {
+                nlohmann::json out;
+                RenderJsonLocked(out);
+                payload = out.dump();
+            }
+        }
+    }
+    if (alarmFunction != nullptr)
+    {
+        for (const auto &alarm : raised)
+        {
+            alarmFunction(alarm.first, alarm.second);
+        }
+    }
+    if (publishNow)
+    {
+        const esp_err_t ret = publish(topic, payload);
+        std::lock_guard<std::mutex> guard(lock);
+        if (ret == ESP_OK)
+        {
+            stats.published++;
+        }
+        else
+        {
+            stats.errors++;
+        }
+    }
+    return ESP_OK;
+}
+
+TaskProfiler::Slot_t *TaskProfiler::FindSlot(const TaskSample_t &task)
+{
+    Slot_t *empty = nullptr;
+    for (Slot_t &slot : slots)
+    {
+        if (slot.used && slot.info.number == task.number)
+        {
+            return &slot;
+        }
+        if (!slot.used && empty == nullptr)
+        {
+            empty = &slot;
+        }
+    }
+    if (empty != nullptr)
+    {
+        const uint8_t index = static_cast<uint8_t>(empty - slots.data());
+        memset(empty, 0, sizeof(Slot_t));
+        empty->info.number = task.number;
+        empty->info.slot = index;
+        empty->info.minStackFree = UINT32_MAX;
+        empty->lastRunTime = task.runTime; // first delta is 0
+        empty->used = true;
+    }
+    return empty;
+}
+
+void TaskProfiler::Update(Slot_t &slot, const TaskSample_t &task, uint32_t totalDelta, uint32_t nowMs)
+{
+    TaskInfo_t &info = slot.info;
+    const bool fresh = (slot.seen == 0); // found this pass, no delta yet
+    const uint32_t delta = task.runTime - slot.lastRunTime;
+    const size_t w = stats.samples % config.window;
+    slot.lastRunTime = task.runTime;
+    slot.deltas[w] = delta;
+    if (!fresh && primed && slot.filled < config.window)
+    {
+        slot.filled++;
+    }
+    // the window of a task started in it only covers the samples it was seen in
+    uint64_t windowDelta = 0;
+    uint64_t windowTotal = 0;
+    for (size_t i = 0; i < slot.filled; i++)
+    {
+        const size_t index = (w + config.window - i) % config.window;
+        windowDelta += slot.deltas[index];
+        windowTotal += totals[index];
+    }
+    const uint16_t cpu = (totalDelta > 0) ? static_cast<uint16_t>(std::min<uint64_t>(uint64_t{delta} * 1000 / totalDelta, UINT16_MAX)) : 0;
+    memcpy(info.name, task.name, NAME_SIZE);
+    info.name[NAME_SIZE - 1] = '\0';
+    info.cpu = (windowTotal > 0) ? static_cast<uint16_t>(std::min<uint64_t>(windowDelta * 1000 / windowTotal, UINT16_MAX)) : 0;
+    info.peakCpu = std::max(info.peakCpu, cpu);
+    info.stackFree = task.stackFree;
+    info.minStackFree = std::min(info.minStackFree, task.stackFree);
+    info.state = task.state;
+    info.priority = task.priority;
+    info.core = task.core;
+    uint8_t alarms = 0;
+    if (config.stackAlarm > 0 && task.stackFree < config.stackAlarm)
+    {
+        alarms |= ALARM_STACK;
+    }
+    if (config.cpuAlarm > 0 && info.cpu > config.cpuAlarm * 10U)
+    {
+        alarms |= ALARM_CPU;
+    }
+    const uint8_t rising = alarms & ~info.alarms;
+    info.alarms = alarms;
+    for (const Alarm_t alarm : {ALARM_STACK, ALARM_CPU})
+    {
+        if ((rising & alarm) != 0)
+        {
+            stats.alarms++;
+            raised.emplace_back(info, alarm);
+        }
+    }
+    if (!primed)
+    {
+        return; // no run time delta yet
+    }
+    Push(Record_t{nowMs, delta, task.stackFree, cpu, info.slot, task.state});
+}
+
+void TaskProfiler::Push(const Record_t &record)
+{
+    ring[ringHead] = record;
+    ringHead = (ringHead + 1) % ring.size();
+    ringCount = std::min(ringCount + 1, ring.size());
+    lastRecords++;
+    stats.records++;
+}
+
+size_t TaskProfiler::GetTasks(TaskInfo_t *tasks, size_t max)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t n = 0;
+    for (const Slot_t &slot : slots)
+    {
+        if (slot.used && n < max)
+        {
+            tasks[n++] = slot.info;
+        }
+    }
+    return n;
+}
+
+size_t TaskProfiler::GetRecords(Record_t *records, size_t max, uint32_t sinceMs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t n = 0;
+    for (size_t i = 0; i < ringCount && n < max; i++)
+    {
+        const Record_t &record = ring[(ringHead + ring.size() - ringCount + i) % ring.size()];
+        if (sinceMs == 0 || static_cast<int32_t>(record.timeMs - sinceMs) > 0)
+        {
+            records[n++] = record;
+        }
+    }
+    return n;
+}
+
+void TaskProfiler::RenderJson(nlohmann::json &out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    RenderJsonLocked(out);
+}
+
+void TaskProfiler::RenderJsonLocked(nlohmann::json &out)
+{
+    nlohmann::json tasks = nlohmann::json::array();
+    for (const Slot_t &slot : slots)
+    {
+        if (!slot.used)
+        {
+            continue;
+        }
+        const TaskInfo_t &info = slot.info;
+        tasks.push_back(nlohmann::json::array({std::string(info.name), info.cpu, info.peakCpu, info.stackFree, info.minStackFree,
+                                               info.state, info.priority, info.core, info.alarms}));
+    }
+    out = {
+        {"period", config.periodMs},
+        {"samples", stats.samples},
+        {"us", stats.lastUs},
+        {"max_us", stats.maxUs},
+        {"over", stats.overBudget},
+        {"tasks", std::move(tasks)},
+    };
+}
+
+void TaskProfiler::RenderBinary(std::string &out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    RenderBinaryLocked(out);
+}
+
+void TaskProfiler::RenderBinaryLocked(std::string &out)
+{
+    const uint16_t records = static_cast<uint16_t>(std::min<size_t>(lastRecords, ringCount));
+    uint8_t count = 0;
+    for (const Slot_t &slot : slots)
+    {
+        count += slot.used ? 1 : 0;
+    }
+    out.clear();
+    out.append("TPRF", 4);
+    out.push_back(1);
+    out.push_back(static_cast<char>(count));
+    out.append(reinterpret_cast<const char *>(&records), 2);
+    for (const Slot_t &slot : slots)
+    {
+        if (!slot.used)
+        {
+            continue;
+        }
+        const TaskInfo_t &info = slot.info;
+        out.push_back(static_cast<char>(info.slot));
+        out.push_back(static_cast<char>(info.alarms));
+        out.append(reinterpret_cast<const char *>(&info.cpu), 2);
+        out.append(reinterpret_cast<const char *>(&info.minStackFree), 4);
+        out.append(info.name, NAME_SIZE);
+    }
+    for (size_t i = records; i > 0; i--)
+    {
+        const Record_t &record = ring[(ringHead + ring.size() - i) % ring.size()];
+        out.append(reinterpret_cast<const char *>(&record), sizeof(Record_t));
+    }
+}
+
+uint32_t TaskProfiler::NowMs() const
+{
+    if (wheel != nullptr)
+    {
+        return static_cast<uint32_t>(wheel->NowUs() / 1000);
+    }
+#ifdef ESP_PLATFORM
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+#else
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+TaskProfiler::Config_t TaskProfiler::GetConfig()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return config;
+}
+
+void TaskProfiler::SetConfig(const Config_t &_config)
+{
+    bool restart = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const uint8_t window = std::min<uint8_t>(std::max<uint8_t>(_config.window, 1), MAX_WINDOW);
+        if (window != config.window)
+        {
+            // the rolling cpu starts over
+            memset(totals, 0, sizeof(totals));
+            for (Slot_t &slot : slots)
+            {
+                memset(slot.deltas, 0, sizeof(slot.deltas));
+                slot.filled = 0;
+            }
+        }
+        restart = (_config.periodMs != config.periodMs);
+        config = _config;
+        config.window = window;
+    }
+    if (restart && timer != nullptr && timer->is_active())
+    {
+        Start();
+    }
+}
+
+TaskProfiler::Stats_t TaskProfiler::GetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void TaskProfiler::ResetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const uint32_t samples = stats.samples; // the rolling windows are indexed by it
+    stats = Stats_t{};
+    stats.samples = samples;
+}
+
+SimulatedTaskTable::SimulatedTaskTable(bool _realTime) : realTime(_realTime)
+{
+}
+
+SimulatedTaskTable &SimulatedTaskTable::Default()
+{
+    static SimulatedTaskTable table(true);
+    static std::once_flag populated;
+    std::call_once(populated, []()
+                   {
+                       // an idle device : the idle tasks take what the others leave
+                       table.Add("IDLE0", 0, 600, 0.86f, 0);
+                       table.Add("IDLE1", 0, 600, 0.93f, 1);
+                       table.Add("main", 1, 1400, 0.01f, 0);
+                       table.Add("esp_timer", 22, 2200, 0.02f, 0);
+                       table.Add("wifi", 23, 1800, 0.07f, 0);
+                       table.Add("tiT", 18, 1200, 0.03f, -1);
+                       table.Add("mqtt_task", 5, 2600, 0.02f, -1);
+                       table.Add("pool0", 5, 3100, 0.02f, 0);
+                       table.Add("pool1", 5, 3100, 0.02f, 1);
+                   });
+    return table;
+}
+
+size_t SimulatedTaskTable::Add(const char *name, uint8_t priority, uint32_t stackFree, float load, int8_t core)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Task_t task{};
+    task.sample.number = nextNumber++;
+    strncpy(task.sample.name, name, TaskProfiler::NAME_SIZE - 1);
+    task.sample.stackFree = stackFree;
+    task.sample.state = 1; // eReady
+    task.sample.priority = priority;
+    task.sample.core = core;
+    task.load = load;
+    task.alive = true;
+    tasks.push_back(task);
+    return tasks.size() - 1;
+}
+
+esp_err_t SimulatedTaskTable::Remove(size_t id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (id >= tasks.size() || !tasks[id].alive)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tasks[id].alive = false;
+    return ESP_OK;
+}
+
+esp_err_t SimulatedTaskTable::SetLoad(size_t id, float load)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (id >= tasks.size())
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tasks[id].load = load;
+    return ESP_OK;
+}
+
+esp_err_t SimulatedTaskTable::SetStackFree(size_t id, uint32_t stackFree)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (id >= tasks.size())
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tasks[id].sample.stackFree = stackFree;
+    return ESP_OK;
+}
+
+esp_err_t SimulatedTaskTable::SetState(size_t id, uint8_t state)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (id >= tasks.size())
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tasks[id].sample.state = state;
+    return ESP_OK;
+}
+
+void SimulatedTaskTable::Advance(uint32_t us)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    AdvanceLocked(us);
+}
+
+void SimulatedTaskTable::AdvanceLocked(uint64_t us)
+{
+    totalUs += us;
+    for (Task_t &task : tasks)
+    {
+        if (task.alive)
+        {
+            task.runTime += task.load * us;
+            task.sample.runTime = static_cast<uint32_t>(static_cast<uint64_t>(task.runTime));
+        }
+    }
+}
+
+size_t SimulatedTaskTable::Read(TaskProfiler::TaskSample_t *samples, size_t max, uint32_t &totalRunTime)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (realTime)
+    {
+        const uint64_t nowUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        if (lastUs != 0)
+        {
+            AdvanceLocked(nowUs - lastUs);
+        }
+        lastUs = nowUs;
+    }
+    totalRunTime = static_cast<uint32_t>(totalUs);
+    size_t count = 0;
+    for (const Task_t &task : tasks)
+    {
+        if (!task.alive)
+        {
+            continue;
+        }
+        if (count < max)
+        {
+            samples[count] = task.sample;
+        }
+        count++;
+    }
+    return count;
+}
+
+TaskProfiler::Source_t SimulatedTaskTable::Source()
+{
+    return [this](TaskProfiler::TaskSample_t *samples, size_t max, uint32_t &totalRunTime)
+    { return Read(samples, max, totalRunTime); };
+}
@@ -0,0 +1,20 @@
+#include "task_profiler_status.hpp"
+
+constexpr char TaskProfilerStatus::TAG[];
+
+TaskProfilerStatus::TaskProfilerStatus(TaskProfiler &_profiler) : Config(TAG), profiler(_profiler)
+{
+}
+
+esp_err_t TaskProfilerStatus::GetConfigurationStatus(json &config_out) const
+{
+    try
+    {
+        profiler.RenderJson(config_out[TAG]);
+        return ESP_OK;
+    }
+    catch (const std::exception &e)
+    {
+        return ESP_FAIL;
+    }
+}
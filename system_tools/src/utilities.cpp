@@ -18,47 +18,20 @@
 #include <soc/soc.h>
 #endif
 #include "utilities.hpp"
+#include "base64.hpp"
+#include "fast_format.hpp"
+#include "text_tools.hpp"
 #include "stdarg.h"
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <math.h>
 #include <memory>
-#include <sstream>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-static const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-"abcdefghijklmnopqrstuvwxyz"
-"0123456789+/";
-
-static int base64EncodedLength(size_t length)
-{
-	return (length + 2 - ((length + 2) % 3)) / 3 * 4;
-} // base64EncodedLength
-
-static int base64EncodedLength(const std::string& in)
-{
-	return base64EncodedLength(in.length());
-} // base64EncodedLength
-
-static void a3_to_a4(unsigned char* a4, unsigned char* a3)
-{
-	a4[0] = (a3[0] & 0xfc) >> 2;
-	a4[1] = ((a3[0] & 0x03) << 4) + ((a3[1] & 0xf0) >> 4);
-	a4[2] = ((a3[1] & 0x0f) << 2) + ((a3[2] & 0xc0) >> 6);
-	a4[3] = (a3[2] & 0x3f);
-} // a3_to_a4
-
-static void a4_to_a3(unsigned char* a3, unsigned char* a4)
-{
-	a3[0] = (a4[0] << 2) + ((a4[1] & 0x30) >> 4);
-	a3[1] = ((a4[1] & 0xf) << 4) + ((a4[2] & 0x3c) >> 2);
-	a3[2] = ((a4[2] & 0x3) << 6) + a4[3];
-} // a4_to_a3
-
 tools::TimeDate_t tools::GetSystemTimeDate()
 {
 	time_t now;
@@ -82,53 +55,10 @@ tools::TimeDate_t tools::GetSystemTimeDate()
  */
 bool tools::base64Encode(const std::string& in, std::string* out)
 {
-	int i = 0, j = 0;
-	size_t enc_len = 0;
-	unsigned char a3[3];
-	unsigned char a4[4];
-
-	out->resize(base64EncodedLength(in));
-
-	int input_len = in.size();
-	std::string::const_iterator input = in.begin();
-
-	while (input_len--)
-	{
-		a3[i++] = *(input++);
-		if (i == 3)
-		{
-			a3_to_a4(a4, a3);
-
-			for (i = 0; i < 4; i++)
-			{
-				(*out)[enc_len++] = kBase64Alphabet[a4[i]];
-			}
-
-			i = 0;
-		}
-	}
-
-	if (i)
-	{
-		for (j = i; j < 3; j++)
-		{
-			a3[j] = '\0';
-		}
-
-		a3_to_a4(a4, a3);
-
-		for (j = 0; j < i + 1; j++)
-		{
-			(*out)[enc_len++] = kBase64Alphabet[a4[j]];
-		}
-
-		while ((i++ < 3))
-		{
-			(*out)[enc_len++] = '=';
-		}
-	}
-
-	return (enc_len == out->size());
+	size_t written = 0;
+	out->resize(Base64::EncodedLength(in.size()));
+	const esp_err_t ret = Base64::Encode(in, &(*out)[0], out->size(), &written);
+	return (ret == ESP_OK && written == out->size());
 } // base64Encode
 
 /**
@@ -181,11 +111,10 @@ multi_heap_info_t tools::GetHeapInfo(uint8_t type)
  */
 std::string tools::dumpHeapInfo(uint8_t type)
 {
-	multi_heap_info_t heapInfo;
-
-	char* buf;
 	std::string strRet("");
 #ifdef ESP_PLATFORM
+	multi_heap_info_t heapInfo;
+	char* buf;
 
 	switch (type)
 	{
@@ -253,97 +182,19 @@ bool tools::endsWith(std::string str, char c)
 	return false;
 } // endsWidth
 
-static int DecodedLength(const std::string& in)
-{
-	int numEq = 0;
-	int n = (int)in.size();
-
-	for (std::string::const_reverse_iterator it = in.rbegin(); *it == '='; ++it)
-	{
-		++numEq;
-	}
-	return ((6 * n) / 8) - numEq;
-} // DecodedLength
-
-static unsigned char b64_lookup(unsigned char c)
-{
-	if (c >= 'A' && c <= 'Z')
-		return c - 'A';
-	if (c >= 'a' && c <= 'z')
-		return c - 71;
-	if (c >= '0' && c <= '9')
-		return c + 4;
-	if (c == '+')
-		return 62;
-	if (c == '/')
-		return 63;
-	return 255;
-}; // b64_lookup
-
 /**
  * @brief Decode a chunk of data that is base64 encoded.
+ * whitespace is skipped and padding is optional ( Base64::LENIENT ), a bad character fails.
  * @param [in] in The string to be decoded.
  * @param [out] out The resulting data.
  */
 bool tools::base64Decode(const std::string& in, std::string* out)
 {
-	int i = 0, j = 0;
-	size_t dec_len = 0;
-	unsigned char a3[3];
-	unsigned char a4[4];
-
-	int input_len = in.size();
-	std::string::const_iterator input = in.begin();
-
-	out->resize(DecodedLength(in));
-
-	while (input_len--)
-	{
-		if (*input == '=')
-		{
-			break;
-		}
-
-		a4[i++] = *(input++);
-		if (i == 4)
-		{
-			for (i = 0; i < 4; i++)
-			{
-				a4[i] = b64_lookup(a4[i]);
-			}
-
-			a4_to_a3(a3, a4);
-
-			for (i = 0; i < 3; i++)
-			{
-				(*out)[dec_len++] = a3[i];
-			}
-
-			i = 0;
-		}
-	}
-
-	if (i)
-	{
-		for (j = i; j < 4; j++)
-		{
-			a4[j] = '\0';
-		}
-
-		for (j = 0; j < 4; j++)
-		{
-			a4[j] = b64_lookup(a4[j]);
-		}
-
-		a4_to_a3(a3, a4);
-
-		for (j = 0; j < i - 1; j++)
-		{
-			(*out)[dec_len++] = a3[j];
-		}
-	}
-
-	return (dec_len == out->size());
+	size_t written = 0;
+	out->resize(Base64::DecodedLength(in.size()));
+	const esp_err_t ret = Base64::Decode(in, reinterpret_cast<uint8_t*>(&(*out)[0]), out->size(), &written, Base64::LENIENT);
+	out->resize(written);
+	return (ret == ESP_OK);
 } // base64Decode
 
 /**
@@ -353,9 +204,7 @@ bool tools::base64Decode(const std::string& in, std::string* out)
  */
 std::string tools::ipToString(uint8_t* ip)
 {
-	std::stringstream s;
-	s << (int)ip[0] << '.' << (int)ip[1] << '.' << (int)ip[2] << '.' << (int)ip[3];
-	return s.str();
+	return ffmt::format(FMT_COMPILE("{}.{}.{}.{}"), ip[0], ip[1], ip[2], ip[3]);
 } // ipToString
 
 /**
@@ -365,7 +214,7 @@ std::string tools::ipToString(uint8_t* ip)
  */
 std::string tools::ipToString(const esp_ip4_addr_t& ipadd)
 {
-	return tools::stringf(IPSTR, IP2STR(&ipadd));
+	return ffmt::format(FMT_COMPILE("{}.{}.{}.{}"), IP2STR(&ipadd));
 } // ipToString
 
 /**
@@ -426,15 +275,13 @@ void tools::hexDump(const uint8_t* pData, uint32_t length)
  * @param [in] delimiter The delimiter characters.
  * @return A vector of strings that are the split of the input.
  */
-std::vector<std::string> tools::split(std::string source, char delimiter)
+std::vector<std::string> tools::split(std::string_view source, char delimiter)
 {
-	// See also: https://stackoverflow.com/questions/5167625/splitting-a-c-stdstring-using-tokens-e-g
+	// text::Split walks the views in place, only the kept parts are copied
 	std::vector<std::string> strings;
-	std::istringstream iss(source);
-	std::string s;
-	while (std::getline(iss, s, delimiter))
+	for (const std::string_view part : text::Split(source, delimiter))
 	{
-		strings.push_back(trim(s));
+		strings.emplace_back(text::Trim(part, " "));
 	}
 	return strings;
 } // split
@@ -469,19 +316,15 @@ bool tools::IsValidUrl(const std::string& str)
  */
 std::string tools::toLower(std::string& value)
 {
-	// Question: Could this be improved with a signature of:
-	// std::string& tools::toLower(std::string& value)
-	std::transform(value.begin(), value.end(), value.begin(), ::tolower);
-	return value;
+	// text::ToLowerInPlace when the copy is not needed
+	return text::ToLowerInPlace(value);
 } // toLower
 
 std::string tools::trim(const std::string& str)
 {
-	size_t first = str.find_first_not_of(' ');
-	if (std::string::npos == first)
+	if (str.find_first_not_of(' ') == std::string::npos)
 		return str;
-	size_t last = str.find_last_not_of(' ');
-	return str.substr(first, (last - first + 1));
+	return std::string(text::Trim(str, " "));
 } // trim
 
 #ifdef ESP_PLATFORM
@@ -750,24 +593,26 @@ uint64_t tools::getEfuseMac(void)
 
 #endif // #ifdef ESP_PLATFORM
 
+/**
+ * @brief printf to a string : one vsnprintf into a stack buffer, a second one only for longer texts.
+ * constant formats of the hot paths use ffmt ( fast_format.hpp ) instead
+ */
 std::string tools::stringf(const std::string fmt_str, ...)
 {
-	int final_n, n = ((int)fmt_str.size()) * 2; /* Reserve two times as much as the length of the fmt_str */
-	std::unique_ptr<char[]> formatted;
+	char stackBuffer[128];
 	va_list ap;
-	while (1)
-	{
-		formatted.reset(new char[n]); /* Wrap the plain char array into the unique_ptr */
-		strcpy(&formatted[0], fmt_str.c_str());
-		va_start(ap, fmt_str);
-		final_n = vsnprintf(&formatted[0], n, fmt_str.c_str(), ap);
-		va_end(ap);
-		if (final_n < 0 || final_n >= n)
-			n += abs(final_n - n + 1);
-		else
-			break;
-	}
-	return std::string(formatted.get());
+	va_start(ap, fmt_str);
+	const int n = vsnprintf(stackBuffer, sizeof(stackBuffer), fmt_str.c_str(), ap);
+	va_end(ap);
+	if (n < 0)
+		return std::string();
+	if (static_cast<size_t>(n) < sizeof(stackBuffer))
+		return std::string(stackBuffer, n);
+	std::string formatted(n, '\0');
+	va_start(ap, fmt_str);
+	vsnprintf(&formatted[0], n + 1, fmt_str.c_str(), ap);
+	va_end(ap);
+	return formatted;
 }
 
 bool tools::CompareBssid(const char bssid[18], const char bssid2[18])
@@ -837,6 +682,25 @@ unsigned int tools::makeWord(unsigned char h, unsigned char l)
 	return (h << 8) | l;
 }
 
+/**
+ * @brief atoi / atol / atof through text::To ( from_chars ) : no locale, no errno,
+ * leading whitespace and trailing text ignored, 0 when there is no number or it does not fit
+ */
+int tools::atoi(const char* s)
+{
+	return (s == nullptr) ? 0 : text::To<int>(s);
+}
+
+long tools::atol(const char* s)
+{
+	return (s == nullptr) ? 0 : text::To<long>(s);
+}
+
+double tools::atof(const char* s)
+{
+	return (s == nullptr) ? 0 : text::To<double>(s);
+}
+
 void tools::reverse(char* begin, char* end)
 {
 	char* is = begin;
@@ -917,16 +781,14 @@ void tools::macstr_to_uint(const char* str, uint8_t bssid[6])
 }
 std::string tools::MacToStr(const uint8_t mac[6], uint8_t count, bool format)
 {
+	ffmt::Buffer<18> bssidStr;
+	for (uint8_t i = 6 - count; i < 6; i++)
 	{
-		std::string bssidStr = "";
-		for (uint8_t i = 6 - count; i < 6; i++)
-		{
-			bssidStr += tools::stringf("%02X", mac[i]);
-			if (format && i < 5)
-				bssidStr += ":";
-		}
-		return bssidStr;
+		ffmt::format_to(bssidStr, FMT_COMPILE("{:02X}"), mac[i]);
+		if (format && i < 5)
+			bssidStr.push_back(':');
 	}
+	return std::string(bssidStr.data(), bssidStr.size());
 }
 
 char* tools::dtostrf(double number, signed char width, unsigned char prec, char* s)
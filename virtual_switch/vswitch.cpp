@@ -2,7 +2,7 @@
 #include "driver/gpio.h"
 #include <string>
 #include <cstdlib>
-#include "nvs_tools.h"
+#include "nvs_cache.h"
 
 vswitch_t::vswitch_t(const std::string& _name) : Config(TAG), name(_name)
 {
@@ -15,7 +15,11 @@ vswitch_t::~vswitch_t()
 
 void vswitch_t::Set(bool val)
 {
-    this->status = val;
+    if (this->status != val)
+    {
+        this->status = val;
+        MarkConfigDirty(); // status is part of GetConfiguration
+    }
 }
 
 
@@ -58,25 +62,13 @@ esp_err_t vswitch_t::SetConfigurationParameters(const json& config_in)
 
 esp_err_t vswitch_t::SaveToNVS()
 {
-    auto nvs = OPEN_NVS_W(this->TAG);
-    esp_err_t ret = ESP_FAIL;
-    if (nvs->isOpen())
-    {
-        ret = nvs->set("status", status);
-    }
-    return ret;
+    return NvsCache::Default().set(this->TAG, "status", status);
 }
 
 
 esp_err_t vswitch_t::LoadFromNVS()
 {
-    auto nvs = OPEN_NVS(this->TAG);
-    esp_err_t ret = ESP_FAIL;
-    if (nvs->isOpen())
-    {
-        ret = nvs->get("status", status);
-    }
-    return ret;
+    return NvsCache::Default().get(this->TAG, "status", status);
 }
 //CONFIG OVERRIDE
 esp_err_t vswitch_t::GetConfiguration(json& config_out) const
@@ -97,6 +89,7 @@ esp_err_t vswitch_t::GetConfiguration(json& config_out) const
 esp_err_t vswitch_t::RestoreDefault()
 {
     status = false;
+    MarkConfigDirty();
     return SaveToNVS();
 }
 